@@ -21,7 +21,8 @@ class AggregatorExecutionContext
 {
 public:
     AggregatorExecutionContext(std::size_t p_totalServerNumber,
-                               Socket::PacketHeader p_requestHeader);
+                               Socket::PacketHeader p_requestHeader,
+                               SizeType p_resultNum);
 
     ~AggregatorExecutionContext();
 
@@ -33,6 +34,8 @@ public:
 
     bool IsCompletedAfterFinsh(std::uint32_t p_finishedCount);
 
+    SizeType GetResultNum() const;
+
 private:
     std::atomic<std::uint32_t> m_unfinishedCount;
 
@@ -40,6 +43,8 @@ private:
 
     Socket::PacketHeader m_requestHeader;
 
+    SizeType m_resultNum;
+
 };
 
 
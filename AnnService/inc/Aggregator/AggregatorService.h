@@ -33,6 +33,17 @@ public:
 
     void Run();
 
+    // Merges the answers of all partition servers into one list of p_resultNum results per index name.
+    // Servers that failed or timed out (nullptr or a status other than Success) are left out.
+    static void MergeServerResults(const std::vector<AggregatorResult>& p_serverResults,
+                                   SizeType p_resultNum,
+                                   Socket::RemoteSearchResult& p_merged);
+
+    // Merges the lists of one index from several partitions into its global top p_resultNum.
+    static void MergeResults(const std::vector<const Socket::IndexSearchResult*>& p_partitions,
+                             SizeType p_resultNum,
+                             Socket::IndexSearchResult& p_merged);
+
 private:
 
     void StartClient();
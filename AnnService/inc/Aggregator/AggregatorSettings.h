@@ -34,6 +34,9 @@ struct AggregatorSettings
 	SizeType m_topK;
 
 	DistCalcMethod m_distMethod;
+
+    // Size of the merged result list when the query has no "resultnum" option.
+    SizeType m_defaultMaxResultNumber;
 };
 
 
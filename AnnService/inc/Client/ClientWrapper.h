@@ -28,6 +28,8 @@ class ClientWrapper
 public:
     typedef std::function<void(Socket::RemoteSearchResult)> Callback;
 
+    typedef std::function<void(Socket::RemoteBatchSearchResult)> BatchCallback;
+
     ClientWrapper(const ClientOptions& p_options);
 
     ~ClientWrapper();
@@ -36,6 +38,11 @@ public:
                         Callback p_callback,
                         const ClientOptions& p_options);
 
+    // Sends all vectors of p_query in one BatchSearchRequest packet; p_callback gets one result per query.
+    void SendBatchQueryAsync(const Socket::RemoteBatchQuery& p_query,
+                             BatchCallback p_callback,
+                             const ClientOptions& p_options);
+
     void WaitAllFinished();
 
     bool IsAvailable() const;
@@ -51,6 +58,8 @@ private:
 
     void SearchResponseHanlder(Socket::ConnectionID p_localConnectionID, Socket::Packet p_packet);
 
+    void BatchSearchResponseHanlder(Socket::ConnectionID p_localConnectionID, Socket::Packet p_packet);
+
     void HandleDeadConnection(Socket::ConnectionID p_cid);
 
 private:
@@ -71,6 +80,8 @@ private:
     std::atomic<std::uint32_t> m_spinCountOfConnection;
 
     Socket::ResourceManager<Callback> m_callbackManager;
+
+    Socket::ResourceManager<BatchCallback> m_batchCallbackManager;
 };
 
 
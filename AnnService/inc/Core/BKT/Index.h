@@ -14,12 +14,14 @@
 #include "../Common/WorkSpace.h"
 #include "../Common/WorkSpacePool.h"
 #include "../Common/RelativeNeighborhoodGraph.h"
+#include "../Common/CompressedGraph.h"
 #include "../Common/BKTree.h"
 #include "../Common/Labelset.h"
 #include "inc/Helper/SimpleIniReader.h"
 #include "inc/Helper/StringConvert.h"
 #include "inc/Helper/ThreadPool.h"
 
+#include <atomic>
 #include <functional>
 #include <shared_mutex>
 
@@ -39,15 +41,26 @@ namespace SPTAG
             class RebuildJob : public Helper::ThreadPool::Job {
             public:
                 RebuildJob(COMMON::Dataset<T>* p_data, COMMON::BKTree* p_tree, COMMON::RelativeNeighborhoodGraph* p_graph, 
-                    DistCalcMethod p_distMethod) : m_data(p_data), m_tree(p_tree), m_graph(p_graph), m_distMethod(p_distMethod) {}
+                    DistCalcMethod p_distMethod, std::shared_ptr<COMMON::IQuantizer> p_quantizer) : m_data(p_data), m_tree(p_tree), m_graph(p_graph), m_distMethod(p_distMethod), m_quantizer(p_quantizer) {}
                 void exec(IAbortOperation* p_abort) {
-                    m_tree->Rebuild<T>(*m_data, m_distMethod, p_abort);
+                    m_tree->Rebuild<T>(*m_data, m_distMethod, m_quantizer, p_abort);
                 }
             private:
                 COMMON::Dataset<T>* m_data;
                 COMMON::BKTree* m_tree;
                 COMMON::RelativeNeighborhoodGraph* m_graph;
                 DistCalcMethod m_distMethod;
+                std::shared_ptr<COMMON::IQuantizer> m_quantizer;
+            };
+
+            class RepairJob : public Helper::ThreadPool::Job {
+            public:
+                RepairJob(Index<T>* p_index) : m_index(p_index) {}
+                void exec(IAbortOperation* p_abort) {
+                    m_index->ConsolidateDeletes(p_abort);
+                }
+            private:
+                Index<T>* m_index;
             };
 
         private:
@@ -60,30 +73,55 @@ namespace SPTAG
             // Graph structure
             COMMON::RelativeNeighborhoodGraph m_pGraph;
 
+            // Read-only packed copy of m_pGraph, which is then emptied; unused unless m_iCompressGraph is set
+            COMMON::CompressedGraph m_pCompressedGraph;
+
             std::string m_sBKTFilename;
             std::string m_sGraphFilename;
             std::string m_sDataPointsFilename;
             std::string m_sDeleteDataPointsFilename;
+            std::string m_sIDMappingFilename;
 
             int m_addCountForRebuild;
+            int m_iAddNumberOfThreads;
+            int m_iAddBatchCandidates;
             float m_fDeletePercentageForRefine;
             std::mutex m_dataAddLock; // protect data and graph
             std::shared_timed_mutex m_dataDeleteLock;
             COMMON::Labelset m_deletedID;
 
+            // Deleted ids no neighbor list links to any more, which AddIndexRecycled hands out again.
+            int m_iDeleteRepairThreshold;
+            std::atomic<SizeType> m_deletesSinceRepair;
+            std::atomic<bool> m_repairQueued;
+            std::atomic<bool> m_deletesConsolidated;
+            std::mutex m_repairLock; // one consolidation at a time
+            std::mutex m_recycleLock; // protect m_recycleIDs
+            std::vector<SizeType> m_recycleIDs;
+
+            // Row i holds the external id of internal id i and the internal id of external id i. Empty unless
+            // the build renumbered the vectors; ids past its end are the same on both sides.
+            COMMON::Dataset<SizeType> m_pIDMapping;
+            int m_iReorderIDs;
+            int m_iCoLocateGraph;
+            int m_iCompressGraph;
+
             std::unique_ptr<COMMON::WorkSpacePool<COMMON::WorkSpace>> m_workSpacePool;
             Helper::ThreadPool m_threadPool;
             int m_iNumberOfThreads;
 
             DistCalcMethod m_iDistCalcMethod;
-            float(*m_fComputeDistance)(const T* pX, const T* pY, DimensionType length);
+            COMMON::DistanceCalcFunc<T> m_fComputeDistance;
             int m_iBaseSquare;
 
             int m_iMaxCheck;        
+            int m_iSearchInterleave;
             int m_iThresholdOfNumberOfContinuousNoBetterPropagation;
             int m_iNumberOfInitialDynamicPivots;
             int m_iNumberOfOtherDynamicPivots;
             int m_iHashTableExp;
+            SizeType m_iVisitedTableLimit;
+            int m_iHugePages;
 
         public:
             Index()
@@ -94,9 +132,12 @@ namespace SPTAG
 #include "inc/Core/BKT/ParameterDefinitionList.h"
 #undef DefineBKTParameter
 
+                m_deletesSinceRepair = 0;
+                m_repairQueued = false;
+                m_deletesConsolidated = false;
                 m_pSamples.SetName("Vector");
-                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod);
-                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+                m_pIDMapping.SetName("IDMapping");
+                BindDistanceFunction();
             }
 
             ~Index() {}
@@ -110,6 +151,12 @@ namespace SPTAG
             inline DistCalcMethod GetDistCalcMethod() const { return m_iDistCalcMethod; }
             inline IndexAlgoType GetIndexAlgoType() const { return IndexAlgoType::BKT; }
             inline VectorValueType GetVectorValueType() const { return GetEnumValueType<T>(); }
+
+            inline void SetQuantizer(std::shared_ptr<COMMON::IQuantizer> p_quantizer)
+            {
+                m_pQuantizer = p_quantizer;
+                BindDistanceFunction();
+            }
             
             inline float AccurateDistance(const void* pX, const void* pY) const { 
                 if (m_iDistCalcMethod == DistCalcMethod::L2) return m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C());
@@ -120,16 +167,18 @@ namespace SPTAG
                 return 1.0f - xy / (sqrt(xx) * sqrt(yy));
             }
             inline float ComputeDistance(const void* pX, const void* pY) const { return m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C()); }
-            inline const void* GetSample(const SizeType idx) const { return (void*)m_pSamples[idx]; }
-            inline bool ContainSample(const SizeType idx) const { return !m_deletedID.Contains(idx); }
-            inline bool NeedRefine() const { return m_deletedID.Count() > (size_t)(GetNumSamples() * m_fDeletePercentageForRefine); }
+            inline const void* GetSample(const SizeType idx) const { return (void*)m_pSamples[ToInternalID(idx)]; }
+            inline const void* GetInternalSample(const SizeType idx) const { return (void*)m_pSamples[idx]; }
+            inline bool ContainSample(const SizeType idx) const { return !m_deletedID.Contains(ToInternalID(idx)); }
+            inline bool NeedRefine() const { return !IsGraphCompressed() && m_deletedID.Count() > (size_t)(GetNumSamples() * m_fDeletePercentageForRefine); }
             std::shared_ptr<std::vector<std::uint64_t>> BufferSize() const
             {
                 std::shared_ptr<std::vector<std::uint64_t>> buffersize(new std::vector<std::uint64_t>);
                 buffersize->push_back(m_pSamples.BufferSize());
                 buffersize->push_back(m_pTrees.BufferSize());
-                buffersize->push_back(m_pGraph.BufferSize());
+                buffersize->push_back(IsGraphCompressed() ? m_pCompressedGraph.BufferSize() : m_pGraph.BufferSize());
                 buffersize->push_back(m_deletedID.BufferSize());
+                if (HasIDMapping()) buffersize->push_back(m_pIDMapping.BufferSize());
                 return std::move(buffersize);
             }
 
@@ -140,6 +189,7 @@ namespace SPTAG
                 files->push_back(m_sBKTFilename);
                 files->push_back(m_sGraphFilename);
                 files->push_back(m_sDeleteDataPointsFilename);
+                if (HasIDMapping()) files->push_back(m_sIDMappingFilename);
                 return std::move(files);
             }
 
@@ -152,11 +202,15 @@ namespace SPTAG
 
             ErrorCode BuildIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, bool p_normalized = false);
             ErrorCode SearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const;
+            ErrorCode SearchIndex(QueryResult* p_queries, int p_queryCount, bool p_searchDeleted = false, int p_threadNum = 0) const;
+            ErrorCode SearchIndexWithFilter(QueryResult &p_query, const std::function<bool(SizeType)>& p_filter, bool p_searchDeleted = false) const;
             ErrorCode RefineSearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const;
             ErrorCode SearchTree(QueryResult &p_query) const;
             ErrorCode AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex = false, bool p_normalized = false);
             ErrorCode DeleteIndex(const void* p_vectors, SizeType p_vectorNum);
             ErrorCode DeleteIndex(const SizeType& p_id);
+            ErrorCode ConsolidateDeletes(IAbortOperation* p_abort = nullptr);
+            ErrorCode AddIndexRecycled(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::vector<SizeType>& p_ids, bool p_normalized = false);
 
             ErrorCode SetParameter(const char* p_param, const char* p_value, const char* p_section = nullptr);
             std::string GetParameter(const char* p_param, const char* p_section = nullptr) const;
@@ -166,7 +220,86 @@ namespace SPTAG
             ErrorCode RefineIndex(std::shared_ptr<VectorIndex>& p_newIndex);
 
         private:
+            // Whether new vectors may pick deleted ones as neighbors. Not once deletes get consolidated, since a
+            // consolidated slot must keep no links until a new vector takes it over.
+            inline bool LinkToDeleted() const { return m_iDeleteRepairThreshold <= 0 && !m_deletesConsolidated; }
+
+            ErrorCode AppendIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized, SizeType& p_begin);
+
+            inline bool HasIDMapping() const { return m_iReorderIDs != 0 || m_pIDMapping.R() > 0; }
+
+            inline SizeType ToExternalID(SizeType p_id) const { return (p_id >= 0 && p_id < m_pIDMapping.R()) ? m_pIDMapping[p_id][0] : p_id; }
+
+            inline SizeType ToInternalID(SizeType p_id) const { return (p_id >= 0 && p_id < m_pIDMapping.R()) ? m_pIDMapping[p_id][1] : p_id; }
+
+            inline void ToExternalIDs(QueryResult& p_query) const
+            {
+                if (m_pIDMapping.R() == 0) return;
+                for (int i = 0; i < p_query.GetResultNum(); i++) p_query.GetResult(i)->VID = ToExternalID(p_query.GetResult(i)->VID);
+            }
+
+            inline std::vector<SizeType> ToExternalIDs(const std::vector<SizeType>& p_ids) const
+            {
+                std::vector<SizeType> ids(p_ids);
+                for (SizeType& id : ids) id = ToExternalID(id);
+                return ids;
+            }
+
+            void ReorderIDs();
+            ErrorCode CoLocateGraph();
+            ErrorCode CompressGraph();
+
+            inline void ApplyPagePolicy()
+            {
+                Helper::PagePolicy policy = (m_iHugePages >= 0 && m_iHugePages <= (int)Helper::PagePolicy::ExplicitHuge) ? (Helper::PagePolicy)m_iHugePages : Helper::PagePolicy::Default;
+                m_pSamples.SetPagePolicy(policy);
+                m_pGraph.SetPagePolicy(policy);
+            }
+
+            inline bool IsGraphCompressed() const { return m_pCompressedGraph.R() > 0; }
+
+            // A compressed list is decoded into the workspace, so the packed record is what has to be fetched early.
+            inline void PrefetchNeighbors(SizeType p_node) const
+            {
+                if (IsGraphCompressed()) _mm_prefetch((const char *)m_pCompressedGraph.Record(p_node), _MM_HINT_T0);
+                else _mm_prefetch((const char *)m_pGraph[p_node], _MM_HINT_T0);
+            }
+
+            inline const SizeType* GetNeighbors(SizeType p_node, COMMON::WorkSpace& p_space) const
+            {
+                if (!IsGraphCompressed()) return m_pGraph[p_node];
+                if (p_space.m_neighbors.size() < (size_t)m_pCompressedGraph.C()) p_space.m_neighbors.resize(m_pCompressedGraph.C());
+                m_pCompressedGraph.Decode(p_node, p_space.m_neighbors.data());
+                return p_space.m_neighbors.data();
+            }
+
+            // Samples of a quantized index are codes, so the distance function and the cosine base come from its quantizer.
+            // Called from the constructor, SetQuantizer and SetParameter(DistCalcMethod), never while searches run.
+            inline void BindDistanceFunction()
+            {
+                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod, m_pQuantizer);
+                int base = m_pQuantizer ? m_pQuantizer->GetBase() : COMMON::Utils::GetBase<T>();
+                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? base * base : 1;
+            }
+
             void SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, bool p_searchDuplicated) const;
+
+            // One query of an interleaved batch search. Every stage ends with prefetches for the next one, and the
+            // other queries of the batch run their stages while those loads are in flight.
+            struct InterleavedQuery
+            {
+                enum class Stage { Pop, Prefetch, Visit, Done };
+
+                COMMON::QueryResultSet<T>* m_query;
+                std::unique_ptr<COMMON::WorkSpace> m_space;
+                NodeDistPair m_gnode;
+                const SizeType* m_node;
+                Stage m_stage;
+            };
+
+            void SearchIndexInterleaved(std::vector<InterleavedQuery>& p_batch, bool p_checkDeleted) const;
+            bool VisitInterleaved(const COMMON::BKTree::Snapshot& p_trees, InterleavedQuery& p_state, bool p_checkDeleted) const;
+            void SearchIndexWithFilter(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, const std::function<bool(SizeType)>& p_filter, bool p_searchDeleted) const;
         };
     } // namespace BKT
 } // namespace SPTAG
@@ -8,6 +8,7 @@ DefineBKTParameter(m_sBKTFilename, std::string, std::string("tree.bin"), "TreeFi
 DefineBKTParameter(m_sGraphFilename, std::string, std::string("graph.bin"), "GraphFilePath")
 DefineBKTParameter(m_sDataPointsFilename, std::string, std::string("vectors.bin"), "VectorFilePath")
 DefineBKTParameter(m_sDeleteDataPointsFilename, std::string, std::string("deletes.bin"), "DeleteVectorFilePath")
+DefineBKTParameter(m_sIDMappingFilename, std::string, std::string("idmapping.bin"), "IDMappingFilePath")
 
 DefineBKTParameter(m_pTrees.m_bfs, int, 0L, "EnableBfs")
 DefineBKTParameter(m_pTrees.m_iTreeNumber, int, 1L, "BKTNumber")
@@ -36,18 +37,27 @@ DefineBKTParameter(m_pGraph.m_iGPURefineDepth, int, 30, "GPURefineDepth") // Dep
 DefineBKTParameter(m_pGraph.m_iGPULeafSize, int, 500, "GPULeafSize")
 DefineBKTParameter(m_pGraph.m_iheadNumGPUs, int, 1, "HeadNumGPUs")
 DefineBKTParameter(m_pGraph.m_iTPTBalanceFactor, int, 2, "TPTBalanceFactor")
+DefineBKTParameter(m_iReorderIDs, int, 0L, "ReorderIDs") // Renumber vectors in graph BFS order after the build
+DefineBKTParameter(m_iCoLocateGraph, int, 0L, "CoLocateGraph") // Store each neighbor list in the same cache lines as its vector
+DefineBKTParameter(m_iCompressGraph, int, 0L, "CompressGraph") // Bit-pack the neighbor lists; the index becomes read-only
 
 DefineBKTParameter(m_iNumberOfThreads, int, 1L, "NumberOfThreads")
 DefineBKTParameter(m_iDistCalcMethod, SPTAG::DistCalcMethod, SPTAG::DistCalcMethod::Cosine, "DistCalcMethod")
 
 DefineBKTParameter(m_fDeletePercentageForRefine, float, 0.4F, "DeletePercentageForRefine")
 DefineBKTParameter(m_addCountForRebuild, int, 1000, "AddCountForRebuild")
+DefineBKTParameter(m_iDeleteRepairThreshold, int, 0L, "DeleteRepairThreshold") // Deletes after which a background pass drops the links to deleted vectors; 0 disables it
+DefineBKTParameter(m_iAddNumberOfThreads, int, 1L, "AddNumberOfThreads") // Threads that link the vectors of one AddIndex call into the graph
+DefineBKTParameter(m_iAddBatchCandidates, int, 0L, "AddBatchCandidates") // Vectors added right before a new vector in the same call that are neighbor candidates too
 DefineBKTParameter(m_iMaxCheck, int, 8192L, "MaxCheck")
+DefineBKTParameter(m_iSearchInterleave, int, 1L, "SearchInterleave") // Queries advanced in lockstep per thread by batch search
 DefineBKTParameter(m_iThresholdOfNumberOfContinuousNoBetterPropagation, int, 3L, "ThresholdOfNumberOfContinuousNoBetterPropagation")
 DefineBKTParameter(m_iNumberOfInitialDynamicPivots, int, 50L, "NumberOfInitialDynamicPivots")
 DefineBKTParameter(m_iNumberOfOtherDynamicPivots, int, 4L, "NumberOfOtherDynamicPivots")
 DefineBKTParameter(m_iHashTableExp, int, 2L, "HashTableExponent")
+DefineBKTParameter(m_iVisitedTableLimit, SizeType, 4 * 1024 * 1024, "VisitedTableLimit") // Ids below this are marked visited in an epoch table, the rest in the hash table
 DefineBKTParameter(m_iDataBlockSize, int, 1024 * 1024, "DataBlockSize")
+DefineBKTParameter(m_iHugePages, int, 0L, "HugePages") // Pages for vectors and graph: 0 default, 1 transparent hugepages, 2 explicit hugepages
 DefineBKTParameter(m_iDataCapacity, int, MaxSize, "DataCapacity")
 DefineBKTParameter(m_iMetaRecordSize, int, 10, "MetaRecordSize")
 
@@ -13,6 +13,7 @@
 #include <cmath>
 #include "inc/Helper/Logging.h"
 #include "inc/Helper/DiskIO.h"
+#include "inc/Core/Common/Float16.h"
 
 #ifndef _MSC_VER
 #include <stdio.h>
@@ -5,11 +5,15 @@
 #define _SPTAG_COMMON_BKTREE_H_
 
 #include <stack>
+#include <random>
 #include <string>
 #include <vector>
-#include <shared_mutex>
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
 
 #include "../VectorIndex.h"
+#include "inc/Helper/Epoch.h"
 
 #include "CommonUtils.h"
 #include "QueryResultSet.h"
@@ -48,9 +52,13 @@ namespace SPTAG
             float* clusterDist;
             float* weightedCounts;
             float* newWeightedCounts;
-            float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length);
+            DistanceCalcFunc<T> fComputeDistance;
+            std::mt19937 rg;
 
-            KmeansArgs(int k, DimensionType dim, SizeType datasize, int threadnum, DistCalcMethod distMethod) : _K(k), _DK(k), _D(dim), _T(threadnum), _M(distMethod) {
+            // The seed defaults to the global rand() state, which is not safe to draw from inside a parallel region;
+            // callers there pass a seed of their own.
+            KmeansArgs(int k, DimensionType dim, SizeType datasize, int threadnum, DistCalcMethod distMethod,
+                const std::shared_ptr<IQuantizer>& quantizer = nullptr, unsigned int seed = (unsigned int)std::rand()) : _K(k), _DK(k), _D(dim), _T(threadnum), _M(distMethod), rg(seed) {
                 centers = (T*)_mm_malloc(sizeof(T) * k * dim, ALIGN_SPTAG);
                 newTCenters = (T*)_mm_malloc(sizeof(T) * k * dim, ALIGN_SPTAG);
                 counts = new SizeType[k];
@@ -61,7 +69,7 @@ namespace SPTAG
                 clusterDist = new float[threadnum * k];
                 weightedCounts = new float[k];
                 newWeightedCounts = new float[threadnum * k];
-                fComputeDistance = COMMON::DistanceCalcSelector<T>(distMethod);
+                fComputeDistance = COMMON::DistanceCalcSelector<T>(distMethod, quantizer);
             }
 
             ~KmeansArgs() {
@@ -102,10 +110,11 @@ namespace SPTAG
                     if (newCounts[k] == 0) continue;
                     SizeType i = pos[k];
                     while (newCounts[k] > 0) {
-                        SizeType swapid = pos[label[i]] + newCounts[label[i]] - 1;
-                        newCounts[label[i]]--;
+                        int l = label[i - first];
+                        SizeType swapid = pos[l] + newCounts[l] - 1;
+                        newCounts[l]--;
                         std::swap(indices[i], indices[swapid]);
-                        std::swap(label[i], label[swapid]);
+                        std::swap(label[i - first], label[swapid - first]);
                     }
                     while (indices[i] != clusterIdx[k]) i++;
                     std::swap(indices[i], indices[pos[k] + counts[k] - 1]);
@@ -206,7 +215,7 @@ namespace SPTAG
                             clusterid = k; smallestDist = dist;
                         }
                     }
-                    args.label[i] = clusterid;
+                    args.label[i - first] = clusterid;
                     inewCounts[clusterid]++;
                     iweightedCounts[clusterid] += smallestDist;
                     idist += smallestDist;
@@ -270,7 +279,7 @@ namespace SPTAG
             float lambda = 0, currDist, minClusterDist = MaxDist;
             for (int numKmeans = 0; numKmeans < tryIters; numKmeans++) {
                 for (int k = 0; k < args._DK; k++) {
-                    SizeType randid = COMMON::Utils::rand(last, first);
+                    SizeType randid = std::uniform_int_distribution<SizeType>(first, last - 1)(args.rg);
                     std::memcpy(args.centers + k*args._D, data[indices[randid]], sizeof(T)*args._D);
                 }
                 args.ClearCounts();
@@ -301,7 +310,7 @@ namespace SPTAG
             float originalLambda = COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() / lambdaFactor / (batchEnd - first);
             for (int iter = 0; iter < 100; iter++) {
                 std::memcpy(args.centers, args.newTCenters, sizeof(T)*args._K*args._D);
-                std::random_shuffle(indices.begin() + first, indices.begin() + last);
+                std::shuffle(indices.begin() + first, indices.begin() + last, args.rg);
 
                 args.ClearCenters();
                 args.ClearCounts();
@@ -410,53 +419,196 @@ namespace SPTAG
 
         class BKTree
         {
+        private:
+            // The finished trees. A published TreeData is never changed: every update publishes a new one and
+            // frees the old one once no reader can hold it anymore.
+            struct TreeData
+            {
+                std::vector<SizeType> m_pTreeStart;
+                std::vector<BKTNode> m_pTreeRoots;
+                std::unordered_map<SizeType, SizeType> m_pSampleCenterMap;
+                // Samples the descent compares queries with: the centers of inner nodes and the samples of the sample map
+                std::unordered_set<SizeType> m_centers;
+            };
+
         public:
-            BKTree(): m_iTreeNumber(1), m_iBKTKmeansK(32), m_iBKTLeafSize(8), m_iSamples(1000), m_fBalanceFactor(-1.0f), m_bfs(0), m_lock(new std::shared_timed_mutex) {}
+            // Pins the trees published at construction for the lifetime of the snapshot. Searches go through a
+            // snapshot so that a concurrent Rebuild neither blocks them nor frees the nodes they walk.
+            class Snapshot
+            {
+            public:
+                explicit Snapshot(const BKTree& p_tree) : m_tree(p_tree), m_data(p_tree.m_pData.load()) {}
+
+                inline const BKTNode& operator[](SizeType index) const { return m_data->m_pTreeRoots[index]; }
+
+                template <typename T>
+                void InitSearchTrees(const Dataset<T>& data, const DistanceCalcFunc<T>& fComputeDistance, COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const
+                {
+                    for (int i = 0; i < (int)m_data->m_pTreeStart.size(); i++) {
+                        const BKTNode& node = m_data->m_pTreeRoots[m_data->m_pTreeStart[i]];
+                        if (node.childStart < 0) {
+                            p_space.m_SPTQueue.insert(NodeDistPair(m_data->m_pTreeStart[i], fComputeDistance(p_query.GetQuantizedTarget(), data[node.centerid], data.C())));
+                        } else if (m_tree.m_bfs) {
+                            float FactorQ = 1.1f;
+                            int MaxBFSNodes = 100;
+                            p_space.m_currBSPTQueue.Resize(MaxBFSNodes); p_space.m_nextBSPTQueue.Resize(MaxBFSNodes);
+                            Heap<NodeDistPair>* p_curr = &p_space.m_currBSPTQueue, * p_next = &p_space.m_nextBSPTQueue;
+                        
+                            p_curr->Top().distance = 1e9;
+                            for (SizeType begin = node.childStart; begin < node.childEnd; begin++) {
+                                SizeType index = m_data->m_pTreeRoots[begin].centerid;
+                                float dist = fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C());
+                                if (dist <= FactorQ * p_curr->Top().distance && p_curr->size() < MaxBFSNodes) {
+                                    p_curr->insert(NodeDistPair(begin, dist));
+                                }
+                                else {
+                                    p_space.m_SPTQueue.insert(NodeDistPair(begin, dist));
+                                }
+                            }
+
+                            for (int level = 1; level < 2; level++) {
+                                p_next->Top().distance = 1e9;
+                                while (!p_curr->empty()) {
+                                    NodeDistPair tmp = p_curr->pop();
+                                    const BKTNode& tnode = m_data->m_pTreeRoots[tmp.node];
+                                    if (tnode.childStart < 0) {
+                                        p_space.m_SPTQueue.insert(tmp);
+                                    }
+                                    else {
+                                        if (!p_space.CheckAndSet(tnode.centerid)) {
+                                            p_space.m_NGQueue.insert(NodeDistPair(tnode.centerid, tmp.distance));
+                                        }
+                                        for (SizeType begin = tnode.childStart; begin < tnode.childEnd; begin++) {
+                                            SizeType index = m_data->m_pTreeRoots[begin].centerid;
+                                            float dist = fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C());
+                                            if (dist <= FactorQ * p_next->Top().distance && p_next->size() < MaxBFSNodes) {
+                                                p_next->insert(NodeDistPair(begin, dist));
+                                            }
+                                            else {
+                                                p_space.m_SPTQueue.insert(NodeDistPair(begin, dist));
+                                            }
+                                        }
+                                    }
+                                }
+                                std::swap(p_curr, p_next);
+                            }
+
+                            while (!p_curr->empty()) {
+                                p_space.m_SPTQueue.insert(p_curr->pop());
+                            }
+                        }
+                        else {
+                            for (SizeType begin = node.childStart; begin < node.childEnd; begin++) {
+                                SizeType index = m_data->m_pTreeRoots[begin].centerid;
+                                p_space.m_SPTQueue.insert(NodeDistPair(begin, fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C())));
+                            }
+                        }
+                    }
+                }
+
+                template <typename T>
+                void SearchTrees(const Dataset<T>& data, const DistanceCalcFunc<T>& fComputeDistance, COMMON::QueryResultSet<T> &p_query,
+                    COMMON::WorkSpace &p_space, const int p_limits) const
+                {
+                    while (!p_space.m_SPTQueue.empty())
+                    {
+                        NodeDistPair bcell = p_space.m_SPTQueue.pop();
+                        const BKTNode& tnode = m_data->m_pTreeRoots[bcell.node];
+                        if (tnode.childStart < 0) {
+                            if (!p_space.CheckAndSet(tnode.centerid)) {
+                                p_space.m_iNumberOfCheckedLeaves++;
+                                p_space.m_NGQueue.insert(NodeDistPair(tnode.centerid, bcell.distance));
+                            }
+                            if (p_space.m_iNumberOfCheckedLeaves >= p_limits) break;
+                        }
+                        else {
+                            if (!p_space.CheckAndSet(tnode.centerid)) {
+                                p_space.m_NGQueue.insert(NodeDistPair(tnode.centerid, bcell.distance));
+                            }
+                            for (SizeType begin = tnode.childStart; begin < tnode.childEnd; begin++) {
+                                SizeType index = m_data->m_pTreeRoots[begin].centerid;
+                                p_space.m_SPTQueue.insert(NodeDistPair(begin, fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C())));
+                            } 
+                        }
+                    }
+                }
+
+            private:
+                Helper::EpochGuard m_pin;
+                const BKTree& m_tree;
+                const TreeData* m_data;
+            };
+
+            BKTree(): m_pData(new TreeData), m_lock(new std::mutex), m_iTreeNumber(1), m_iBKTKmeansK(32), m_iBKTLeafSize(8), m_iSamples(1000), m_bfs(0), m_fBalanceFactor(-1.0f) {}
             
-            BKTree(const BKTree& other): m_iTreeNumber(other.m_iTreeNumber), 
+            BKTree(const BKTree& other): m_pData(new TreeData),
+                                   m_lock(new std::mutex),
+                                   m_iTreeNumber(other.m_iTreeNumber), 
                                    m_iBKTKmeansK(other.m_iBKTKmeansK), 
                                    m_iBKTLeafSize(other.m_iBKTLeafSize),
                                    m_iSamples(other.m_iSamples),
-                                   m_fBalanceFactor(other.m_fBalanceFactor),
-                                   m_lock(new std::shared_timed_mutex) {}
-            ~BKTree() {}
+                                   m_bfs(other.m_bfs),
+                                   m_fBalanceFactor(other.m_fBalanceFactor) {}
+            ~BKTree() { delete m_pData.load(); }
 
-            inline const BKTNode& operator[](SizeType index) const { return m_pTreeRoots[index]; }
-            inline BKTNode& operator[](SizeType index) { return m_pTreeRoots[index]; }
+            // Direct node access for code that does not race with Rebuild; searches use a Snapshot.
+            inline const BKTNode& operator[](SizeType index) const { return m_pData.load()->m_pTreeRoots[index]; }
 
-            inline SizeType size() const { return (SizeType)m_pTreeRoots.size(); }
+            inline SizeType size() const { return (SizeType)m_pData.load()->m_pTreeRoots.size(); }
             
             inline SizeType sizePerTree() const {
-                std::shared_lock<std::shared_timed_mutex> lock(*m_lock);
-                return (SizeType)m_pTreeRoots.size() - m_pTreeStart.back(); 
+                Helper::EpochGuard pin;
+                const TreeData* data = m_pData.load();
+                return (SizeType)data->m_pTreeRoots.size() - data->m_pTreeStart.back(); 
+            }
+
+            inline const std::unordered_map<SizeType, SizeType>& GetSampleMap() const { return m_pData.load()->m_pSampleCenterMap; }
+
+            // Whether the published trees route by sample p_id. Callers that overwrite the vector of a sample hold
+            // m_lock, so that no trees routing by it are published in between.
+            inline bool IsCenter(SizeType p_id) const
+            {
+                Helper::EpochGuard pin;
+                return m_pData.load()->m_centers.count(p_id) > 0;
             }
 
-            inline const std::unordered_map<SizeType, SizeType>& GetSampleMap() const { return m_pSampleCenterMap; }
+            // Sample x becomes sample p_newIDs[x]. A root keeps the sample count of its tree in centerid and the
+            // closing node of every tree keeps -1, so only ids inside [0, p_newIDs.size()) are renamed.
+            void RenumberSamples(const std::vector<SizeType>& p_newIDs)
+            {
+                std::lock_guard<std::mutex> lock(*m_lock);
+                std::unique_ptr<TreeData> data(new TreeData(*m_pData.load()));
+                SizeType samples = (SizeType)p_newIDs.size();
+                for (BKTNode& node : data->m_pTreeRoots) {
+                    if (node.centerid >= 0 && node.centerid < samples) node.centerid = p_newIDs[node.centerid];
+                }
+
+                std::unordered_map<SizeType, SizeType> sampleMap;
+                for (const auto& pair : data->m_pSampleCenterMap) {
+                    if (pair.first >= 0) sampleMap[p_newIDs[pair.first]] = p_newIDs[pair.second];
+                    else sampleMap[-1 - p_newIDs[-1 - pair.first]] = pair.second;
+                }
+                data->m_pSampleCenterMap.swap(sampleMap);
+                Publish(data.release());
+            }
 
+            // Builds new trees off to the side and publishes them; running searches finish on the old trees.
             template <typename T>
-            void Rebuild(const Dataset<T>& data, DistCalcMethod distMethod, IAbortOperation* abort)
+            void Rebuild(const Dataset<T>& data, DistCalcMethod distMethod, const std::shared_ptr<IQuantizer>& quantizer, IAbortOperation* abort)
             {
                 BKTree newTrees(*this);
-                newTrees.BuildTrees<T>(data, distMethod, 1, nullptr, nullptr, false, abort);
+                newTrees.BuildTrees<T>(data, distMethod, 1, nullptr, nullptr, false, abort, quantizer);
+                if (abort && abort->ShouldAbort()) return;
 
-                std::unique_lock<std::shared_timed_mutex> lock(*m_lock);
-                m_pTreeRoots.swap(newTrees.m_pTreeRoots);
-                m_pTreeStart.swap(newTrees.m_pTreeStart);
-                m_pSampleCenterMap.swap(newTrees.m_pSampleCenterMap);
+                std::lock_guard<std::mutex> lock(*m_lock);
+                Publish(newTrees.m_pData.exchange(new TreeData));
             }
 
             template <typename T>
             void BuildTrees(const Dataset<T>& data, DistCalcMethod distMethod, int numOfThreads, 
                 std::vector<SizeType>* indices = nullptr, std::vector<SizeType>* reverseIndices = nullptr, 
-                bool dynamicK = false, IAbortOperation* abort = nullptr)
+                bool dynamicK = false, IAbortOperation* abort = nullptr, const std::shared_ptr<IQuantizer>& quantizer = nullptr)
             {
-                struct  BKTStackItem {
-                    SizeType index, first, last;
-                    bool debug;
-                    BKTStackItem(SizeType index_, SizeType first_, SizeType last_, bool debug_ = false) : index(index_), first(first_), last(last_), debug(debug_) {}
-                };
-                std::stack<BKTStackItem> ss;
-
                 std::vector<SizeType> localindices;
                 if (indices == nullptr) {
                     localindices.resize(data.R());
@@ -465,10 +617,17 @@ namespace SPTAG
                 else {
                     localindices.assign(indices->begin(), indices->end());
                 }
-                KmeansArgs<T> args(m_iBKTKmeansK, data.C(), (SizeType)localindices.size(), numOfThreads, distMethod);
+                KmeansArgs<T> args(m_iBKTKmeansK, data.C(), (SizeType)localindices.size(), numOfThreads, distMethod, quantizer);
 
                 if (m_fBalanceFactor < 0) m_fBalanceFactor = DynamicFactorSelect(data, localindices, 0, (SizeType)localindices.size(), args, m_iSamples);
 
+                // Clusters above deferSize are split here with all threads working inside KmeansAssign;
+                // everything smaller is built as an independent single threaded task and spliced in afterwards.
+                SizeType deferSize = max((SizeType)m_iBKTLeafSize, (SizeType)(localindices.size() / (max(numOfThreads, 1) * 16)));
+                std::vector<std::unique_ptr<KmeansArgs<T>>> taskArgs(max(numOfThreads, 1));
+
+                m_pTreeStart.clear();
+                m_pTreeRoots.clear();
                 m_pSampleCenterMap.clear();
                 for (char i = 0; i < m_iTreeNumber; i++)
                 {
@@ -478,72 +637,56 @@ namespace SPTAG
                     m_pTreeRoots.emplace_back((SizeType)localindices.size());
                     LOG(Helper::LogLevel::LL_Info, "Start to build BKTree %d\n", i + 1);
 
-                    ss.push(BKTStackItem(m_pTreeStart[i], 0, (SizeType)localindices.size(), true));
-                    while (!ss.empty()) {
-                        if (abort && abort->ShouldAbort()) return;
-
-                        BKTStackItem item = ss.top(); ss.pop();
-                        SizeType newBKTid = (SizeType)m_pTreeRoots.size();
-                        m_pTreeRoots[item.index].childStart = newBKTid;
-                        if (item.last - item.first <= m_iBKTLeafSize) {
-                            for (SizeType j = item.first; j < item.last; j++) {
-                                SizeType cid = (reverseIndices == nullptr)? localindices[j]: reverseIndices->at(localindices[j]);
-                                m_pTreeRoots.emplace_back(cid);
-                            }
-                        }
-                        else { // clustering the data into BKTKmeansK clusters
-                            if (dynamicK) {
-                                args._DK = std::min<int>((item.last - item.first) / m_iBKTLeafSize + 1, m_iBKTKmeansK);
-                                args._DK = std::max<int>(args._DK, 2);
-                            }
-
-                            int numClusters = KmeansClustering(data, localindices, item.first, item.last, args, m_iSamples, m_fBalanceFactor, item.debug, abort);
-                            if (numClusters <= 1) {
-                                SizeType end = min(item.last + 1, (SizeType)localindices.size());
-                                std::sort(localindices.begin() + item.first, localindices.begin() + end);
-                                m_pTreeRoots[item.index].centerid = (reverseIndices == nullptr) ? localindices[item.first] : reverseIndices->at(localindices[item.first]);
-                                m_pTreeRoots[item.index].childStart = -m_pTreeRoots[item.index].childStart;
-                                for (SizeType j = item.first + 1; j < end; j++) {
-                                    SizeType cid = (reverseIndices == nullptr) ? localindices[j] : reverseIndices->at(localindices[j]);
-                                    m_pTreeRoots.emplace_back(cid);
-                                    m_pSampleCenterMap[cid] = m_pTreeRoots[item.index].centerid;
-                                }
-                                m_pSampleCenterMap[-1 - m_pTreeRoots[item.index].centerid] = item.index;
-                            }
-                            else {
-                                SizeType maxCount = 0;
-                                for (int k = 0; k < m_iBKTKmeansK; k++) if (args.counts[k] > maxCount) maxCount = args.counts[k];
-                                for (int k = 0; k < m_iBKTKmeansK; k++) {
-                                    if (args.counts[k] == 0) continue;
-                                    SizeType cid = (reverseIndices == nullptr) ? localindices[item.first + args.counts[k] - 1] : reverseIndices->at(localindices[item.first + args.counts[k] - 1]);
-                                    m_pTreeRoots.emplace_back(cid);
-                                    if (args.counts[k] > 1) ss.push(BKTStackItem(newBKTid++, item.first, item.first + args.counts[k] - 1, item.debug && (args.counts[k] == maxCount)));
-                                    item.first += args.counts[k];
-                                }
-                            }
-                        }
-                        m_pTreeRoots[item.index].childEnd = (SizeType)m_pTreeRoots.size();
+                    std::vector<BKTStackItem> deferred;
+                    BuildSubTree(data, localindices, reverseIndices, args, dynamicK, abort,
+                        BKTStackItem(m_pTreeStart[i], 0, (SizeType)localindices.size(), (unsigned int)std::rand(), true),
+                        m_pTreeRoots, m_pSampleCenterMap, deferSize, &deferred);
+                    if (abort && abort->ShouldAbort()) return;
+
+                    std::vector<std::vector<BKTNode>> subTrees(deferred.size());
+                    std::vector<std::unordered_map<SizeType, SizeType>> subSampleMaps(deferred.size());
+#pragma omp parallel for num_threads(numOfThreads) schedule(dynamic,1)
+                    for (int j = 0; j < (int)deferred.size(); j++)
+                    {
+                        if (abort && abort->ShouldAbort()) continue;
+
+                        BKTStackItem root = deferred[j];
+                        std::unique_ptr<KmeansArgs<T>>& targs = taskArgs[omp_get_thread_num()];
+                        if (targs == nullptr) targs.reset(new KmeansArgs<T>(m_iBKTKmeansK, data.C(), deferSize, 1, distMethod, quantizer, root.seed));
+
+                        subTrees[j].emplace_back(m_pTreeRoots[root.index].centerid);
+                        root.index = 0;
+                        BuildSubTree(data, localindices, reverseIndices, *targs, dynamicK, abort, root, subTrees[j], subSampleMaps[j], 0, (std::vector<BKTStackItem>*)nullptr);
                     }
+                    if (abort && abort->ShouldAbort()) return;
+
+                    for (size_t j = 0; j < deferred.size(); j++) SpliceSubTree(deferred[j].index, subTrees[j], subSampleMaps[j]);
+
                     m_pTreeRoots.emplace_back(-1);
                     LOG(Helper::LogLevel::LL_Info, "%d BKTree built, %zu %zu\n", i + 1, m_pTreeRoots.size() - m_pTreeStart[i], localindices.size());
                 }
+                Publish(TakeTrees());
             }
 
             inline std::uint64_t BufferSize() const
             {
-                return sizeof(int) + sizeof(SizeType) * m_iTreeNumber +
-                    sizeof(SizeType) + sizeof(BKTNode) * m_pTreeRoots.size();
+                Helper::EpochGuard pin;
+                const TreeData* data = m_pData.load();
+                return sizeof(int) + sizeof(SizeType) * data->m_pTreeStart.size() +
+                    sizeof(SizeType) + sizeof(BKTNode) * data->m_pTreeRoots.size();
             }
 
             ErrorCode SaveTrees(std::shared_ptr<Helper::DiskPriorityIO> p_out) const
             {
-                std::shared_lock<std::shared_timed_mutex> lock(*m_lock);
-                IOBINARY(p_out, WriteBinary, sizeof(m_iTreeNumber), (char*)&m_iTreeNumber);
-                IOBINARY(p_out, WriteBinary, sizeof(SizeType) * m_iTreeNumber, (char*)m_pTreeStart.data());
-                SizeType treeNodeSize = (SizeType)m_pTreeRoots.size();
+                Helper::EpochGuard pin;
+                const TreeData* data = m_pData.load();
+                int treeNumber = (int)data->m_pTreeStart.size();
+                IOBINARY(p_out, WriteBinary, sizeof(treeNumber), (char*)&treeNumber);
+                IOBINARY(p_out, WriteBinary, sizeof(SizeType) * treeNumber, (char*)data->m_pTreeStart.data());
+                SizeType treeNodeSize = (SizeType)data->m_pTreeRoots.size();
                 IOBINARY(p_out, WriteBinary, sizeof(treeNodeSize), (char*)&treeNodeSize);
-                IOBINARY(p_out, WriteBinary, sizeof(BKTNode) * treeNodeSize, (char*)m_pTreeRoots.data());
-                LOG(Helper::LogLevel::LL_Info, "Save BKT (%d,%d) Finish!\n", m_iTreeNumber, treeNodeSize);
+                IOBINARY(p_out, WriteBinary, sizeof(BKTNode) * treeNodeSize, (char*)data->m_pTreeRoots.data());
+                LOG(Helper::LogLevel::LL_Info, "Save BKT (%d,%d) Finish!\n", treeNumber, treeNodeSize);
                 return ErrorCode::Success;
             }
 
@@ -568,6 +711,7 @@ namespace SPTAG
                 m_pTreeRoots.resize(treeNodeSize);
                 memcpy(m_pTreeRoots.data(), pBKTMemFile, sizeof(BKTNode) * treeNodeSize);
                 if (m_pTreeRoots.size() > 0 && m_pTreeRoots.back().centerid != -1) m_pTreeRoots.emplace_back(-1);
+                Publish(TakeTrees());
                 LOG(Helper::LogLevel::LL_Info, "Load BKT (%d,%d) Finish!\n", m_iTreeNumber, treeNodeSize);
                 return ErrorCode::Success;
             }
@@ -584,6 +728,7 @@ namespace SPTAG
                 IOBINARY(p_input, ReadBinary, sizeof(BKTNode) * treeNodeSize, (char*)m_pTreeRoots.data());
 
                 if (m_pTreeRoots.size() > 0 && m_pTreeRoots.back().centerid != -1) m_pTreeRoots.emplace_back(-1);
+                Publish(TakeTrees());
                 LOG(Helper::LogLevel::LL_Info, "Load BKT (%d,%d) Finish!\n", m_iTreeNumber, treeNodeSize);
                 return ErrorCode::Success;
             }
@@ -596,105 +741,150 @@ namespace SPTAG
                 return LoadTrees(ptr);
             }
 
+        private:
+            struct BKTStackItem {
+                SizeType index, first, last;
+                unsigned int seed;
+                bool debug;
+                BKTStackItem(SizeType index_, SizeType first_, SizeType last_, unsigned int seed_, bool debug_ = false) : index(index_), first(first_), last(last_), seed(seed_), debug(debug_) {}
+            };
+
+            // Every cluster reseeds the kmeans generator from its own stack item, so the tree only depends on
+            // the root seed and not on which thread or phase happened to build a given subtree.
             template <typename T>
-            void InitSearchTrees(const Dataset<T>& data, float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length), COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const
+            void BuildSubTree(const Dataset<T>& data, std::vector<SizeType>& localindices, std::vector<SizeType>* reverseIndices,
+                KmeansArgs<T>& args, bool dynamicK, IAbortOperation* abort, const BKTStackItem& root,
+                std::vector<BKTNode>& nodes, std::unordered_map<SizeType, SizeType>& sampleMap,
+                SizeType deferSize, std::vector<BKTStackItem>* deferred)
             {
-                for (char i = 0; i < m_iTreeNumber; i++) {
-                    const BKTNode& node = m_pTreeRoots[m_pTreeStart[i]];
-                    if (node.childStart < 0) {
-                        p_space.m_SPTQueue.insert(NodeDistPair(m_pTreeStart[i], fComputeDistance(p_query.GetQuantizedTarget(), data[node.centerid], data.C())));
-                    } else if (m_bfs) {
-                        float FactorQ = 1.1f;
-                        int MaxBFSNodes = 100;
-                        p_space.m_currBSPTQueue.Resize(MaxBFSNodes); p_space.m_nextBSPTQueue.Resize(MaxBFSNodes);
-                        Heap<NodeDistPair>* p_curr = &p_space.m_currBSPTQueue, * p_next = &p_space.m_nextBSPTQueue;
-                        
-                        p_curr->Top().distance = 1e9;
-                        for (SizeType begin = node.childStart; begin < node.childEnd; begin++) {
-                            SizeType index = m_pTreeRoots[begin].centerid;
-                            float dist = fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C());
-                            if (dist <= FactorQ * p_curr->Top().distance && p_curr->size() < MaxBFSNodes) {
-                                p_curr->insert(NodeDistPair(begin, dist));
-                            }
-                            else {
-                                p_space.m_SPTQueue.insert(NodeDistPair(begin, dist));
-                            }
-                        }
+                std::stack<BKTStackItem> ss;
+                ss.push(root);
+                while (!ss.empty()) {
+                    if (abort && abort->ShouldAbort()) return;
+
+                    BKTStackItem item = ss.top(); ss.pop();
+                    if (deferred != nullptr && item.last - item.first > m_iBKTLeafSize && item.last - item.first <= deferSize) {
+                        deferred->push_back(item);
+                        continue;
+                    }
 
-                        for (int level = 1; level < 2; level++) {
-                            p_next->Top().distance = 1e9;
-                            while (!p_curr->empty()) {
-                                NodeDistPair tmp = p_curr->pop();
-                                const BKTNode& tnode = m_pTreeRoots[tmp.node];
-                                if (tnode.childStart < 0) {
-                                    p_space.m_SPTQueue.insert(tmp);
-                                }
-                                else {
-                                    if (!p_space.CheckAndSet(tnode.centerid)) {
-                                        p_space.m_NGQueue.insert(NodeDistPair(tnode.centerid, tmp.distance));
-                                    }
-                                    for (SizeType begin = tnode.childStart; begin < tnode.childEnd; begin++) {
-                                        SizeType index = m_pTreeRoots[begin].centerid;
-                                        float dist = fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C());
-                                        if (dist <= FactorQ * p_next->Top().distance && p_next->size() < MaxBFSNodes) {
-                                            p_next->insert(NodeDistPair(begin, dist));
-                                        }
-                                        else {
-                                            p_space.m_SPTQueue.insert(NodeDistPair(begin, dist));
-                                        }
-                                    }
-                                }
-                            }
-                            std::swap(p_curr, p_next);
+                    SizeType newBKTid = (SizeType)nodes.size();
+                    nodes[item.index].childStart = newBKTid;
+                    if (item.last - item.first <= m_iBKTLeafSize) {
+                        for (SizeType j = item.first; j < item.last; j++) {
+                            SizeType cid = (reverseIndices == nullptr)? localindices[j]: reverseIndices->at(localindices[j]);
+                            nodes.emplace_back(cid);
+                        }
+                    }
+                    else { // clustering the data into BKTKmeansK clusters
+                        if (dynamicK) {
+                            args._DK = std::min<int>((item.last - item.first) / m_iBKTLeafSize + 1, m_iBKTKmeansK);
+                            args._DK = std::max<int>(args._DK, 2);
                         }
 
-                        while (!p_curr->empty()) {
-                            p_space.m_SPTQueue.insert(p_curr->pop());
+                        args.rg.seed(item.seed);
+                        int numClusters = KmeansClustering(data, localindices, item.first, item.last, args, m_iSamples, m_fBalanceFactor, item.debug, abort);
+                        if (numClusters <= 1) {
+                            SizeType end = min(item.last + 1, (SizeType)localindices.size());
+                            std::sort(localindices.begin() + item.first, localindices.begin() + end);
+                            nodes[item.index].centerid = (reverseIndices == nullptr) ? localindices[item.first] : reverseIndices->at(localindices[item.first]);
+                            nodes[item.index].childStart = -nodes[item.index].childStart;
+                            for (SizeType j = item.first + 1; j < end; j++) {
+                                SizeType cid = (reverseIndices == nullptr) ? localindices[j] : reverseIndices->at(localindices[j]);
+                                nodes.emplace_back(cid);
+                                sampleMap[cid] = nodes[item.index].centerid;
+                            }
+                            sampleMap[-1 - nodes[item.index].centerid] = item.index;
                         }
-                    }
-                    else {
-                        for (SizeType begin = node.childStart; begin < node.childEnd; begin++) {
-                            SizeType index = m_pTreeRoots[begin].centerid;
-                            p_space.m_SPTQueue.insert(NodeDistPair(begin, fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C())));
+                        else {
+                            SizeType maxCount = 0;
+                            for (int k = 0; k < m_iBKTKmeansK; k++) if (args.counts[k] > maxCount) maxCount = args.counts[k];
+                            for (int k = 0; k < m_iBKTKmeansK; k++) {
+                                if (args.counts[k] == 0) continue;
+                                SizeType cid = (reverseIndices == nullptr) ? localindices[item.first + args.counts[k] - 1] : reverseIndices->at(localindices[item.first + args.counts[k] - 1]);
+                                nodes.emplace_back(cid);
+                                if (args.counts[k] > 1) ss.push(BKTStackItem(newBKTid++, item.first, item.first + args.counts[k] - 1, (unsigned int)args.rg(), item.debug && (args.counts[k] == maxCount)));
+                                item.first += args.counts[k];
+                            }
                         }
                     }
+                    nodes[item.index].childEnd = (SizeType)nodes.size();
                 }
             }
 
-            template <typename T>
-            void SearchTrees(const Dataset<T>& data, float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length), COMMON::QueryResultSet<T> &p_query,
-                COMMON::WorkSpace &p_space, const int p_limits) const
+            // Appends a subtree built by BuildSubTree, whose node 0 stands for m_pTreeRoots[rootIndex].
+            // Local index j >= 1 moves to offset + j. Inside a subtree only the root can have its children
+            // start at 1, so a childStart of -1 on any other node is the "no children" marker rather than
+            // a negated child start.
+            void SpliceSubTree(SizeType rootIndex, const std::vector<BKTNode>& nodes, const std::unordered_map<SizeType, SizeType>& sampleMap)
             {
-                while (!p_space.m_SPTQueue.empty())
-                {
-                    NodeDistPair bcell = p_space.m_SPTQueue.pop();
-                    const BKTNode& tnode = m_pTreeRoots[bcell.node];
-                    if (tnode.childStart < 0) {
-                        if (!p_space.CheckAndSet(tnode.centerid)) {
-                            p_space.m_iNumberOfCheckedLeaves++;
-                            p_space.m_NGQueue.insert(NodeDistPair(tnode.centerid, bcell.distance));
-                        }
-                        if (p_space.m_iNumberOfCheckedLeaves >= p_limits) break;
+                SizeType offset = (SizeType)m_pTreeRoots.size() - 1;
+                auto relocate = [offset](SizeType childStart) {
+                    return (childStart >= 0) ? offset + childStart : -(offset - childStart);
+                };
+
+                BKTNode& root = m_pTreeRoots[rootIndex];
+                root.centerid = nodes[0].centerid;
+                root.childStart = relocate(nodes[0].childStart);
+                root.childEnd = offset + nodes[0].childEnd;
+                for (size_t j = 1; j < nodes.size(); j++) {
+                    m_pTreeRoots.push_back(nodes[j]);
+                    BKTNode& node = m_pTreeRoots.back();
+                    if (node.childStart != -1) {
+                        node.childStart = relocate(node.childStart);
+                        node.childEnd = offset + node.childEnd;
                     }
-                    else {
-                        if (!p_space.CheckAndSet(tnode.centerid)) {
-                            p_space.m_NGQueue.insert(NodeDistPair(tnode.centerid, bcell.distance));
-                        }
-                        for (SizeType begin = tnode.childStart; begin < tnode.childEnd; begin++) {
-                            SizeType index = m_pTreeRoots[begin].centerid;
-                            p_space.m_SPTQueue.insert(NodeDistPair(begin, fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C())));
-                        } 
+                }
+
+                for (const auto& pair : sampleMap) {
+                    if (pair.first >= 0) m_pSampleCenterMap[pair.first] = pair.second;
+                    else m_pSampleCenterMap[pair.first] = (pair.second == 0) ? rootIndex : offset + pair.second;
+                }
+            }
+
+            // Moves the trees built or loaded so far into a TreeData for Publish.
+            TreeData* TakeTrees()
+            {
+                TreeData* data = new TreeData;
+                data->m_pTreeStart.swap(m_pTreeStart);
+                data->m_pTreeRoots.swap(m_pTreeRoots);
+                data->m_pSampleCenterMap.swap(m_pSampleCenterMap);
+                return data;
+            }
+
+            // Makes p_data the trees new searches see, and frees the old trees once the searches that may
+            // still walk them are done.
+            void Publish(TreeData* p_data)
+            {
+                // A tree root keeps its sample count in centerid, and a node without children is a leaf.
+                std::unordered_set<SizeType> roots(p_data->m_pTreeStart.begin(), p_data->m_pTreeStart.end());
+                p_data->m_centers.clear();
+                for (SizeType i = 0; i < (SizeType)p_data->m_pTreeRoots.size(); i++) {
+                    const BKTNode& node = p_data->m_pTreeRoots[i];
+                    if (node.centerid >= 0 && node.childStart != -1 && roots.count(i) == 0) p_data->m_centers.insert(node.centerid);
+                }
+                for (const auto& pair : p_data->m_pSampleCenterMap) {
+                    if (pair.first >= 0) {
+                        p_data->m_centers.insert(pair.first);
+                        p_data->m_centers.insert(pair.second);
                     }
                 }
+
+                TreeData* old = m_pData.exchange(p_data);
+                Helper::WaitForReaders();
+                delete old;
             }
 
-        private:
+            // Trees under construction by BuildTrees or LoadTrees
             std::vector<SizeType> m_pTreeStart;
             std::vector<BKTNode> m_pTreeRoots;
             std::unordered_map<SizeType, SizeType> m_pSampleCenterMap;
 
+            std::atomic<TreeData*> m_pData;
+
         public:
-            std::unique_ptr<std::shared_timed_mutex> m_lock;
+            // Serializes the writers that publish new trees
+            std::unique_ptr<std::mutex> m_lock;
             int m_iTreeNumber, m_iBKTKmeansK, m_iBKTLeafSize, m_iSamples, m_bfs;
             float m_fBalanceFactor;
         };
@@ -52,7 +52,7 @@ namespace SPTAG
 
             template<typename T>
             static inline int GetBaseCore() {
-                if (GetEnumValueType<T>() != VectorValueType::Float) {
+                if (!std::numeric_limits<T>::is_iec559) {
                     return (int)(std::numeric_limits<T>::max)();
                 }
                 return 1;
@@ -0,0 +1,282 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_COMPRESSEDGRAPH_H_
+#define _SPTAG_COMMON_COMPRESSEDGRAPH_H_
+
+#include "NeighborhoodGraph.h"
+
+namespace SPTAG
+{
+    namespace COMMON
+    {
+        // Read-only copy of a NeighborhoodGraph. Every neighbor list is bit-packed relative to its smallest id
+        // (frame of reference coding), which keeps the list in distance order and makes each id a fixed width
+        // field. List i starts at byte m_pOffsets[i] of m_pData and is laid out as
+        //     uint8 count | uint8 bits, high bit set if a tree node reference follows | SizeType base |
+        //     [SizeType tree node reference] | count ids of bits bits each, minus base
+        // The data ends with 8 bytes of padding so that every field can be read with one unaligned 64 bit load.
+        // The file starts with a format tag, then the sizes, the R() + 1 offsets and the data.
+        class CompressedGraph
+        {
+        public:
+            // "SPTCGRF1" in file byte order.
+            static const std::uint64_t c_formatTag = 0x3146524743545053ULL;
+
+            CompressedGraph() {}
+
+            inline SizeType R() const { return m_iGraphSize; }
+
+            inline DimensionType C() const { return m_iNeighborhoodSize; }
+
+            inline std::uint64_t BufferSize() const
+            {
+                return HeaderSize() + sizeof(std::uint64_t) * (m_iGraphSize + 1) + m_iDataBytes;
+            }
+
+            ErrorCode Compress(const NeighborhoodGraph& p_graph)
+            {
+                DimensionType C = p_graph.m_iNeighborhoodSize;
+                if (C <= 0 || C > 255) {
+                    LOG(Helper::LogLevel::LL_Error, "Cannot compress neighbor lists of %d ids.\n", C);
+                    return ErrorCode::Fail;
+                }
+
+                SizeType R = p_graph.R();
+                m_offsets.resize((size_t)R + 1);
+                m_data.clear();
+                m_data.reserve(((size_t)R) * C * sizeof(SizeType) / 2);
+                for (SizeType i = 0; i < R; i++) {
+                    m_offsets[i] = m_data.size();
+                    const SizeType* node = p_graph[i];
+                    SizeType ref = (node[C - 1] < -1) ? node[C - 1] : -1;
+                    DimensionType count = 0, limit = (ref < -1) ? C - 1 : C;
+                    SizeType base = MaxSize, top = 0;
+                    while (count < limit && node[count] >= 0) {
+                        base = min(base, node[count]);
+                        top = max(top, node[count]);
+                        count++;
+                    }
+                    if (count == 0) base = 0;
+
+                    std::uint8_t bits = 0;
+                    while (bits < 31 && (((SizeType)1) << bits) <= top - base) bits++;
+
+                    m_data.push_back((std::uint8_t)count);
+                    m_data.push_back(bits | ((ref < -1) ? 0x80 : 0));
+                    Append(base);
+                    if (ref < -1) Append(ref);
+
+                    std::uint64_t word = 0;
+                    int filled = 0;
+                    for (DimensionType j = 0; j < count; j++) {
+                        word |= ((std::uint64_t)(node[j] - base)) << filled;
+                        filled += bits;
+                        while (filled >= 8) {
+                            m_data.push_back((std::uint8_t)word);
+                            word >>= 8;
+                            filled -= 8;
+                        }
+                    }
+                    if (filled > 0) m_data.push_back((std::uint8_t)word);
+                }
+                m_offsets[R] = m_data.size();
+                m_data.resize(m_data.size() + sizeof(std::uint64_t), 0);
+
+                m_iGraphSize = R;
+                m_iNeighborhoodSize = C;
+                m_iDataBytes = m_data.size();
+                m_pOffsets = m_offsets.data();
+                m_pData = m_data.data();
+                LOG(Helper::LogLevel::LL_Info, "Compress graph (%d,%d): %llu bytes instead of %llu.\n", R, C,
+                    (unsigned long long)BufferSize(), (unsigned long long)(sizeof(SizeType) * C * (std::uint64_t)R));
+                return ErrorCode::Success;
+            }
+
+            // Start of the packed list of node, for prefetching.
+            inline const std::uint8_t* Record(SizeType node) const
+            {
+                return m_pData + m_pOffsets[node];
+            }
+
+            // Writes the C() ids of node in the layout of NeighborhoodGraph: the neighbors, then -1 padding, and
+            // the tree node reference, if any, in the last slot.
+            inline void Decode(SizeType node, SizeType* p_out) const
+            {
+                const std::uint8_t* p = m_pData + m_pOffsets[node];
+                DimensionType count = p[0];
+                int bits = p[1] & 0x7F;
+                bool hasRef = (p[1] & 0x80) != 0;
+                SizeType base = *((const SizeType*)(p + 2));
+                p += 2 + sizeof(SizeType);
+                if (hasRef) {
+                    p_out[m_iNeighborhoodSize - 1] = *((const SizeType*)p);
+                    p += sizeof(SizeType);
+                }
+
+                std::uint64_t mask = (((std::uint64_t)1) << bits) - 1;
+                std::uint64_t pos = 0;
+                for (DimensionType i = 0; i < count; i++, pos += bits) {
+                    std::uint64_t word = *((const std::uint64_t*)(p + (pos >> 3)));
+                    p_out[i] = base + (SizeType)((word >> (pos & 7)) & mask);
+                }
+                for (DimensionType i = count; i < m_iNeighborhoodSize - (hasRef ? 1 : 0); i++) p_out[i] = -1;
+            }
+
+            ErrorCode Save(std::shared_ptr<Helper::DiskPriorityIO> p_out) const
+            {
+                std::uint64_t tag = c_formatTag;
+                IOBINARY(p_out, WriteBinary, sizeof(std::uint64_t), (char*)&tag);
+                IOBINARY(p_out, WriteBinary, sizeof(SizeType), (char*)&m_iGraphSize);
+                IOBINARY(p_out, WriteBinary, sizeof(DimensionType), (char*)&m_iNeighborhoodSize);
+                IOBINARY(p_out, WriteBinary, sizeof(std::uint64_t), (char*)&m_iDataBytes);
+                IOBINARY(p_out, WriteBinary, sizeof(std::uint64_t) * (m_iGraphSize + 1), (char*)m_pOffsets);
+                IOBINARY(p_out, WriteBinary, m_iDataBytes, (char*)m_pData);
+                LOG(Helper::LogLevel::LL_Info, "Save CompressedGraph (%d,%d) Finish!\n", m_iGraphSize, m_iNeighborhoodSize);
+                return ErrorCode::Success;
+            }
+
+            ErrorCode Load(std::shared_ptr<Helper::DiskPriorityIO> p_input)
+            {
+                *this = CompressedGraph();
+                ErrorCode ret = Read(p_input);
+                if (ret != ErrorCode::Success) return Reject(ret);
+                LOG(Helper::LogLevel::LL_Info, "Load CompressedGraph (%d,%d) Finish!\n", m_iGraphSize, m_iNeighborhoodSize);
+                return ErrorCode::Success;
+            }
+
+            // Reads the lists in place from a memory mapped file of p_length bytes.
+            ErrorCode Load(char* p_memFile, std::uint64_t p_length)
+            {
+                *this = CompressedGraph();
+                if (p_length < HeaderSize()) {
+                    LOG(Helper::LogLevel::LL_Error, "CompressedGraph blob of %llu bytes is shorter than its header.\n", (unsigned long long)p_length);
+                    return ErrorCode::FailedParseValue;
+                }
+                std::uint64_t tag = *((std::uint64_t*)p_memFile);
+                p_memFile += sizeof(std::uint64_t);
+                m_iGraphSize = *((SizeType*)p_memFile);
+                p_memFile += sizeof(SizeType);
+                m_iNeighborhoodSize = *((DimensionType*)p_memFile);
+                p_memFile += sizeof(DimensionType);
+                m_iDataBytes = *((std::uint64_t*)p_memFile);
+                p_memFile += sizeof(std::uint64_t);
+
+                // The offsets and the data must both lie inside the blob.
+                std::uint64_t available = p_length - HeaderSize();
+                ErrorCode ret = ErrorCode::Success;
+                if ((ret = CheckHeader(tag, available)) != ErrorCode::Success) return Reject(ret);
+                std::uint64_t offsetBytes = sizeof(std::uint64_t) * ((std::uint64_t)m_iGraphSize + 1);
+                if (offsetBytes > available || m_iDataBytes > available - offsetBytes) {
+                    LOG(Helper::LogLevel::LL_Error, "CompressedGraph (%d nodes, %llu data bytes) does not fit its %llu byte blob.\n",
+                        m_iGraphSize, (unsigned long long)m_iDataBytes, (unsigned long long)p_length);
+                    return Reject(ErrorCode::FailedParseValue);
+                }
+
+                m_pOffsets = (const std::uint64_t*)p_memFile;
+                m_pData = (const std::uint8_t*)(p_memFile + offsetBytes);
+                if ((ret = CheckRecords()) != ErrorCode::Success) return Reject(ret);
+                LOG(Helper::LogLevel::LL_Info, "Load CompressedGraph (%d,%d) Finish!\n", m_iGraphSize, m_iNeighborhoodSize);
+                return ErrorCode::Success;
+            }
+
+        private:
+            ErrorCode Read(std::shared_ptr<Helper::DiskPriorityIO> p_input)
+            {
+                std::uint64_t tag = 0;
+                IOBINARY(p_input, ReadBinary, sizeof(std::uint64_t), (char*)&tag);
+                IOBINARY(p_input, ReadBinary, sizeof(SizeType), (char*)&m_iGraphSize);
+                IOBINARY(p_input, ReadBinary, sizeof(DimensionType), (char*)&m_iNeighborhoodSize);
+                IOBINARY(p_input, ReadBinary, sizeof(std::uint64_t), (char*)&m_iDataBytes);
+                // A stream has no known length, so the data may be at most as large as R() lists of C() ids.
+                ErrorCode ret = ErrorCode::Success;
+                if ((ret = CheckHeader(tag, MaxRecordBytes() * (std::uint64_t)max(m_iGraphSize, 0) + sizeof(std::uint64_t))) != ErrorCode::Success) return ret;
+
+                m_offsets.resize((size_t)m_iGraphSize + 1);
+                m_data.resize(m_iDataBytes);
+                IOBINARY(p_input, ReadBinary, sizeof(std::uint64_t) * (m_iGraphSize + 1), (char*)m_offsets.data());
+                IOBINARY(p_input, ReadBinary, m_iDataBytes, (char*)m_data.data());
+                m_pOffsets = m_offsets.data();
+                m_pData = m_data.data();
+                return CheckRecords();
+            }
+
+            static inline std::uint64_t HeaderSize()
+            {
+                return sizeof(std::uint64_t) + sizeof(SizeType) + sizeof(DimensionType) + sizeof(std::uint64_t);
+            }
+
+            // Largest list of C() ids: count, bits, base, tree node reference and C() ids of 31 bits.
+            inline std::uint64_t MaxRecordBytes() const
+            {
+                return 2 + 2 * sizeof(SizeType) + ((std::uint64_t)m_iNeighborhoodSize * 31 + 7) / 8;
+            }
+
+            ErrorCode CheckHeader(std::uint64_t p_tag, std::uint64_t p_maxDataBytes) const
+            {
+                if (p_tag != c_formatTag) {
+                    LOG(Helper::LogLevel::LL_Error, "Graph file is not a CompressedGraph.\n");
+                    return ErrorCode::FailedParseValue;
+                }
+                if (m_iGraphSize < 0 || m_iNeighborhoodSize <= 0 || m_iNeighborhoodSize > 255 ||
+                    m_iDataBytes < sizeof(std::uint64_t) || m_iDataBytes > p_maxDataBytes) {
+                    LOG(Helper::LogLevel::LL_Error, "CompressedGraph header (%d,%d) with %llu data bytes is invalid.\n",
+                        m_iGraphSize, m_iNeighborhoodSize, (unsigned long long)m_iDataBytes);
+                    return ErrorCode::FailedParseValue;
+                }
+                return ErrorCode::Success;
+            }
+
+            // Every list must lie between its offset and the next one, hold at most C() ids and start from an id
+            // of the graph, and the padding must follow the last list. The packed ids are not decoded here.
+            ErrorCode CheckRecords() const
+            {
+                if (m_pOffsets[0] != 0 || m_pOffsets[m_iGraphSize] > m_iDataBytes - sizeof(std::uint64_t)) {
+                    LOG(Helper::LogLevel::LL_Error, "CompressedGraph offsets do not match its %llu data bytes.\n", (unsigned long long)m_iDataBytes);
+                    return ErrorCode::FailedParseValue;
+                }
+                for (SizeType i = 0; i < m_iGraphSize; i++) {
+                    std::uint64_t begin = m_pOffsets[i], end = m_pOffsets[i + 1];
+                    if (end < begin || end - begin < 2 + sizeof(SizeType)) {
+                        LOG(Helper::LogLevel::LL_Error, "CompressedGraph list %d has invalid offsets.\n", i);
+                        return ErrorCode::FailedParseValue;
+                    }
+                    const std::uint8_t* p = m_pData + begin;
+                    DimensionType count = p[0];
+                    int bits = p[1] & 0x7F;
+                    bool hasRef = (p[1] & 0x80) != 0;
+                    SizeType base = *((const SizeType*)(p + 2));
+                    std::uint64_t bytes = 2 + sizeof(SizeType) * (hasRef ? 2 : 1) + ((std::uint64_t)count * bits + 7) / 8;
+                    if (count > m_iNeighborhoodSize - (hasRef ? 1 : 0) || bits > 31 || bytes > end - begin ||
+                        base < 0 || (count > 0 && base >= m_iGraphSize)) {
+                        LOG(Helper::LogLevel::LL_Error, "CompressedGraph list %d is corrupted.\n", i);
+                        return ErrorCode::FailedParseValue;
+                    }
+                }
+                return ErrorCode::Success;
+            }
+
+            inline ErrorCode Reject(ErrorCode p_ret)
+            {
+                *this = CompressedGraph();
+                return p_ret;
+            }
+
+            inline void Append(SizeType p_value)
+            {
+                std::uint8_t* bytes = (std::uint8_t*)&p_value;
+                m_data.insert(m_data.end(), bytes, bytes + sizeof(SizeType));
+            }
+
+            SizeType m_iGraphSize = 0;
+            DimensionType m_iNeighborhoodSize = 0;
+            std::uint64_t m_iDataBytes = 0;
+            std::vector<std::uint64_t> m_offsets;
+            std::vector<std::uint8_t> m_data;
+            const std::uint64_t* m_pOffsets = nullptr;
+            const std::uint8_t* m_pData = nullptr;
+        };
+    }
+}
+
+#endif // _SPTAG_COMMON_COMPRESSEDGRAPH_H_
@@ -4,14 +4,20 @@
 #ifndef _SPTAG_COMMON_DATASET_H_
 #define _SPTAG_COMMON_DATASET_H_
 
+#include "inc/Helper/PageAllocator.h"
+
 namespace SPTAG
 {
     namespace COMMON
     {
         // structure to save Data and Graph
+        // Rows are rowStride elements apart. The stride is cols unless Restride left room after every row for
+        // the rows of other datasets, which then share the records as views (see ShareRows).
         template <typename T>
         class Dataset
         {
+            template <typename U> friend class Dataset;
+
         private:
             std::string name = "Data";
             SizeType rows = 0;
@@ -22,7 +28,12 @@ namespace SPTAG
             SizeType maxRows;
             SizeType rowsInBlock;
             SizeType rowsInBlockEx;
-            std::vector<T*> incBlocks;
+            std::size_t rowStride = 1;
+            std::vector<char*> incBlocks;
+            // Blocks of incremental rows: incBlocks, or the owner's blocks for a view at byte blockOffset
+            const std::vector<char*>* blocks = &incBlocks;
+            std::size_t blockOffset = 0;
+            Helper::PagePolicy pagePolicy = Helper::PagePolicy::Default;
 
         public:
             Dataset() {}
@@ -33,21 +44,23 @@ namespace SPTAG
             }
             ~Dataset()
             {
-                if (ownData) _mm_free(data);
-                for (T* ptr : incBlocks) _mm_free(ptr);
-                incBlocks.clear();
+                Release();
             }
             void Initialize(SizeType rows_, DimensionType cols_, SizeType rowsInBlock_, SizeType capacity_, T* data_ = nullptr, bool transferOnwership_ = true)
             {
+                Release();
                 rows = rows_;
                 cols = cols_;
+                rowStride = cols_;
+                incRows = 0;
                 data = data_;
+                ownData = false;
                 if (data_ == nullptr || !transferOnwership_)
                 {
                     ownData = true;
-                    data = (T*)_mm_malloc(((size_t)rows) * cols * sizeof(T), ALIGN_SPTAG);
+                    data = (T*)Helper::AllocatePages(((size_t)rows) * cols * sizeof(T), pagePolicy);
                     if (data_ != nullptr) memcpy(data, data_, ((size_t)rows) * cols * sizeof(T));
-                    else std::memset(data, -1, ((size_t)rows) * cols * sizeof(T));
+                    else std::memset((void*)data, -1, ((size_t)rows) * cols * sizeof(T));
                 }
                 maxRows = capacity_;
                 rowsInBlockEx = static_cast<SizeType>(ceil(log2(rowsInBlock_)));
@@ -55,6 +68,8 @@ namespace SPTAG
                 incBlocks.reserve((static_cast<std::int64_t>(capacity_) + rowsInBlock) >> rowsInBlockEx);
             }
             void SetName(const std::string& name_) { name = name_; }
+            // Pages for the rows allocated from now on
+            void SetPagePolicy(Helper::PagePolicy policy_) { pagePolicy = policy_; }
             const std::string& Name() const { return name; }
 
             void SetR(SizeType R_) 
@@ -70,14 +85,15 @@ namespace SPTAG
             inline SizeType R() const { return rows + incRows; }
             inline DimensionType C() const { return cols; }
             inline std::uint64_t BufferSize() const { return sizeof(SizeType) + sizeof(DimensionType) + sizeof(T) * R() * C(); }
+            inline bool IsView() const { return blocks != &incBlocks; }
 
             inline const T* At(SizeType index) const
             {
                 if (index >= rows) {
                     SizeType incIndex = index - rows;
-                    return incBlocks[incIndex >> rowsInBlockEx] + ((size_t)(incIndex & rowsInBlock)) * cols;
+                    return (const T*)((*blocks)[incIndex >> rowsInBlockEx] + blockOffset) + ((size_t)(incIndex & rowsInBlock)) * rowStride;
                 }
-                return data + ((size_t)index) * cols;
+                return data + ((size_t)index) * rowStride;
             }
 
             T* operator[](SizeType index)
@@ -93,24 +109,34 @@ namespace SPTAG
             ErrorCode AddBatch(const T* pData, SizeType num)
             {
                 if (R() > maxRows - num) return ErrorCode::MemoryOverFlow;
+                if (IsView()) return ErrorCode::Fail;
 
                 SizeType written = 0;
                 while (written < num) {
                     SizeType curBlockIdx = ((incRows + written) >> rowsInBlockEx);
                     if (curBlockIdx >= (SizeType)incBlocks.size()) {
-                        T* newBlock = (T*)_mm_malloc(((size_t)rowsInBlock + 1) * cols * sizeof(T), ALIGN_SPTAG);
+                        char* newBlock = (char*)Helper::AllocatePages(((size_t)rowsInBlock + 1) * rowStride * sizeof(T), pagePolicy);
                         if (newBlock == nullptr) return ErrorCode::MemoryOverFlow;
                         incBlocks.push_back(newBlock);
                     }
                     SizeType curBlockPos = ((incRows + written) & rowsInBlock);
                     SizeType toWrite = min(rowsInBlock + 1 - curBlockPos, num - written);
-                    std::memcpy(incBlocks[curBlockIdx] + ((size_t)curBlockPos) * cols, pData + ((size_t)written) * cols, ((size_t)toWrite) * cols * sizeof(T));
+                    T* dest = (T*)incBlocks[curBlockIdx] + ((size_t)curBlockPos) * rowStride;
+                    if (rowStride == (std::size_t)cols) {
+                        std::memcpy(dest, pData + ((size_t)written) * cols, ((size_t)toWrite) * cols * sizeof(T));
+                    }
+                    else {
+                        for (SizeType i = 0; i < toWrite; i++) {
+                            std::memcpy(dest + ((size_t)i) * rowStride, pData + ((size_t)written + i) * cols, cols * sizeof(T));
+                        }
+                    }
                     written += toWrite;
                 }
                 incRows += written;
                 return ErrorCode::Success;
             }
 
+            // Adds num rows filled with -1. A view only claims rows whose records the owner already added.
             ErrorCode AddBatch(SizeType num)
             {
                 if (R() > maxRows - num) return ErrorCode::MemoryOverFlow;
@@ -118,13 +144,18 @@ namespace SPTAG
                 SizeType written = 0;
                 while (written < num) {
                     SizeType curBlockIdx = (incRows + written) >> rowsInBlockEx;
-                    if (curBlockIdx >= (SizeType)incBlocks.size()) {
-                        T* newBlock = (T*)_mm_malloc(sizeof(T) * (rowsInBlock + 1) * cols, ALIGN_SPTAG);
+                    if (curBlockIdx >= (SizeType)blocks->size()) {
+                        if (IsView()) return ErrorCode::MemoryOverFlow;
+                        char* newBlock = (char*)Helper::AllocatePages(sizeof(T) * (rowsInBlock + 1) * rowStride, pagePolicy);
                         if (newBlock == nullptr) return ErrorCode::MemoryOverFlow;
-                        std::memset(newBlock, -1, sizeof(T) * (rowsInBlock + 1) * cols);
+                        std::memset(newBlock, -1, sizeof(T) * (rowsInBlock + 1) * rowStride);
                         incBlocks.push_back(newBlock);
                     }
-                    written += min(rowsInBlock + 1 - ((incRows + written) & rowsInBlock), num - written);
+                    SizeType toWrite = min(rowsInBlock + 1 - ((incRows + written) & rowsInBlock), num - written);
+                    if (IsView()) {
+                        for (SizeType i = 0; i < toWrite; i++) std::memset((void*)At(rows + incRows + written + i), -1, sizeof(T) * cols);
+                    }
+                    written += toWrite;
                 }
                 incRows += written;
                 return ErrorCode::Success;
@@ -135,14 +166,19 @@ namespace SPTAG
                 SizeType CR = R();
                 IOBINARY(p_out, WriteBinary, sizeof(SizeType), (char*)&CR);
                 IOBINARY(p_out, WriteBinary, sizeof(DimensionType), (char*)&cols);
+                if (rowStride != (std::size_t)cols) {
+                    for (SizeType i = 0; i < CR; i++) IOBINARY(p_out, WriteBinary, sizeof(T) * cols, (char*)At(i));
+                    LOG(Helper::LogLevel::LL_Info, "Save %s (%d,%d) Finish!\n", name.c_str(), CR, cols);
+                    return ErrorCode::Success;
+                }
                 IOBINARY(p_out, WriteBinary, sizeof(T) * cols * rows, (char*)data);
                 
                 SizeType blocks = (incRows >> rowsInBlockEx);
                 for (int i = 0; i < blocks; i++)
-                    IOBINARY(p_out, WriteBinary, sizeof(T) * cols * (rowsInBlock + 1), (char*)incBlocks[i]);
+                    IOBINARY(p_out, WriteBinary, sizeof(T) * cols * (rowsInBlock + 1), incBlocks[i]);
 
                 SizeType remain = (incRows & rowsInBlock);
-                if (remain > 0) IOBINARY(p_out, WriteBinary, sizeof(T) * cols * remain, (char*)incBlocks[blocks]);
+                if (remain > 0) IOBINARY(p_out, WriteBinary, sizeof(T) * cols * remain, incBlocks[blocks]);
                 LOG(Helper::LogLevel::LL_Info, "Save %s (%d,%d) Finish!\n", name.c_str(), CR, cols);
                 return ErrorCode::Success;
             }
@@ -190,10 +226,77 @@ namespace SPTAG
                 return ErrorCode::Success;
             }
 
+            // Copies the rows into records of p_recordBytes bytes, so the rest of every record can hold the rows of
+            // other datasets (see ShareRows). p_recordBytes must be a multiple of sizeof(T).
+            ErrorCode Restride(std::size_t p_recordBytes)
+            {
+                if (IsView() || p_recordBytes % sizeof(T) != 0 || p_recordBytes < sizeof(T) * cols) return ErrorCode::Fail;
+
+                SizeType R = this->R();
+                std::size_t stride = p_recordBytes / sizeof(T);
+                T* newData = (T*)Helper::AllocatePages(((size_t)R) * p_recordBytes, pagePolicy);
+                if (newData == nullptr) return ErrorCode::MemoryOverFlow;
+                std::memset((void*)newData, -1, ((size_t)R) * p_recordBytes);
+                for (SizeType i = 0; i < R; i++) {
+                    std::memcpy((void*)(newData + ((size_t)i) * stride), (void*)At(i), sizeof(T) * cols);
+                }
+
+                if (ownData) Helper::FreePages(data);
+                for (char* ptr : incBlocks) Helper::FreePages(ptr);
+                incBlocks.clear();
+                data = newData;
+                ownData = true;
+                rows = R;
+                incRows = 0;
+                rowStride = stride;
+                return ErrorCode::Success;
+            }
+
+            // Moves the first p_cols columns of the rows (all of them if p_cols is 0) into the records of p_owner,
+            // p_byteOffset bytes after the start of each record, and keeps reading and writing them there. Both
+            // datasets must have the same number of rows and the same block size, and rows the owner adds later
+            // show up here once AddBatch(num) claims them.
+            template <typename U>
+            ErrorCode ShareRows(Dataset<U>& p_owner, std::size_t p_byteOffset, DimensionType p_cols = 0)
+            {
+                DimensionType C = (p_cols > 0 && p_cols < cols) ? p_cols : cols;
+                std::size_t recordBytes = p_owner.rowStride * sizeof(U);
+                if (p_owner.IsView() || p_owner.R() != R() || p_owner.rowsInBlock != rowsInBlock ||
+                    recordBytes % sizeof(T) != 0 || p_byteOffset % sizeof(T) != 0 || p_byteOffset + sizeof(T) * C > recordBytes) return ErrorCode::Fail;
+
+                SizeType R = this->R();
+                for (SizeType i = 0; i < R; i++) {
+                    std::memcpy((char*)p_owner.At(i) + p_byteOffset, (void*)At(i), sizeof(T) * C);
+                }
+
+                Release();
+                cols = C;
+                data = (T*)((char*)p_owner.data + p_byteOffset);
+                rows = p_owner.rows;
+                incRows = p_owner.incRows;
+                rowStride = recordBytes / sizeof(T);
+                blocks = &p_owner.incBlocks;
+                blockOffset = p_byteOffset;
+                return ErrorCode::Success;
+            }
+
+            // Moves row order[i] to row i in place, with one temporary copy of the rows.
+            void Reorder(const std::vector<SizeType>& order)
+            {
+                SizeType R = (SizeType)(order.size());
+                std::vector<T> tmp(((size_t)R) * cols);
+                for (SizeType i = 0; i < R; i++) {
+                    std::memcpy(tmp.data() + ((size_t)i) * cols, (void*)this->At(order[i]), sizeof(T) * cols);
+                }
+                for (SizeType i = 0; i < R; i++) {
+                    std::memcpy((void*)this->At(i), tmp.data() + ((size_t)i) * cols, sizeof(T) * cols);
+                }
+            }
+
             ErrorCode Refine(const std::vector<SizeType>& indices, Dataset<T>& data) const
             {
                 SizeType R = (SizeType)(indices.size());
-                data.Initialize(R, cols, rowsInBlock + 1, static_cast<SizeType>(incBlocks.capacity() * (rowsInBlock + 1)));
+                data.Initialize(R, cols, rowsInBlock + 1, maxRows);
                 for (SizeType i = 0; i < R; i++) {
                     std::memcpy((void*)data.At(i), (void*)this->At(indices[i]), sizeof(T) * cols);
                 }
@@ -220,6 +323,18 @@ namespace SPTAG
                 if (ptr == nullptr || !ptr->Initialize(sDataPointsFileName.c_str(), std::ios::binary | std::ios::out)) return ErrorCode::FailedCreateFile;
                 return Refine(indices, ptr);
             }
+
+        private:
+            void Release()
+            {
+                if (ownData) Helper::FreePages(data);
+                for (char* ptr : incBlocks) Helper::FreePages(ptr);
+                incBlocks.clear();
+                data = nullptr;
+                ownData = false;
+                blocks = &incBlocks;
+                blockOffset = 0;
+            }
         };
     }
 }
@@ -18,14 +18,36 @@ namespace SPTAG
     {
         template <typename T>
         using DistanceCalcReturn = float(*)(const T*, const T*, DimensionType);
+
+        // Distance function of an index. A plain index calls the raw kernel pointer; only an index whose samples
+        // are codes binds the code distance of its quantizer, which the index keeps alive while the function is used.
+        template <typename T>
+        class DistanceCalcFunc
+        {
+        public:
+            DistanceCalcFunc(DistanceCalcReturn<T> p_fDistance = nullptr) : m_fDistance(p_fDistance) {}
+
+            DistanceCalcFunc(const IQuantizer* p_quantizer, bool p_L2) : m_pQuantizer(p_quantizer), m_bL2(p_L2) {}
+
+            inline float operator()(const T* pX, const T* pY, DimensionType length) const
+            {
+                if (m_pQuantizer == nullptr) return m_fDistance(pX, pY, length);
+                return m_bL2 ? m_pQuantizer->L2Distance((const std::uint8_t*)pX, (const std::uint8_t*)pY)
+                    : m_pQuantizer->CosineDistance((const std::uint8_t*)pX, (const std::uint8_t*)pY);
+            }
+
+        private:
+            DistanceCalcReturn<T> m_fDistance = nullptr;
+            const IQuantizer* m_pQuantizer = nullptr;
+            bool m_bL2 = true;
+        };
+
         template<typename T>
         inline DistanceCalcReturn<T> DistanceCalcSelector(SPTAG::DistCalcMethod p_method);
 
         class DistanceUtils
         {
         public:
-            static std::shared_ptr<IQuantizer> Quantizer;
-            
             template <typename T>
             static float ComputeL2Distance(const T* pX, const T* pY, DimensionType length)
             {
@@ -48,15 +70,27 @@ namespace SPTAG
 
             static float ComputeL2Distance_SSE(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
             static float ComputeL2Distance_AVX(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
 
             static float ComputeL2Distance_SSE(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
             static float ComputeL2Distance_AVX(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
 
             static float ComputeL2Distance_SSE(const std::int16_t* pX, const std::int16_t* pY, DimensionType length);
             static float ComputeL2Distance_AVX(const std::int16_t* pX, const std::int16_t* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const std::int16_t* pX, const std::int16_t* pY, DimensionType length);
 
             static float ComputeL2Distance_SSE(const float* pX, const float* pY, DimensionType length);
             static float ComputeL2Distance_AVX(const float* pX, const float* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const float* pX, const float* pY, DimensionType length);
+
+            static float ComputeL2Distance_AVX(const Float16* pX, const Float16* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const Float16* pX, const Float16* pY, DimensionType length);
+
+            static float ComputeL2Distance_AVX(const BFloat16* pX, const BFloat16* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const BFloat16* pX, const BFloat16* pY, DimensionType length);
 
             template <typename T>
             static float ComputeCosineDistance(const T* pX, const T* pY, DimensionType length)
@@ -80,16 +114,142 @@ namespace SPTAG
 
             static float ComputeCosineDistance_SSE(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
             static float ComputeCosineDistance_AVX(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
+            static float ComputeCosineDistance_AVX512(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
+            static float ComputeCosineDistance_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
 
             static float ComputeCosineDistance_SSE(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
             static float ComputeCosineDistance_AVX(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+            static float ComputeCosineDistance_AVX512(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+            static float ComputeCosineDistance_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
 
             static float ComputeCosineDistance_SSE(const std::int16_t* pX, const std::int16_t* pY, DimensionType length);
             static float ComputeCosineDistance_AVX(const std::int16_t* pX, const std::int16_t* pY, DimensionType length);
+            static float ComputeCosineDistance_AVX512(const std::int16_t* pX, const std::int16_t* pY, DimensionType length);
 
             static float ComputeCosineDistance_SSE(const float* pX, const float* pY, DimensionType length);
             static float ComputeCosineDistance_AVX(const float* pX, const float* pY, DimensionType length);
+            static float ComputeCosineDistance_AVX512(const float* pX, const float* pY, DimensionType length);
+
+            static float ComputeCosineDistance_AVX(const Float16* pX, const Float16* pY, DimensionType length);
+            static float ComputeCosineDistance_AVX512(const Float16* pX, const Float16* pY, DimensionType length);
+
+            static float ComputeCosineDistance_AVX(const BFloat16* pX, const BFloat16* pY, DimensionType length);
+            static float ComputeCosineDistance_AVX512(const BFloat16* pX, const BFloat16* pY, DimensionType length);
+
+
+            // Product quantization codes, one byte per subvector for 8-bit codes or two per byte (low nibble first)
+            // for 4-bit codes.
+            template <int Bits>
+            static inline std::uint8_t GetCode(const std::uint8_t* pCodes, DimensionType i)
+            {
+                if (Bits == 4) return (pCodes[i >> 1] >> ((i & 1) << 2)) & 0x0F;
+                return pCodes[i];
+            }
+
+            // Asymmetric distance: sums the query table entries (ks per subvector) picked by the codes of pCodes.
+            template <int Bits>
+            static float ComputeADCDistance(const float* pTable, const std::uint8_t* pCodes, DimensionType numSubvectors, SizeType ks)
+            {
+                float diff = 0;
+                for (DimensionType i = 0; i < numSubvectors; i++, pTable += ks) diff += pTable[GetCode<Bits>(pCodes, i)];
+                return diff;
+            }
+
+            template <int Bits>
+            static float ComputeADCDistance_AVX(const float* pTable, const std::uint8_t* pCodes, DimensionType numSubvectors, SizeType ks);
+            template <int Bits>
+            static float ComputeADCDistance_AVX512(const float* pTable, const std::uint8_t* pCodes, DimensionType numSubvectors, SizeType ks);
+
+            // Symmetric distance: sums the precomputed centroid pair distances (ks * ks per subvector) of two codes.
+            template <int Bits>
+            static float ComputeSDCDistance(const float* pTables, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType numSubvectors, SizeType ks)
+            {
+                float diff = 0;
+                SizeType blockSize = ks * ks;
+                for (DimensionType i = 0; i < numSubvectors; i++, pTables += blockSize) diff += pTables[GetCode<Bits>(pX, i) * ks + GetCode<Bits>(pY, i)];
+                return diff;
+            }
+
+            template <int Bits>
+            static float ComputeSDCDistance_AVX(const float* pTables, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType numSubvectors, SizeType ks);
+            template <int Bits>
+            static float ComputeSDCDistance_AVX512(const float* pTables, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType numSubvectors, SizeType ks);
+
+            // 4-bit fast scan over a block of 32 codes. The block holds, for every pair of subvectors, one byte per code
+            // with the first subvector in the low nibble; pLUT holds 16 quantized distances per subvector. pOut receives
+            // the 32 summed distances.
+            static void ComputeFastScanDistances(const std::uint8_t* pLUT, const std::uint8_t* pBlock, DimensionType numSubvectorPairs, std::uint16_t* pOut)
+            {
+                std::memset(pOut, 0, sizeof(std::uint16_t) * 32);
+                for (DimensionType p = 0; p < numSubvectorPairs; p++, pLUT += 32, pBlock += 32) {
+                    for (int k = 0; k < 32; k++) pOut[k] += pLUT[pBlock[k] & 0x0F] + pLUT[16 + (pBlock[k] >> 4)];
+                }
+            }
+
+            static void ComputeFastScanDistances_AVX(const std::uint8_t* pLUT, const std::uint8_t* pBlock, DimensionType numSubvectorPairs, std::uint16_t* pOut);
+
+            // Scalar quantization codes, one code per dimension laid out like the PQ codes above, decoding to
+            // pMin[i] + code * pScale[i]. The asymmetric L2 takes the query with pMin already subtracted.
+            template <int Bits>
+            static float ComputeSQL2Distance(const float* pQuery, const float* pScale, const std::uint8_t* pCodes, DimensionType length)
+            {
+                float diff = 0;
+                for (DimensionType i = 0; i < length; i++) {
+                    float d = pQuery[i] - GetCode<Bits>(pCodes, i) * pScale[i];
+                    diff += d * d;
+                }
+                return diff;
+            }
+
+            template <int Bits>
+            static float ComputeSQL2Distance_AVX(const float* pQuery, const float* pScale, const std::uint8_t* pCodes, DimensionType length);
+            template <int Bits>
+            static float ComputeSQL2Distance_AVX512(const float* pQuery, const float* pScale, const std::uint8_t* pCodes, DimensionType length);
 
+            // Asymmetric dot product of the codes with per dimension query weights (the query scaled by pScale).
+            template <int Bits>
+            static float ComputeSQDotProduct(const float* pWeights, const std::uint8_t* pCodes, DimensionType length)
+            {
+                float sum = 0;
+                for (DimensionType i = 0; i < length; i++) sum += pWeights[i] * GetCode<Bits>(pCodes, i);
+                return sum;
+            }
+
+            template <int Bits>
+            static float ComputeSQDotProduct_AVX(const float* pWeights, const std::uint8_t* pCodes, DimensionType length);
+            template <int Bits>
+            static float ComputeSQDotProduct_AVX512(const float* pWeights, const std::uint8_t* pCodes, DimensionType length);
+
+            // Symmetric L2 between two code vectors.
+            template <int Bits>
+            static float ComputeSQSDCL2Distance(const float* pScale, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+            {
+                float diff = 0;
+                for (DimensionType i = 0; i < length; i++) {
+                    float d = ((int)GetCode<Bits>(pX, i) - (int)GetCode<Bits>(pY, i)) * pScale[i];
+                    diff += d * d;
+                }
+                return diff;
+            }
+
+            template <int Bits>
+            static float ComputeSQSDCL2Distance_AVX(const float* pScale, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+            template <int Bits>
+            static float ComputeSQSDCL2Distance_AVX512(const float* pScale, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+
+            // Symmetric dot product of the two decoded vectors.
+            template <int Bits>
+            static float ComputeSQSDCDotProduct(const float* pMin, const float* pScale, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+            {
+                float sum = 0;
+                for (DimensionType i = 0; i < length; i++) sum += (pMin[i] + GetCode<Bits>(pX, i) * pScale[i]) * (pMin[i] + GetCode<Bits>(pY, i) * pScale[i]);
+                return sum;
+            }
+
+            template <int Bits>
+            static float ComputeSQSDCDotProduct_AVX(const float* pMin, const float* pScale, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+            template <int Bits>
+            static float ComputeSQSDCDotProduct_AVX512(const float* pMin, const float* pScale, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
 
             template<typename T>
             static inline float ComputeDistance(const T* p1, const T* p2, DimensionType length, SPTAG::DistCalcMethod distCalcMethod)
@@ -119,7 +279,11 @@ namespace SPTAG
             {
             case SPTAG::DistCalcMethod::InnerProduct:
             case SPTAG::DistCalcMethod::Cosine:
-                if (InstructionSet::AVX2() || (isSize4 && InstructionSet::AVX()))
+                if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512);
+                }
+                else if (InstructionSet::AVX2() || (isSize4 && InstructionSet::AVX()))
                 {
                     return &(DistanceUtils::ComputeCosineDistance_AVX);
                 }
@@ -132,7 +296,11 @@ namespace SPTAG
                 }
 
             case SPTAG::DistCalcMethod::L2:
-                if (InstructionSet::AVX2() || (isSize4 && InstructionSet::AVX()))
+                if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512);
+                }
+                else if (InstructionSet::AVX2() || (isSize4 && InstructionSet::AVX()))
                 {
                     return &(DistanceUtils::ComputeL2Distance_AVX);
                 }
@@ -150,6 +318,133 @@ namespace SPTAG
             return nullptr;
         }
 
+        template<>
+        inline DistanceCalcReturn<Float16> DistanceCalcSelector<Float16>(SPTAG::DistCalcMethod p_method)
+        {
+            switch (p_method)
+            {
+            case SPTAG::DistCalcMethod::InnerProduct:
+            case SPTAG::DistCalcMethod::Cosine:
+                if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512);
+                }
+                else if (InstructionSet::F16C() && InstructionSet::AVX())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX);
+                }
+                else {
+                    return &(DistanceUtils::ComputeCosineDistance<Float16>);
+                }
+
+            case SPTAG::DistCalcMethod::L2:
+                if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512);
+                }
+                else if (InstructionSet::F16C() && InstructionSet::AVX())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX);
+                }
+                else {
+                    return &(DistanceUtils::ComputeL2Distance<Float16>);
+                }
+            default:
+                break;
+            }
+            return nullptr;
+        }
+
+        template<>
+        inline DistanceCalcReturn<BFloat16> DistanceCalcSelector<BFloat16>(SPTAG::DistCalcMethod p_method)
+        {
+            switch (p_method)
+            {
+            case SPTAG::DistCalcMethod::InnerProduct:
+            case SPTAG::DistCalcMethod::Cosine:
+                if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512);
+                }
+                else if (InstructionSet::AVX2())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX);
+                }
+                else {
+                    return &(DistanceUtils::ComputeCosineDistance<BFloat16>);
+                }
+
+            case SPTAG::DistCalcMethod::L2:
+                if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512);
+                }
+                else if (InstructionSet::AVX2())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX);
+                }
+                else {
+                    return &(DistanceUtils::ComputeL2Distance<BFloat16>);
+                }
+            default:
+                break;
+            }
+            return nullptr;
+        }
+
+        template<>
+        inline DistanceCalcReturn<std::int8_t> DistanceCalcSelector<std::int8_t>(SPTAG::DistCalcMethod p_method)
+        {
+            switch (p_method)
+            {
+            case SPTAG::DistCalcMethod::InnerProduct:
+            case SPTAG::DistCalcMethod::Cosine:
+                if (InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512);
+                }
+                else if (InstructionSet::AVX2())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX);
+                }
+                else if (InstructionSet::SSE2())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_SSE);
+                }
+                else {
+                    return &(DistanceUtils::ComputeCosineDistance<std::int8_t>);
+                }
+
+            case SPTAG::DistCalcMethod::L2:
+                if (InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512);
+                }
+                else if (InstructionSet::AVX2())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX);
+                }
+                else if (InstructionSet::SSE2())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_SSE);
+                }
+                else {
+                    return &(DistanceUtils::ComputeL2Distance<std::int8_t>);
+                }
+            default:
+                break;
+            }
+            return nullptr;
+        }
+
         template<>
         inline DistanceCalcReturn<std::uint8_t> DistanceCalcSelector<std::uint8_t>(SPTAG::DistCalcMethod p_method)
         {
@@ -157,8 +452,13 @@ namespace SPTAG
             {
             case SPTAG::DistCalcMethod::InnerProduct:
             case SPTAG::DistCalcMethod::Cosine:
-                if (DistanceUtils::Quantizer) {
-                    return ([](const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length) {return DistanceUtils::Quantizer->CosineDistance(pX, pY); });
+                if (InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512);
                 }
                 else if (InstructionSet::AVX2())
                 {
@@ -173,8 +473,13 @@ namespace SPTAG
                 }
 
             case SPTAG::DistCalcMethod::L2:
-                if (DistanceUtils::Quantizer) {
-                    return ([](const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length) {return DistanceUtils::Quantizer->L2Distance(pX, pY); });
+                if (InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512);
                 }
                 else if (InstructionSet::AVX2())
                 {
@@ -192,6 +497,15 @@ namespace SPTAG
             }
             return nullptr;
         }
+
+        // Distance function of an index whose samples are the codes of p_quantizer, or the plain kernel for
+        // p_method when the index is not quantized. The caller keeps the quantizer alive.
+        template<typename T>
+        inline DistanceCalcFunc<T> DistanceCalcSelector(SPTAG::DistCalcMethod p_method, const std::shared_ptr<IQuantizer>& p_quantizer)
+        {
+            if (p_quantizer == nullptr) return DistanceCalcFunc<T>(DistanceCalcSelector<T>(p_method));
+            return DistanceCalcFunc<T>(p_quantizer.get(), p_method == SPTAG::DistCalcMethod::L2);
+        }
     }
 }
 
@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_FLOAT16_H_
+#define _SPTAG_COMMON_FLOAT16_H_
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace SPTAG
+{
+    // 16 bit storage types for vector values. They only store the bits; every arithmetic operation
+    // goes through float, so the generic templates can treat them like any other value type.
+    class Float16
+    {
+    public:
+        Float16() = default;
+
+        Float16(float p_value) : m_bits(FromFloat(p_value)) {}
+
+        operator float() const { return ToFloat(m_bits); }
+
+        inline std::uint16_t Bits() const { return m_bits; }
+
+        static inline Float16 FromBits(std::uint16_t p_bits) { Float16 f; f.m_bits = p_bits; return f; }
+
+        // IEEE 754 binary16, round to nearest even.
+        static inline std::uint16_t FromFloat(float p_value)
+        {
+            const std::uint32_t f32infty = 255U << 23;
+            const std::uint32_t f16max = (127U + 16) << 23;
+            const std::uint32_t denormMagic = ((127U - 15) + (23 - 10) + 1) << 23;
+
+            std::uint32_t x = AsUInt(p_value);
+            std::uint32_t sign = x & 0x80000000U;
+            x ^= sign;
+
+            std::uint16_t o;
+            if (x >= f16max) {
+                o = (x > f32infty) ? 0x7e00 : 0x7c00;
+            }
+            else if (x < (113U << 23)) {
+                o = (std::uint16_t)(AsUInt(AsFloat(x) + AsFloat(denormMagic)) - denormMagic);
+            }
+            else {
+                std::uint32_t mantOdd = (x >> 13) & 1;
+                x += ((std::uint32_t)(15 - 127) << 23) + 0xfff;
+                x += mantOdd;
+                o = (std::uint16_t)(x >> 13);
+            }
+            return (std::uint16_t)(o | (sign >> 16));
+        }
+
+        static inline float ToFloat(std::uint16_t p_bits)
+        {
+            const std::uint32_t shiftedExp = 0x7c00U << 13;
+
+            std::uint32_t o = (std::uint32_t)(p_bits & 0x7fff) << 13;
+            std::uint32_t exp = shiftedExp & o;
+            o += (127U - 15) << 23;
+            if (exp == shiftedExp) {
+                o += (128U - 16) << 23;
+            }
+            else if (exp == 0) {
+                o += 1U << 23;
+                o = AsUInt(AsFloat(o) - AsFloat(113U << 23));
+            }
+            o |= (std::uint32_t)(p_bits & 0x8000) << 16;
+            return AsFloat(o);
+        }
+
+    private:
+        static inline std::uint32_t AsUInt(float p_value) { std::uint32_t u; std::memcpy(&u, &p_value, sizeof(u)); return u; }
+
+        static inline float AsFloat(std::uint32_t p_value) { float f; std::memcpy(&f, &p_value, sizeof(f)); return f; }
+
+        std::uint16_t m_bits;
+    };
+
+    class BFloat16
+    {
+    public:
+        BFloat16() = default;
+
+        BFloat16(float p_value) : m_bits(FromFloat(p_value)) {}
+
+        operator float() const { return ToFloat(m_bits); }
+
+        inline std::uint16_t Bits() const { return m_bits; }
+
+        static inline BFloat16 FromBits(std::uint16_t p_bits) { BFloat16 f; f.m_bits = p_bits; return f; }
+
+        // Upper half of a binary32, round to nearest even.
+        static inline std::uint16_t FromFloat(float p_value)
+        {
+            std::uint32_t x;
+            std::memcpy(&x, &p_value, sizeof(x));
+            if ((x & 0x7fffffffU) > 0x7f800000U) return (std::uint16_t)((x >> 16) | 0x40);
+            x += 0x7fffU + ((x >> 16) & 1);
+            return (std::uint16_t)(x >> 16);
+        }
+
+        static inline float ToFloat(std::uint16_t p_bits)
+        {
+            std::uint32_t x = (std::uint32_t)p_bits << 16;
+            float f;
+            std::memcpy(&f, &x, sizeof(f));
+            return f;
+        }
+
+    private:
+        std::uint16_t m_bits;
+    };
+
+    static_assert(sizeof(Float16) == 2 && sizeof(BFloat16) == 2, "16 bit value types must not be padded!");
+    static_assert(std::is_trivial<Float16>::value && std::is_trivial<BFloat16>::value, "16 bit value types must stay trivial for raw vector buffers!");
+}
+
+namespace std
+{
+    template<>
+    class numeric_limits<SPTAG::Float16> : public numeric_limits<float>
+    {
+    public:
+        static SPTAG::Float16 (min)() { return SPTAG::Float16::FromBits(0x0400); }
+        static SPTAG::Float16 (max)() { return SPTAG::Float16::FromBits(0x7bff); }
+        static SPTAG::Float16 lowest() { return SPTAG::Float16::FromBits(0xfbff); }
+        static SPTAG::Float16 epsilon() { return SPTAG::Float16::FromBits(0x1400); }
+        static SPTAG::Float16 infinity() { return SPTAG::Float16::FromBits(0x7c00); }
+        static const int digits = 11;
+    };
+
+    template<>
+    class numeric_limits<SPTAG::BFloat16> : public numeric_limits<float>
+    {
+    public:
+        static SPTAG::BFloat16 (min)() { return SPTAG::BFloat16::FromBits(0x0080); }
+        static SPTAG::BFloat16 (max)() { return SPTAG::BFloat16::FromBits(0x7f7f); }
+        static SPTAG::BFloat16 lowest() { return SPTAG::BFloat16::FromBits(0xff7f); }
+        static SPTAG::BFloat16 epsilon() { return SPTAG::BFloat16::FromBits(0x3c00); }
+        static SPTAG::BFloat16 infinity() { return SPTAG::BFloat16::FromBits(0x7f80); }
+        static const int digits = 8;
+    };
+}
+
+#endif // _SPTAG_COMMON_FLOAT16_H_
@@ -14,9 +14,15 @@ namespace SPTAG
         class IQuantizer
         {
         public:
-            virtual float L2Distance(const std::uint8_t* pX, const std::uint8_t* pY) = 0;
+            inline float L2Distance(const std::uint8_t* pX, const std::uint8_t* pY) const
+            {
+                return m_fL2Distance(this, pX, pY);
+            }
 
-            virtual float CosineDistance(const std::uint8_t* pX, const std::uint8_t* pY) = 0;
+            inline float CosineDistance(const std::uint8_t* pX, const std::uint8_t* pY) const
+            {
+                return m_fCosineDistance(this, pX, pY);
+            }
 
             virtual void QuantizeVector(const void* vec, std::uint8_t* vecout) = 0;
 
@@ -34,7 +40,7 @@ namespace SPTAG
 
             virtual ErrorCode LoadQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_in) = 0;
 
-            static ErrorCode LoadIQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_in);
+            static ErrorCode LoadIQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_in, std::shared_ptr<IQuantizer>& p_quantizer);
 
             virtual bool GetEnableADC() = 0;
 
@@ -47,6 +53,28 @@ namespace SPTAG
             virtual DimensionType GetNumSubvectors() const = 0;
 
             virtual int GetBase() = 0;
+
+            // 4-bit fast scan over blocks of 32 codes, see PQQuantizer. FastScanTableSize is 0 for quantizers without it.
+            virtual SizeType FastScanTableSize() const = 0;
+
+            virtual void QuantizeFastScanTable(const void* vec, std::uint8_t* tableout) const = 0;
+
+            // Bound on the difference between a fast scan distance and the ADC L2 distance of the same code.
+            virtual float FastScanTolerance(const std::uint8_t* table) const = 0;
+
+            virtual SizeType FastScanBlockSize() const = 0;
+
+            virtual void PackFastScanBlock(const std::uint8_t* codes, SizeType p_stride, SizeType p_num, std::uint8_t* blockout) const = 0;
+
+            virtual void ComputeFastScanDistances(const std::uint8_t* table, const std::uint8_t* block, float* distout) const = 0;
+
+        protected:
+            typedef float (*CodeDistanceFunc)(const IQuantizer*, const std::uint8_t*, const std::uint8_t*);
+
+            // Bound by the implementation to the kernels for its code layout, ADC mode and CPU, so the
+            // distance calls of the search loops do not go through the vtable.
+            CodeDistanceFunc m_fL2Distance = nullptr;
+            CodeDistanceFunc m_fCosineDistance = nullptr;
         };
     }
 }
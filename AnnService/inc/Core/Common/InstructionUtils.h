@@ -29,6 +29,9 @@ namespace SPTAG {
             static bool SSE(void);
             static bool SSE2(void);
             static bool AVX2(void);
+            static bool F16C(void);
+            static bool AVX512(void);
+            static bool AVX512VNNI(void);
             static void PrintInstructionSet(void);
 
         private:
@@ -42,6 +45,9 @@ namespace SPTAG {
                 bool HW_SSE2;
                 bool HW_AVX;
                 bool HW_AVX2;
+                bool HW_F16C;
+                bool HW_AVX512;
+                bool HW_AVX512VNNI;
             };
         };
     }
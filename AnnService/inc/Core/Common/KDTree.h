@@ -48,10 +48,10 @@ namespace SPTAG
             }
 
             template <typename T>
-            void Rebuild(const Dataset<T>& data, IAbortOperation* abort)
+            void Rebuild(const Dataset<T>& data, const std::shared_ptr<IQuantizer>& quantizer, IAbortOperation* abort)
             {
                 COMMON::KDTree newTrees(*this);
-                newTrees.BuildTrees<T>(data, 1, nullptr, abort);
+                newTrees.BuildTrees<T>(data, 1, nullptr, abort, quantizer);
 
                 std::unique_lock<std::shared_timed_mutex> lock(*m_lock);
                 m_pTreeRoots.swap(newTrees.m_pTreeRoots);
@@ -59,15 +59,16 @@ namespace SPTAG
             }
 
             template <typename T>
-            void BuildTrees(const Dataset<T>& data, int numOfThreads, std::vector<SizeType>* indices = nullptr, IAbortOperation* abort = nullptr)
+            void BuildTrees(const Dataset<T>& data, int numOfThreads, std::vector<SizeType>* indices = nullptr, IAbortOperation* abort = nullptr,
+                const std::shared_ptr<IQuantizer>& quantizer = nullptr)
             {
-                if (COMMON::DistanceUtils::Quantizer)
+                if (quantizer)
                 {
-                    switch (COMMON::DistanceUtils::Quantizer->GetReconstructType())
+                    switch (quantizer->GetReconstructType())
                     {
 #define DefineVectorValueType(Name, Type) \
 case VectorValueType::Name: \
-BuildTreesCore<T, Type>(data, numOfThreads, indices, abort); \
+BuildTreesCore<T, Type>(data, numOfThreads, indices, abort, quantizer.get()); \
 break;
 
 #include "inc/Core/DefinitionList.h"
@@ -78,12 +79,12 @@ break;
                 }
                 else
                 {
-                    BuildTreesCore<T, T>(data, numOfThreads, indices, abort);
+                    BuildTreesCore<T, T>(data, numOfThreads, indices, abort, nullptr);
                 }
             }
 
             template <typename T, typename R>
-            void BuildTreesCore(const Dataset<T>& data, int numOfThreads, std::vector<SizeType>* indices = nullptr, IAbortOperation* abort = nullptr)
+            void BuildTreesCore(const Dataset<T>& data, int numOfThreads, std::vector<SizeType>* indices, IAbortOperation* abort, IQuantizer* quantizer)
             {
                 std::vector<SizeType> localindices;
                 if (indices == nullptr) {
@@ -109,7 +110,7 @@ break;
                     m_pTreeStart[i] = i * (SizeType)pindices.size();
                     LOG(Helper::LogLevel::LL_Info, "Start to build KDTree %d\n", i + 1);
                     SizeType iTreeSize = m_pTreeStart[i];
-                    DivideTree<T, R>(data, pindices, 0, (SizeType)pindices.size() - 1, m_pTreeStart[i], iTreeSize, abort);
+                    DivideTree<T, R>(data, pindices, 0, (SizeType)pindices.size() - 1, m_pTreeStart[i], iTreeSize, quantizer, abort);
                     LOG(Helper::LogLevel::LL_Info, "%d KDTree built, %d %zu\n", i + 1, iTreeSize - m_pTreeStart[i], pindices.size());
                 }
             }
@@ -211,7 +212,7 @@ break;
             }
 
             template <typename T>
-            void InitSearchTrees(const Dataset<T>& p_data, float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length), COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const
+            void InitSearchTrees(const Dataset<T>& p_data, const DistanceCalcFunc<T>& fComputeDistance, COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const
             {
                 for (int i = 0; i < m_iTreeNumber; i++) {
                     KDTSearch(p_data, fComputeDistance, p_query, p_space, m_pTreeStart[i], 0);
@@ -219,7 +220,7 @@ break;
             }
 
             template <typename T>
-            void SearchTrees(const Dataset<T>& p_data, float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length), COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, const int p_limits) const
+            void SearchTrees(const Dataset<T>& p_data, const DistanceCalcFunc<T>& fComputeDistance, COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, const int p_limits) const
             {
                 while (!p_space.m_SPTQueue.empty() && p_space.m_iNumberOfCheckedLeaves < p_limits)
                 {
@@ -231,12 +232,12 @@ break;
         private:
 
             template <typename T>
-            void KDTSearch(const Dataset<T>& p_data, float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length), COMMON::QueryResultSet<T>& p_query,
+            void KDTSearch(const Dataset<T>& p_data, const DistanceCalcFunc<T>& fComputeDistance, COMMON::QueryResultSet<T>& p_query,
                 COMMON::WorkSpace& p_space, const SizeType node, const float distBound) const
             {
-                if (COMMON::DistanceUtils::Quantizer)
+                if (p_query.GetQuantizer())
                 {
-                    switch (COMMON::DistanceUtils::Quantizer->GetReconstructType())
+                    switch (p_query.GetQuantizer()->GetReconstructType())
                     {
 #define DefineVectorValueType(Name, Type) \
 case VectorValueType::Name: \
@@ -256,7 +257,7 @@ return KDTSearchCore<T, Type>(p_data, fComputeDistance, p_query, p_space, node,
             }
 
             template <typename T, typename Q>
-            void KDTSearchCore(const Dataset<T>& p_data, float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length), COMMON::QueryResultSet<T> &p_query,
+            void KDTSearchCore(const Dataset<T>& p_data, const DistanceCalcFunc<T>& fComputeDistance, COMMON::QueryResultSet<T> &p_query,
                            COMMON::WorkSpace& p_space, const SizeType node, const float distBound) const {
                 if (node < 0)
                 {
@@ -298,11 +299,11 @@ return KDTSearchCore<T, Type>(p_data, fComputeDistance, p_query, p_space, node,
 
             template <typename T, typename R>
             void DivideTree(const Dataset<T>& data, std::vector<SizeType>& indices, SizeType first, SizeType last,
-                SizeType index, SizeType &iTreeSize, IAbortOperation* abort = nullptr) {
+                SizeType index, SizeType &iTreeSize, IQuantizer* quantizer, IAbortOperation* abort = nullptr) {
                 if (abort && abort->ShouldAbort()) return;
 
-                ChooseDivision<T, R>(data, m_pTreeRoots[index], indices, first, last);
-                SizeType i = Subdivide<T, R>(data, m_pTreeRoots[index], indices, first, last);
+                ChooseDivision<T, R>(data, m_pTreeRoots[index], indices, first, last, quantizer);
+                SizeType i = Subdivide<T, R>(data, m_pTreeRoots[index], indices, first, last, quantizer);
                 if (i - 1 <= first)
                 {
                     m_pTreeRoots[index].left = -indices[first] - 1;
@@ -311,7 +312,7 @@ return KDTSearchCore<T, Type>(p_data, fComputeDistance, p_query, p_space, node,
                 {
                     iTreeSize++;
                     m_pTreeRoots[index].left = iTreeSize;
-                    DivideTree<T, R>(data, indices, first, i - 1, iTreeSize, iTreeSize);
+                    DivideTree<T, R>(data, indices, first, i - 1, iTreeSize, iTreeSize, quantizer);
                 }
                 if (last == i)
                 {
@@ -321,20 +322,20 @@ return KDTSearchCore<T, Type>(p_data, fComputeDistance, p_query, p_space, node,
                 {
                     iTreeSize++;
                     m_pTreeRoots[index].right = iTreeSize;
-                    DivideTree<T, R>(data, indices, i, last, iTreeSize, iTreeSize);
+                    DivideTree<T, R>(data, indices, i, last, iTreeSize, iTreeSize, quantizer);
                 }
             }
 
             template <typename T, typename R>
-            void ChooseDivision(const Dataset<T>& data, KDTNode& node, const std::vector<SizeType>& indices, const SizeType first, const SizeType last)
+            void ChooseDivision(const Dataset<T>& data, KDTNode& node, const std::vector<SizeType>& indices, const SizeType first, const SizeType last, IQuantizer* quantizer)
             {
                 SizeType cols = data.C();
-                bool quantizer_exists = (nullptr != COMMON::DistanceUtils::Quantizer);
+                bool quantizer_exists = (nullptr != quantizer);
                 R* v_holder = nullptr;
                 if (quantizer_exists)
                 {
-                    cols = COMMON::DistanceUtils::Quantizer->ReconstructDim();
-                    v_holder = (R*)_mm_malloc(COMMON::DistanceUtils::Quantizer->ReconstructSize(), ALIGN_SPTAG);
+                    cols = quantizer->ReconstructDim();
+                    v_holder = (R*)_mm_malloc(quantizer->ReconstructSize(), ALIGN_SPTAG);
                 }
                 std::vector<float> meanValues(cols, 0);
                 std::vector<float> varianceValues(cols, 0);
@@ -346,7 +347,7 @@ return KDTSearchCore<T, Type>(p_data, fComputeDistance, p_query, p_space, node,
                     R* v;
                     if (quantizer_exists)
                     {
-                        COMMON::DistanceUtils::Quantizer->ReconstructVector((uint8_t*)data[indices[j]], v_holder);
+                        quantizer->ReconstructVector((uint8_t*)data[indices[j]], v_holder);
                         v = v_holder;
                     } 
                     else
@@ -368,7 +369,7 @@ return KDTSearchCore<T, Type>(p_data, fComputeDistance, p_query, p_space, node,
                     R* v;
                     if (quantizer_exists)
                     {
-                        COMMON::DistanceUtils::Quantizer->ReconstructVector((uint8_t*)data[indices[j]], v_holder);
+                        quantizer->ReconstructVector((uint8_t*)data[indices[j]], v_holder);
                         v = v_holder;
                     }
                     else
@@ -423,15 +424,15 @@ return KDTSearchCore<T, Type>(p_data, fComputeDistance, p_query, p_space, node,
             }
 
             template <typename T, typename R>
-            SizeType Subdivide(const Dataset<T>& data, const KDTNode& node, std::vector<SizeType>& indices, const SizeType first, const SizeType last) const
+            SizeType Subdivide(const Dataset<T>& data, const KDTNode& node, std::vector<SizeType>& indices, const SizeType first, const SizeType last, IQuantizer* quantizer) const
             {
                 SizeType i = first;
                 SizeType j = last;
-                bool quantizer_exists = (bool) COMMON::DistanceUtils::Quantizer;
+                bool quantizer_exists = (nullptr != quantizer);
                 R* v_holder = nullptr;
                 if (quantizer_exists)
                 {
-                    v_holder = (R*)_mm_malloc(COMMON::DistanceUtils::Quantizer->ReconstructSize(), ALIGN_SPTAG);
+                    v_holder = (R*)_mm_malloc(quantizer->ReconstructSize(), ALIGN_SPTAG);
                 }
                 // decide which child one point belongs
                 while (i <= j)
@@ -440,7 +441,7 @@ return KDTSearchCore<T, Type>(p_data, fComputeDistance, p_query, p_space, node,
                     SizeType ind = indices[i];
                     if (quantizer_exists)
                     {
-                        COMMON::DistanceUtils::Quantizer->ReconstructVector((uint8_t*)data[ind], v_holder);
+                        quantizer->ReconstructVector((uint8_t*)data[ind], v_holder);
                         v = v_holder;
                     } 
                     else
@@ -11,49 +11,122 @@ namespace SPTAG
 {
     namespace COMMON
     {
+        // One bit per vector, kept in fixed size blocks so that AddBatch never moves existing labels
+        // while searches read them. On disk it keeps the one byte per vector layout of the old
+        // Dataset<std::int8_t> based set (1 for labeled, -1 otherwise), so existing indexes still load.
         class Labelset
         {
         private:
+            typedef std::atomic<std::uint64_t> Word;
+
+            std::string m_name;
             std::atomic<SizeType> m_inserted;
-            Dataset<std::int8_t> m_data;
-            
+            SizeType m_rows = 0;
+            SizeType m_maxRows = 0;
+            SizeType m_wordsInBlockEx = 0;
+            SizeType m_wordsInBlock = 0;
+            std::vector<Word*> m_blocks;
+
+            inline Word& GetWord(SizeType key) const
+            {
+                SizeType word = (key >> 6);
+                return m_blocks[word >> m_wordsInBlockEx][word & m_wordsInBlock];
+            }
+
+            inline ErrorCode Reserve(SizeType rows)
+            {
+                SizeType words = (rows + 63) >> 6;
+                while (((SizeType)m_blocks.size() << m_wordsInBlockEx) < words) {
+                    Word* newBlock = new (std::nothrow) Word[(size_t)m_wordsInBlock + 1]();
+                    if (newBlock == nullptr) return ErrorCode::MemoryOverFlow;
+                    m_blocks.push_back(newBlock);
+                }
+                return ErrorCode::Success;
+            }
+
+            inline void Clear()
+            {
+                for (Word* ptr : m_blocks) delete[] ptr;
+                m_blocks.clear();
+                m_rows = 0;
+            }
+
         public:
-            Labelset() 
+            Labelset() : m_name("DeleteID")
             {
                 m_inserted = 0;
-                m_data.SetName("DeleteID");
             }
 
+            ~Labelset()
+            {
+                Clear();
+            }
+
+            void SetName(const std::string& name) { m_name = name; }
+
+            const std::string& Name() const { return m_name; }
+
             void Initialize(SizeType size, SizeType blockSize, SizeType capacity)
             {
-                m_data.Initialize(size, 1, blockSize, capacity);
+                Clear();
+                m_inserted = 0;
+                m_maxRows = capacity;
+                SizeType wordsInBlock = max((SizeType)1, (blockSize + 63) >> 6);
+                m_wordsInBlockEx = static_cast<SizeType>(ceil(log2(wordsInBlock)));
+                m_wordsInBlock = (1 << m_wordsInBlockEx) - 1;
+                m_blocks.reserve((((static_cast<std::int64_t>(capacity) + 63) >> 6) + m_wordsInBlock) >> m_wordsInBlockEx);
+                if (Reserve(size) == ErrorCode::Success) m_rows = size;
             }
 
             inline size_t Count() const { return m_inserted.load(); }
 
+            inline SizeType R() const { return m_rows; }
+
             inline bool Contains(const SizeType& key) const
             {
-                return *m_data[key] == 1;
+                return (GetWord(key).load(std::memory_order_relaxed) & ((std::uint64_t)1 << (key & 63))) != 0;
             }
 
             inline bool Insert(const SizeType& key)
             {
-                char oldvalue = InterlockedExchange8((char*)m_data[key], 1);
-                if (oldvalue == 1) return false;
+                std::uint64_t bit = ((std::uint64_t)1 << (key & 63));
+                if (GetWord(key).fetch_or(bit) & bit) return false;
                 m_inserted++;
                 return true;
             }
 
+            inline bool Remove(const SizeType& key)
+            {
+                std::uint64_t bit = ((std::uint64_t)1 << (key & 63));
+                if (!(GetWord(key).fetch_and(~bit) & bit)) return false;
+                m_inserted--;
+                return true;
+            }
+
             inline ErrorCode Save(std::shared_ptr<Helper::DiskPriorityIO> output)
             {
                 SizeType deleted = m_inserted.load();
                 IOBINARY(output, WriteBinary, sizeof(SizeType), (char*)&deleted);
-                return m_data.Save(output);
+
+                SizeType rows = m_rows;
+                DimensionType cols = 1;
+                IOBINARY(output, WriteBinary, sizeof(SizeType), (char*)&rows);
+                IOBINARY(output, WriteBinary, sizeof(DimensionType), (char*)&cols);
+
+                const SizeType batch = 1 << 16;
+                std::vector<std::int8_t> buffer(batch);
+                for (SizeType begin = 0; begin < rows; begin += batch) {
+                    SizeType num = min(batch, rows - begin);
+                    for (SizeType i = 0; i < num; i++) buffer[i] = Contains(begin + i) ? 1 : -1;
+                    IOBINARY(output, WriteBinary, sizeof(std::int8_t) * num, (char*)buffer.data());
+                }
+                LOG(Helper::LogLevel::LL_Info, "Save %s (%d,%d) Finish!\n", m_name.c_str(), rows, cols);
+                return ErrorCode::Success;
             }
 
             inline ErrorCode Save(std::string filename)
             {
-                LOG(Helper::LogLevel::LL_Info, "Save %s To %s\n", m_data.Name().c_str(), filename.c_str());
+                LOG(Helper::LogLevel::LL_Info, "Save %s To %s\n", m_name.c_str(), filename.c_str());
                 auto ptr = f_createIO();
                 if (ptr == nullptr || !ptr->Initialize(filename.c_str(), std::ios::binary | std::ios::out)) return ErrorCode::FailedCreateFile;
                 return Save(ptr);
@@ -61,15 +134,29 @@ namespace SPTAG
 
             inline ErrorCode Load(std::shared_ptr<Helper::DiskPriorityIO> input, SizeType blockSize, SizeType capacity)
             {
-                SizeType deleted;
+                SizeType deleted, rows;
+                DimensionType cols;
                 IOBINARY(input, ReadBinary, sizeof(SizeType), (char*)&deleted);
-                m_inserted = deleted;
-                return m_data.Load(input, blockSize, capacity);
+                IOBINARY(input, ReadBinary, sizeof(SizeType), (char*)&rows);
+                IOBINARY(input, ReadBinary, sizeof(DimensionType), (char*)&cols);
+
+                Initialize(rows, blockSize, capacity);
+                if (m_rows != rows) return ErrorCode::MemoryOverFlow;
+
+                const SizeType batch = 1 << 16;
+                std::vector<std::int8_t> buffer(batch);
+                for (SizeType begin = 0; begin < rows; begin += batch) {
+                    SizeType num = min(batch, rows - begin);
+                    IOBINARY(input, ReadBinary, sizeof(std::int8_t) * num, (char*)buffer.data());
+                    for (SizeType i = 0; i < num; i++) if (buffer[i] == 1) Insert(begin + i);
+                }
+                LOG(Helper::LogLevel::LL_Info, "Load %s (%d,%d) Finish!\n", m_name.c_str(), rows, cols);
+                return ErrorCode::Success;
             }
 
             inline ErrorCode Load(std::string filename, SizeType blockSize, SizeType capacity)
             {
-                LOG(Helper::LogLevel::LL_Info, "Load %s From %s\n", m_data.Name().c_str(), filename.c_str());
+                LOG(Helper::LogLevel::LL_Info, "Load %s From %s\n", m_name.c_str(), filename.c_str());
                 auto ptr = f_createIO();
                 if (ptr == nullptr || !ptr->Initialize(filename.c_str(), std::ios::binary | std::ios::in)) return ErrorCode::FailedOpenFile;
                 return Load(ptr, blockSize, capacity);
@@ -77,23 +164,39 @@ namespace SPTAG
 
             inline ErrorCode Load(char* pmemoryFile, SizeType blockSize, SizeType capacity)
             {
-                m_inserted = *((SizeType*)pmemoryFile);
-                return m_data.Load(pmemoryFile + sizeof(SizeType), blockSize, capacity);
+                pmemoryFile += sizeof(SizeType);
+                SizeType rows = *((SizeType*)pmemoryFile);
+                pmemoryFile += sizeof(SizeType);
+                DimensionType cols = *((DimensionType*)pmemoryFile);
+                pmemoryFile += sizeof(DimensionType);
+
+                Initialize(rows, blockSize, capacity);
+                if (m_rows != rows) return ErrorCode::MemoryOverFlow;
+
+                const std::int8_t* labels = (const std::int8_t*)pmemoryFile;
+                for (SizeType i = 0; i < rows; i++) if (labels[i] == 1) Insert(i);
+                LOG(Helper::LogLevel::LL_Info, "Load %s (%d,%d) Finish!\n", m_name.c_str(), rows, cols);
+                return ErrorCode::Success;
             }
 
             inline ErrorCode AddBatch(SizeType num)
             {
-                return m_data.AddBatch(num);
+                if (m_rows > m_maxRows - num) return ErrorCode::MemoryOverFlow;
+
+                ErrorCode ret;
+                if ((ret = Reserve(m_rows + num)) != ErrorCode::Success) return ret;
+                m_rows += num;
+                return ErrorCode::Success;
             }
 
-            inline std::uint64_t BufferSize() const 
+            inline std::uint64_t BufferSize() const
             {
-                return m_data.BufferSize() + sizeof(SizeType);
+                return sizeof(SizeType) + sizeof(SizeType) + sizeof(DimensionType) + sizeof(std::int8_t) * m_rows;
             }
 
             inline void SetR(SizeType num)
             {
-                m_data.SetR(num);
+                if (Reserve(num) == ErrorCode::Success) m_rows = num;
             }
         };
     }
@@ -14,6 +14,8 @@
 #include <chrono>
 #include <queue>
 #include <atomic>
+#include <algorithm>
+#include <unordered_set>
 
 #if defined(GPU)
 #include <cuda.h>
@@ -74,7 +76,7 @@ namespace SPTAG
                     for (SizeType y = 0; y < m_iGraphSize; y++)
                     {
                         if ((idmap != nullptr && idmap->find(y) != idmap->end())) continue;
-                        float dist = index->ComputeDistance(index->GetSample(x), index->GetSample(y));
+                        float dist = index->ComputeDistance(index->GetInternalSample(x), index->GetInternalSample(y));
                         query.AddPoint(y, dist);
                     }
                     query.SortResult();
@@ -127,9 +129,9 @@ namespace SPTAG
             void PartitionByTptree(VectorIndex* index, std::vector<SizeType>& indices, const SizeType first, const SizeType last,
                 std::vector<std::pair<SizeType, SizeType>>& leaves)
             {
-                if (COMMON::DistanceUtils::Quantizer)
+                if (index->GetQuantizer())
                 {
-                    switch (COMMON::DistanceUtils::Quantizer->GetReconstructType())
+                    switch (index->GetQuantizer()->GetReconstructType())
                     {
 #define DefineVectorValueType(Name, Type) \
 case VectorValueType::Name: \
@@ -159,11 +161,11 @@ break;
                 else
                 {
                     SizeType cols = index->GetFeatureDim();
-                    bool quantizer_exists = (bool)COMMON::DistanceUtils::Quantizer;
+                    bool quantizer_exists = (bool)index->GetQuantizer();
                     R* v_holder = nullptr;
                     if (quantizer_exists) {
-                        cols = COMMON::DistanceUtils::Quantizer->ReconstructDim();
-                        v_holder = (R*)_mm_malloc(COMMON::DistanceUtils::Quantizer->ReconstructSize(), ALIGN_SPTAG);
+                        cols = index->GetQuantizer()->ReconstructDim();
+                        v_holder = (R*)_mm_malloc(index->GetQuantizer()->ReconstructSize(), ALIGN_SPTAG);
                     }
                     std::vector<float> Mean(cols, 0);
 
@@ -176,12 +178,12 @@ break;
                         R* v;
                         if (quantizer_exists)
                         {
-                            COMMON::DistanceUtils::Quantizer->ReconstructVector((uint8_t*)index->GetSample(indices[j]), v_holder);
+                            index->GetQuantizer()->ReconstructVector((uint8_t*)index->GetInternalSample(indices[j]), v_holder);
                             v = v_holder;
                         }
                         else
                         {
-                            v = (R*)index->GetSample(indices[j]);
+                            v = (R*)index->GetInternalSample(indices[j]);
                         }
 
                         for (DimensionType k = 0; k < cols; k++)
@@ -205,12 +207,12 @@ break;
                         R* v;
                         if (quantizer_exists)
                         {
-                            COMMON::DistanceUtils::Quantizer->ReconstructVector((uint8_t*)index->GetSample(indices[j]), v_holder);
+                            index->GetQuantizer()->ReconstructVector((uint8_t*)index->GetInternalSample(indices[j]), v_holder);
                             v = v_holder;
                         }
                         else
                         {
-                            v = (R*)index->GetSample(indices[j]);
+                            v = (R*)index->GetInternalSample(indices[j]);
                         }
 
                         for (DimensionType k = 0; k < cols; k++)
@@ -252,12 +254,12 @@ break;
                             R* v;
                             if (quantizer_exists)
                             {
-                                COMMON::DistanceUtils::Quantizer->ReconstructVector((uint8_t*)index->GetSample(indices[first + j]), v_holder);
+                                index->GetQuantizer()->ReconstructVector((uint8_t*)index->GetInternalSample(indices[first + j]), v_holder);
                                 v = v_holder;
                             }
                             else
                             {
-                                v = (R*)index->GetSample(indices[first + j]);
+                                v = (R*)index->GetInternalSample(indices[first + j]);
                             }
                             for (int k = 0; k < m_numTopDimensionTPTSplit; k++)
                             {
@@ -291,12 +293,12 @@ break;
                         R* v;
                         if (quantizer_exists)
                         {
-                            COMMON::DistanceUtils::Quantizer->ReconstructVector((uint8_t*)index->GetSample(indices[i]), v_holder);
+                            index->GetQuantizer()->ReconstructVector((uint8_t*)index->GetInternalSample(indices[i]), v_holder);
                             v = v_holder;
                         }
                         else
                         {
-                            v = (R*)index->GetSample(indices[i]);
+                            v = (R*)index->GetInternalSample(indices[i]);
                         }
 
                         for (int k = 0; k < m_numTopDimensionTPTSplit; k++)
@@ -372,7 +374,7 @@ break;
                             {
                                 SizeType p1 = TptreeDataIndices[i][x];
                                 SizeType p2 = TptreeDataIndices[i][y];
-                                float dist = index->ComputeDistance(index->GetSample(p1), index->GetSample(p2));
+                                float dist = index->ComputeDistance(index->GetInternalSample(p1), index->GetInternalSample(p2));
                                 if (idmap != nullptr) {
                                     p1 = (idmap->find(p1) == idmap->end()) ? p1 : idmap->at(p1);
                                     p2 = (idmap->find(p2) == idmap->end()) ? p2 : idmap->at(p2);
@@ -545,7 +547,7 @@ break;
 
                     SizeType* outnodes = newGraph->m_pNeighborhoodGraph[i];
 
-                    COMMON::QueryResultSet<T> query((const T*)index->GetSample(indices[i]), m_iCEF + 1);
+                    COMMON::QueryResultSet<T> query((const T*)index->GetInternalSample(indices[i]), m_iCEF + 1);
                     index->RefineSearchIndex(query, false);
                     RebuildNeighbors(index, indices[i], outnodes, query.GetResults(), m_iCEF + 1);
 
@@ -566,11 +568,11 @@ break;
             template <typename T>
             void RefineNode(VectorIndex* index, const SizeType node, bool updateNeighbors, bool searchDeleted, int CEF)
             {
-                COMMON::QueryResultSet<T> query((const T*)index->GetSample(node), CEF + 1);
+                COMMON::QueryResultSet<T> query((const T*)index->GetInternalSample(node), CEF + 1);
                 void* rec_query = nullptr;
-                if (COMMON::DistanceUtils::Quantizer) {
-                    rec_query = _mm_malloc(COMMON::DistanceUtils::Quantizer->ReconstructSize(), ALIGN_SPTAG);
-                    COMMON::DistanceUtils::Quantizer->ReconstructVector((const uint8_t*)query.GetTarget(), rec_query);
+                if (index->GetQuantizer()) {
+                    rec_query = _mm_malloc(index->GetQuantizer()->ReconstructSize(), ALIGN_SPTAG);
+                    index->GetQuantizer()->ReconstructVector((const uint8_t*)query.GetTarget(), rec_query);
                     query.SetTarget((T*)rec_query);
                 }
                 index->RefineSearchIndex(query, searchDeleted);
@@ -592,6 +594,124 @@ break;
                 }
             }
 
+            // RefineNode with updated neighbors for a node that other threads link their own new nodes to at the
+            // same time. The new list is written under the node's lock, and links other threads made to the node
+            // meanwhile are inserted again afterwards. The vectors from p_shareBegin up to node are candidates
+            // too, so that vectors added together find each other before the graph leads to them.
+            template <typename T>
+            void LinkNewNode(VectorIndex* index, const SizeType node, int CEF, SizeType p_shareBegin, bool searchDeleted = true)
+            {
+                COMMON::QueryResultSet<T> query((const T*)index->GetInternalSample(node), CEF + 1);
+                void* rec_query = nullptr;
+                if (index->GetQuantizer()) {
+                    rec_query = _mm_malloc(index->GetQuantizer()->ReconstructSize(), ALIGN_SPTAG);
+                    index->GetQuantizer()->ReconstructVector((const uint8_t*)query.GetTarget(), rec_query);
+                    query.SetTarget((T*)rec_query);
+                }
+                index->RefineSearchIndex(query, searchDeleted);
+                if (rec_query)
+                {
+                    _mm_free(rec_query);
+                }
+
+                std::vector<BasicResult> candidates;
+                candidates.reserve(CEF + 1 + max(node - p_shareBegin, 0));
+                for (int j = 0; j <= CEF; j++)
+                {
+                    BasicResult* item = query.GetResult(j);
+                    if (item->VID < 0) break;
+                    candidates.emplace_back(item->VID, item->Dist);
+                }
+                if (p_shareBegin < node) {
+                    std::unordered_set<SizeType> found;
+                    for (const BasicResult& item : candidates) found.insert(item.VID);
+                    const void* nodeVec = index->GetInternalSample(node);
+                    for (SizeType other = p_shareBegin; other < node; other++) {
+                        if (found.count(other) == 0) candidates.emplace_back(other, index->ComputeDistance(nodeVec, index->GetInternalSample(other)));
+                    }
+                    std::sort(candidates.begin(), candidates.end(), [](const BasicResult& a, const BasicResult& b) {
+                        return a.Dist < b.Dist || (a.Dist == b.Dist && a.VID < b.VID);
+                    });
+                }
+
+                std::vector<SizeType> neighbors(m_iNeighborhoodSize), concurrentLinks;
+                RebuildNeighbors(index, node, neighbors.data(), candidates.data(), (int)candidates.size());
+                {
+                    std::lock_guard<std::mutex> lock(m_dataUpdateLock[node]);
+                    SizeType* nodes = m_pNeighborhoodGraph[node];
+                    for (DimensionType k = 0; k < m_iNeighborhoodSize; k++) {
+                        if (nodes[k] >= 0) concurrentLinks.push_back(nodes[k]);
+                    }
+                    std::copy(neighbors.begin(), neighbors.end(), nodes);
+                }
+                for (SizeType other : concurrentLinks) {
+                    InsertNeighbors(index, node, other, index->ComputeDistance(index->GetInternalSample(node), index->GetInternalSample(other)));
+                }
+
+                for (const BasicResult& item : candidates)
+                {
+                    if (item.VID == node) continue;
+                    InsertNeighbors(index, item.VID, node, item.Dist);
+                }
+            }
+
+            // Drops the deleted neighbors of node the way FreshDiskANN consolidates deletes: its live neighbors and
+            // the live neighbors of its deleted neighbors are pruned again with the RNG rule. A tree node reference
+            // in the last slot is kept, and links other threads add to the node meanwhile are inserted again
+            // afterwards. Returns false if node has no deleted neighbor and was left alone.
+            template <typename F>
+            bool RepairNode(VectorIndex* index, const SizeType node, const F& p_isDeleted)
+            {
+                const SizeType* nodes = m_pNeighborhoodGraph[node];
+                std::vector<SizeType> before(nodes, nodes + m_iNeighborhoodSize);
+                if (std::none_of(before.begin(), before.end(), [&](SizeType id) { return id >= 0 && p_isDeleted(id); })) return false;
+
+                const void* nodeVec = index->GetInternalSample(node);
+                std::unordered_set<SizeType> found;
+                found.insert(node);
+                std::vector<BasicResult> candidates;
+                auto addCandidate = [&](SizeType id) {
+                    if (id < 0 || p_isDeleted(id) || !found.insert(id).second) return;
+                    candidates.emplace_back(id, index->ComputeDistance(nodeVec, index->GetInternalSample(id)));
+                };
+                for (SizeType id : before) {
+                    if (id < 0) continue;
+                    if (!p_isDeleted(id)) {
+                        addCandidate(id);
+                        continue;
+                    }
+                    const SizeType* deletedNodes = m_pNeighborhoodGraph[id];
+                    for (DimensionType k = 0; k < m_iNeighborhoodSize; k++) addCandidate(deletedNodes[k]);
+                }
+                std::sort(candidates.begin(), candidates.end(), [](const BasicResult& a, const BasicResult& b) {
+                    return a.Dist < b.Dist || (a.Dist == b.Dist && a.VID < b.VID);
+                });
+
+                std::vector<SizeType> neighbors(m_iNeighborhoodSize), concurrentLinks;
+                RebuildNeighbors(index, node, neighbors.data(), candidates.data(), (int)candidates.size());
+                if (before[m_iNeighborhoodSize - 1] < -1) neighbors[m_iNeighborhoodSize - 1] = before[m_iNeighborhoodSize - 1];
+                {
+                    std::lock_guard<std::mutex> lock(m_dataUpdateLock[node]);
+                    SizeType* row = m_pNeighborhoodGraph[node];
+                    for (DimensionType k = 0; k < m_iNeighborhoodSize; k++) {
+                        if (row[k] >= 0 && !p_isDeleted(row[k]) && std::find(before.begin(), before.end(), row[k]) == before.end()) concurrentLinks.push_back(row[k]);
+                    }
+                    std::copy(neighbors.begin(), neighbors.end(), row);
+                }
+                for (SizeType other : concurrentLinks) {
+                    InsertNeighbors(index, node, other, index->ComputeDistance(nodeVec, index->GetInternalSample(other)));
+                }
+                return true;
+            }
+
+            // Empties the neighbor list of node, e.g. before a new vector takes over its slot.
+            inline void ResetNode(SizeType node)
+            {
+                std::lock_guard<std::mutex> lock(m_dataUpdateLock[node]);
+                SizeType* nodes = m_pNeighborhoodGraph[node];
+                for (DimensionType k = 0; k < m_iNeighborhoodSize; k++) nodes[k] = -1;
+            }
+
             inline std::uint64_t BufferSize() const
             {
                 return m_pNeighborhoodGraph.BufferSize();
@@ -655,6 +775,28 @@ break;
                 return ErrorCode::Success;
             }
 
+            // Node p_order[i] becomes node i, and every neighbor id x becomes p_newIDs[x]. Negative entries are
+            // tree node references or padding and keep their value.
+            void RenumberNodes(const std::vector<SizeType>& p_order, const std::vector<SizeType>& p_newIDs)
+            {
+                m_pNeighborhoodGraph.Reorder(p_order);
+#pragma omp parallel for
+                for (SizeType i = 0; i < m_iGraphSize; i++) {
+                    SizeType* nodes = m_pNeighborhoodGraph[i];
+                    for (DimensionType j = 0; j < m_iNeighborhoodSize; j++) {
+                        if (nodes[j] >= 0) nodes[j] = p_newIDs[nodes[j]];
+                    }
+                }
+            }
+
+            // Keeps the neighbor list of node i inside row i of p_owner, p_byteOffset bytes after its start. A fresh
+            // build leaves spare columns past m_iNeighborhoodSize, which are dropped here.
+            template <typename U>
+            ErrorCode CoLocate(Dataset<U>& p_owner, std::size_t p_byteOffset)
+            {
+                return m_pNeighborhoodGraph.ShareRows(p_owner, p_byteOffset, m_iNeighborhoodSize);
+            }
+
             inline SizeType* operator[](SizeType index) { return m_pNeighborhoodGraph[index]; }
 
             inline const SizeType* operator[](SizeType index) const { return m_pNeighborhoodGraph[index]; }
@@ -671,6 +813,15 @@ break;
 
             inline SizeType R() const { return m_iGraphSize; }
 
+            inline void SetPagePolicy(Helper::PagePolicy p_policy) { m_pNeighborhoodGraph.SetPagePolicy(p_policy); }
+
+            // Frees the neighbor lists, e.g. once a CompressedGraph copy answers the searches.
+            inline void Clear(SizeType blockSize, SizeType capacity)
+            {
+                m_pNeighborhoodGraph.Initialize(0, m_iNeighborhoodSize, blockSize, capacity);
+                m_iGraphSize = 0;
+            }
+
             inline std::string Type() const { return m_pNeighborhoodGraph.Name(); }
 
             static std::shared_ptr<NeighborhoodGraph> CreateInstance(std::string type);
@@ -22,16 +22,13 @@ namespace SPTAG
         class PQQuantizer : public IQuantizer
         {
         public:
-            PQQuantizer();
+            explicit PQQuantizer(bool FourBitCodes = false);
 
-            PQQuantizer(DimensionType NumSubvectors, SizeType KsPerSubvector, DimensionType DimPerSubvector, bool EnableADC, std::shared_ptr<T> Codebooks);
+            // FourBitCodes packs two codes per byte (low nibble first) and needs KsPerSubvector <= 16.
+            PQQuantizer(DimensionType NumSubvectors, SizeType KsPerSubvector, DimensionType DimPerSubvector, bool EnableADC, std::shared_ptr<T> Codebooks, bool FourBitCodes = false);
 
             ~PQQuantizer();
 
-            virtual float L2Distance(const std::uint8_t* pX, const std::uint8_t* pY);
-
-            virtual float CosineDistance(const std::uint8_t* pX, const std::uint8_t* pY);
-
             virtual void QuantizeVector(const void* vec, std::uint8_t* vecout);
             
             virtual SizeType QuantizeSize();
@@ -66,33 +63,75 @@ namespace SPTAG
             }
 
             QuantizerType GetQuantizerType() {
-                return QuantizerType::PQQuantizer;
+                return m_FourBitCodes ? QuantizerType::PQ4Quantizer : QuantizerType::PQQuantizer;
             }
 
+            bool GetFourBitCodes() const { return m_FourBitCodes; }
+
+            // Fast scan for 4-bit codes: the query L2 table is quantized to 8 bits and the codes of 32 vectors are
+            // stored transposed in one block, so the distances of a whole block come out of a few pshufb per subvector pair.
+            virtual SizeType FastScanTableSize() const;
+
+            virtual void QuantizeFastScanTable(const void* vec, std::uint8_t* tableout) const;
+
+            virtual float FastScanTolerance(const std::uint8_t* table) const;
+
+            virtual SizeType FastScanBlockSize() const;
+
+            // Packs p_num (<= 32) 4-bit codes, p_stride bytes apart, into one fast scan block; missing entries are zero.
+            virtual void PackFastScanBlock(const std::uint8_t* codes, SizeType p_stride, SizeType p_num, std::uint8_t* blockout) const;
+
+            // Approximate L2 distances of the 32 block entries to the query of the table.
+            virtual void ComputeFastScanDistances(const std::uint8_t* table, const std::uint8_t* block, float* distout) const;
+
         private:
             DimensionType m_NumSubvectors;
             SizeType m_KsPerSubvector;
             DimensionType m_DimPerSubvector;
             SizeType m_BlockSize;
             bool m_EnableADC;
+            bool m_FourBitCodes;
+
+            typedef float (*ADCKernel)(const float*, const std::uint8_t*, DimensionType, SizeType);
+            typedef float (*SDCKernel)(const float*, const std::uint8_t*, const std::uint8_t*, DimensionType, SizeType);
+            typedef void (*FastScanKernel)(const std::uint8_t*, const std::uint8_t*, DimensionType, std::uint16_t*);
+
+            ADCKernel m_fADCDistance = nullptr;
+            SDCKernel m_fSDCDistance = nullptr;
+            FastScanKernel m_fFastScan = nullptr;
 
             inline SizeType m_DistIndexCalc(SizeType i, SizeType j, SizeType k);
 
+            template <int Bits>
+            void SelectKernels();
+
+            void BindDistanceKernels();
+
+            static float ADCL2Distance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY);
+
+            static float ADCCosineDistance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY);
+
+            static float SDCL2Distance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY);
+
+            static float SDCCosineDistance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY);
+
             std::shared_ptr<T> m_codebooks;
             std::unique_ptr<const float[]> m_CosineDistanceTables;
             std::unique_ptr<const float[]> m_L2DistanceTables;
         };
 
         template <typename T>
-        PQQuantizer<T>::PQQuantizer() : m_NumSubvectors(0), m_KsPerSubvector(0), m_DimPerSubvector(0), m_BlockSize(0), m_EnableADC(false)
+        PQQuantizer<T>::PQQuantizer(bool FourBitCodes) : m_NumSubvectors(0), m_KsPerSubvector(0), m_DimPerSubvector(0), m_BlockSize(0), m_EnableADC(false), m_FourBitCodes(FourBitCodes)
         {
+            BindDistanceKernels();
         }
 
         template <typename T>
-        PQQuantizer<T>::PQQuantizer(DimensionType NumSubvectors, SizeType KsPerSubvector, DimensionType DimPerSubvector, bool EnableADC, std::shared_ptr<T> Codebooks) : 
+        PQQuantizer<T>::PQQuantizer(DimensionType NumSubvectors, SizeType KsPerSubvector, DimensionType DimPerSubvector, bool EnableADC, std::shared_ptr<T> Codebooks, bool FourBitCodes) : 
             m_NumSubvectors(NumSubvectors), m_KsPerSubvector(KsPerSubvector), m_DimPerSubvector(DimPerSubvector), 
-            m_BlockSize(KsPerSubvector* KsPerSubvector), m_EnableADC(EnableADC), m_codebooks(std::move(Codebooks))
+            m_BlockSize(KsPerSubvector* KsPerSubvector), m_EnableADC(EnableADC), m_FourBitCodes(FourBitCodes), m_codebooks(std::move(Codebooks))
         {
+            assert(!m_FourBitCodes || m_KsPerSubvector <= 16);
             auto temp_m_CosineDistanceTables = std::make_unique<float[]>(m_BlockSize * m_NumSubvectors);
             auto temp_m_L2DistanceTables = std::make_unique<float[]>(m_BlockSize * m_NumSubvectors);
 
@@ -110,6 +149,7 @@ namespace SPTAG
             }
             m_CosineDistanceTables = std::move(temp_m_CosineDistanceTables);
             m_L2DistanceTables = std::move(temp_m_L2DistanceTables);
+            BindDistanceKernels();
         }
 
         template <typename T>
@@ -117,44 +157,6 @@ namespace SPTAG
         {
         }
 
-        template <typename T>
-        float PQQuantizer<T>::L2Distance(const std::uint8_t* pX, const std::uint8_t* pY)
-            // pX must be query distance table for ADC
-        {
-            float out = 0;
-            if (GetEnableADC()) {               
-                for (int i = 0; i < m_NumSubvectors; i++) {
-                    out += ((float*) pX)[i * m_KsPerSubvector + (size_t) pY[i]];
-                }
-            }
-            else {
-                for (int i = 0; i < m_NumSubvectors; i++) {
-                    out += m_L2DistanceTables[m_DistIndexCalc(i, pX[i], pY[i])];
-                }                
-            }
-            return out;
-        }
-
-        template <typename T>
-        float PQQuantizer<T>::CosineDistance(const std::uint8_t* pX, const std::uint8_t* pY)
-            // pX must be query distance table for ADC
-        {
-            float out = 0;
-            if (GetEnableADC())
-            {
-                for (int i = 0; i < m_NumSubvectors; i++) {
-                    out += ((float*)pX)[(m_NumSubvectors * m_KsPerSubvector) + (i * m_KsPerSubvector) + (size_t) pY[i]];
-                }
-            }
-            else
-            {
-                for (int i = 0; i < m_NumSubvectors; i++) {
-                    out += m_CosineDistanceTables[m_DistIndexCalc(i, pX[i], pY[i])];
-                }
-            }
-            return DistanceUtils::ConvertCosineSimilarityToDistance(out);
-        }
-
         template <typename T>
         void PQQuantizer<T>::QuantizeVector(const void* vec, std::uint8_t* vecout)
         {
@@ -178,6 +180,7 @@ namespace SPTAG
             else 
             {
                 auto distCalc = DistanceCalcSelector<T>(DistCalcMethod::L2);
+                if (m_FourBitCodes) std::memset(vecout, 0, QuantizeSize());
 
                 for (int i = 0; i < m_NumSubvectors; i++) {
                     int bestIndex = -1;
@@ -193,7 +196,8 @@ namespace SPTAG
                         }
                     }
                     assert(bestIndex != -1);
-                    vecout[i] = bestIndex;
+                    if (m_FourBitCodes) vecout[i >> 1] |= (std::uint8_t)(bestIndex << ((i & 1) << 2));
+                    else vecout[i] = bestIndex;
                 }
             }           
         }
@@ -207,7 +211,7 @@ namespace SPTAG
             }
             else
             {
-                return m_NumSubvectors;
+                return m_FourBitCodes ? (m_NumSubvectors + 1) / 2 : m_NumSubvectors;
             }           
         }
 
@@ -215,7 +219,8 @@ namespace SPTAG
         void PQQuantizer<T>::ReconstructVector(const std::uint8_t* qvec, void* vecout)
         {
             for (int i = 0; i < m_NumSubvectors; i++) {
-                SizeType codebook_idx = (i * m_KsPerSubvector * m_DimPerSubvector) + (qvec[i] * m_DimPerSubvector);
+                std::uint8_t code = m_FourBitCodes ? DistanceUtils::GetCode<4>(qvec, i) : qvec[i];
+                SizeType codebook_idx = (i * m_KsPerSubvector * m_DimPerSubvector) + (code * m_DimPerSubvector);
                 T* sub_vecout = &((T*)vecout)[i * m_DimPerSubvector];
                 for (int j = 0; j < m_DimPerSubvector; j++) {
                     sub_vecout[j] = m_codebooks.get()[codebook_idx + j];
@@ -245,7 +250,7 @@ namespace SPTAG
         template <typename T>
         ErrorCode PQQuantizer<T>::SaveQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_out) const
         {
-            QuantizerType qtype = QuantizerType::PQQuantizer;
+            QuantizerType qtype = m_FourBitCodes ? QuantizerType::PQ4Quantizer : QuantizerType::PQQuantizer;
             VectorValueType rtype = GetEnumValueType<T>();
             IOBINARY(p_out, WriteBinary, sizeof(QuantizerType), (char*)&qtype);
             IOBINARY(p_out, WriteBinary, sizeof(VectorValueType), (char*)&rtype);
@@ -268,6 +273,10 @@ namespace SPTAG
             IOBINARY(p_in, ReadBinary, sizeof(DimensionType), (char*)&m_DimPerSubvector);
             LOG(Helper::LogLevel::LL_Info, "After read dim: %s.\n", std::to_string(m_DimPerSubvector).c_str());
             m_BlockSize = m_KsPerSubvector * m_KsPerSubvector;
+            if (m_FourBitCodes && m_KsPerSubvector > 16) {
+                LOG(Helper::LogLevel::LL_Error, "4-bit PQ codes need KsPerSubvector <= 16, got %d.\n", m_KsPerSubvector);
+                return ErrorCode::Fail;
+            }
 
             m_codebooks.reset(new T[m_NumSubvectors * m_KsPerSubvector * m_DimPerSubvector], std::default_delete<T[]>());
             LOG(Helper::LogLevel::LL_Info, "sizeof(T): %s.\n", std::to_string(sizeof(T)).c_str());
@@ -291,6 +300,7 @@ namespace SPTAG
             }
             m_CosineDistanceTables = std::move(temp_m_CosineDistanceTables);
             m_L2DistanceTables = std::move(temp_m_L2DistanceTables);
+            BindDistanceKernels();
             LOG(Helper::LogLevel::LL_Info, "Loaded quantizer: Subvectors:%d KsPerSubvector:%d DimPerSubvector:%d\n", m_NumSubvectors, m_KsPerSubvector, m_DimPerSubvector);
             return ErrorCode::Success;
         }
@@ -329,6 +339,151 @@ namespace SPTAG
         void PQQuantizer<T>::SetEnableADC(bool enableADC)
         {
             m_EnableADC = enableADC;
+            BindDistanceKernels();
+        }
+
+        template <typename T>
+        SizeType PQQuantizer<T>::FastScanTableSize() const
+        {
+            if (!m_FourBitCodes) return 0;
+            return 32 * ((m_NumSubvectors + 1) / 2) + 2 * sizeof(float);
+        }
+
+        template <typename T>
+        void PQQuantizer<T>::QuantizeFastScanTable(const void* vec, std::uint8_t* tableout) const
+        {
+            assert(m_FourBitCodes);
+            auto distCalc = DistanceCalcSelector<T>(DistCalcMethod::L2);
+            DimensionType pairs = (m_NumSubvectors + 1) / 2;
+            std::vector<float> dists(m_NumSubvectors * m_KsPerSubvector);
+            float bias = 0, maxRange = 0;
+            for (int i = 0; i < m_NumSubvectors; i++)
+            {
+                const T* subvec = ((const T*)vec) + i * m_DimPerSubvector;
+                float* subdists = dists.data() + i * m_KsPerSubvector;
+                for (int j = 0; j < m_KsPerSubvector; j++)
+                {
+                    subdists[j] = distCalc(subvec, &(m_codebooks.get()[(i * m_KsPerSubvector + j) * m_DimPerSubvector]), m_DimPerSubvector);
+                }
+                auto range = std::minmax_element(subdists, subdists + m_KsPerSubvector);
+                bias += *range.first;
+                maxRange = max(maxRange, *range.second - *range.first);
+            }
+
+            // One scale for all subvectors so the 16-bit sums stay comparable; keep the sum of 2 * pairs entries in 16 bits.
+            float levels = (float)min(255, 65535 / (2 * pairs));
+            float scale = (maxRange > 0) ? maxRange / levels : 1.0f;
+            std::memset(tableout, 0, FastScanTableSize());
+            for (int i = 0; i < m_NumSubvectors; i++)
+            {
+                const float* subdists = dists.data() + i * m_KsPerSubvector;
+                float subMin = *std::min_element(subdists, subdists + m_KsPerSubvector);
+                for (int j = 0; j < m_KsPerSubvector; j++)
+                {
+                    tableout[i * 16 + j] = (std::uint8_t)min(levels, std::floor((subdists[j] - subMin) / scale + 0.5f));
+                }
+            }
+            float* params = (float*)(tableout + 32 * pairs);
+            params[0] = bias;
+            params[1] = scale;
+        }
+
+        template <typename T>
+        float PQQuantizer<T>::FastScanTolerance(const std::uint8_t* table) const
+        {
+            // Every subvector entry is rounded to the nearest step; one more step covers the float rounding.
+            const float* params = (const float*)(table + 32 * ((m_NumSubvectors + 1) / 2));
+            return params[1] * (0.5f * m_NumSubvectors + 1.0f);
+        }
+
+        template <typename T>
+        SizeType PQQuantizer<T>::FastScanBlockSize() const
+        {
+            return 32 * ((m_NumSubvectors + 1) / 2);
+        }
+
+        template <typename T>
+        void PQQuantizer<T>::PackFastScanBlock(const std::uint8_t* codes, SizeType p_stride, SizeType p_num, std::uint8_t* blockout) const
+        {
+            assert(m_FourBitCodes && p_num <= 32);
+            DimensionType pairs = (m_NumSubvectors + 1) / 2;
+            std::memset(blockout, 0, FastScanBlockSize());
+            for (SizeType k = 0; k < p_num; k++, codes += p_stride)
+            {
+                for (DimensionType p = 0; p < pairs; p++) blockout[p * 32 + k] = codes[p];
+            }
+        }
+
+        template <typename T>
+        void PQQuantizer<T>::ComputeFastScanDistances(const std::uint8_t* table, const std::uint8_t* block, float* distout) const
+        {
+            DimensionType pairs = (m_NumSubvectors + 1) / 2;
+            const float* params = (const float*)(table + 32 * pairs);
+            std::uint16_t sums[32];
+            m_fFastScan(table, block, pairs, sums);
+            for (int k = 0; k < 32; k++) distout[k] = params[0] + params[1] * sums[k];
+        }
+
+        template <typename T>
+        template <int Bits>
+        void PQQuantizer<T>::SelectKernels()
+        {
+            if (InstructionSet::AVX512())
+            {
+                m_fADCDistance = &(DistanceUtils::ComputeADCDistance_AVX512<Bits>);
+                m_fSDCDistance = &(DistanceUtils::ComputeSDCDistance_AVX512<Bits>);
+            }
+            else if (InstructionSet::AVX2())
+            {
+                m_fADCDistance = &(DistanceUtils::ComputeADCDistance_AVX<Bits>);
+                m_fSDCDistance = &(DistanceUtils::ComputeSDCDistance_AVX<Bits>);
+            }
+            else
+            {
+                m_fADCDistance = &(DistanceUtils::ComputeADCDistance<Bits>);
+                m_fSDCDistance = &(DistanceUtils::ComputeSDCDistance<Bits>);
+            }
+        }
+
+        template <typename T>
+        void PQQuantizer<T>::BindDistanceKernels()
+        {
+            if (m_FourBitCodes) SelectKernels<4>();
+            else SelectKernels<8>();
+            m_fFastScan = InstructionSet::AVX2() ? &(DistanceUtils::ComputeFastScanDistances_AVX) : &(DistanceUtils::ComputeFastScanDistances);
+
+            m_fL2Distance = m_EnableADC ? &ADCL2Distance : &SDCL2Distance;
+            m_fCosineDistance = m_EnableADC ? &ADCCosineDistance : &SDCCosineDistance;
+        }
+
+        template <typename T>
+        float PQQuantizer<T>::ADCL2Distance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY)
+            // pX must be query distance table for ADC
+        {
+            const PQQuantizer<T>* pq = static_cast<const PQQuantizer<T>*>(q);
+            return pq->m_fADCDistance((const float*)pX, pY, pq->m_NumSubvectors, pq->m_KsPerSubvector);
+        }
+
+        template <typename T>
+        float PQQuantizer<T>::ADCCosineDistance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY)
+        {
+            const PQQuantizer<T>* pq = static_cast<const PQQuantizer<T>*>(q);
+            const float* table = ((const float*)pX) + pq->m_NumSubvectors * pq->m_KsPerSubvector;
+            return DistanceUtils::ConvertCosineSimilarityToDistance(pq->m_fADCDistance(table, pY, pq->m_NumSubvectors, pq->m_KsPerSubvector));
+        }
+
+        template <typename T>
+        float PQQuantizer<T>::SDCL2Distance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY)
+        {
+            const PQQuantizer<T>* pq = static_cast<const PQQuantizer<T>*>(q);
+            return pq->m_fSDCDistance(pq->m_L2DistanceTables.get(), pX, pY, pq->m_NumSubvectors, pq->m_KsPerSubvector);
+        }
+
+        template <typename T>
+        float PQQuantizer<T>::SDCCosineDistance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY)
+        {
+            const PQQuantizer<T>* pq = static_cast<const PQQuantizer<T>*>(q);
+            return DistanceUtils::ConvertCosineSimilarityToDistance(pq->m_fSDCDistance(pq->m_CosineDistanceTables.get(), pX, pY, pq->m_NumSubvectors, pq->m_KsPerSubvector));
         }
 
         template <typename T>
@@ -0,0 +1,182 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_QUANTIZERTRAINER_H_
+#define _SPTAG_COMMON_QUANTIZERTRAINER_H_
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+
+#include "../VectorSet.h"
+#include "BKTree.h"
+#include "PQQuantizer.h"
+#include "SQQuantizer.h"
+
+namespace SPTAG
+{
+    namespace COMMON
+    {
+        // Picks min(p_sampleNum, p_total) distinct ids out of [0, p_total) uniformly (Floyd's algorithm),
+        // sorted so that copying the samples walks the source forward.
+        inline std::vector<SizeType> SampleVectorIDs(SizeType p_total, SizeType p_sampleNum, std::mt19937& p_rg)
+        {
+            std::vector<SizeType> ids;
+            if (p_sampleNum >= p_total) {
+                ids.resize(p_total);
+                std::iota(ids.begin(), ids.end(), 0);
+                return ids;
+            }
+
+            std::unordered_set<SizeType> picked;
+            picked.reserve(p_sampleNum * 2);
+            for (SizeType j = p_total - p_sampleNum; j < p_total; j++) {
+                SizeType t = std::uniform_int_distribution<SizeType>(0, j)(p_rg);
+                if (!picked.insert(t).second) picked.insert(j);
+            }
+            ids.assign(picked.begin(), picked.end());
+            std::sort(ids.begin(), ids.end());
+            return ids;
+        }
+
+        // k-means++ seeding: every next center is drawn with probability proportional to its squared
+        // distance to the closest center picked so far. Writes the seeds to args.newTCenters.
+        template <typename T>
+        void InitCentersPlusPlus(const Dataset<T>& p_data, KmeansArgs<T>& args)
+        {
+            SizeType rows = p_data.R();
+            std::vector<float> nearest(rows, MaxDist);
+            SizeType pick = std::uniform_int_distribution<SizeType>(0, rows - 1)(args.rg);
+            for (int k = 0; k < args._K; k++) {
+                T* center = args.newTCenters + k * args._D;
+                std::memcpy(center, p_data[pick], sizeof(T) * args._D);
+                if (k + 1 == args._K) break;
+
+                double total = 0;
+                for (SizeType i = 0; i < rows; i++) {
+                    float dist = args.fComputeDistance(p_data[i], center, args._D);
+                    if (dist < nearest[i]) nearest[i] = dist;
+                    total += nearest[i];
+                }
+                if (total <= 0) {
+                    pick = std::uniform_int_distribution<SizeType>(0, rows - 1)(args.rg);
+                    continue;
+                }
+
+                double target = std::uniform_real_distribution<double>(0, total)(args.rg);
+                for (pick = 0; pick < rows - 1; pick++) {
+                    target -= nearest[pick];
+                    if (target <= 0) break;
+                }
+            }
+        }
+
+        // Plain (unbalanced) Lloyd k-means over all rows of p_data, reusing the BKT clustering steps with
+        // lambda 0. Returns the average distortion; the centers end up in args.newTCenters.
+        template <typename T>
+        float TrainCodebook(const Dataset<T>& p_data, KmeansArgs<T>& args, int p_maxIter)
+        {
+            SizeType rows = p_data.R();
+            std::vector<SizeType> indices(rows);
+            std::iota(indices.begin(), indices.end(), 0);
+
+            InitCentersPlusPlus(p_data, args);
+
+            float currDist = 0;
+            for (int iter = 0; iter < p_maxIter; iter++) {
+                std::memcpy(args.centers, args.newTCenters, sizeof(T) * args._K * args._D);
+
+                args.ClearCenters();
+                args.ClearCounts();
+                args.ClearDists(-MaxDist);
+                currDist = KmeansAssign(p_data, indices, 0, rows, args, true, 0);
+                std::memcpy(args.counts, args.newCounts, sizeof(SizeType) * args._K);
+
+                if (RefineCenters(p_data, args) < 1e-3) break;
+            }
+            return currDist / rows;
+        }
+
+        // Trains a PQ codebook on a uniform sample of p_vectors. Every subspace is clustered independently,
+        // so the subspaces are spread over p_threadNum threads with one single threaded k-means each.
+        template <typename T>
+        std::shared_ptr<PQQuantizer<T>> TrainPQQuantizer(const std::shared_ptr<VectorSet>& p_vectors,
+            DimensionType p_numSubvectors, SizeType p_ksPerSubvector, SizeType p_sampleNum, int p_threadNum,
+            int p_maxIter = 100, unsigned int p_seed = 0, bool p_fourBitCodes = false)
+        {
+            DimensionType dim = p_vectors->Dimension();
+            if (p_numSubvectors <= 0 || dim % p_numSubvectors != 0) {
+                LOG(Helper::LogLevel::LL_Error, "Dimension %d cannot be split into %d subvectors.\n", dim, p_numSubvectors);
+                return nullptr;
+            }
+            SizeType maxKs = p_fourBitCodes ? 16 : 256;
+            if (p_ksPerSubvector <= 0 || p_ksPerSubvector > maxKs) {
+                LOG(Helper::LogLevel::LL_Error, "KsPerSubvector must be in [1, %d] for %d bit codes, got %d.\n", maxKs, p_fourBitCodes ? 4 : 8, p_ksPerSubvector);
+                return nullptr;
+            }
+
+            std::mt19937 rg(p_seed);
+            std::vector<SizeType> samples = SampleVectorIDs(p_vectors->Count(), p_sampleNum, rg);
+            SizeType sampleNum = (SizeType)samples.size();
+            if (sampleNum < p_ksPerSubvector) {
+                LOG(Helper::LogLevel::LL_Error, "Need at least %d training vectors, got %d.\n", p_ksPerSubvector, sampleNum);
+                return nullptr;
+            }
+
+            DimensionType dsub = dim / p_numSubvectors;
+            std::shared_ptr<T> codebooks(new T[((size_t)p_numSubvectors) * p_ksPerSubvector * dsub], std::default_delete<T[]>());
+            LOG(Helper::LogLevel::LL_Info, "Train PQ: %d samples, %d subvectors x %d dims, %d centroids each.\n", sampleNum, p_numSubvectors, dsub, p_ksPerSubvector);
+
+#pragma omp parallel for num_threads(p_threadNum) schedule(dynamic,1)
+            for (int m = 0; m < p_numSubvectors; m++) {
+                Dataset<T> subspace(sampleNum, dsub, sampleNum, sampleNum);
+                for (SizeType i = 0; i < sampleNum; i++) {
+                    std::memcpy(subspace[i], (const T*)p_vectors->GetVector(samples[i]) + m * dsub, sizeof(T) * dsub);
+                }
+
+                KmeansArgs<T> args(p_ksPerSubvector, dsub, sampleNum, 1, DistCalcMethod::L2);
+                args.rg.seed(p_seed + m);
+                float dist = TrainCodebook(subspace, args, p_maxIter);
+                std::memcpy(codebooks.get() + ((size_t)m) * p_ksPerSubvector * dsub, args.newTCenters, sizeof(T) * p_ksPerSubvector * dsub);
+                LOG(Helper::LogLevel::LL_Debug, "Subvector %d trained, avg distortion %f.\n", m, dist);
+            }
+            return std::make_shared<PQQuantizer<T>>(p_numSubvectors, p_ksPerSubvector, dsub, false, codebooks, p_fourBitCodes);
+        }
+
+        // Trains a scalar quantizer: the levels of every dimension span the min and max of that dimension
+        // over a uniform sample of p_vectors.
+        template <typename T>
+        std::shared_ptr<SQQuantizer<T>> TrainSQQuantizer(const std::shared_ptr<VectorSet>& p_vectors,
+            SizeType p_sampleNum, int p_threadNum, unsigned int p_seed = 0, bool p_fourBitCodes = false)
+        {
+            DimensionType dim = p_vectors->Dimension();
+            std::mt19937 rg(p_seed);
+            std::vector<SizeType> samples = SampleVectorIDs(p_vectors->Count(), p_sampleNum, rg);
+            SizeType sampleNum = (SizeType)samples.size();
+            if (sampleNum == 0) {
+                LOG(Helper::LogLevel::LL_Error, "Need at least 1 training vector.\n");
+                return nullptr;
+            }
+            LOG(Helper::LogLevel::LL_Info, "Train SQ: %d samples, %d dims, %d bits.\n", sampleNum, dim, p_fourBitCodes ? 4 : 8);
+
+            std::vector<float> minValue(dim, (std::numeric_limits<float>::max)()), maxValue(dim, std::numeric_limits<float>::lowest());
+#pragma omp parallel for num_threads(p_threadNum) schedule(static)
+            for (DimensionType j = 0; j < dim; j++) {
+                for (SizeType i = 0; i < sampleNum; i++) {
+                    float v = (float)(((const T*)p_vectors->GetVector(samples[i]))[j]);
+                    if (v < minValue[j]) minValue[j] = v;
+                    if (v > maxValue[j]) maxValue[j] = v;
+                }
+            }
+
+            std::vector<float> scale(dim);
+            float levels = p_fourBitCodes ? 15.0f : 255.0f;
+            for (DimensionType j = 0; j < dim; j++) scale[j] = (maxValue[j] - minValue[j]) / levels;
+            return std::make_shared<SQQuantizer<T>>(dim, false, minValue, scale, p_fourBitCodes);
+        }
+    }
+}
+
+#endif // _SPTAG_COMMON_QUANTIZERTRAINER_H_
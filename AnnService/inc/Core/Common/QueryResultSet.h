@@ -59,12 +59,12 @@ public:
 
     T* GetQuantizedTarget()
     {
-        if (COMMON::DistanceUtils::Quantizer)
+        if (m_quantizer)
         {
             if (!m_quantizedTarget)
             {
-                m_quantizedTarget = _mm_malloc(COMMON::DistanceUtils::Quantizer->QuantizeSize(), ALIGN_SPTAG);
-                COMMON::DistanceUtils::Quantizer->QuantizeVector((void*)m_target, (uint8_t*)m_quantizedTarget);
+                m_quantizedTarget = _mm_malloc(m_quantizer->QuantizeSize(), ALIGN_SPTAG);
+                m_quantizer->QuantizeVector((void*)m_target, (uint8_t*)m_quantizedTarget);
             }
             return reinterpret_cast<T*>(m_quantizedTarget);
         }
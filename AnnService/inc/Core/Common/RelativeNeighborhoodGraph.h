@@ -25,7 +25,7 @@ namespace SPTAG
 
                     bool good = true;
                     for (DimensionType k = 0; k < count; k++) {
-                        if (m_fRNGFactor * index->ComputeDistance(index->GetSample(nodes[k]), index->GetSample(item.VID)) < item.Dist) {
+                        if (m_fRNGFactor * index->ComputeDistance(index->GetInternalSample(nodes[k]), index->GetInternalSample(item.VID)) < item.Dist) {
                             good = false;
                             break;
                         }
@@ -38,8 +38,8 @@ namespace SPTAG
             void InsertNeighbors(VectorIndex* index, const SizeType node, SizeType insertNode, float insertDist)
             {                
                 SizeType* nodes = m_pNeighborhoodGraph[node];
-                const void* nodeVec = index->GetSample(node);
-                const void* insertVec = index->GetSample(insertNode);
+                const void* nodeVec = index->GetInternalSample(node);
+                const void* insertVec = index->GetInternalSample(insertNode);
                 
                 std::lock_guard<std::mutex> lock(m_dataUpdateLock[node]);
 
@@ -47,7 +47,7 @@ namespace SPTAG
                 _mm_prefetch((const char*)(nodeVec), _MM_HINT_T0);
                 _mm_prefetch((const char*)(insertVec), _MM_HINT_T0);
                 for (DimensionType i = 0; i < m_iNeighborhoodSize; i++) {
-                    _mm_prefetch((const char*)(index->GetSample(nodes[i])), _MM_HINT_T0);
+                    _mm_prefetch((const char*)(index->GetInternalSample(nodes[i])), _MM_HINT_T0);
                 }
 
                 SizeType tmpNode;
@@ -63,7 +63,7 @@ namespace SPTAG
                         break;
                     }
 
-                    tmpVec = index->GetSample(tmpNode);
+                    tmpVec = index->GetInternalSample(tmpNode);
                     tmpDist = index->ComputeDistance(tmpVec, nodeVec);
                     if (tmpDist > insertDist || (insertDist == tmpDist && insertNode < tmpNode))
                     {
@@ -71,7 +71,7 @@ namespace SPTAG
                         while (++k < m_iNeighborhoodSize && nodes[k] >= -1 && index->ComputeDistance(tmpVec, nodeVec) <= index->ComputeDistance(tmpVec, insertVec)) {
                             std::swap(tmpNode, nodes[k]);
                             if (tmpNode < 0) return;
-                            tmpVec = index->GetSample(tmpNode);
+                            tmpVec = index->GetInternalSample(tmpNode);
                         }
                         break;
                     }
@@ -0,0 +1,329 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_SQQUANTIZER_H_
+#define _SPTAG_COMMON_SQQUANTIZER_H_
+
+#include "CommonUtils.h"
+#include "DistanceUtils.h"
+#include "IQuantizer.h"
+#include <cmath>
+#include <memory>
+#include <vector>
+
+
+namespace SPTAG
+{
+    namespace COMMON
+    {
+        // Scalar quantizer: every dimension is mapped on its own to 256 (SQ8) or 16 (SQ4) evenly spaced levels
+        // between the trained per dimension minimum and maximum. 4-bit codes are packed two per byte, low nibble first.
+        template <typename T>
+        class SQQuantizer : public IQuantizer
+        {
+        public:
+            explicit SQQuantizer(bool FourBitCodes = false);
+
+            // Min and Scale hold one entry per dimension; a value x is encoded as round((x - Min) / Scale).
+            SQQuantizer(DimensionType Dim, bool EnableADC, const std::vector<float>& Min, const std::vector<float>& Scale, bool FourBitCodes = false);
+
+            ~SQQuantizer();
+
+            virtual void QuantizeVector(const void* vec, std::uint8_t* vecout);
+
+            virtual SizeType QuantizeSize();
+
+            virtual void ReconstructVector(const std::uint8_t* qvec, void* vecout);
+
+            virtual SizeType ReconstructSize();
+
+            virtual DimensionType ReconstructDim();
+
+            virtual std::uint64_t BufferSize() const;
+
+            virtual ErrorCode SaveQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_out) const;
+
+            virtual ErrorCode LoadQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_in);
+
+            virtual DimensionType GetNumSubvectors() const;
+
+            virtual int GetBase();
+
+            virtual bool GetEnableADC();
+
+            virtual void SetEnableADC(bool enableADC);
+
+            VectorValueType GetReconstructType()
+            {
+                return GetEnumValueType<T>();
+            }
+
+            QuantizerType GetQuantizerType() {
+                return m_FourBitCodes ? QuantizerType::SQ4Quantizer : QuantizerType::SQ8Quantizer;
+            }
+
+            bool GetFourBitCodes() const { return m_FourBitCodes; }
+
+            int GetLevels() const { return m_FourBitCodes ? 15 : 255; }
+
+            // Scalar codes have no fast scan layout.
+            virtual SizeType FastScanTableSize() const { return 0; }
+
+            virtual void QuantizeFastScanTable(const void*, std::uint8_t*) const {}
+
+            virtual float FastScanTolerance(const std::uint8_t*) const { return 0; }
+
+            virtual SizeType FastScanBlockSize() const { return 0; }
+
+            virtual void PackFastScanBlock(const std::uint8_t*, SizeType, SizeType, std::uint8_t*) const {}
+
+            virtual void ComputeFastScanDistances(const std::uint8_t*, const std::uint8_t*, float*) const {}
+
+        private:
+            DimensionType m_Dim;
+            bool m_EnableADC;
+            bool m_FourBitCodes;
+            float m_BaseSquare;
+
+            std::vector<float> m_Min;
+            std::vector<float> m_Scale;
+
+            typedef float (*L2Kernel)(const float*, const float*, const std::uint8_t*, DimensionType);
+            typedef float (*DotKernel)(const float*, const std::uint8_t*, DimensionType);
+            typedef float (*SDCL2Kernel)(const float*, const std::uint8_t*, const std::uint8_t*, DimensionType);
+            typedef float (*SDCDotKernel)(const float*, const float*, const std::uint8_t*, const std::uint8_t*, DimensionType);
+
+            L2Kernel m_fL2Kernel = nullptr;
+            DotKernel m_fDotKernel = nullptr;
+            SDCL2Kernel m_fSDCL2Kernel = nullptr;
+            SDCDotKernel m_fSDCDotKernel = nullptr;
+
+            template <int Bits>
+            void SelectKernels();
+
+            void BindDistanceKernels();
+
+            static float ADCL2Distance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY);
+
+            static float ADCCosineDistance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY);
+
+            static float SDCL2Distance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY);
+
+            static float SDCCosineDistance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY);
+        };
+
+        template <typename T>
+        SQQuantizer<T>::SQQuantizer(bool FourBitCodes) : m_Dim(0), m_EnableADC(false), m_FourBitCodes(FourBitCodes)
+        {
+            BindDistanceKernels();
+        }
+
+        template <typename T>
+        SQQuantizer<T>::SQQuantizer(DimensionType Dim, bool EnableADC, const std::vector<float>& Min, const std::vector<float>& Scale, bool FourBitCodes) :
+            m_Dim(Dim), m_EnableADC(EnableADC), m_FourBitCodes(FourBitCodes), m_Min(Min), m_Scale(Scale)
+        {
+            BindDistanceKernels();
+        }
+
+        template <typename T>
+        SQQuantizer<T>::~SQQuantizer()
+        {
+        }
+
+        template <typename T>
+        void SQQuantizer<T>::QuantizeVector(const void* vec, std::uint8_t* vecout)
+        {
+            const T* x = (const T*)vec;
+            if (GetEnableADC())
+            {
+                // Query layout: x - Min for L2, x * Scale and the sum of x * Min for the dot product.
+                float* query = (float*)vecout;
+                float bias = 0;
+                for (DimensionType i = 0; i < m_Dim; i++)
+                {
+                    float v = (float)x[i];
+                    query[i] = v - m_Min[i];
+                    query[m_Dim + i] = v * m_Scale[i];
+                    bias += v * m_Min[i];
+                }
+                query[2 * m_Dim] = bias;
+            }
+            else
+            {
+                float levels = (float)GetLevels();
+                if (m_FourBitCodes) std::memset(vecout, 0, QuantizeSize());
+                for (DimensionType i = 0; i < m_Dim; i++)
+                {
+                    float code = (m_Scale[i] > 0) ? std::floor(((float)x[i] - m_Min[i]) / m_Scale[i] + 0.5f) : 0;
+                    std::uint8_t c = (std::uint8_t)max(0.0f, min(levels, code));
+                    if (m_FourBitCodes) vecout[i >> 1] |= (std::uint8_t)(c << ((i & 1) << 2));
+                    else vecout[i] = c;
+                }
+            }
+        }
+
+        template <typename T>
+        SizeType SQQuantizer<T>::QuantizeSize()
+        {
+            if (GetEnableADC())
+            {
+                return sizeof(float) * (2 * m_Dim + 1);
+            }
+            return m_FourBitCodes ? (m_Dim + 1) / 2 : m_Dim;
+        }
+
+        template <typename T>
+        void SQQuantizer<T>::ReconstructVector(const std::uint8_t* qvec, void* vecout)
+        {
+            T* out = (T*)vecout;
+            for (DimensionType i = 0; i < m_Dim; i++)
+            {
+                std::uint8_t code = m_FourBitCodes ? DistanceUtils::GetCode<4>(qvec, i) : qvec[i];
+                out[i] = (T)(m_Min[i] + code * m_Scale[i]);
+            }
+        }
+
+        template <typename T>
+        SizeType SQQuantizer<T>::ReconstructSize()
+        {
+            return sizeof(T) * ReconstructDim();
+        }
+
+        template <typename T>
+        DimensionType SQQuantizer<T>::ReconstructDim()
+        {
+            return m_Dim;
+        }
+
+        template <typename T>
+        std::uint64_t SQQuantizer<T>::BufferSize() const
+        {
+            return sizeof(float) * m_Dim * 2 + sizeof(DimensionType) + sizeof(VectorValueType) + sizeof(QuantizerType);
+        }
+
+        template <typename T>
+        ErrorCode SQQuantizer<T>::SaveQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_out) const
+        {
+            QuantizerType qtype = m_FourBitCodes ? QuantizerType::SQ4Quantizer : QuantizerType::SQ8Quantizer;
+            VectorValueType rtype = GetEnumValueType<T>();
+            IOBINARY(p_out, WriteBinary, sizeof(QuantizerType), (char*)&qtype);
+            IOBINARY(p_out, WriteBinary, sizeof(VectorValueType), (char*)&rtype);
+            IOBINARY(p_out, WriteBinary, sizeof(DimensionType), (char*)&m_Dim);
+            IOBINARY(p_out, WriteBinary, sizeof(float) * m_Dim, (char*)m_Min.data());
+            IOBINARY(p_out, WriteBinary, sizeof(float) * m_Dim, (char*)m_Scale.data());
+            LOG(Helper::LogLevel::LL_Info, "Saving quantizer: Dim:%d Bits:%d\n", m_Dim, m_FourBitCodes ? 4 : 8);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode SQQuantizer<T>::LoadQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_in)
+        {
+            IOBINARY(p_in, ReadBinary, sizeof(DimensionType), (char*)&m_Dim);
+            m_Min.resize(m_Dim);
+            m_Scale.resize(m_Dim);
+            IOBINARY(p_in, ReadBinary, sizeof(float) * m_Dim, (char*)m_Min.data());
+            IOBINARY(p_in, ReadBinary, sizeof(float) * m_Dim, (char*)m_Scale.data());
+            BindDistanceKernels();
+            LOG(Helper::LogLevel::LL_Info, "Loaded quantizer: Dim:%d Bits:%d\n", m_Dim, m_FourBitCodes ? 4 : 8);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        int SQQuantizer<T>::GetBase()
+        {
+            return COMMON::Utils::GetBaseCore<T>();
+        }
+
+        template <typename T>
+        DimensionType SQQuantizer<T>::GetNumSubvectors() const
+        {
+            return m_Dim;
+        }
+
+        template <typename T>
+        bool SQQuantizer<T>::GetEnableADC()
+        {
+            return m_EnableADC;
+        }
+
+        template <typename T>
+        void SQQuantizer<T>::SetEnableADC(bool enableADC)
+        {
+            m_EnableADC = enableADC;
+            BindDistanceKernels();
+        }
+
+        template <typename T>
+        template <int Bits>
+        void SQQuantizer<T>::SelectKernels()
+        {
+            if (InstructionSet::AVX512())
+            {
+                m_fL2Kernel = &(DistanceUtils::ComputeSQL2Distance_AVX512<Bits>);
+                m_fDotKernel = &(DistanceUtils::ComputeSQDotProduct_AVX512<Bits>);
+                m_fSDCL2Kernel = &(DistanceUtils::ComputeSQSDCL2Distance_AVX512<Bits>);
+                m_fSDCDotKernel = &(DistanceUtils::ComputeSQSDCDotProduct_AVX512<Bits>);
+            }
+            else if (InstructionSet::AVX2())
+            {
+                m_fL2Kernel = &(DistanceUtils::ComputeSQL2Distance_AVX<Bits>);
+                m_fDotKernel = &(DistanceUtils::ComputeSQDotProduct_AVX<Bits>);
+                m_fSDCL2Kernel = &(DistanceUtils::ComputeSQSDCL2Distance_AVX<Bits>);
+                m_fSDCDotKernel = &(DistanceUtils::ComputeSQSDCDotProduct_AVX<Bits>);
+            }
+            else
+            {
+                m_fL2Kernel = &(DistanceUtils::ComputeSQL2Distance<Bits>);
+                m_fDotKernel = &(DistanceUtils::ComputeSQDotProduct<Bits>);
+                m_fSDCL2Kernel = &(DistanceUtils::ComputeSQSDCL2Distance<Bits>);
+                m_fSDCDotKernel = &(DistanceUtils::ComputeSQSDCDotProduct<Bits>);
+            }
+        }
+
+        template <typename T>
+        void SQQuantizer<T>::BindDistanceKernels()
+        {
+            if (m_FourBitCodes) SelectKernels<4>();
+            else SelectKernels<8>();
+
+            // Cosine follows the distance of the reconstructed type: base * base minus the dot product.
+            float base = (float)COMMON::Utils::GetBaseCore<T>();
+            m_BaseSquare = base * base;
+
+            m_fL2Distance = m_EnableADC ? &ADCL2Distance : &SDCL2Distance;
+            m_fCosineDistance = m_EnableADC ? &ADCCosineDistance : &SDCCosineDistance;
+        }
+
+        template <typename T>
+        float SQQuantizer<T>::ADCL2Distance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY)
+            // pX must be the query layout written by QuantizeVector for ADC
+        {
+            const SQQuantizer<T>* sq = static_cast<const SQQuantizer<T>*>(q);
+            return sq->m_fL2Kernel((const float*)pX, sq->m_Scale.data(), pY, sq->m_Dim);
+        }
+
+        template <typename T>
+        float SQQuantizer<T>::ADCCosineDistance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY)
+        {
+            const SQQuantizer<T>* sq = static_cast<const SQQuantizer<T>*>(q);
+            const float* query = (const float*)pX;
+            return sq->m_BaseSquare - query[2 * sq->m_Dim] - sq->m_fDotKernel(query + sq->m_Dim, pY, sq->m_Dim);
+        }
+
+        template <typename T>
+        float SQQuantizer<T>::SDCL2Distance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY)
+        {
+            const SQQuantizer<T>* sq = static_cast<const SQQuantizer<T>*>(q);
+            return sq->m_fSDCL2Kernel(sq->m_Scale.data(), pX, pY, sq->m_Dim);
+        }
+
+        template <typename T>
+        float SQQuantizer<T>::SDCCosineDistance(const IQuantizer* q, const std::uint8_t* pX, const std::uint8_t* pY)
+        {
+            const SQQuantizer<T>* sq = static_cast<const SQQuantizer<T>*>(q);
+            return sq->m_BaseSquare - sq->m_fSDCDotKernel(sq->m_Min.data(), sq->m_Scale.data(), pX, pY, sq->m_Dim);
+        }
+    }
+}
+
+#endif // _SPTAG_COMMON_SQQUANTIZER_H_
@@ -158,8 +158,8 @@ namespace SPTAG
 
             template<typename T>
             static void GenerateTruth(std::shared_ptr<VectorSet> querySet, std::shared_ptr<VectorSet> vectorSet, const std::string truthFile,
-                const SPTAG::DistCalcMethod distMethod, const int K, const SPTAG::TruthFileType p_truthFileType) {
-                if (querySet->Dimension() != vectorSet->Dimension() && !SPTAG::COMMON::DistanceUtils::Quantizer)
+                const SPTAG::DistCalcMethod distMethod, const int K, const SPTAG::TruthFileType p_truthFileType, const std::shared_ptr<IQuantizer>& quantizer = nullptr) {
+                if (querySet->Dimension() != vectorSet->Dimension() && !quantizer)
                 {
                     LOG(Helper::LogLevel::LL_Error, "query and vector have different dimensions.");
                     exit(-1);
@@ -167,13 +167,15 @@ namespace SPTAG
 
                 std::vector< std::vector<SPTAG::SizeType> > truthset(querySet->Count(), std::vector<SPTAG::SizeType>(K, 0));
                 std::vector< std::vector<float> > distset(querySet->Count(), std::vector<float>(K, 0));
+                auto fComputeDistance = SPTAG::COMMON::DistanceCalcSelector<T>(distMethod, quantizer);
 #pragma omp parallel for
                 for (int i = 0; i < querySet->Count(); ++i)
                 {
                     SPTAG::COMMON::QueryResultSet<T> query((const T*)(querySet->GetVector(i)), K);
+                    query.SetQuantizer(quantizer.get());
                     for (SPTAG::SizeType j = 0; j < vectorSet->Count(); j++)
                     {
-                        float dist = SPTAG::COMMON::DistanceUtils::ComputeDistance(query.GetQuantizedTarget(), reinterpret_cast<T*>(vectorSet->GetVector(j)), vectorSet->Dimension(), distMethod);
+                        float dist = fComputeDistance(query.GetQuantizedTarget(), reinterpret_cast<T*>(vectorSet->GetVector(j)), vectorSet->Dimension());
                         query.AddPoint(j, dist);
                     }
                     query.SortResult();
@@ -290,12 +292,13 @@ namespace SPTAG
                 COMMON::QueryResultSet<void> sampleANN(query, K);
                 COMMON::QueryResultSet<void> sampleTruth(query, K);
                 void* reconstructVector = nullptr;
-                if (SPTAG::COMMON::DistanceUtils::Quantizer)
+                if (index->GetQuantizer())
                 {
-                    reconstructVector = _mm_malloc(SPTAG::COMMON::DistanceUtils::Quantizer->ReconstructSize(), ALIGN_SPTAG);
-                    SPTAG::COMMON::DistanceUtils::Quantizer->ReconstructVector((const uint8_t*)query, reconstructVector);
+                    reconstructVector = _mm_malloc(index->GetQuantizer()->ReconstructSize(), ALIGN_SPTAG);
+                    index->GetQuantizer()->ReconstructVector((const uint8_t*)query, reconstructVector);
                     sampleANN.SetTarget(reconstructVector);
                     sampleTruth.SetTarget(reconstructVector);
+                    sampleTruth.SetQuantizer(index->GetQuantizer().get());
                 }
 
                 index->SearchIndex(sampleANN);
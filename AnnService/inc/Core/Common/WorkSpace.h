@@ -8,7 +8,6 @@
 #include "CommonUtils.h"
 #include "Heap.h"
 
-#include <stdarg.h>
 
 namespace SPTAG
 {
@@ -28,6 +27,9 @@ namespace SPTAG
             // Max pool size.
             int m_poolSize;
 
+            // Whether anything was inserted since the last clear.
+            bool m_used;
+
             // Record 2 hash tables.
             // [0~m_poolSize + 1) is the first block.
             // [m_poolSize + 1, 2*(m_poolSize + 1)) is the second block;
@@ -46,7 +48,7 @@ namespace SPTAG
             }
 
         public:
-            OptHashPosVector(): m_secondHash(false), m_exp(2), m_poolSize(8191) {}
+            OptHashPosVector(): m_secondHash(false), m_exp(2), m_poolSize(8191), m_used(false) {}
 
             ~OptHashPosVector() {}
 
@@ -62,11 +64,14 @@ namespace SPTAG
                 m_exp = exp;
                 m_poolSize = (1 << (ex + exp)) - 1;
                 m_hashTable.reset(new SizeType[(m_poolSize + 1) * 2]);
+                m_used = true;
                 clear();
             }
 
             void clear()
             {
+                if (!m_used) return;
+                m_used = false;
                 if (!m_secondHash)
                 {
                     // Clear first block.
@@ -87,6 +92,7 @@ namespace SPTAG
             inline bool CheckAndSet(SizeType idx)
             {
                 // Inner Index is begin from 1
+                m_used = true;
                 return _CheckAndSet(m_hashTable.get(), m_poolSize, true, idx + 1) == 0;
             }
 
@@ -138,6 +144,63 @@ namespace SPTAG
             }
         };
 
+        // Visited flags for the ids below m_limit, stored as the epoch of the query that last visited them.
+        // clear() starts a new epoch instead of wiping the table, so it only touches memory once every 65535
+        // queries. The table grows with the largest id seen, up to m_limit entries.
+        class EpochPosVector
+        {
+        private:
+            std::unique_ptr<std::uint16_t[]> m_epochs;
+
+            SizeType m_size;
+
+            SizeType m_limit;
+
+            std::uint16_t m_epoch;
+
+        public:
+            EpochPosVector() : m_size(0), m_limit(0), m_epoch(1) {}
+
+            void Init(SizeType limit)
+            {
+                m_epochs.reset();
+                m_size = 0;
+                m_limit = max(limit, 0);
+                m_epoch = 1;
+            }
+
+            void clear()
+            {
+                if (++m_epoch == 0)
+                {
+                    if (m_size > 0) memset(m_epochs.get(), 0, sizeof(std::uint16_t) * m_size);
+                    m_epoch = 1;
+                }
+            }
+
+            inline SizeType Limit() const { return m_limit; }
+
+            // Only valid for idx < Limit().
+            inline bool CheckAndSet(SizeType idx)
+            {
+                if (idx >= m_size) Resize(idx);
+                if (m_epochs[idx] == m_epoch) return true;
+                m_epochs[idx] = m_epoch;
+                return false;
+            }
+
+        private:
+            void Resize(SizeType idx)
+            {
+                SizeType newSize = min(m_limit, max(idx + 1, m_size * 2));
+                std::uint16_t* newEpochs = new std::uint16_t[newSize];
+                if (m_size > 0) memcpy(newEpochs, m_epochs.get(), sizeof(std::uint16_t) * m_size);
+                memset(newEpochs + m_size, 0, sizeof(std::uint16_t) * (newSize - m_size));
+                m_epochs.reset(newEpochs);
+                m_size = newSize;
+            }
+        };
+
         class DistPriorityQueue {
             int m_size;
             std::unique_ptr<float[]> m_data;
@@ -205,12 +268,13 @@ namespace SPTAG
 
             WorkSpace(WorkSpace& other) 
             {
-                Initialize(other.m_iMaxCheck, other.nodeCheckStatus.HashTableExponent());
+                Initialize(other.m_iMaxCheck, other.nodeCheckStatus.HashTableExponent(), other.nodeEpochStatus.Limit());
             }
 
-            void Initialize(int maxCheck, int hashExp)
+            void Initialize(int maxCheck, int hashExp, SizeType visitedLimit)
             {
                 nodeCheckStatus.Init(maxCheck, hashExp);
+                nodeEpochStatus.Init(visitedLimit);
                 m_SPTQueue.Resize(maxCheck * 10);
                 m_NGQueue.Resize(maxCheck * 30);
                 m_Results.Resize(maxCheck / 16);
@@ -222,16 +286,10 @@ namespace SPTAG
                 m_iMaxCheck = maxCheck;
             }
 
-            void Initialize(va_list& arg)
-            {
-                int maxCheck = va_arg(arg, int);
-                int hashExp = va_arg(arg, int);
-                Initialize(maxCheck, hashExp);
-            }
-
             void Reset(int maxCheck, int resultNum)
             {
                 nodeCheckStatus.clear();
+                nodeEpochStatus.clear();
                 m_SPTQueue.clear();
                 m_NGQueue.clear();
                 m_Results.clear(max(maxCheck / 16, resultNum));
@@ -245,6 +303,7 @@ namespace SPTAG
 
             inline bool CheckAndSet(SizeType idx)
             {
+                if (idx < nodeEpochStatus.Limit()) return nodeEpochStatus.CheckAndSet(idx);
                 return nodeCheckStatus.CheckAndSet(idx);
             }
 
@@ -253,8 +312,11 @@ namespace SPTAG
                 return nodeCheckStatus.HashTableExponent(); 
             }
 
+            // Visited ids at or above nodeEpochStatus.Limit()
             OptHashPosVector nodeCheckStatus;
 
+            EpochPosVector nodeEpochStatus;
+
             // counter for dynamic pivoting
             int m_iNumOfContinuousNoBetterPropagation;
             int m_iContinuousLimit;
@@ -272,6 +334,9 @@ namespace SPTAG
             Heap<NodeDistPair> m_nextBSPTQueue;
 
             DistPriorityQueue m_Results;
+
+            // Neighbor list decoded from a compressed graph
+            std::vector<SizeType> m_neighbors;
         };
     }
 }
@@ -7,65 +7,150 @@
 #include "WorkSpace.h"
 #include "inc/Helper/ConcurrentSet.h"
 
-#include <list>
+#include <atomic>
+#include <memory>
 #include <mutex>
-#include <stdarg.h>
 
 namespace SPTAG
 {
     namespace COMMON
     {
-
+        // Hands out workspaces for searches. Every thread keeps up to c_threadCacheSize returned workspaces in a
+        // thread local cache, so a thread that searches the same index over and over neither locks nor touches
+        // a shared counter. Only a cache miss (first search of a thread, nested rents, another index) goes to
+        // the shared queue, which Init fills with the expected number of search threads.
+        //
+        // The slots of a thread's cache are shared by all pools of the same workspace type, so a thread never
+        // holds more than c_threadCacheSize workspaces of one type, and every slot records the pool and the
+        // generation it was returned for. Init starts a new generation and Drain, which also runs when the pool
+        // is destroyed, retires the current one. Workspaces cached for a retired generation are never handed out
+        // again and are freed by the next Rent on their thread, of any pool, so neither an old size (MaxCheck,
+        // HashTableExponent, ...) nor a destroyed index keeps them alive for long. A workspace rented across an
+        // Init keeps its old sizes and still works, because the visited table and the heaps grow on demand.
         template<typename T>
         class WorkSpacePool
         {
         public:
-            WorkSpacePool() {}
+            static const int c_threadCacheSize = 4;
+
+            WorkSpacePool() : m_state(std::make_shared<std::atomic<std::uint64_t>>(NextGeneration())) {}
 
-            ~WorkSpacePool() 
+            ~WorkSpacePool()
             {
-                std::shared_ptr<T> workspace;
-                while (m_workSpacePool.try_pop(workspace))
-                {
-                    workspace.reset();
-                }
+                Drain();
             }
 
-            std::shared_ptr<T> Rent()
+            std::unique_ptr<T> Rent()
             {
-                std::shared_ptr<T> workSpace;
+                std::unique_ptr<T> workSpace;
+                for (CacheSlot& slot : ThreadCache())
                 {
-                    if (m_workSpacePool.try_pop(workSpace))
+                    if (slot.m_workSpace == nullptr) continue;
+
+                    if (slot.IsStale())
                     {
+                        slot.m_workSpace.reset();
                     }
-                    else
+                    else if (workSpace == nullptr && slot.m_state == m_state)
                     {
-                        workSpace.reset(new T(m_workSpace));
+                        workSpace = std::move(slot.m_workSpace);
                     }
                 }
-                return workSpace;
+                if (workSpace != nullptr) return workSpace;
+
+                T* pooled = nullptr;
+                if (m_workSpacePool.try_pop(pooled)) return std::unique_ptr<T>(pooled);
+
+                std::lock_guard<std::mutex> lock(m_templateLock);
+                return std::unique_ptr<T>(new T(m_workSpace));
             }
 
-            void Return(const std::shared_ptr<T>& p_workSpace)
+            void Return(std::unique_ptr<T>&& p_workSpace)
             {
-                m_workSpacePool.push(p_workSpace);
+                std::uint64_t generation = m_state->load(std::memory_order_acquire);
+                if (generation == c_retired) return;
+
+                // Prefer a slot this pool used before, which spares the reference count of m_state.
+                CacheSlot* victim = nullptr;
+                for (CacheSlot& slot : ThreadCache())
+                {
+                    if (slot.m_workSpace != nullptr && !slot.IsStale()) continue;
+
+                    if (victim == nullptr || slot.m_state == m_state) victim = &slot;
+                    if (slot.m_state == m_state) break;
+                }
+
+                if (victim == nullptr)
+                {
+                    m_workSpacePool.push(p_workSpace.release());
+                    return;
+                }
+                if (victim->m_state != m_state) victim->m_state = m_state;
+                victim->m_generation = generation;
+                victim->m_workSpace = std::move(p_workSpace);
             }
 
-            void Init(int size, ...)
+            // Sizes the workspaces with p_args, which are passed on to T::Initialize, and queues p_size of them.
+            template<typename... Args>
+            void Init(int p_size, Args... p_args)
             {
-                va_list args;
-                va_start(args, size);
-                m_workSpace.Initialize(args);
-                va_end(args);
-                for (int i = 0; i < size; i++)
+                Drain();
                 {
-                    std::shared_ptr<T> workSpace(new T(m_workSpace));
-                    m_workSpacePool.push(std::move(workSpace));
+                    std::lock_guard<std::mutex> lock(m_templateLock);
+                    m_workSpace.Initialize(p_args...);
+                }
+                m_state->store(NextGeneration(), std::memory_order_release);
+
+                for (int i = 0; i < p_size; i++)
+                {
+                    m_workSpacePool.push(new T(m_workSpace));
                 }
             }
 
         private:
-            Helper::Concurrent::ConcurrentQueue<std::shared_ptr<T>> m_workSpacePool;
+            static const std::uint64_t c_retired = 0;
+
+            struct CacheSlot
+            {
+                // The generation of the pool that returned the workspace; it lives as long as the slot refers to it.
+                std::shared_ptr<std::atomic<std::uint64_t>> m_state;
+                std::uint64_t m_generation = c_retired;
+                std::unique_ptr<T> m_workSpace;
+
+                bool IsStale() const
+                {
+                    return m_state->load(std::memory_order_relaxed) != m_generation;
+                }
+            };
+
+            static CacheSlot (&ThreadCache())[c_threadCacheSize]
+            {
+                thread_local CacheSlot cache[c_threadCacheSize];
+                return cache;
+            }
+
+            // Generations are unique over all pools of this type and never c_retired.
+            static std::uint64_t NextGeneration()
+            {
+                static std::atomic<std::uint64_t> generation(c_retired);
+                return ++generation;
+            }
+
+            // Retires the current generation and frees the queued workspaces.
+            void Drain()
+            {
+                m_state->store(c_retired, std::memory_order_release);
+
+                T* workSpace = nullptr;
+                while (m_workSpacePool.try_pop(workSpace))
+                {
+                    delete workSpace;
+                }
+            }
+
+            std::shared_ptr<std::atomic<std::uint64_t>> m_state;
+            Helper::Concurrent::ConcurrentQueue<T*> m_workSpacePool;
+            std::mutex m_templateLock;
             T m_workSpace;
         };
 
@@ -388,7 +388,7 @@ __host__ Point<T, SUMTYPE, Dim>* convertMatrix(SPTAG::VectorIndex* index, size_t
   T* data;
 
   for(int i=0; i<rows; i++) {
-    data = (T*)index->GetSample(i);
+    data = (T*)index->GetInternalSample(i);
     pointArray[i].loadChunk(data, exact_dim);
   }
   return pointArray;
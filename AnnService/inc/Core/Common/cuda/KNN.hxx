@@ -655,7 +655,7 @@ void buildGraphGPU(SPTAG::VectorIndex* index, int dataSize, int KVAL, int trees,
 
   int dim = index->GetFeatureDim();
   int metric = (int)index->GetDistCalcMethod();
-  DTYPE* data = (DTYPE*)index->GetSample(0);
+  DTYPE* data = (DTYPE*)index->GetInternalSample(0);
 
   // Number of levels set to have approximately 500 points per leaf
   int levels = (int)std::log2(dataSize/leafSize);
@@ -793,7 +793,7 @@ void buildGraphGPU_Batch(SPTAG::VectorIndex* index, size_t dataSize, size_t KVAL
   int dim = index->GetFeatureDim();
   int metric = (int)index->GetDistCalcMethod();
 
-  DTYPE* data = (DTYPE*)index->GetSample(0);
+  DTYPE* data = (DTYPE*)index->GetInternalSample(0);
 
   // Number of levels is based on the chosen leaf size
   int levels = (int)std::log2(dataSize/leafSize);
@@ -45,7 +45,7 @@ void getCandidates(SPTAG::VectorIndex* index, int numVectors, int candidatesPerV
 #pragma omp parallel for schedule(dynamic)
   for (SizeType i = 0; i < numVectors; i++)
   {
-    SPTAG::COMMON::QueryResultSet<T> query((const T*)index->GetSample(i), candidatesPerVector);
+    SPTAG::COMMON::QueryResultSet<T> query((const T*)index->GetInternalSample(i), candidatesPerVector);
      index->SearchTree(query);
      for (SPTAG::DimensionType j = 0; j < candidatesPerVector; j++) {
        candidates[i*candidatesPerVector+j] = query.GetResult(j)->VID;
@@ -38,14 +38,16 @@ namespace SPTAG
         {
             class RebuildJob : public Helper::ThreadPool::Job {
             public:
-                RebuildJob(COMMON::Dataset<T>* p_data, COMMON::KDTree* p_tree, COMMON::RelativeNeighborhoodGraph* p_graph) : m_data(p_data), m_tree(p_tree), m_graph(p_graph) {}
+                RebuildJob(COMMON::Dataset<T>* p_data, COMMON::KDTree* p_tree, COMMON::RelativeNeighborhoodGraph* p_graph,
+                    std::shared_ptr<COMMON::IQuantizer> p_quantizer) : m_data(p_data), m_tree(p_tree), m_graph(p_graph), m_quantizer(p_quantizer) {}
                 void exec(IAbortOperation* p_abort) {
-                    m_tree->Rebuild<T>(*m_data, p_abort);
+                    m_tree->Rebuild<T>(*m_data, m_quantizer, p_abort);
                 }
             private:
                 COMMON::Dataset<T>* m_data;
                 COMMON::KDTree* m_tree;
                 COMMON::RelativeNeighborhoodGraph* m_graph;
+                std::shared_ptr<COMMON::IQuantizer> m_quantizer;
             };
 
         private:
@@ -74,7 +76,7 @@ namespace SPTAG
             int m_iNumberOfThreads;
 
             DistCalcMethod m_iDistCalcMethod;
-            float(*m_fComputeDistance)(const T* pX, const T* pY, DimensionType length);
+            COMMON::DistanceCalcFunc<T> m_fComputeDistance;
             int m_iBaseSquare;
  
             int m_iMaxCheck;
@@ -82,6 +84,7 @@ namespace SPTAG
             int m_iNumberOfInitialDynamicPivots;
             int m_iNumberOfOtherDynamicPivots;
             int m_iHashTableExp;
+            SizeType m_iVisitedTableLimit;
 
         public:
             Index()
@@ -93,8 +96,7 @@ namespace SPTAG
 #undef DefineKDTParameter
 
                 m_pSamples.SetName("Vector");
-                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod);
-                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+                BindDistanceFunction();
             }
 
             ~Index() {}
@@ -108,6 +110,12 @@ namespace SPTAG
             inline DistCalcMethod GetDistCalcMethod() const { return m_iDistCalcMethod; }
             inline IndexAlgoType GetIndexAlgoType() const { return IndexAlgoType::KDT; }
             inline VectorValueType GetVectorValueType() const { return GetEnumValueType<T>(); }
+
+            inline void SetQuantizer(std::shared_ptr<COMMON::IQuantizer> p_quantizer)
+            {
+                m_pQuantizer = p_quantizer;
+                BindDistanceFunction();
+            }
             
             inline float AccurateDistance(const void* pX, const void* pY) const {
                 if (m_iDistCalcMethod == DistCalcMethod::L2) return m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C());
@@ -150,6 +158,7 @@ namespace SPTAG
 
             ErrorCode BuildIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, bool p_normalized = false);
             ErrorCode SearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const;
+            ErrorCode SearchIndexWithFilter(QueryResult &p_query, const std::function<bool(SizeType)>& p_filter, bool p_searchDeleted = false) const;
             ErrorCode RefineSearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const;
             ErrorCode SearchTree(QueryResult &p_query) const;
             ErrorCode AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex = false, bool p_normalized = false);
@@ -164,8 +173,18 @@ namespace SPTAG
             ErrorCode RefineIndex(std::shared_ptr<VectorIndex>& p_newIndex);
 
         private:
+            // Samples of a quantized index are codes, so the distance function and the cosine base come from its quantizer.
+            // Called from the constructor, SetQuantizer and SetParameter(DistCalcMethod), never while searches run.
+            inline void BindDistanceFunction()
+            {
+                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod, m_pQuantizer);
+                int base = m_pQuantizer ? m_pQuantizer->GetBase() : COMMON::Utils::GetBase<T>();
+                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? base * base : 1;
+            }
+
             void SearchIndexWithDeleted(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const;
             void SearchIndexWithoutDeleted(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const;
+            void SearchIndexWithFilter(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, const std::function<bool(SizeType)>& p_filter, bool p_searchDeleted) const;
         };
     } // namespace KDT
 } // namespace SPTAG
@@ -45,6 +45,7 @@ DefineKDTParameter(m_iThresholdOfNumberOfContinuousNoBetterPropagation, int, 3L,
 DefineKDTParameter(m_iNumberOfInitialDynamicPivots, int, 50L, "NumberOfInitialDynamicPivots")
 DefineKDTParameter(m_iNumberOfOtherDynamicPivots, int, 4L, "NumberOfOtherDynamicPivots")
 DefineKDTParameter(m_iHashTableExp, int, 2L, "HashTableExponent")
+DefineKDTParameter(m_iVisitedTableLimit, SizeType, 4 * 1024 * 1024, "VisitedTableLimit") // Ids below this are marked visited in an epoch table, the rest in the hash table
 DefineKDTParameter(m_iDataBlockSize, int, 1024 * 1024, "DataBlockSize")
 DefineKDTParameter(m_iDataCapacity, int, MaxSize, "DataCapacity")
 DefineKDTParameter(m_iMetaRecordSize, int, 10, "MetaRecordSize")
@@ -13,9 +13,15 @@
 #include <cmath>
 #include <climits>
 #include <future>
+#include <functional>
+#include <algorithm>
+#include <shared_mutex>
+#include <unordered_set>
 
 #ifdef _MSC_VER
 #define ASYNC_READ 1
+#else
+#define BATCH_READ 1
 #endif
 
 namespace SPTAG
@@ -97,20 +103,10 @@ namespace SPTAG
 
             virtual bool LoadIndex(Options& p_opt) {
                 m_extraFullGraphFile = p_opt.m_indexDirectory + FolderSep + p_opt.m_ssdIndex;
-                std::string curFile = m_extraFullGraphFile;
-                do {
-                    auto curIndexFile = f_createAsyncIO();
-                    if (curIndexFile == nullptr || !curIndexFile->Initialize(curFile.c_str(), std::ios::binary | std::ios::in, (1 << 20), 2, 2, p_opt.m_ioThreads)) {
-                        LOG(Helper::LogLevel::LL_Error, "Cannot open file:%s!\n", curFile.c_str());
-                        return false;
-                    }
-
-                    m_indexContexts.emplace_back(curIndexFile);
-                    m_totalListCount += LoadingHeadInfo(curFile, p_opt.m_searchPostingPageLimit, m_indexContexts.back());
-
-                    curFile = m_extraFullGraphFile + "_" + std::to_string(m_indexContexts.size());
-                } while (fileexists(curFile.c_str()));
-                m_listPerFile = static_cast<int>((m_totalListCount + m_indexContexts.size() - 1) / m_indexContexts.size());
+                m_searchPostingPageLimit = p_opt.m_searchPostingPageLimit;
+                m_ioThreads = p_opt.m_ioThreads;
+                if (!OpenPostingFiles()) return false;
+                m_postingDeltas.resize(m_totalListCount);
                 return true;
             }
 
@@ -131,11 +127,83 @@ namespace SPTAG
                 std::atomic<int> diskIO(0);
                 std::atomic<int> diskRead(0);
 
+                bool checkDeleted = (m_deletedID != nullptr && m_deletedID->Count() > 0);
+
+                // With 4-bit PQ codes and ADC L2 distances, the postings are scanned 32 records at a time in a
+                // transposed block. The fast scan distance bounds the ADC distance, so only the records that can
+                // still enter the results get their exact distance, and the results stay the same.
+                const auto& quantizer = p_index->GetQuantizer();
+                bool fastScan = (quantizer != nullptr && quantizer->GetEnableADC() && quantizer->FastScanTableSize() > 0 &&
+                    p_index->GetDistCalcMethod() == DistCalcMethod::L2);
+                float fastScanTolerance = 0;
+                if (fastScan)
+                {
+                    p_exWorkSpace->m_fastScanTable.resize(quantizer->FastScanTableSize());
+                    p_exWorkSpace->m_fastScanBlock.resize(quantizer->FastScanBlockSize());
+                    quantizer->QuantizeFastScanTable(queryResults.GetTarget(), p_exWorkSpace->m_fastScanTable.data());
+                    fastScanTolerance = quantizer->FastScanTolerance(p_exWorkSpace->m_fastScanTable.data());
+                }
+
+                auto processRecords = [&](char* records, int recordCount, int curPostingID)
+                {
+                    float fastScanDists[32];
+                    for (int i = 0; i < recordCount; ++i)
+                    {
+                        if (fastScan && (i & 31) == 0)
+                        {
+                            quantizer->PackFastScanBlock(reinterpret_cast<std::uint8_t*>(records + i * m_vectorInfoSize + sizeof(int)),
+                                m_vectorInfoSize, min(32, recordCount - i), p_exWorkSpace->m_fastScanBlock.data());
+                            quantizer->ComputeFastScanDistances(p_exWorkSpace->m_fastScanTable.data(), p_exWorkSpace->m_fastScanBlock.data(), fastScanDists);
+                        }
+
+                        char* vectorInfo = records + i * m_vectorInfoSize;
+                        int vectorID = *(reinterpret_cast<int*>(vectorInfo));
+                        vectorInfo += sizeof(int);
+
+                        if (checkDeleted && m_deletedID->Contains(vectorID)) continue;
+                        if (p_exWorkSpace->m_deduper.CheckAndSet(vectorID)) continue;
+                        curCheck += 1;
+                        if (fastScan && fastScanDists[i & 31] - fastScanTolerance > queryResults.worstDist()) continue;
+
+                        auto distance2leaf = p_index->ComputeDistance(queryResults.GetQuantizedTarget(), vectorInfo);
+                        queryResults.AddPoint(vectorID, distance2leaf);
+                    }
+
+                    if (truth) {
+                        for (int i = 0; i < recordCount; ++i) {
+                            char* vectorInfo = records + i * m_vectorInfoSize;
+                            int vectorID = *(reinterpret_cast<int*>(vectorInfo));
+                            if (truth && truth->count(vectorID)) (*found)[curPostingID].insert(vectorID);
+                        }
+                    }
+                    listElements += recordCount;
+                };
+
+                auto processPosting = [&](ListInfo* listInfo, char* buffer, int curPostingID)
+                {
+                    processRecords(buffer + listInfo->pageOffset, listInfo->listEleCount, curPostingID);
+                };
+
+                std::shared_lock<std::shared_timed_mutex> postingLock(m_postingDeltaLock);
                 bool oneContext = (m_indexContexts.size() == 1);
                 for (uint32_t pi = 0; pi < postingListCount; ++pi)
                 {
                     auto curPostingID = p_exWorkSpace->m_postingIDs[pi];
 
+                    if (curPostingID < static_cast<int>(m_postingDeltas.size()))
+                    {
+                        std::shared_ptr<const PostingDelta> delta = std::atomic_load(&(m_postingDeltas[curPostingID]));
+                        if (delta != nullptr)
+                        {
+                            for (const PostingDelta* chunk = delta.get(); chunk != nullptr; chunk = chunk->m_previous.get())
+                            {
+                                processRecords(const_cast<char*>(chunk->m_records.data()), static_cast<int>(chunk->m_records.size() / m_vectorInfoSize), curPostingID);
+                            }
+                            if (delta->m_override) continue;
+                        }
+                    }
+                    if (curPostingID >= m_totalListCount) continue;
+
                     IndexContext* indexContext;
                     ListInfo* listInfo;
                     if (oneContext) {
@@ -158,53 +226,38 @@ namespace SPTAG
                     size_t totalBytes = (static_cast<size_t>(listInfo->listPageCount) << PageSizeEx);
                     char* buffer = (char*)((p_exWorkSpace->m_pageBuffers[pi]).GetBuffer());
 
-#ifdef ASYNC_READ
-                    ++unprocessed;
+#if defined(ASYNC_READ) || defined(BATCH_READ)
                     auto& request = p_exWorkSpace->m_diskRequests[pi];
                     request.m_offset = listInfo->listOffset;
                     request.m_readSize = totalBytes;
                     request.m_buffer = buffer;
+                    request.m_success = false;
+                    request.m_pListInfo = (void*)listInfo;
+#ifdef ASYNC_READ
+                    ++unprocessed;
                     request.m_callback = [&p_exWorkSpace, &request](bool success)
                     {
                         request.m_success = success;
                         p_exWorkSpace->m_processIocp.push(&request);
                     };
-                    request.m_success = false;
-                    request.m_pListInfo = (void*)listInfo;
 
                     if (!((indexContext->m_indexFile)->ReadFileAsync(request)))
                     {
                         LOG(Helper::LogLevel::LL_Error, "Failed to read file!\n");
                         p_exWorkSpace->m_processIocp.push(&request);
                     }
+#else
+                    request.m_callback = nullptr;
+                    request.m_payload = (void*)indexContext;
+                    p_exWorkSpace->m_batchRequests.push_back(&request);
+#endif
 #else
                     auto numRead = (indexContext->m_indexFile)->ReadBinary(totalBytes, buffer, listInfo->listOffset);
                     if (numRead != totalBytes) {
                         LOG(Helper::LogLevel::LL_Error, "File %s read bytes, expected: %zu, acutal: %llu.\n", m_extraFullGraphFile.c_str(), totalBytes, numRead);
                         exit(-1);
                     }
-
-                    for (int i = 0; i < listInfo->listEleCount; ++i)
-                    {
-                        char* vectorInfo = buffer + listInfo->pageOffset + i * m_vectorInfoSize;
-                        int vectorID = *(reinterpret_cast<int*>(vectorInfo));
-                        vectorInfo += sizeof(int);
-
-                        if (p_exWorkSpace->m_deduper.CheckAndSet(vectorID)) continue;
-
-                        auto distance2leaf = p_index->ComputeDistance(queryResults.GetQuantizedTarget(), vectorInfo);
-                        queryResults.AddPoint(vectorID, distance2leaf);
-                        curCheck += 1;
-                    }
-
-                    if (truth) {
-                        for (int i = 0; i < listInfo->listEleCount; ++i) {
-                            char* vectorInfo = buffer + listInfo->pageOffset + i * m_vectorInfoSize;
-                            int vectorID = *(reinterpret_cast<int*>(vectorInfo));
-                            if (truth && truth->count(vectorID)) (*found)[curPostingID].insert(vectorID);
-                        }
-                    }
-                    listElements += listInfo->listEleCount;
+                    processPosting(listInfo, buffer, curPostingID);
 #endif
                 }
 
@@ -218,32 +271,38 @@ namespace SPTAG
 
                     if (request->m_success)
                     {
-                        ListInfo* listInfo = (ListInfo*)(request->m_pListInfo);
-                        char* buffer = request->m_buffer;
-
-                        for (int i = 0; i < listInfo->listEleCount; ++i)
-                        {
-                            char* vectorInfo = buffer + listInfo->pageOffset + i * m_vectorInfoSize;
-                            int vectorID = *(reinterpret_cast<int*>(vectorInfo));
-                            vectorInfo += sizeof(int);
-
-                            if (p_exWorkSpace->m_deduper.CheckAndSet(vectorID)) continue;
+                        processPosting((ListInfo*)(request->m_pListInfo), request->m_buffer, p_exWorkSpace->m_postingIDs[request - p_exWorkSpace->m_diskRequests.data()]);
+                    }
+                }
+#endif
+#ifdef BATCH_READ
+                auto& batchRequests = p_exWorkSpace->m_batchRequests;
+                if (oneContext) {
+                    m_indexContexts[0].m_indexFile->BatchReadFile(batchRequests.data(), static_cast<std::uint32_t>(batchRequests.size()));
+                }
+                else {
+                    // Postings are spread over several files, submit one batch per file.
+                    auto contextEnd = batchRequests.begin();
+                    while (contextEnd != batchRequests.end())
+                    {
+                        auto contextBegin = contextEnd;
+                        void* context = (*contextBegin)->m_payload;
+                        contextEnd = std::partition(contextBegin, batchRequests.end(), [context](Helper::AsyncReadRequest* request) { return request->m_payload == context; });
+                        ((IndexContext*)context)->m_indexFile->BatchReadFile(&(*contextBegin), static_cast<std::uint32_t>(contextEnd - contextBegin));
+                    }
+                }
 
-                            auto distance2leaf = p_index->ComputeDistance(queryResults.GetQuantizedTarget(), vectorInfo);
-                            queryResults.AddPoint(vectorID, distance2leaf);
-                            curCheck += 1;
-                        }
-                        if (truth) {
-                            for (int i = 0; i < listInfo->listEleCount; ++i) {
-                                char* vectorInfo = buffer + listInfo->pageOffset + i * m_vectorInfoSize;
-                                int vectorID = *(reinterpret_cast<int*>(vectorInfo));
-                                int curPostingID = p_exWorkSpace->m_postingIDs[request - p_exWorkSpace->m_diskRequests.data()];
-                                if (truth && truth->count(vectorID)) (*found)[curPostingID].insert(vectorID);
-                            }
-                        }
-                        listElements += listInfo->listEleCount;
+                for (auto request : batchRequests)
+                {
+                    Helper::DiskListRequest* diskRequest = static_cast<Helper::DiskListRequest*>(request);
+                    if (!diskRequest->m_success)
+                    {
+                        LOG(Helper::LogLevel::LL_Error, "File %s read bytes failed at offset %llu.\n", m_extraFullGraphFile.c_str(), diskRequest->m_offset);
+                        continue;
                     }
+                    processPosting((ListInfo*)(diskRequest->m_pListInfo), diskRequest->m_buffer, p_exWorkSpace->m_postingIDs[diskRequest - p_exWorkSpace->m_diskRequests.data()]);
                 }
+                batchRequests.clear();
 #endif
                 if (p_stats) 
                 {
@@ -313,7 +372,7 @@ namespace SPTAG
                         SizeType start = i * batchSize;
                         SizeType end = min(start + batchSize, fullCount);
                         auto fullVectors = p_reader->GetVectorSet(start, end);
-                        if (p_opt.m_distCalcMethod == DistCalcMethod::Cosine && !p_reader->IsNormalized()) fullVectors->Normalize(p_opt.m_iSSDNumberOfThreads);
+                        if (p_opt.m_distCalcMethod == DistCalcMethod::Cosine && !p_reader->IsNormalized() && !p_headIndex->GetQuantizer()) fullVectors->Normalize(p_opt.m_iSSDNumberOfThreads);
 
                         if (p_opt.m_batches > 1) {
                             selections.LoadBatch(static_cast<size_t>(start) * p_opt.m_replicaCount, static_cast<size_t>(end) * p_opt.m_replicaCount);
@@ -451,7 +510,7 @@ namespace SPTAG
                 if (p_opt.m_ssdIndexFileNum > 1) selections.SaveBatch();
 
                 auto fullVectors = p_reader->GetVectorSet();
-                if (p_opt.m_distCalcMethod == DistCalcMethod::Cosine && !p_reader->IsNormalized()) fullVectors->Normalize(p_opt.m_iSSDNumberOfThreads);
+                if (p_opt.m_distCalcMethod == DistCalcMethod::Cosine && !p_reader->IsNormalized() && !p_headIndex->GetQuantizer()) fullVectors->Normalize(p_opt.m_iSSDNumberOfThreads);
 
                 for (int i = 0; i < p_opt.m_ssdIndexFileNum; i++) {
                     size_t curPostingListOffSet = i * postingFileSize;
@@ -470,12 +529,34 @@ namespace SPTAG
                     OutputSSDIndexFile((i == 0) ? outputFile : outputFile + "_" + std::to_string(i),
                         vectorInfoSize,
                         curPostingListSizes,
-                        selections,
                         postPageNum,
                         postPageOffset,
                         postingOrderInIndex,
-                        fullVectors,
-                        curPostingListOffSet);
+                        fullVectors->Count(),
+                        fullVectors->Dimension(),
+                        [&](int p_id, Helper::DiskPriorityIO* p_out)
+                        {
+                            int node = p_id + static_cast<int>(curPostingListOffSet);
+                            std::size_t selectIdx = selections.lower_bound(node);
+                            for (int j = 0; j < curPostingListSizes[p_id]; ++j)
+                            {
+                                if (selections[selectIdx].node != node)
+                                {
+                                    LOG(Helper::LogLevel::LL_Error, "Selection ID NOT MATCH! node:%d offset:%zu\n", node, selectIdx);
+                                    exit(1);
+                                }
+
+                                int vid = selections[selectIdx++].tonode;
+                                if (p_out->WriteBinary(sizeof(vid), reinterpret_cast<char*>(&vid)) != sizeof(vid)) {
+                                    LOG(Helper::LogLevel::LL_Error, "Failed to write SSDIndex File!");
+                                    exit(1);
+                                }
+                                if (p_out->WriteBinary(fullVectors->PerVectorDataSize(), reinterpret_cast<char*>(fullVectors->GetVector(vid))) != fullVectors->PerVectorDataSize()) {
+                                    LOG(Helper::LogLevel::LL_Error, "Failed to write SSDIndex File!");
+                                    exit(1);
+                                }
+                            }
+                        });
                 }
 
                 auto t5 = std::chrono::high_resolution_clock::now();
@@ -485,6 +566,209 @@ namespace SPTAG
                 return true;
             }
 
+            virtual SizeType GetDocumentCount() const { return m_documentCount; }
+
+            virtual void ExtendPostings(SizeType p_postingCount)
+            {
+                std::unique_lock<std::shared_timed_mutex> lock(m_postingDeltaLock);
+                if (p_postingCount > static_cast<SizeType>(m_postingDeltas.size())) m_postingDeltas.resize(p_postingCount);
+            }
+
+            virtual int GetPostingSize(SizeType p_postingID)
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(m_postingDeltaLock);
+                if (p_postingID < 0 || p_postingID >= static_cast<SizeType>(m_postingDeltas.size())) return 0;
+
+                int size = 0;
+                std::shared_ptr<const PostingDelta> delta = std::atomic_load(&(m_postingDeltas[p_postingID]));
+                if (delta != nullptr) {
+                    size += static_cast<int>(delta->m_totalSize / m_vectorInfoSize);
+                    if (delta->m_override) return size;
+                }
+                if (p_postingID < m_totalListCount) size += GetListInfo(p_postingID)->listEleCount;
+                return size;
+            }
+
+            // Returns the live records of a posting: disk and memory merged, deleted and duplicated vectors removed.
+            virtual bool ReadPosting(SizeType p_postingID, std::string& p_posting)
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(m_postingDeltaLock);
+                if (p_postingID < 0 || p_postingID >= static_cast<SizeType>(m_postingDeltas.size())) {
+                    p_posting.clear();
+                    return false;
+                }
+                std::shared_ptr<const PostingDelta> delta = std::atomic_load(&(m_postingDeltas[p_postingID]));
+                return MergePosting(p_postingID, delta.get(), p_posting);
+            }
+
+            // Callers serialize writers of the same posting, readers see either the old or the new list of chunks.
+            virtual bool AppendPosting(SizeType p_postingID, const std::string& p_appendPosting)
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(m_postingDeltaLock);
+                if (p_postingID < 0 || p_postingID >= static_cast<SizeType>(m_postingDeltas.size())) return false;
+
+                std::shared_ptr<const PostingDelta> previous = std::atomic_load(&(m_postingDeltas[p_postingID]));
+                std::shared_ptr<PostingDelta> delta(new PostingDelta());
+                delta->m_records = p_appendPosting;
+                if (previous != nullptr) {
+                    delta->m_override = previous->m_override;
+                    delta->m_totalSize = previous->m_totalSize;
+                }
+                delta->m_totalSize += p_appendPosting.size();
+
+                // Newer chunks that are not larger than the new one are folded into it, so the chunk sizes at least
+                // double towards the oldest one: a posting has O(log n) chunks and a record is copied O(log n) times.
+                while (previous != nullptr && previous->m_records.size() <= delta->m_records.size()) {
+                    delta->m_records.insert(0, previous->m_records);
+                    previous = previous->m_previous;
+                }
+                delta->m_previous = previous;
+                std::atomic_store(&(m_postingDeltas[p_postingID]), std::shared_ptr<const PostingDelta>(delta));
+                return true;
+            }
+
+            virtual bool OverridePosting(SizeType p_postingID, const std::string& p_posting)
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(m_postingDeltaLock);
+                if (p_postingID < 0 || p_postingID >= static_cast<SizeType>(m_postingDeltas.size())) return false;
+
+                std::shared_ptr<PostingDelta> delta(new PostingDelta());
+                delta->m_override = true;
+                delta->m_records = p_posting;
+                delta->m_totalSize = p_posting.size();
+                std::atomic_store(&(m_postingDeltas[p_postingID]), std::shared_ptr<const PostingDelta>(delta));
+                return true;
+            }
+
+            virtual std::uint64_t PostingDeltaBufferSize()
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(m_postingDeltaLock);
+                std::uint64_t size = sizeof(int) * 2;
+                for (auto& item : m_postingDeltas) {
+                    std::shared_ptr<const PostingDelta> delta = std::atomic_load(&item);
+                    if (delta != nullptr) size += sizeof(int) * 3 + delta->m_totalSize;
+                }
+                return size;
+            }
+
+            virtual ErrorCode SavePostingDelta(std::shared_ptr<Helper::DiskPriorityIO> p_output)
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(m_postingDeltaLock);
+                std::vector<std::pair<int, std::shared_ptr<const PostingDelta>>> deltas;
+                for (int i = 0; i < static_cast<int>(m_postingDeltas.size()); i++) {
+                    std::shared_ptr<const PostingDelta> delta = std::atomic_load(&(m_postingDeltas[i]));
+                    if (delta != nullptr) deltas.emplace_back(i, delta);
+                }
+
+                int postingCount = static_cast<int>(m_postingDeltas.size());
+                int deltaCount = static_cast<int>(deltas.size());
+                IOBINARY(p_output, WriteBinary, sizeof(int), (char*)&postingCount);
+                IOBINARY(p_output, WriteBinary, sizeof(int), (char*)&deltaCount);
+                for (auto& item : deltas) {
+                    int isOverride = item.second->m_override ? 1 : 0;
+                    int recordCount = static_cast<int>(item.second->m_totalSize / m_vectorInfoSize);
+                    IOBINARY(p_output, WriteBinary, sizeof(int), (char*)&(item.first));
+                    IOBINARY(p_output, WriteBinary, sizeof(int), (char*)&isOverride);
+                    IOBINARY(p_output, WriteBinary, sizeof(int), (char*)&recordCount);
+                    for (const PostingDelta* chunk : Chunks(item.second.get())) {
+                        if (!chunk->m_records.empty()) IOBINARY(p_output, WriteBinary, chunk->m_records.size(), chunk->m_records.data());
+                    }
+                }
+                LOG(Helper::LogLevel::LL_Info, "Save posting delta (%d,%d) Finish!\n", postingCount, deltaCount);
+                return ErrorCode::Success;
+            }
+
+            virtual ErrorCode LoadPostingDelta(std::shared_ptr<Helper::DiskPriorityIO> p_input)
+            {
+                int postingCount, deltaCount;
+                IOBINARY(p_input, ReadBinary, sizeof(int), (char*)&postingCount);
+                IOBINARY(p_input, ReadBinary, sizeof(int), (char*)&deltaCount);
+                if (postingCount < m_totalListCount) {
+                    LOG(Helper::LogLevel::LL_Error, "Posting delta has %d postings, less than %d in the posting file!\n", postingCount, m_totalListCount);
+                    return ErrorCode::Fail;
+                }
+
+                std::unique_lock<std::shared_timed_mutex> lock(m_postingDeltaLock);
+                m_postingDeltas.clear();
+                m_postingDeltas.resize(postingCount);
+                for (int i = 0; i < deltaCount; i++) {
+                    int postingID, isOverride, recordCount;
+                    IOBINARY(p_input, ReadBinary, sizeof(int), (char*)&postingID);
+                    IOBINARY(p_input, ReadBinary, sizeof(int), (char*)&isOverride);
+                    IOBINARY(p_input, ReadBinary, sizeof(int), (char*)&recordCount);
+                    if (postingID < 0 || postingID >= postingCount) return ErrorCode::Fail;
+
+                    std::shared_ptr<PostingDelta> delta(new PostingDelta());
+                    delta->m_override = (isOverride != 0);
+                    delta->m_records.resize(static_cast<size_t>(recordCount) * m_vectorInfoSize);
+                    delta->m_totalSize = delta->m_records.size();
+                    if (recordCount > 0) IOBINARY(p_input, ReadBinary, delta->m_records.size(), &(delta->m_records[0]));
+                    m_postingDeltas[postingID] = delta;
+                }
+                LOG(Helper::LogLevel::LL_Info, "Load posting delta (%d,%d) Finish!\n", postingCount, deltaCount);
+                return ErrorCode::Success;
+            }
+
+            // Rewrites every posting with its delta merged into a new posting file and drops the deltas.
+            virtual ErrorCode CompactPostings()
+            {
+                std::unique_lock<std::shared_timed_mutex> lock(m_postingDeltaLock);
+                if (m_vectorInfoSize == 0) return ErrorCode::Fail;
+
+                auto t1 = std::chrono::high_resolution_clock::now();
+                int postingCount = static_cast<int>(m_postingDeltas.size());
+                std::vector<std::string> postings(postingCount);
+                std::vector<int> postingListSizes(postingCount, 0);
+                for (int i = 0; i < postingCount; i++) {
+                    if (!MergePosting(i, m_postingDeltas[i].get(), postings[i])) return ErrorCode::Fail;
+                    postingListSizes[i] = static_cast<int>(postings[i].size() / m_vectorInfoSize);
+                    if (postingListSizes[i] > ((m_searchPostingPageLimit << PageSizeEx) / m_vectorInfoSize)) {
+                        LOG(Helper::LogLevel::LL_Warning, "Posting %d has %d vectors, more than the search page limit %d holds.\n", i, postingListSizes[i], m_searchPostingPageLimit);
+                    }
+                }
+
+                std::unique_ptr<int[]> postPageNum;
+                std::unique_ptr<std::uint16_t[]> postPageOffset;
+                std::vector<int> postingOrderInIndex;
+                SelectPostingOffset(m_vectorInfoSize, postingListSizes, postPageNum, postPageOffset, postingOrderInIndex);
+
+                std::string tmpFile = m_extraFullGraphFile + "_tmp";
+                OutputSSDIndexFile(tmpFile,
+                    m_vectorInfoSize,
+                    postingListSizes,
+                    postPageNum,
+                    postPageOffset,
+                    postingOrderInIndex,
+                    m_documentCount,
+                    static_cast<DimensionType>((m_vectorInfoSize - sizeof(int)) / sizeof(ValueType)),
+                    [&](int p_id, Helper::DiskPriorityIO* p_out)
+                    {
+                        if (postings[p_id].empty()) return;
+                        if (p_out->WriteBinary(postings[p_id].size(), postings[p_id].data()) != postings[p_id].size()) {
+                            LOG(Helper::LogLevel::LL_Error, "Failed to write SSDIndex File!");
+                            exit(1);
+                        }
+                    });
+
+                size_t fileCount = m_indexContexts.size();
+                m_indexContexts.clear();
+                for (size_t i = 1; i < fileCount; i++) std::remove((m_extraFullGraphFile + "_" + std::to_string(i)).c_str());
+                std::remove(m_extraFullGraphFile.c_str());
+                if (std::rename(tmpFile.c_str(), m_extraFullGraphFile.c_str()) != 0) {
+                    LOG(Helper::LogLevel::LL_Error, "Failed to rename %s to %s!\n", tmpFile.c_str(), m_extraFullGraphFile.c_str());
+                    return ErrorCode::DiskIOFail;
+                }
+
+                m_totalListCount = 0;
+                if (!OpenPostingFiles()) return ErrorCode::FailedOpenFile;
+                m_postingDeltas.clear();
+                m_postingDeltas.resize(postingCount);
+
+                auto t2 = std::chrono::high_resolution_clock::now();
+                LOG(Helper::LogLevel::LL_Info, "Compact %d postings into %s in %.2lf sec.\n", postingCount, m_extraFullGraphFile.c_str(), std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() / 1000.0);
+                return ErrorCode::Success;
+            }
+
         private:
             struct ListInfo
             {
@@ -505,7 +789,92 @@ namespace SPTAG
                 IndexContext(std::shared_ptr<SPTAG::Helper::DiskPriorityIO> indexFile) : m_indexFile(indexFile) {}
             };
 
+            // Records written after the posting file was built, kept as an immutable list of chunks
+            // from the newest to the oldest. With m_override set the disk posting is stale and the
+            // chunks hold the whole posting.
+            struct PostingDelta {
+                std::string m_records;
+
+                std::shared_ptr<const PostingDelta> m_previous;
+
+                std::size_t m_totalSize = 0;
+
+                bool m_override = false;
+            };
+
+            // Chunks of a delta from the oldest to the newest.
+            static std::vector<const PostingDelta*> Chunks(const PostingDelta* p_delta)
+            {
+                std::vector<const PostingDelta*> chunks;
+                for (; p_delta != nullptr; p_delta = p_delta->m_previous.get()) chunks.push_back(p_delta);
+                std::reverse(chunks.begin(), chunks.end());
+                return chunks;
+            }
+
+            inline ListInfo* GetListInfo(SizeType p_postingID)
+            {
+                if (m_indexContexts.size() == 1) return &(m_indexContexts[0].m_listInfos[p_postingID]);
+                return &(m_indexContexts[p_postingID / m_listPerFile].m_listInfos[p_postingID % m_listPerFile]);
+            }
+
         private:
+            bool OpenPostingFiles()
+            {
+                std::string curFile = m_extraFullGraphFile;
+                do {
+                    auto curIndexFile = f_createAsyncIO();
+                    if (curIndexFile == nullptr || !curIndexFile->Initialize(curFile.c_str(), std::ios::binary | std::ios::in, (1 << 20), 2, 2, m_ioThreads)) {
+                        LOG(Helper::LogLevel::LL_Error, "Cannot open file:%s!\n", curFile.c_str());
+                        return false;
+                    }
+
+                    m_indexContexts.emplace_back(curIndexFile);
+                    m_totalListCount += LoadingHeadInfo(curFile, m_searchPostingPageLimit, m_indexContexts.back());
+
+                    curFile = m_extraFullGraphFile + "_" + std::to_string(m_indexContexts.size());
+                } while (fileexists(curFile.c_str()));
+                m_listPerFile = static_cast<int>((m_totalListCount + m_indexContexts.size() - 1) / m_indexContexts.size());
+                return true;
+            }
+
+            // Disk records of a posting followed by the delta chunks, deleted and duplicated vectors removed.
+            // Callers hold m_postingDeltaLock.
+            bool MergePosting(SizeType p_postingID, const PostingDelta* p_delta, std::string& p_posting)
+            {
+                p_posting.clear();
+                std::string records;
+                if ((p_delta == nullptr || !p_delta->m_override) && p_postingID < m_totalListCount) {
+                    IndexContext* indexContext = (m_indexContexts.size() == 1) ? &(m_indexContexts[0]) : &(m_indexContexts[p_postingID / m_listPerFile]);
+                    ListInfo* listInfo = GetListInfo(p_postingID);
+                    if (listInfo->listEleCount > 0) {
+                        size_t totalBytes = (static_cast<size_t>(listInfo->listPageCount) << PageSizeEx);
+                        PageBuffer<std::uint8_t> buffer;
+                        buffer.ReservePageBuffer(totalBytes);
+                        if (indexContext->m_indexFile->ReadBinary(totalBytes, (char*)buffer.GetBuffer(), listInfo->listOffset) != totalBytes) {
+                            LOG(Helper::LogLevel::LL_Error, "File %s read bytes failed at offset %llu.\n", m_extraFullGraphFile.c_str(), listInfo->listOffset);
+                            return false;
+                        }
+                        records.assign((char*)buffer.GetBuffer() + listInfo->pageOffset, static_cast<size_t>(listInfo->listEleCount) * m_vectorInfoSize);
+                    }
+                }
+                if (p_delta != nullptr) {
+                    records.reserve(records.size() + p_delta->m_totalSize);
+                    for (const PostingDelta* chunk : Chunks(p_delta)) records += chunk->m_records;
+                }
+
+                std::unordered_set<int> visited;
+                size_t recordCount = records.size() / m_vectorInfoSize;
+                p_posting.reserve(records.size());
+                for (size_t i = 0; i < recordCount; i++) {
+                    const char* vectorInfo = records.data() + i * m_vectorInfoSize;
+                    int vectorID = *(reinterpret_cast<const int*>(vectorInfo));
+                    if (m_deletedID != nullptr && m_deletedID->Contains(vectorID)) continue;
+                    if (!visited.insert(vectorID).second) continue;
+                    p_posting.append(vectorInfo, m_vectorInfoSize);
+                }
+                return true;
+            }
+
             int LoadingHeadInfo(const std::string& p_file, int p_postingPageLimit, IndexContext& p_indexContext)
             {
                 auto ptr = SPTAG::f_createIO();
@@ -593,6 +962,8 @@ namespace SPTAG
                     }
                 }
 
+                m_documentCount = m_totalDocumentCount;
+
                 LOG(Helper::LogLevel::LL_Info,
                     "Finish reading header info, list count %d, total doc count %d, dimension %d, list page offset %d.\n",
                     m_listCount,
@@ -703,15 +1074,16 @@ namespace SPTAG
             }
 
 
+            // Writes a posting file; p_writePosting writes the records of one posting at the current position.
             void OutputSSDIndexFile(const std::string& p_outputFile,
                 size_t p_spacePerVector,
                 const std::vector<int>& p_postingListSizes,
-                Selection& p_postingSelections,
                 const std::unique_ptr<int[]>& p_postPageNum,
                 const std::unique_ptr<std::uint16_t[]>& p_postPageOffset,
                 const std::vector<int>& p_postingOrderInIndex,
-                std::shared_ptr<VectorSet> p_fullVectors,
-                size_t p_postingListOffset)
+                SizeType p_documentCount,
+                DimensionType p_dimension,
+                std::function<void(int, Helper::DiskPriorityIO*)> p_writePosting)
             {
                 LOG(Helper::LogLevel::LL_Info, "Start output...\n");
 
@@ -754,14 +1126,14 @@ namespace SPTAG
                 }
 
                 // Number of all documents.
-                i32Val = static_cast<int>(p_fullVectors->Count());
+                i32Val = static_cast<int>(p_documentCount);
                 if (ptr->WriteBinary(sizeof(i32Val), reinterpret_cast<char*>(&i32Val)) != sizeof(i32Val)) {
                     LOG(Helper::LogLevel::LL_Error, "Failed to write SSDIndex File!");
                     exit(1);
                 }
 
                 // Bytes of each vector.
-                i32Val = static_cast<int>(p_fullVectors->Dimension());
+                i32Val = static_cast<int>(p_dimension);
                 if (ptr->WriteBinary(sizeof(i32Val), reinterpret_cast<char*>(&i32Val)) != sizeof(i32Val)) {
                     LOG(Helper::LogLevel::LL_Error, "Failed to write SSDIndex File!");
                     exit(1);
@@ -856,26 +1228,8 @@ namespace SPTAG
                         listOffset = targetOffset;
                     }
 
-                    std::size_t selectIdx = p_postingSelections.lower_bound(id + (int)p_postingListOffset);
-                    for (int j = 0; j < p_postingListSizes[id]; ++j)
-                    {
-                        if (p_postingSelections[selectIdx].node != id + (int)p_postingListOffset)
-                        {
-                            LOG(Helper::LogLevel::LL_Error, "Selection ID NOT MATCH! node:%d offset:%zu\n", id + (int)p_postingListOffset, selectIdx);
-                            exit(1);
-                        }
-
-                        i32Val = p_postingSelections[selectIdx++].tonode;
-                        if (ptr->WriteBinary(sizeof(i32Val), reinterpret_cast<char*>(&i32Val)) != sizeof(i32Val)) {
-                            LOG(Helper::LogLevel::LL_Error, "Failed to write SSDIndex File!");
-                            exit(1);
-                        }
-                        if (ptr->WriteBinary(p_fullVectors->PerVectorDataSize(), reinterpret_cast<char*>(p_fullVectors->GetVector(i32Val))) != p_fullVectors->PerVectorDataSize()) {
-                            LOG(Helper::LogLevel::LL_Error, "Failed to write SSDIndex File!");
-                            exit(1);
-                        }
-                        listOffset += p_spacePerVector;
-                    }
+                    p_writePosting(id, ptr.get());
+                    listOffset += p_spacePerVector * p_postingListSizes[id];
                 }
 
                 paddingSize = PageSize - (listOffset % PageSize);
@@ -915,6 +1269,16 @@ namespace SPTAG
             int m_totalListCount = 0;
 
             int m_listPerFile = 0;
+
+            int m_searchPostingPageLimit = 0;
+
+            int m_ioThreads = 1;
+
+            SizeType m_documentCount = 0;
+
+            std::shared_timed_mutex m_postingDeltaLock;
+
+            std::vector<std::shared_ptr<const PostingDelta>> m_postingDeltas;
         };
     } // namespace SPANN
 } // namespace SPTAG
@@ -8,6 +8,7 @@
 
 #include "inc/Core/VectorIndex.h"
 #include "inc/Core/Common/WorkSpace.h"
+#include "inc/Core/Common/Labelset.h"
 #include "inc/Helper/AsyncFileReader.h"
 
 #if defined(_MSC_VER) || defined(__INTEL_COMPILER)
@@ -125,14 +126,7 @@ namespace SPTAG {
                     m_pageBuffers[pi].ReservePageBuffer(p_maxPages);
                 }
                 m_diskRequests.resize(p_internalResultNum);
-            }
-
-            void Initialize(va_list& arg) {
-                int maxCheck = va_arg(arg, int);
-                int hashExp = va_arg(arg, int);
-                int internalResultNum = va_arg(arg, int);
-                int maxPages = va_arg(arg, int);
-                Initialize(maxCheck, hashExp, internalResultNum, maxPages);
+                m_batchRequests.reserve(p_internalResultNum);
             }
 
             std::vector<int> m_postingIDs;
@@ -144,6 +138,20 @@ namespace SPTAG {
             std::vector<PageBuffer<std::uint8_t>> m_pageBuffers;
 
             std::vector<Helper::DiskListRequest> m_diskRequests;
+
+            std::vector<Helper::AsyncReadRequest*> m_batchRequests;
+
+            // Full precision vectors read back for reranking, grown on first use.
+            PageBuffer<std::uint8_t> m_rerankBuffer;
+
+            std::vector<Helper::AsyncReadRequest> m_rerankRequests;
+
+            std::vector<Helper::AsyncReadRequest*> m_rerankBatch;
+
+            // Quantized query table and transposed block of 32 codes for the 4-bit fast scan of the postings.
+            std::vector<std::uint8_t> m_fastScanTable;
+
+            std::vector<std::uint8_t> m_fastScanBlock;
         };
 
         class IExtraSearcher
@@ -168,6 +176,35 @@ namespace SPTAG {
             virtual bool BuildIndex(std::shared_ptr<Helper::VectorSetReader>& p_reader, 
                 std::shared_ptr<VectorIndex> p_index, 
                 Options& p_opt) = 0;
+
+            // Updates are kept in memory on top of the read-only posting file.
+            // A posting is a packed array of (int vectorID, vector) records.
+            virtual SizeType GetDocumentCount() const = 0;
+
+            virtual void ExtendPostings(SizeType p_postingCount) = 0;
+
+            virtual int GetPostingSize(SizeType p_postingID) = 0;
+
+            virtual bool ReadPosting(SizeType p_postingID, std::string& p_posting) = 0;
+
+            virtual bool AppendPosting(SizeType p_postingID, const std::string& p_appendPosting) = 0;
+
+            virtual bool OverridePosting(SizeType p_postingID, const std::string& p_posting) = 0;
+
+            virtual std::uint64_t PostingDeltaBufferSize() = 0;
+
+            virtual ErrorCode SavePostingDelta(std::shared_ptr<Helper::DiskPriorityIO> p_output) = 0;
+
+            virtual ErrorCode LoadPostingDelta(std::shared_ptr<Helper::DiskPriorityIO> p_input) = 0;
+
+            // Merges the in-memory updates back into the posting file and drops them.
+            virtual ErrorCode CompactPostings() = 0;
+
+            // Vectors marked in p_deletedID are skipped when scanning postings.
+            void SetDeletedID(const COMMON::Labelset* p_deletedID) { m_deletedID = p_deletedID; }
+
+        protected:
+            const COMMON::Labelset* m_deletedID = nullptr;
         };
     } // SPANN
 } // SPTAG
@@ -14,6 +14,7 @@
 #include "../Common/WorkSpacePool.h"
 
 #include "../Common/Labelset.h"
+#include "../Common/FineGrainedLock.h"
 #include "inc/Helper/SimpleIniReader.h"
 #include "inc/Helper/StringConvert.h"
 #include "inc/Helper/ThreadPool.h"
@@ -25,6 +26,7 @@
 
 #include <functional>
 #include <shared_mutex>
+#include <unordered_set>
 
 namespace SPTAG
 {
@@ -39,24 +41,50 @@ namespace SPTAG
         template<typename T>
         class Index : public VectorIndex
         {
+            class SplitJob : public Helper::ThreadPool::Job
+            {
+            public:
+                SplitJob(Index<T>* p_index, SizeType p_headID) : m_index(p_index), m_headID(p_headID) {}
+                void exec(IAbortOperation* p_abort) {
+                    m_index->Split(m_headID);
+                }
+            private:
+                Index<T>* m_index;
+                SizeType m_headID;
+            };
+
         private:
             std::shared_ptr<VectorIndex> m_index;
             std::shared_ptr<std::uint64_t> m_vectorTranslateMap;
             std::unordered_map<std::string, std::string> m_headParameters;
 
             std::shared_ptr<IExtraSearcher> m_extraSearcher;
+            std::shared_ptr<Helper::DiskPriorityIO> m_fullVectors; // page aligned full precision vectors for rerank
+            VectorValueType m_fullVectorType;
+            DimensionType m_fullVectorDim;
+            std::uint64_t m_fullVectorBytes = 0;
             std::unique_ptr<COMMON::WorkSpacePool<ExtraWorkSpace>> m_workSpacePool;
 
             Options m_options;
 
-            float(*m_fComputeDistance)(const T* pX, const T* pY, DimensionType length);
+            COMMON::DistanceCalcFunc<T> m_fComputeDistance;
             int m_iBaseSquare;
 
+            COMMON::Labelset m_deletedID;
+            std::mutex m_dataAddLock; // protect vector id assignment
+            mutable std::shared_timed_mutex m_headLock; // protect head growth and the translate map
+            COMMON::FineGrainedLock m_postingLocks;
+            SizeType m_translateMapCapacity;
+            int m_postingSizeLimit;
+
+            std::mutex m_splitLock;
+            std::unordered_set<SizeType> m_splitList;
+            Helper::ThreadPool m_splitThreadPool;
+
         public:
-            Index()
+            Index() : m_fullVectorType(VectorValueType::Undefined), m_fullVectorDim(0), m_translateMapCapacity(0), m_postingSizeLimit(0)
             {
-                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_options.m_distCalcMethod);
-                m_iBaseSquare = (m_options.m_distCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+                BindDistanceFunction();
             }
 
             ~Index() {}
@@ -73,6 +101,14 @@ namespace SPTAG
             inline DistCalcMethod GetDistCalcMethod() const { return m_options.m_distCalcMethod; }
             inline IndexAlgoType GetIndexAlgoType() const { return IndexAlgoType::SPANN; }
             inline VectorValueType GetVectorValueType() const { return GetEnumValueType<T>(); }
+
+            // Postings and head vectors are codes of the same quantizer, so the head index shares it.
+            inline void SetQuantizer(std::shared_ptr<COMMON::IQuantizer> p_quantizer)
+            {
+                m_pQuantizer = p_quantizer;
+                BindDistanceFunction();
+                if (m_index != nullptr) m_index->SetQuantizer(p_quantizer);
+            }
             
             inline float AccurateDistance(const void* pX, const void* pY) const { 
                 if (m_options.m_distCalcMethod == DistCalcMethod::L2) return m_fComputeDistance((const T*)pX, (const T*)pY, m_options.m_dim);
@@ -83,7 +119,7 @@ namespace SPTAG
                 return 1.0f - xy / (sqrt(xx) * sqrt(yy));
             }
             inline float ComputeDistance(const void* pX, const void* pY) const { return m_fComputeDistance((const T*)pX, (const T*)pY, m_options.m_dim); }
-            inline bool ContainSample(const SizeType idx) const { return idx < m_options.m_vectorSize; }
+            inline bool ContainSample(const SizeType idx) const { return idx < m_options.m_vectorSize && !m_deletedID.Contains(idx); }
 
             std::shared_ptr<std::vector<std::uint64_t>> BufferSize() const
             {
@@ -91,6 +127,9 @@ namespace SPTAG
                 auto headIndexBufferSize = m_index->BufferSize();
                 buffersize->insert(buffersize->end(), headIndexBufferSize->begin(), headIndexBufferSize->end());
                 buffersize->push_back(sizeof(long long) * m_index->GetNumSamples());
+                buffersize->push_back(m_deletedID.BufferSize());
+                buffersize->push_back((m_extraSearcher != nullptr) ? m_extraSearcher->PostingDeltaBufferSize() : 0);
+                if (HasFullVectors()) buffersize->push_back(m_fullVectorBytes);
                 return std::move(buffersize);
             }
 
@@ -102,6 +141,9 @@ namespace SPTAG
                     files->push_back(m_options.m_headIndexFolder + FolderSep + file);
                 }
                 files->push_back(m_options.m_headIDFile);
+                files->push_back(m_options.m_deleteIDFile);
+                files->push_back(m_options.m_postingDeltaFile);
+                if (HasFullVectors()) files->push_back(m_options.m_fullVectorFile);
                 return std::move(files);
             }
 
@@ -123,17 +165,43 @@ namespace SPTAG
             std::string GetParameter(const char* p_param, const char* p_section = nullptr) const;
 
             inline const void* GetSample(const SizeType idx) const { return nullptr; }
-            inline SizeType GetNumDeleted() const { return 0; }
+            inline SizeType GetNumDeleted() const { return (SizeType)m_deletedID.Count(); }
             inline bool NeedRefine() const { return false; }
 
             ErrorCode RefineSearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const { return ErrorCode::Undefined; }
             ErrorCode SearchTree(QueryResult& p_query) const { return ErrorCode::Undefined; }
-            ErrorCode AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex = false, bool p_normalized = false) { return ErrorCode::Undefined; }
-            ErrorCode DeleteIndex(const void* p_vectors, SizeType p_vectorNum) { return ErrorCode::Undefined; }
-            ErrorCode DeleteIndex(const SizeType& p_id) { return ErrorCode::Undefined; }
-            ErrorCode RefineIndex(const std::vector<std::shared_ptr<Helper::DiskPriorityIO>>& p_indexStreams, IAbortOperation* p_abort) { return ErrorCode::Undefined; }
+            ErrorCode AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex = false, bool p_normalized = false);
+            ErrorCode DeleteIndex(const void* p_vectors, SizeType p_vectorNum);
+            ErrorCode DeleteIndex(const SizeType& p_id);
+            ErrorCode RefineIndex(const std::vector<std::shared_ptr<Helper::DiskPriorityIO>>& p_indexStreams, IAbortOperation* p_abort);
             ErrorCode RefineIndex(std::shared_ptr<VectorIndex>& p_newIndex) { return ErrorCode::Undefined; }
         private:
+            // Like the head index, rebound only at build or load time, never while searches run.
+            inline void BindDistanceFunction()
+            {
+                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_options.m_distCalcMethod, m_pQuantizer);
+                int base = m_pQuantizer ? m_pQuantizer->GetBase() : COMMON::Utils::GetBase<T>();
+                m_iBaseSquare = (m_options.m_distCalcMethod == DistCalcMethod::Cosine) ? base * base : 1;
+            }
+
+            inline std::string FullVectorFilePath() const { return m_options.m_indexDirectory + FolderSep + m_options.m_fullVectorFile; }
+
+            // Whether the index folder holds full precision vectors for rerank, loaded or not yet.
+            inline bool HasFullVectors() const { return m_fullVectors != nullptr || fileexists(FullVectorFilePath().c_str()); }
+
+            ErrorCode BuildFullVectors();
+            ErrorCode SaveFullVectors(std::shared_ptr<Helper::DiskPriorityIO> p_output) const;
+            ErrorCode LoadFullVectors();
+            void RerankResults(COMMON::QueryResultSet<T>& p_results, int p_resultNum, ExtraWorkSpace* p_exWorkSpace) const;
+
+            void InitUpdate();
+            void SelectReplicas(const T* p_vector, std::vector<SizeType>& p_heads) const;
+            SizeType SearchNearestHead(const T* p_vector, float& p_dist) const;
+            ErrorCode Append(SizeType p_headID, const std::string& p_records);
+            ErrorCode Split(SizeType p_headID);
+            ErrorCode Merge(SizeType p_headID);
+            void QueueSplit(SizeType p_headID);
+
             bool CheckHeadIndexType();
             void SelectHeadAdjustOptions(int p_vectorCount);
             int SelectHeadDynamicallyInternal(const std::shared_ptr<COMMON::BKTree> p_tree, int p_nodeID, const Options& p_opts, std::vector<int>& p_selected);
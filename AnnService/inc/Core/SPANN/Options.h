@@ -20,6 +20,7 @@ namespace SPTAG {
             IndexAlgoType m_indexAlgoType;
             DimensionType m_dim;
             std::string m_vectorPath;
+            std::string m_fullVectorPath; //Optional, full precision source of the rerank file
             VectorFileType m_vectorType;
             SizeType m_vectorSize; //Optional on condition
             std::string m_vectorDelimiter; //Optional on condition
@@ -39,7 +40,9 @@ namespace SPTAG {
             std::string m_headVectorFile;
             std::string m_headIndexFolder;
             std::string m_deleteIDFile;
+            std::string m_postingDeltaFile;
             std::string m_ssdIndex;
+            std::string m_fullVectorFile;
             bool m_deleteHeadVectors;
             int m_ssdIndexFileNum;
             std::string m_quantizerFilePath;
@@ -113,6 +116,10 @@ namespace SPTAG {
             int m_debugBuildInternalResultNum;
             bool m_enableADC;
 
+            // Updating
+            int m_mergeThreshold;
+            int m_updateThreadNum;
+
             Options() {
 #define DefineBasicParameter(VarName, VarType, DefaultValue, RepresentStr) \
                 VarName = DefaultValue; \
@@ -9,6 +9,7 @@ DefineBasicParameter(m_distCalcMethod, SPTAG::DistCalcMethod, SPTAG::DistCalcMet
 DefineBasicParameter(m_indexAlgoType, SPTAG::IndexAlgoType, SPTAG::IndexAlgoType::BKT, "IndexAlgoType")
 DefineBasicParameter(m_dim, SPTAG::DimensionType, -1, "Dim")
 DefineBasicParameter(m_vectorPath, std::string, std::string(""), "VectorPath")
+DefineBasicParameter(m_fullVectorPath, std::string, std::string(""), "FullVectorPath")
 DefineBasicParameter(m_vectorType, SPTAG::VectorFileType, SPTAG::VectorFileType::DEFAULT, "VectorType")
 DefineBasicParameter(m_vectorSize, SPTAG::SizeType, -1, "VectorSize")
 DefineBasicParameter(m_vectorDelimiter, std::string, std::string("|"), "VectorDelimiter")
@@ -26,9 +27,11 @@ DefineBasicParameter(m_generateTruth, bool, false, "GenerateTruth")
 DefineBasicParameter(m_indexDirectory, std::string, std::string("SPANN"), "IndexDirectory")
 DefineBasicParameter(m_headIDFile, std::string, std::string("SPTAGHeadVectorIDs.bin"), "HeadVectorIDs")
 DefineBasicParameter(m_deleteIDFile, std::string, std::string("DeletedIDs.bin"), "DeletedIDs")
+DefineBasicParameter(m_postingDeltaFile, std::string, std::string("SPTAGPostingDelta.bin"), "PostingDelta")
 DefineBasicParameter(m_headVectorFile, std::string, std::string("SPTAGHeadVectors.bin"), "HeadVectors")
 DefineBasicParameter(m_headIndexFolder, std::string, std::string("HeadIndex"), "HeadIndexFolder")
 DefineBasicParameter(m_ssdIndex, std::string, std::string("SPTAGFullList.bin"), "SSDIndex")
+DefineBasicParameter(m_fullVectorFile, std::string, std::string("SPTAGFullVectors.bin"), "FullVectors")
 DefineBasicParameter(m_deleteHeadVectors, bool, false, "DeleteHeadVectors")
 DefineBasicParameter(m_ssdIndexFileNum, int, 1, "SSDIndexFileNum")
 DefineBasicParameter(m_quantizerFilePath, std::string, std::string(), "QuantizerFilePath")
@@ -111,4 +114,8 @@ DefineSSDParameter(m_enableADC, bool, false, "EnableADC")
 DefineSSDParameter(m_recall_analysis, bool, false, "RecallAnalysis")
 DefineSSDParameter(m_debugBuildInternalResultNum, int, 64, "DebugBuildInternalResultNum")
 
+// Updating
+DefineSSDParameter(m_mergeThreshold, int, 10, "MergeThreshold")
+DefineSSDParameter(m_updateThreadNum, int, 1, "UpdateThreadNum")
+
 #endif
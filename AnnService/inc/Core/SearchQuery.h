@@ -10,6 +10,10 @@
 
 namespace SPTAG
 {
+namespace COMMON
+{
+class IQuantizer;
+}
 
 // Space to save temporary answer, similar with TopKCache
 class QueryResult
@@ -22,12 +26,13 @@ public:
         : m_target(nullptr),
           m_resultNum(0),
           m_withMeta(false),
-          m_quantizedTarget(nullptr)
+          m_quantizedTarget(nullptr),
+          m_quantizer(nullptr)
     {
     }
 
 
-    QueryResult(const void* p_target, int p_resultNum, bool p_withMeta) : m_quantizedTarget(nullptr)
+    QueryResult(const void* p_target, int p_resultNum, bool p_withMeta) : m_quantizedTarget(nullptr), m_quantizer(nullptr)
     {
         Init(p_target, p_resultNum, p_withMeta);
     }
@@ -37,7 +42,8 @@ public:
         : m_target(p_target),
           m_resultNum(p_resultNum),
           m_withMeta(p_withMeta),
-          m_quantizedTarget(nullptr)
+          m_quantizedTarget(nullptr),
+          m_quantizer(nullptr)
     {
         m_results.Set(p_results, p_resultNum, false);
     }
@@ -46,6 +52,7 @@ public:
     QueryResult(const QueryResult& p_other)
     {
         Init(p_other.m_target, p_other.m_resultNum, p_other.m_withMeta);
+        m_quantizer = p_other.m_quantizer;
         if (m_resultNum > 0)
         {
             std::copy(p_other.m_results.Data(), p_other.m_results.Data() + m_resultNum, m_results.Data());
@@ -56,6 +63,7 @@ public:
     QueryResult& operator=(const QueryResult& p_other)
     {
         Init(p_other.m_target, p_other.m_resultNum, p_other.m_withMeta);
+        m_quantizer = p_other.m_quantizer;
         if (m_resultNum > 0)
         {
             std::copy(p_other.m_results.Data(), p_other.m_results.Data() + m_resultNum, m_results.Data());
@@ -80,6 +88,7 @@ public:
         m_resultNum = p_resultNum;
         m_withMeta = p_withMeta;
         m_quantizedTarget = nullptr;
+        m_quantizer = nullptr;
 
         m_results = Array<BasicResult>::Alloc(p_resultNum);
     }
@@ -108,6 +117,27 @@ public:
     }
 
 
+    // Set by the index before it searches, so that the target is quantized with the codebook of the
+    // index that is searched. Switching to another quantizer drops the cached quantized target.
+    inline void SetQuantizer(COMMON::IQuantizer* p_quantizer)
+    {
+        if (m_quantizer == p_quantizer) return;
+
+        m_quantizer = p_quantizer;
+        if (m_quantizedTarget)
+        {
+            _mm_free(m_quantizedTarget);
+        }
+        m_quantizedTarget = nullptr;
+    }
+
+
+    inline COMMON::IQuantizer* GetQuantizer() const
+    {
+        return m_quantizer;
+    }
+
+
     inline BasicResult* GetResult(int i) const
     {
         return i < m_resultNum ? m_results.Data() + i : nullptr;
@@ -196,6 +226,8 @@ protected:
 
     void* m_quantizedTarget;
 
+    COMMON::IQuantizer* m_quantizer;
+
     int m_resultNum;
 
     bool m_withMeta;
@@ -10,6 +10,7 @@
 #include "MetadataSet.h"
 #include "inc/Helper/SimpleIniReader.h"
 #include <unordered_set>
+#include <functional>
 
 namespace SPTAG
 {
@@ -33,7 +34,19 @@ public:
 
     virtual ErrorCode DeleteIndex(const void* p_vectors, SizeType p_vectorNum) = 0;
 
+    // Removes every link to a deleted vector from the graph, so that their ids can be reused by
+    // AddIndexRecycled, without the full copy RefineIndex makes.
+    virtual ErrorCode ConsolidateDeletes(IAbortOperation* p_abort = nullptr) { return ErrorCode::Undefined; }
+
+    // AddIndex that puts the vectors into the slots of consolidated deletes first and only appends the rest.
+    // p_ids receives the id of every added vector. Indexes with metadata cannot reuse ids.
+    virtual ErrorCode AddIndexRecycled(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::vector<SizeType>& p_ids, bool p_normalized = false) { return ErrorCode::Undefined; }
+
     virtual ErrorCode SearchIndex(QueryResult& p_results, bool p_searchDeleted = false) const = 0;
+
+    // Only vectors accepted by p_filter are returned. Rejected vectors are still traversed, so the filter
+    // is applied during the search instead of on an oversized result list afterwards.
+    virtual ErrorCode SearchIndexWithFilter(QueryResult& p_results, const std::function<bool(SizeType)>& p_filter, bool p_searchDeleted = false) const { return ErrorCode::Undefined; }
     
     virtual ErrorCode RefineSearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const = 0;
 
@@ -45,6 +58,9 @@ public:
     virtual float ComputeDistance(const void* pX, const void* pY) const = 0;
     virtual const void* GetSample(const SizeType idx) const = 0;
     virtual bool ContainSample(const SizeType idx) const = 0;
+    // Sample by the id the graph and RefineSearchIndex work with. It only differs from GetSample when the
+    // index renumbered its vectors at build time (BKT ReorderIDs).
+    virtual const void* GetInternalSample(const SizeType idx) const { return GetSample(idx); }
     virtual bool NeedRefine() const = 0;
    
     virtual DimensionType GetFeatureDim() const = 0;
@@ -84,6 +100,10 @@ public:
 
     virtual ErrorCode SearchIndex(const void* p_vector, int p_vectorCount, int p_neighborCount, bool p_withMeta, BasicResult* p_results) const;
 
+    // Searches the queries in parallel. A positive p_threadNum caps the threads, for callers that already run
+    // on one of many worker threads; 0 uses the OpenMP default. Returns the first error any query hit.
+    virtual ErrorCode SearchIndex(QueryResult* p_queries, int p_queryCount, bool p_searchDeleted = false, int p_threadNum = 0) const;
+
     virtual void ApproximateRNG(std::shared_ptr<VectorSet>& fullVectors, std::unordered_set<SizeType>& exceptIDS, int candidateNum, Edge* selections, int replicaCount, int numThreads, int numTrees, int leafSize, float RNGFactor, int numGPUs);
 
     static void SortSelections(std::vector<Edge>* selections);
@@ -102,11 +122,22 @@ public:
     }
     virtual void SetIndexName(std::string p_name) { m_sIndexName = p_name; }
 
-    static ErrorCode LoadQuantizer(std::string p_quantizerFile);
+    // The samples of a quantized index are codes of its own quantizer, which the distance function of
+    // the index and the queries it searches use. Indexes with different codebooks can share a process.
+    // Set it while building or loading the index only: the distance function is rebound without a lock, so
+    // it must not race with searches, adds or refines of the same index.
+    virtual void SetQuantizer(std::shared_ptr<COMMON::IQuantizer> p_quantizer) { m_pQuantizer = p_quantizer; }
+
+    inline const std::shared_ptr<COMMON::IQuantizer>& GetQuantizer() const { return m_pQuantizer; }
+
+    ErrorCode LoadQuantizer(const std::string& p_quantizerFile);
 
     static std::shared_ptr<VectorIndex> CreateInstance(IndexAlgoType p_algo, VectorValueType p_valuetype);
 
-    static ErrorCode LoadIndex(const std::string& p_loaderFilePath, std::shared_ptr<VectorIndex>& p_vectorIndex);
+    // With p_memoryMap, BKT and KDT indexes search straight from a copy-on-write mapping of the index
+    // files instead of reading them into memory. Pages are only copied when AddIndex, DeleteIndex or
+    // refine writes to them.
+    static ErrorCode LoadIndex(const std::string& p_loaderFilePath, std::shared_ptr<VectorIndex>& p_vectorIndex, bool p_memoryMap = false);
 
     static ErrorCode LoadIndexFromFile(const std::string& p_file, std::shared_ptr<VectorIndex>& p_vectorIndex);
 
@@ -147,6 +178,8 @@ private:
 
     ErrorCode SaveIndexConfig(std::shared_ptr<Helper::DiskPriorityIO> p_configOut);
 
+    ErrorCode LoadIndexFromMemory(Helper::IniReader& p_reader, const std::vector<ByteArray>& p_indexBlobs);
+
 protected:
     bool m_bReady = false;
     std::string m_sIndexName = "";
@@ -154,7 +187,9 @@ protected:
     std::string m_sMetadataIndexFile = "metadataIndex.bin";
     std::string m_sQuantizerFile = "quantizer.bin";
     std::shared_ptr<MetadataSet> m_pMetadata;
+    std::shared_ptr<COMMON::IQuantizer> m_pQuantizer;
     std::shared_ptr<void> m_pMetaToVec;
+    std::vector<ByteArray> m_mappedFiles;
 
 public:
     int m_iDataBlockSize;
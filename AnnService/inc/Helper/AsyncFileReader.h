@@ -15,6 +15,7 @@
 #include <vector>
 #include <thread>
 #include <stdint.h>
+#include <atomic>
 
 #ifdef _MSC_VER
 #include <tchar.h>
@@ -27,6 +28,15 @@
 #include <sys/syscall.h>
 #include <linux/aio_abi.h>
 
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#define IO_URING_READ 1
+#endif
+#endif
+
 #include "ConcurrentSet.h"
 #endif
 
@@ -583,6 +593,313 @@ namespace SPTAG
 
             std::vector<std::thread> m_fileIocpThreads;
         };
+#ifdef IO_URING_READ
+        namespace DiskUtils
+        {
+            // A single submission/completion ring. Only one thread may use a ring at a time.
+            class IOUring
+            {
+            public:
+                IOUring() {}
+
+                ~IOUring() { Destroy(); }
+
+                bool Setup(unsigned p_entries)
+                {
+                    struct io_uring_params params;
+                    memset(&params, 0, sizeof(params));
+                    m_ringHandle = static_cast<int>(syscall(__NR_io_uring_setup, p_entries, &params));
+                    if (m_ringHandle < 0) return false;
+
+                    m_entries = params.sq_entries;
+                    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+                    m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+                    m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringHandle, IORING_OFF_SQ_RING);
+                    m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringHandle, IORING_OFF_CQ_RING);
+                    void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringHandle, IORING_OFF_SQES);
+                    if (m_sqRing == MAP_FAILED || m_cqRing == MAP_FAILED || sqes == MAP_FAILED)
+                    {
+                        if (sqes != MAP_FAILED) munmap(sqes, m_sqesSize);
+                        Destroy();
+                        return false;
+                    }
+                    m_sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+                    char* sq = static_cast<char*>(m_sqRing);
+                    m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+                    m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                    m_sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                    m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+                    char* cq = static_cast<char*>(m_cqRing);
+                    m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                    m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                    m_cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                    m_cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+                    m_iovecs.resize(m_entries);
+                    return true;
+                }
+
+                void Destroy()
+                {
+                    if (m_sqes != nullptr) munmap(m_sqes, m_sqesSize);
+                    if (m_cqRing != MAP_FAILED) munmap(m_cqRing, m_cqRingSize);
+                    if (m_sqRing != MAP_FAILED) munmap(m_sqRing, m_sqRingSize);
+                    if (m_ringHandle >= 0) close(m_ringHandle);
+
+                    m_sqes = nullptr;
+                    m_cqRing = m_sqRing = MAP_FAILED;
+                    m_ringHandle = -1;
+                }
+
+                unsigned Entries() const { return m_entries; }
+
+                // Submit up to Entries() reads and wait for all of them. Returns the number of requests handed to
+                // the kernel, always the first ones; the caller must complete the rest.
+                std::uint32_t Read(int p_fileHandle, AsyncReadRequest** p_requests, std::uint32_t p_count)
+                {
+                    unsigned tail = *m_sqTail;
+                    for (std::uint32_t i = 0; i < p_count; i++)
+                    {
+                        unsigned index = tail & *m_sqMask;
+                        AsyncReadRequest* request = p_requests[i];
+                        m_iovecs[index].iov_base = request->m_buffer;
+                        m_iovecs[index].iov_len = request->m_readSize;
+
+                        struct io_uring_sqe* sqe = m_sqes + index;
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READV;
+                        sqe->fd = p_fileHandle;
+                        sqe->addr = reinterpret_cast<std::uint64_t>(&(m_iovecs[index]));
+                        sqe->len = 1;
+                        sqe->off = request->m_offset;
+                        sqe->user_data = reinterpret_cast<std::uint64_t>(request);
+
+                        m_sqArray[index] = index;
+                        tail++;
+                    }
+                    __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+
+                    // The kernel may consume fewer entries than asked for, so keep submitting the rest.
+                    std::uint32_t submitted = 0;
+                    while (submitted < p_count)
+                    {
+                        int ret = static_cast<int>(syscall(__NR_io_uring_enter, m_ringHandle, p_count - submitted, 0, 0, nullptr, 0));
+                        if (ret < 0 && errno == EINTR) continue;
+                        if (ret <= 0) break;
+                        submitted += static_cast<std::uint32_t>(ret);
+                    }
+                    if (submitted < p_count)
+                    {
+                        // Take back the entries the kernel did not consume, so that they neither keep pointing at
+                        // requests the caller completes on its own nor go out with the next batch.
+                        __atomic_store_n(m_sqTail, __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+                    }
+
+                    std::uint32_t completed = 0;
+                    while (completed < submitted)
+                    {
+                        unsigned head = *m_cqHead;
+                        unsigned cqTail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+                        if (head == cqTail)
+                        {
+                            if (syscall(__NR_io_uring_enter, m_ringHandle, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) break;
+                            continue;
+                        }
+
+                        for (; head != cqTail; head++, completed++)
+                        {
+                            struct io_uring_cqe* cqe = m_cqes + (head & *m_cqMask);
+                            AsyncReadRequest* request = reinterpret_cast<AsyncReadRequest*>(cqe->user_data);
+                            request->m_success = (cqe->res >= 0 && static_cast<std::uint64_t>(cqe->res) == request->m_readSize);
+                        }
+                        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+                    }
+                    return completed;
+                }
+
+            private:
+                int m_ringHandle = -1;
+
+                unsigned m_entries = 0;
+
+                void* m_sqRing = MAP_FAILED;
+                size_t m_sqRingSize = 0;
+                unsigned* m_sqHead = nullptr;
+                unsigned* m_sqTail = nullptr;
+                unsigned* m_sqMask = nullptr;
+                unsigned* m_sqArray = nullptr;
+
+                struct io_uring_sqe* m_sqes = nullptr;
+                size_t m_sqesSize = 0;
+
+                void* m_cqRing = MAP_FAILED;
+                size_t m_cqRingSize = 0;
+                unsigned* m_cqHead = nullptr;
+                unsigned* m_cqTail = nullptr;
+                unsigned* m_cqMask = nullptr;
+                struct io_uring_cqe* m_cqes = nullptr;
+
+                std::vector<struct iovec> m_iovecs;
+            };
+        }
+
+        class IOUringFileIO : public SPTAG::Helper::DiskPriorityIO
+        {
+        public:
+            IOUringFileIO(SPTAG::Helper::DiskIOScenario scenario = SPTAG::Helper::DiskIOScenario::DIS_UserRead) {}
+
+            virtual ~IOUringFileIO() { ShutDown(); }
+
+            virtual bool Initialize(const char* filePath, int openMode,
+                std::uint64_t maxIOSize = (1 << 20),
+                std::uint32_t maxReadRetries = 2,
+                std::uint32_t maxWriteRetries = 2,
+                std::uint16_t threadPoolSize = 4)
+            {
+                m_fileHandle = open(filePath, O_RDONLY | O_NOATIME);
+                if (m_fileHandle == -1) {
+                    LOG(SPTAG::Helper::LogLevel::LL_Error, "Failed to create file handle: %s\n", filePath);
+                    return false;
+                }
+
+                DiskUtils::IOUring* ring = GetRing();
+                if (ring == nullptr) {
+                    LOG(SPTAG::Helper::LogLevel::LL_Warning, "Cannot setup io_uring (%s), fall back to serial reads: %s\n", strerror(errno), filePath);
+                    m_ringAvailable = false;
+                }
+                else {
+                    ReturnRing(ring);
+                }
+                return true;
+            }
+
+            virtual std::uint64_t ReadBinary(std::uint64_t readSize, char* buffer, std::uint64_t offset = UINT64_MAX)
+            {
+                return pread(m_fileHandle, (void*)buffer, readSize, offset);
+            }
+
+            virtual std::uint64_t WriteBinary(std::uint64_t writeSize, const char* buffer, std::uint64_t offset = UINT64_MAX)
+            {
+                return 0;
+            }
+
+            virtual std::uint64_t ReadString(std::uint64_t& readSize, std::unique_ptr<char[]>& buffer, char delim = '\n', std::uint64_t offset = UINT64_MAX)
+            {
+                return 0;
+            }
+
+            virtual std::uint64_t WriteString(const char* buffer, std::uint64_t offset = UINT64_MAX)
+            {
+                return 0;
+            }
+
+            virtual bool ReadFileAsync(SPTAG::Helper::AsyncReadRequest& readRequest)
+            {
+                SPTAG::Helper::AsyncReadRequest* request = &readRequest;
+                BatchReadFile(&request, 1);
+                return true;
+            }
+
+            virtual std::uint32_t BatchReadFile(SPTAG::Helper::AsyncReadRequest** readRequests, std::uint32_t requestCount)
+            {
+                DiskUtils::IOUring* ring = m_ringAvailable ? GetRing() : nullptr;
+                if (ring == nullptr) return DiskPriorityIO::BatchReadFile(readRequests, requestCount);
+
+                std::uint32_t processed = 0;
+                while (processed < requestCount)
+                {
+                    std::uint32_t batch = min(requestCount - processed, static_cast<std::uint32_t>(ring->Entries()));
+                    std::uint32_t done = ring->Read(m_fileHandle, readRequests + processed, batch);
+                    processed += done;
+                    m_ringReads += done;
+                    if (done < batch)
+                    {
+                        LOG(SPTAG::Helper::LogLevel::LL_Error, "io_uring submission failed (%s), fall back to serial reads!\n", strerror(errno));
+                        delete ring;
+                        ring = nullptr;
+                        break;
+                    }
+                }
+                if (ring != nullptr) ReturnRing(ring);
+
+                if (processed < requestCount)
+                {
+                    DiskPriorityIO::BatchReadFile(readRequests + processed, requestCount - processed);
+                }
+
+                std::uint32_t success = 0;
+                for (std::uint32_t i = 0; i < processed; i++)
+                {
+                    SPTAG::Helper::AsyncReadRequest* request = readRequests[i];
+                    if (request->m_success) success++;
+                    if (request->m_callback) request->m_callback(request->m_success);
+                }
+                for (std::uint32_t i = processed; i < requestCount; i++)
+                {
+                    if (readRequests[i]->m_success) success++;
+                }
+                return success;
+            }
+
+            virtual std::uint64_t TellP() { return 0; }
+
+            // Whether batches go through io_uring; false when no ring could be set up.
+            bool RingAvailable() const { return m_ringAvailable; }
+
+            // Requests completed through io_uring rather than the serial fallback.
+            std::uint64_t RingReadCount() const { return m_ringReads; }
+
+            virtual void ShutDown()
+            {
+                DiskUtils::IOUring* ring = nullptr;
+                while (m_rings.try_pop(ring))
+                {
+                    delete ring;
+                }
+
+                if (m_fileHandle != -1)
+                {
+                    close(m_fileHandle);
+                    m_fileHandle = -1;
+                }
+            }
+
+        private:
+            DiskUtils::IOUring* GetRing()
+            {
+                DiskUtils::IOUring* ring = nullptr;
+                if (m_rings.try_pop(ring)) return ring;
+
+                ring = new DiskUtils::IOUring();
+                if (!ring->Setup(c_ringEntries))
+                {
+                    delete ring;
+                    return nullptr;
+                }
+                return ring;
+            }
+
+            void ReturnRing(DiskUtils::IOUring* p_ring)
+            {
+                m_rings.push(p_ring);
+            }
+
+        private:
+            static const unsigned c_ringEntries = 256;
+
+            int m_fileHandle = -1;
+
+            std::atomic<bool> m_ringAvailable{ true };
+
+            std::atomic<std::uint64_t> m_ringReads{ 0 };
+
+            Helper::Concurrent::ConcurrentQueue<DiskUtils::IOUring*> m_rings;
+        };
+#endif
 #endif
     }
 }
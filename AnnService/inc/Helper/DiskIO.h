@@ -58,6 +58,21 @@ namespace SPTAG
 
             virtual bool ReadFileAsync(AsyncReadRequest& readRequest) = 0;
 
+            // Read all requests and return once every one of them has completed.
+            // Backends without native batching fall back to serial ReadBinary.
+            virtual std::uint32_t BatchReadFile(AsyncReadRequest** readRequests, std::uint32_t requestCount)
+            {
+                std::uint32_t success = 0;
+                for (std::uint32_t i = 0; i < requestCount; i++)
+                {
+                    AsyncReadRequest* request = readRequests[i];
+                    request->m_success = (ReadBinary(request->m_readSize, request->m_buffer, request->m_offset) == request->m_readSize);
+                    if (request->m_success) success++;
+                    if (request->m_callback) request->m_callback(request->m_success);
+                }
+                return success;
+            }
+
             virtual std::uint64_t TellP() = 0;
 
             virtual void ShutDown() = 0;
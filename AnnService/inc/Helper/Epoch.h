@@ -0,0 +1,40 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_HELPER_EPOCH_H_
+#define _SPTAG_HELPER_EPOCH_H_
+
+namespace SPTAG
+{
+namespace Helper
+{
+
+struct EpochSlot;
+
+// Epoch based reclamation for read-mostly structures that are swapped as a whole. A reader pins the current
+// epoch with an EpochGuard for as long as it uses a pointer it loaded; a writer publishes the new object,
+// calls WaitForReaders, and may then free the old one. Pinning only writes to a slot owned by the calling
+// thread, so readers never write to memory shared with other cores. Guards nest on one thread.
+class EpochGuard
+{
+public:
+    EpochGuard();
+
+    ~EpochGuard();
+
+    EpochGuard(const EpochGuard&) = delete;
+
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+private:
+    EpochSlot* m_slot;
+};
+
+// Returns once every EpochGuard alive at the time of the call is destroyed. Must not be called while the
+// calling thread holds an EpochGuard.
+void WaitForReaders();
+
+} // namespace Helper
+} // namespace SPTAG
+
+#endif // _SPTAG_HELPER_EPOCH_H_
@@ -0,0 +1,26 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_HELPER_MEMORYMAP_H_
+#define _SPTAG_HELPER_MEMORYMAP_H_
+
+#include "inc/Core/CommonDataStructure.h"
+
+#include <string>
+
+namespace SPTAG
+{
+namespace Helper
+{
+
+// Maps a whole file copy-on-write. The pages are shared with the page cache (and with every other
+// process mapping the same file) until this process writes to them; a write gives the process a
+// private copy of that page only and is never written back to the file.
+// The mapping is released when the last copy of the returned array goes away.
+// Returns an empty array if the file cannot be mapped or is empty.
+ByteArray MapFile(const std::string& p_filePath);
+
+} // namespace Helper
+} // namespace SPTAG
+
+#endif // _SPTAG_HELPER_MEMORYMAP_H_
@@ -0,0 +1,33 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_HELPER_NUMA_H_
+#define _SPTAG_HELPER_NUMA_H_
+
+namespace SPTAG
+{
+namespace Helper
+{
+
+// NUMA placement helpers. On Linux they read the topology from /sys/devices/system/node and call the
+// scheduler and memory policy system calls directly, so libnuma is not needed. Elsewhere, and on hosts
+// without that information, the machine looks like a single node 0.
+
+// Number of NUMA nodes, at least 1. Nodes are numbered 0 to NumaNodeCount() - 1.
+int NumaNodeCount();
+
+// Pins the calling thread to the CPUs of p_node and records the node for CurrentNumaNode. Memory the
+// thread touches first is then placed on that node by the default policy.
+bool BindThreadToNumaNode(int p_node);
+
+// Node the calling thread was bound to with BindThreadToNumaNode, or 0.
+int CurrentNumaNode();
+
+// With p_interleave, pages the calling thread allocates from now on are spread round robin over all nodes;
+// without it, they go back to the node of the thread that first touches them.
+bool SetInterleaveMemory(bool p_interleave);
+
+} // namespace Helper
+} // namespace SPTAG
+
+#endif // _SPTAG_HELPER_NUMA_H_
@@ -0,0 +1,43 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_HELPER_PAGEALLOCATOR_H_
+#define _SPTAG_HELPER_PAGEALLOCATOR_H_
+
+#include <cstddef>
+
+namespace SPTAG
+{
+namespace Helper
+{
+
+// How large buffers such as Dataset rows are backed by memory pages.
+enum class PagePolicy : int
+{
+    // Plain aligned heap memory
+    Default = 0,
+
+    // Anonymous memory hinted with madvise(MADV_HUGEPAGE), so the kernel backs it with transparent hugepages
+    // when it can
+    TransparentHuge = 1,
+
+    // Memory from the explicit hugetlbfs pool (MAP_HUGETLB); falls back to TransparentHuge when the pool
+    // has no free pages
+    ExplicitHuge = 2,
+};
+
+// Allocates p_size bytes, aligned to at least 32 bytes, with pages of p_policy. Platforms without hugepages,
+// and requests smaller than one 2 MB hugepage, use Default. Returns nullptr if the memory cannot be allocated.
+void* AllocatePages(std::size_t p_size, PagePolicy p_policy);
+
+// Frees memory from AllocatePages, whichever backing it got.
+void FreePages(void* p_ptr);
+
+// Hints that an existing range, e.g. a memory mapped index file, should be backed by transparent hugepages.
+// Does nothing where the hint is not supported.
+void AdviseHugePages(void* p_ptr, std::size_t p_size);
+
+} // namespace Helper
+} // namespace SPTAG
+
+#endif // _SPTAG_HELPER_PAGEALLOCATOR_H_
@@ -164,9 +164,9 @@ namespace SPTAG {
                 std::string truthFile = p_opts.m_truthPath;
                 std::string warmupFile = p_opts.m_warmupPath;
 
-                if (COMMON::DistanceUtils::Quantizer)
+                if (p_index->GetQuantizer())
                 {
-                    COMMON::DistanceUtils::Quantizer->SetEnableADC(p_opts.m_enableADC);
+                    p_index->GetQuantizer()->SetEnableADC(p_opts.m_enableADC);
                 }
 
                 if (!p_opts.m_logFile.empty())
@@ -177,6 +177,8 @@ namespace SPTAG {
                 int internalResultNum = p_opts.m_searchInternalResultNum;
                 int K = p_opts.m_resultNum;
                 int truthK = (p_opts.m_truthResultNum <= 0) ? K : p_opts.m_truthResultNum;
+                // Keep enough candidates per query for the index to rerank.
+                int candidateNum = max(max(K, internalResultNum), p_opts.m_rerank);
 
                 if (!warmupFile.empty())
                 {
@@ -191,7 +193,7 @@ namespace SPTAG {
                     auto warmupQuerySet = queryReader->GetVectorSet();
                     int warmupNumQueries = warmupQuerySet->Count();
 
-                    std::vector<QueryResult> warmupResults(warmupNumQueries, QueryResult(NULL, max(K, internalResultNum), false));
+                    std::vector<QueryResult> warmupResults(warmupNumQueries, QueryResult(NULL, candidateNum, false));
                     std::vector<SPANN::SearchStats> warmpUpStats(warmupNumQueries);
                     for (int i = 0; i < warmupNumQueries; ++i)
                     {
@@ -215,7 +217,7 @@ namespace SPTAG {
                 auto querySet = queryReader->GetVectorSet();
                 int numQueries = querySet->Count();
 
-                std::vector<QueryResult> results(numQueries, QueryResult(NULL, max(K, internalResultNum), false));
+                std::vector<QueryResult> results(numQueries, QueryResult(NULL, candidateNum, false));
                 std::vector<SPANN::SearchStats> stats(numQueries);
                 for (int i = 0; i < numQueries; ++i)
                 {
@@ -243,23 +245,6 @@ namespace SPTAG {
                     }
                 }
 
-                if (p_opts.m_rerank > 0 && vectorSet != nullptr) {
-                    LOG(Helper::LogLevel::LL_Info, "\n Begin rerank...\n");
-                    COMMON::DistanceUtils::Quantizer.reset();
-                    for (int i = 0; i < results.size(); i++)
-                    {
-                        for (int j = 0; j < K; j++)
-                        {
-                            if (results[i].GetResult(j)->VID < 0) continue;
-                            results[i].GetResult(j)->Dist = COMMON::DistanceUtils::ComputeDistance((const ValueType*)querySet->GetVector(i),
-                                (const ValueType*)vectorSet->GetVector(results[i].GetResult(j)->VID), querySet->Dimension(), p_opts.m_distCalcMethod);
-                        }
-                        BasicResult* re = results[i].GetResults();
-                        std::sort(re, re + K, COMMON::Compare);
-                    }
-                    K = p_opts.m_rerank;
-                }
-
                 float recall = 0;
                 std::vector<std::set<SizeType>> truth;
                 if (!truthFile.empty())
@@ -866,7 +866,7 @@ namespace SPTAG {
                 Utils::StopW sw;
 
                 LOG(Helper::LogLevel::LL_Info, "Start loading vector file.\n");
-                auto valueType = COMMON::DistanceUtils::Quantizer ? SPTAG::VectorValueType::UInt8 : opts.m_valueType;
+                auto valueType = !opts.m_quantizerFilePath.empty() ? SPTAG::VectorValueType::UInt8 : opts.m_valueType;
                 std::shared_ptr<Helper::ReaderOptions> options(new Helper::ReaderOptions(valueType, opts.m_dim, opts.m_vectorType, opts.m_vectorDelimiter));
                 auto vectorReader = Helper::VectorSetReader::CreateInstance(options);
                 if (ErrorCode::Success != vectorReader->LoadFile(opts.m_vectorPath))
@@ -6,6 +6,7 @@
 
 #include "ServiceContext.h"
 #include "../Socket/Server.h"
+#include "../Socket/RemoteSearchQuery.h"
 
 #include <boost/asio.hpp>
 
@@ -13,6 +14,8 @@
 #include <vector>
 #include <thread>
 #include <condition_variable>
+#include <atomic>
+#include <functional>
 
 namespace SPTAG
 {
@@ -32,6 +35,12 @@ public:
 
     void Run();
 
+    // Runs the queries of p_query on every index of p_indexMap it names, one search thread per call.
+    // The socket handler already runs on one of many pool threads, so an OpenMP team per request would
+    // only oversubscribe the cores.
+    static Socket::RemoteBatchSearchResult SearchBatch(const Socket::RemoteBatchQuery& p_query,
+                                                       const std::map<std::string, std::shared_ptr<VectorIndex>>& p_indexMap);
+
 private:
     void RunSocketMode();
 
@@ -42,6 +51,8 @@ private:
     void SearchHanlderCallback(std::shared_ptr<SearchExecutionContext> p_exeContext,
                                Socket::Packet p_srcPacket);
 
+    void BatchSearchHanlder(Socket::ConnectionID p_localConnectionID, Socket::Packet p_packet);
+
 private:
     enum class ServeMode : std::uint8_t
     {
@@ -58,7 +69,15 @@ private:
 
     ServeMode m_serveMode;
 
-    std::unique_ptr<boost::asio::thread_pool> m_threadPool;
+    void PostSearch(std::function<void()> p_handler);
+
+    // One pool per NUMA node holding replicas in NumaMode::Replicate, a single pool otherwise.
+    std::vector<std::unique_ptr<boost::asio::thread_pool>> m_threadPools;
+
+    // The NUMA node each pool binds its threads to; empty when the pools are not bound.
+    std::vector<int> m_poolNodes;
+
+    std::atomic<std::uint32_t> m_nextThreadPool;
 
     boost::asio::io_context m_ioContext;
 
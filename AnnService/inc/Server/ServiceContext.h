@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <map>
+#include <vector>
 
 namespace SPTAG
 {
@@ -24,16 +25,30 @@ public:
 
     const std::map<std::string, std::shared_ptr<VectorIndex>>& GetIndexMap() const;
 
+    // Indexes to search from a thread on p_numaNode: that node's replicas in NumaMode::Replicate,
+    // the shared indexes otherwise.
+    const std::map<std::string, std::shared_ptr<VectorIndex>>& GetIndexMap(int p_numaNode) const;
+
+    // NUMA nodes holding replicas in NumaMode::Replicate, in increasing order; empty otherwise.
+    const std::vector<int>& GetReplicaNodes() const;
+
     const std::shared_ptr<ServiceSettings>& GetServiceSettings() const;
 
     bool IsInitialized() const;
 
 private:
+    std::shared_ptr<VectorIndex> LoadReplicas(const std::string& p_indexName, const std::string& p_indexFolder, bool p_memoryMap);
+
     bool m_initialized;
 
     std::shared_ptr<ServiceSettings> m_settings;
 
     std::map<std::string, std::shared_ptr<VectorIndex>> m_fullIndexList;
+
+    // Replicas per NUMA node. m_fullIndexList holds those of the lowest node, for threads that are not bound.
+    std::vector<std::map<std::string, std::shared_ptr<VectorIndex>>> m_replicaIndexList;
+
+    std::vector<int> m_replicaNodes;
 };
 
 
@@ -13,6 +13,20 @@ namespace SPTAG
 namespace Service
 {
 
+// How indexes are placed on a host with several NUMA nodes.
+enum class NumaMode : std::uint8_t
+{
+    // Default placement; search threads run anywhere.
+    None,
+
+    // Index memory is interleaved over all nodes, so no node serves every lookup remotely.
+    Interleave,
+
+    // Every node loads its own copy of each index, and search requests for that copy run on threads
+    // pinned to the node.
+    Replicate
+};
+
 struct ServiceSettings
 {
     ServiceSettings();
@@ -28,6 +42,8 @@ struct ServiceSettings
     SizeType m_threadNum;
 
     SizeType m_socketThreadNum;
+
+    NumaMode m_numaMode;
 };
 
 
@@ -85,6 +85,9 @@ struct RemoteSearchResult
 
     const std::uint8_t* Read(const std::uint8_t* p_buffer);
 
+    // Same as Read, but returns nullptr instead of reading past p_buffer + p_length.
+    const std::uint8_t* Read(const std::uint8_t* p_buffer, std::size_t p_length);
+
 
     ResultStatus m_status;
 
@@ -92,6 +95,69 @@ struct RemoteSearchResult
 };
 
 
+// Several queries with raw typed vectors, so the server can search them without any text parsing.
+struct RemoteBatchQuery
+{
+    static constexpr std::uint16_t MajorVersion() { return 1; }
+    static constexpr std::uint16_t MirrorVersion() { return 0; }
+
+    RemoteBatchQuery();
+
+    std::size_t EstimateBufferSize() const;
+
+    std::uint8_t* Write(std::uint8_t* p_buffer) const;
+
+    // Returns nullptr if the query does not fit into the p_length bytes of p_buffer, or if the dimension,
+    // the query count or any result number is not positive.
+    const std::uint8_t* Read(const std::uint8_t* p_buffer, std::size_t p_length);
+
+    std::uint32_t QueryCount() const;
+
+
+    // Comma separated, same as the "indexname" option of a string query.
+    std::string m_indexNames;
+
+    VectorValueType m_valueType;
+
+    DimensionType m_dimension;
+
+    bool m_extractMetadata;
+
+    // Result number of each query. The vectors are packed back to back in m_vectors in the same order.
+    std::vector<std::int32_t> m_resultNums;
+
+    ByteArray m_vectors;
+};
+
+
+struct RemoteBatchSearchResult
+{
+    static constexpr std::uint16_t MajorVersion() { return 1; }
+    static constexpr std::uint16_t MirrorVersion() { return 0; }
+
+    RemoteBatchSearchResult();
+
+    RemoteBatchSearchResult(const RemoteBatchSearchResult& p_right);
+
+    RemoteBatchSearchResult(RemoteBatchSearchResult&& p_right);
+
+    RemoteBatchSearchResult& operator=(RemoteBatchSearchResult&& p_right);
+
+    std::size_t EstimateBufferSize() const;
+
+    std::uint8_t* Write(std::uint8_t* p_buffer) const;
+
+    // Returns nullptr if the results do not fit into the p_length bytes of p_buffer.
+    const std::uint8_t* Read(const std::uint8_t* p_buffer, std::size_t p_length);
+
+
+    RemoteSearchResult::ResultStatus m_status;
+
+    // One entry per query of the request, in request order.
+    std::vector<RemoteSearchResult> m_queryResults;
+};
+
+
 
 } // namespace SPTAG
 } // namespace Socket
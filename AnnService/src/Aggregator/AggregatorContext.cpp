@@ -35,6 +35,7 @@ AggregatorContext::AggregatorContext(const std::string& p_filePath)
     m_settings->m_valueType = iniReader.GetParameter("Service", "ValueType", VectorValueType::Float);
     m_settings->m_topK = iniReader.GetParameter("Service", "TopK", static_cast<SizeType>(-1));
     m_settings->m_distMethod = iniReader.GetParameter("Service", "DistCalcMethod", DistCalcMethod::L2);
+    m_settings->m_defaultMaxResultNumber = iniReader.GetParameter("Service", "DefaultMaxResultNumber", static_cast<SizeType>(10));
     const std::string emptyStr;
 
     SizeType serverNum = iniReader.GetParameter("Servers", "Number", static_cast<SizeType>(0));
@@ -7,8 +7,10 @@ using namespace SPTAG;
 using namespace SPTAG::Aggregator;
 
 AggregatorExecutionContext::AggregatorExecutionContext(std::size_t p_totalServerNumber,
-                                                       Socket::PacketHeader p_requestHeader)
-    : m_requestHeader(std::move(p_requestHeader))
+                                                       Socket::PacketHeader p_requestHeader,
+                                                       SizeType p_resultNum)
+    : m_requestHeader(std::move(p_requestHeader)),
+      m_resultNum(p_resultNum)
 {
     m_results.clear();
     m_results.resize(p_totalServerNumber);
@@ -49,3 +51,10 @@ AggregatorExecutionContext::IsCompletedAfterFinsh(std::uint32_t p_finishedCount)
     auto lastCount = m_unfinishedCount.fetch_sub(p_finishedCount);
     return lastCount <= p_finishedCount;
 }
+
+
+SizeType
+AggregatorExecutionContext::GetResultNum() const
+{
+    return m_resultNum;
+}
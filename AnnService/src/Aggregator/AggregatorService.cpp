@@ -5,6 +5,11 @@
 #include "inc/Server/QueryParser.h"
 #include "inc/Core/Common/DistanceUtils.h"
 #include "inc/Helper/Base64Encode.h"
+#include "inc/Helper/CommonHelper.h"
+
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace SPTAG;
 using namespace SPTAG::Aggregator;
@@ -212,12 +217,25 @@ AggregatorService::SearchRequestHanlder(Socket::ConnectionID p_localConnectionID
     std::vector<Socket::ConnectionID> remoteServers;
     remoteServers.reserve(context->GetRemoteServers().size());
 
-	if (context->GetSettings()->m_topK > 0 && context->GetRemoteServers().size() == context->GetCenters()->Count()) {
-		Socket::RemoteQuery remoteQuery;
-		remoteQuery.Read(p_packet.Body());
+    Socket::RemoteQuery remoteQuery;
+    remoteQuery.Read(p_packet.Body());
+
+    Service::QueryParser queryParser;
+    queryParser.Parse(remoteQuery.m_queryString, "|");
+
+    SizeType resultNum = context->GetSettings()->m_defaultMaxResultNumber;
+    for (const auto& optionPair : queryParser.GetOptions())
+    {
+        if (Helper::StrUtils::StrEqualIgnoreCase(optionPair.first, "resultnum"))
+        {
+            if (!Helper::Convert::ConvertStringTo<SizeType>(optionPair.second, resultNum) || resultNum <= 0)
+            {
+                resultNum = context->GetSettings()->m_defaultMaxResultNumber;
+            }
+        }
+    }
 
-		Service::QueryParser queryParser;
-		queryParser.Parse(remoteQuery.m_queryString, "|");
+	if (context->GetSettings()->m_topK > 0 && context->GetRemoteServers().size() == context->GetCenters()->Count()) {
 		ByteArray vector;
 		size_t vectorSize;
 		SizeType vectorDimension = 0;
@@ -273,7 +291,7 @@ AggregatorService::SearchRequestHanlder(Socket::ConnectionID p_localConnectionID
     }
 
     std::shared_ptr<AggregatorExecutionContext> executionContext(
-        new AggregatorExecutionContext(remoteServers.size(), requestHeader));
+        new AggregatorExecutionContext(remoteServers.size(), requestHeader, resultNum));
 
     for (std::uint32_t i = 0; i < remoteServers.size(); ++i)
     {
@@ -372,42 +390,120 @@ AggregatorService::AggregateResults(std::shared_ptr<AggregatorExecutionContext>
     packet.Header().m_processStatus = Socket::PacketProcessStatus::Ok;
     packet.Header().m_resourceID = p_exectionContext->GetRequestHeader().m_resourceID;
 
+    std::vector<AggregatorResult> serverResults;
+    serverResults.reserve(p_exectionContext->GetServerNumber());
+    for (std::size_t i = 0; i < p_exectionContext->GetServerNumber(); ++i)
+    {
+        serverResults.push_back(p_exectionContext->GetResult(i));
+    }
+
     Socket::RemoteSearchResult remoteResult;
-    remoteResult.m_status = Socket::RemoteSearchResult::ResultStatus::Success;
+    MergeServerResults(serverResults, p_exectionContext->GetResultNum(), remoteResult);
 
-    std::size_t resultNum = 0;
-    for (std::size_t i = 0; i < p_exectionContext->GetServerNumber(); ++i)
+    std::uint32_t cap = static_cast<std::uint32_t>(remoteResult.EstimateBufferSize());
+    packet.AllocateBuffer(cap);
+    packet.Header().m_bodyLength = static_cast<std::uint32_t>(remoteResult.Write(packet.Body()) - packet.Body());
+    packet.Header().WriteBuffer(packet.HeaderBuffer());
+
+    m_socketServer->SendPacket(p_exectionContext->GetRequestHeader().m_connectionID,
+                               std::move(packet),
+                               nullptr);
+}
+
+
+void
+AggregatorService::MergeServerResults(const std::vector<AggregatorResult>& p_serverResults,
+                                      SizeType p_resultNum,
+                                      Socket::RemoteSearchResult& p_merged)
+{
+    p_merged.m_status = Socket::RemoteSearchResult::ResultStatus::Success;
+    p_merged.m_allIndexResults.clear();
+
+    // Group the per-server lists by index name; each partition returns its own top K of the same index.
+    std::vector<std::vector<const Socket::IndexSearchResult*>> groups;
+    std::unordered_map<std::string, std::size_t> groupIndex;
+    for (const auto& result : p_serverResults)
     {
-        const auto& result = p_exectionContext->GetResult(i);
-        if (nullptr == result)
+        if (nullptr == result || Socket::RemoteSearchResult::ResultStatus::Success != result->m_status)
         {
             continue;
         }
 
-        resultNum += result->m_allIndexResults.size();
+        for (const auto& indexRes : result->m_allIndexResults)
+        {
+            auto iter = groupIndex.find(indexRes.m_indexName);
+            if (iter == groupIndex.end())
+            {
+                iter = groupIndex.emplace(indexRes.m_indexName, groups.size()).first;
+                groups.emplace_back();
+            }
+
+            groups[iter->second].push_back(&indexRes);
+        }
+    }
+
+    p_merged.m_allIndexResults.reserve(groups.size());
+    for (const auto& group : groups)
+    {
+        p_merged.m_allIndexResults.emplace_back();
+        MergeResults(group, p_resultNum, p_merged.m_allIndexResults.back());
     }
+}
 
-    remoteResult.m_allIndexResults.reserve(resultNum);
-    for (std::size_t i = 0; i < p_exectionContext->GetServerNumber(); ++i)
+
+void
+AggregatorService::MergeResults(const std::vector<const Socket::IndexSearchResult*>& p_partitions,
+                                SizeType p_resultNum,
+                                Socket::IndexSearchResult& p_merged)
+{
+    typedef std::pair<float, std::size_t> Cursor;
+
+    bool withMeta = false;
+    std::vector<int> positions(p_partitions.size(), 0);
+    std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heads;
+    for (std::size_t i = 0; i < p_partitions.size(); ++i)
     {
-        const auto& result = p_exectionContext->GetResult(i);
-        if (nullptr == result)
+        const QueryResult& results = p_partitions[i]->m_results;
+        withMeta = withMeta || results.WithMeta();
+        if (results.GetResultNum() > 0 && results.GetResult(0)->VID >= 0)
         {
-            continue;
+            heads.emplace(results.GetResult(0)->Dist, i);
         }
+    }
+
+    p_merged.m_indexName = p_partitions.front()->m_indexName;
+    p_merged.m_results.Init(nullptr, static_cast<int>(p_resultNum), withMeta);
+
+    // A vector replicated to several partitions comes back from each of them. Only the metadata
+    // identifies it across partitions, VIDs are local to the partition that returned them.
+    std::unordered_set<std::string> seen;
+    int count = 0;
+    while (!heads.empty() && count < p_resultNum)
+    {
+        std::size_t part = heads.top().second;
+        heads.pop();
 
-        for (auto& indexRes : result->m_allIndexResults)
+        const QueryResult& results = p_partitions[part]->m_results;
+        int pos = positions[part]++;
+        const BasicResult* res = results.GetResult(pos);
+        if (pos + 1 < results.GetResultNum() && results.GetResult(pos + 1)->VID >= 0)
         {
-            remoteResult.m_allIndexResults.emplace_back(std::move(indexRes));
+            heads.emplace(results.GetResult(pos + 1)->Dist, part);
         }
-    }
 
-    std::uint32_t cap = static_cast<std::uint32_t>(remoteResult.EstimateBufferSize());
-    packet.AllocateBuffer(cap);
-    packet.Header().m_bodyLength = static_cast<std::uint32_t>(remoteResult.Write(packet.Body()) - packet.Body());
-    packet.Header().WriteBuffer(packet.HeaderBuffer());
+        if (results.WithMeta() && res->Meta.Length() > 0)
+        {
+            if (!seen.emplace(reinterpret_cast<const char*>(res->Meta.Data()), res->Meta.Length()).second)
+            {
+                continue;
+            }
+        }
 
-    m_socketServer->SendPacket(p_exectionContext->GetRequestHeader().m_connectionID,
-                               std::move(packet),
-                               nullptr);
+        p_merged.m_results.SetResult(count, res->VID, res->Dist);
+        if (withMeta)
+        {
+            p_merged.m_results.SetMetadata(count, res->Meta);
+        }
+        ++count;
+    }
 }
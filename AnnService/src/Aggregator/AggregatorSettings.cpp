@@ -9,6 +9,7 @@ using namespace SPTAG::Aggregator;
 AggregatorSettings::AggregatorSettings()
     : m_searchTimeout(100),
       m_threadNum(8),
-      m_socketThreadNum(8)
+      m_socketThreadNum(8),
+      m_defaultMaxResultNumber(10)
 {
 }
@@ -97,6 +97,61 @@ ClientWrapper::SendQueryAsync(const Socket::RemoteQuery& p_query,
 }
 
 
+void
+ClientWrapper::SendBatchQueryAsync(const Socket::RemoteBatchQuery& p_query,
+                                   BatchCallback p_callback,
+                                   const ClientOptions& p_options)
+{
+    if (!bool(p_callback))
+    {
+        return;
+    }
+
+    auto conn = GetConnection();
+
+    auto timeoutCallback = [this](std::shared_ptr<BatchCallback> p_callback)
+    {
+        DecreaseUnfnishedJobCount();
+        if (nullptr != p_callback)
+        {
+            Socket::RemoteBatchSearchResult result;
+            result.m_status = Socket::RemoteSearchResult::ResultStatus::Timeout;
+
+            (*p_callback)(std::move(result));
+        }
+    };
+
+
+    auto connectCallback = [p_callback, this](bool p_connectSucc)
+    {
+        if (!p_connectSucc)
+        {
+            Socket::RemoteBatchSearchResult result;
+            result.m_status = Socket::RemoteSearchResult::ResultStatus::FailedNetwork;
+
+            p_callback(std::move(result));
+            DecreaseUnfnishedJobCount();
+        }
+    };
+
+    Socket::Packet packet;
+    packet.Header().m_connectionID = c_invalidConnectionID;
+    packet.Header().m_packetType = PacketType::BatchSearchRequest;
+    packet.Header().m_processStatus = PacketProcessStatus::Ok;
+    packet.Header().m_resourceID = m_batchCallbackManager.Add(std::make_shared<BatchCallback>(std::move(p_callback)),
+                                                              p_options.m_searchTimeout,
+                                                              std::move(timeoutCallback));
+
+    packet.Header().m_bodyLength = static_cast<std::uint32_t>(p_query.EstimateBufferSize());
+    packet.AllocateBuffer(packet.Header().m_bodyLength);
+    p_query.Write(packet.Body());
+    packet.Header().WriteBuffer(packet.HeaderBuffer());
+
+    ++m_unfinishedJobCount;
+    m_client->SendPacket(conn.first, std::move(packet), connectCallback);
+}
+
+
 void
 ClientWrapper::WaitAllFinished()
 {
@@ -135,6 +190,12 @@ ClientWrapper::GetHandlerMap()
                                   std::placeholders::_1,
                                   std::placeholders::_2));
 
+    handlerMap->emplace(PacketType::BatchSearchResponse,
+                        std::bind(&ClientWrapper::BatchSearchResponseHanlder,
+                                  this,
+                                  std::placeholders::_1,
+                                  std::placeholders::_2));
+
     return handlerMap;
 }
 
@@ -202,6 +263,29 @@ ClientWrapper::SearchResponseHanlder(Socket::ConnectionID p_localConnectionID, S
 }
 
 
+void
+ClientWrapper::BatchSearchResponseHanlder(Socket::ConnectionID p_localConnectionID, Socket::Packet p_packet)
+{
+    std::shared_ptr<BatchCallback> callback = m_batchCallbackManager.GetAndRemove(p_packet.Header().m_resourceID);
+    if (nullptr == callback)
+    {
+        return;
+    }
+
+    Socket::RemoteBatchSearchResult result;
+    if (p_packet.Header().m_processStatus != PacketProcessStatus::Ok
+        || 0 == p_packet.Header().m_bodyLength
+        || nullptr == result.Read(p_packet.Body(), p_packet.Header().m_bodyLength))
+    {
+        result = Socket::RemoteBatchSearchResult();
+        result.m_status = Socket::RemoteSearchResult::ResultStatus::FailedExecute;
+    }
+
+    (*callback)(std::move(result));
+    DecreaseUnfnishedJobCount();
+}
+
+
 void
 ClientWrapper::HandleDeadConnection(Socket::ConnectionID p_cid)
 {
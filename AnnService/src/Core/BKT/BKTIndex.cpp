@@ -31,14 +31,37 @@ namespace SPTAG
         {
             if (p_indexBlobs.size() < 3) return ErrorCode::LackOfInputs;
 
+            ApplyPagePolicy();
+            if (m_iHugePages) {
+                Helper::AdviseHugePages(p_indexBlobs[0].Data(), p_indexBlobs[0].Length());
+                Helper::AdviseHugePages(p_indexBlobs[2].Data(), p_indexBlobs[2].Length());
+            }
+
             if (m_pSamples.Load((char*)p_indexBlobs[0].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (m_pTrees.LoadTrees((char*)p_indexBlobs[1].Data()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
-            if (m_pGraph.LoadGraph((char*)p_indexBlobs[2].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success) return ErrorCode::FailedParseValue;
+            if (m_iCompressGraph) {
+                if (m_pCompressedGraph.Load((char*)p_indexBlobs[2].Data(), p_indexBlobs[2].Length()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
+                if (m_pCompressedGraph.R() != m_pSamples.R()) {
+                    LOG(Helper::LogLevel::LL_Error, "Compressed graph has %d nodes for %d samples.\n", m_pCompressedGraph.R(), m_pSamples.R());
+                    return ErrorCode::FailedParseValue;
+                }
+                m_pGraph.m_iNeighborhoodSize = m_pCompressedGraph.C();
+            }
+            else if (m_pGraph.LoadGraph((char*)p_indexBlobs[2].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (p_indexBlobs.size() > 3 && m_deletedID.Load((char*)p_indexBlobs[3].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success) return ErrorCode::FailedParseValue;
+            if (HasIDMapping()) {
+                if (p_indexBlobs.size() < 5) return ErrorCode::LackOfInputs;
+                if (m_pIDMapping.Load((char*)p_indexBlobs[4].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success) return ErrorCode::FailedParseValue;
+            }
+            if (m_iCoLocateGraph && !m_iCompressGraph) {
+                // Co-locating copies the vectors and the graph into new heap records, which defeats the mapping.
+                if (!m_mappedFiles.empty()) LOG(Helper::LogLevel::LL_Warning, "CoLocateGraph is skipped for a memory mapped index.\n");
+                else if (CoLocateGraph() != ErrorCode::Success) return ErrorCode::FailedParseValue;
+            }
 
             omp_set_num_threads(m_iNumberOfThreads);
             m_workSpacePool.reset(new COMMON::WorkSpacePool<COMMON::WorkSpace>());
-            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             m_threadPool.init();
             return ErrorCode::Success;
         }
@@ -48,16 +71,31 @@ namespace SPTAG
         {
             if (p_indexStreams.size() < 4) return ErrorCode::LackOfInputs;
 
+            ApplyPagePolicy();
             ErrorCode ret = ErrorCode::Success;
             if (p_indexStreams[0] == nullptr || (ret = m_pSamples.Load(p_indexStreams[0], m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
             if (p_indexStreams[1] == nullptr || (ret = m_pTrees.LoadTrees(p_indexStreams[1])) != ErrorCode::Success) return ret;
-            if (p_indexStreams[2] == nullptr || (ret = m_pGraph.LoadGraph(p_indexStreams[2], m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
+            if (p_indexStreams[2] == nullptr) return ret;
+            if (m_iCompressGraph) {
+                if ((ret = m_pCompressedGraph.Load(p_indexStreams[2])) != ErrorCode::Success) return ret;
+                if (m_pCompressedGraph.R() != m_pSamples.R()) {
+                    LOG(Helper::LogLevel::LL_Error, "Compressed graph has %d nodes for %d samples.\n", m_pCompressedGraph.R(), m_pSamples.R());
+                    return ErrorCode::FailedParseValue;
+                }
+                m_pGraph.m_iNeighborhoodSize = m_pCompressedGraph.C();
+            }
+            else if ((ret = m_pGraph.LoadGraph(p_indexStreams[2], m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
             if (p_indexStreams[3] == nullptr) m_deletedID.Initialize(m_pSamples.R(), m_iDataBlockSize, m_iDataCapacity);
             else if ((ret = m_deletedID.Load(p_indexStreams[3], m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
+            if (HasIDMapping()) {
+                if (p_indexStreams.size() < 5 || p_indexStreams[4] == nullptr) return ErrorCode::LackOfInputs;
+                if ((ret = m_pIDMapping.Load(p_indexStreams[4], m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
+            }
+            if (m_iCoLocateGraph && !m_iCompressGraph && (ret = CoLocateGraph()) != ErrorCode::Success) return ret;
 
             omp_set_num_threads(m_iNumberOfThreads);
             m_workSpacePool.reset(new COMMON::WorkSpacePool<COMMON::WorkSpace>());
-            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             m_threadPool.init();
             return ret;
         }
@@ -67,7 +105,9 @@ namespace SPTAG
         {
             auto workSpace = m_workSpacePool->Rent();
             m_iHashTableExp = workSpace->HashTableExponent();
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
+            if (m_pIDMapping.R() > 0) m_iReorderIDs = 1;
+            m_iCompressGraph = IsGraphCompressed() ? 1 : 0;
 
 #define DefineBKTParameter(VarName, VarType, DefaultValue, RepresentStr) \
     IOSTRING(p_configOut, WriteString, (RepresentStr + std::string("=") + GetParameter(RepresentStr) + std::string("\n")).c_str());
@@ -90,22 +130,29 @@ namespace SPTAG
             ErrorCode ret = ErrorCode::Success;
             if ((ret = m_pSamples.Save(p_indexStreams[0])) != ErrorCode::Success) return ret;
             if ((ret = m_pTrees.SaveTrees(p_indexStreams[1])) != ErrorCode::Success) return ret;
-            if ((ret = m_pGraph.SaveGraph(p_indexStreams[2])) != ErrorCode::Success) return ret;
+            if (IsGraphCompressed()) {
+                if ((ret = m_pCompressedGraph.Save(p_indexStreams[2])) != ErrorCode::Success) return ret;
+            }
+            else if ((ret = m_pGraph.SaveGraph(p_indexStreams[2])) != ErrorCode::Success) return ret;
             if ((ret = m_deletedID.Save(p_indexStreams[3])) != ErrorCode::Success) return ret;
+            if (HasIDMapping()) {
+                if (p_indexStreams.size() < 5) return ErrorCode::LackOfInputs;
+                if ((ret = m_pIDMapping.Save(p_indexStreams[4])) != ErrorCode::Success) return ret;
+            }
             return ret;
         }
 
 #pragma region K-NN search
 /*
 #define Search(CheckDeleted, CheckDuplicated) \
-        std::shared_lock<std::shared_timed_mutex> lock(*(m_pTrees.m_lock)); \
-        m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space); \
-        m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots); \
+        COMMON::BKTree::Snapshot trees(m_pTrees); \
+        trees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space); \
+        trees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots); \
         const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1; \
         while (!p_space.m_NGQueue.empty()) { \
             NodeDistPair gnode = p_space.m_NGQueue.pop(); \
             SizeType tmpNode = gnode.node; \
-            const SizeType *node = m_pGraph[tmpNode]; \
+            const SizeType *node = GetNeighbors(tmpNode, p_space); \
             _mm_prefetch((const char *)node, _MM_HINT_T0); \
             for (DimensionType i = 0; i <= checkPos; i++) { \
                 _mm_prefetch((const char *)(m_pSamples)[node[i]], _MM_HINT_T0); \
@@ -113,7 +160,7 @@ namespace SPTAG
             if (gnode.distance <= p_query.worstDist()) { \
                 SizeType checkNode = node[checkPos]; \
                 if (checkNode < -1) { \
-                    const COMMON::BKTNode& tnode = m_pTrees[-2 - checkNode]; \
+                    const COMMON::BKTNode& tnode = trees[-2 - checkNode]; \
                     SizeType i = -tnode.childStart; \
                     do { \
                         CheckDeleted \
@@ -122,7 +169,7 @@ namespace SPTAG
                             CheckDuplicated \
                             break; \
                         } \
-                        tmpNode = m_pTrees[i].centerid; \
+                        tmpNode = trees[i].centerid; \
                     } while (i++ < tnode.childEnd); \
                 } else { \
                     CheckDeleted \
@@ -146,29 +193,30 @@ namespace SPTAG
                 p_space.m_NGQueue.insert(NodeDistPair(nn_index, distance2leaf)); \
             } \
             if (p_space.m_NGQueue.Top().distance > p_space.m_SPTQueue.Top().distance) { \
-                m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves); \
+                trees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves); \
             } \
         } \
         p_query.SortResult(); \
 */
 
 #define Search(CheckDeleted, CheckDuplicated) \
-        std::shared_lock<std::shared_timed_mutex> lock(*(m_pTrees.m_lock)); \
-        m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space); \
-        m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots); \
+        COMMON::BKTree::Snapshot trees(m_pTrees); \
+        p_query.SetQuantizer(m_pQuantizer.get()); \
+        trees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space); \
+        trees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots); \
         const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1; \
         while (!p_space.m_NGQueue.empty()) { \
             NodeDistPair gnode = p_space.m_NGQueue.pop(); \
             SizeType tmpNode = gnode.node; \
-            const SizeType *node = m_pGraph[tmpNode]; \
-            _mm_prefetch((const char *)node, _MM_HINT_T0); \
+            PrefetchNeighbors(tmpNode); \
+            const SizeType *node = GetNeighbors(tmpNode, p_space); \
             for (DimensionType i = 0; i <= checkPos; i++) { \
                 _mm_prefetch((const char *)(m_pSamples)[node[i]], _MM_HINT_T0); \
             } \
             if (gnode.distance <= p_query.worstDist()) { \
                 SizeType checkNode = node[checkPos]; \
                 if (checkNode < -1) { \
-                    const COMMON::BKTNode& tnode = m_pTrees[-2 - checkNode]; \
+                    const COMMON::BKTNode& tnode = trees[-2 - checkNode]; \
                     SizeType i = -tnode.childStart; \
                     do { \
                         CheckDeleted \
@@ -176,7 +224,7 @@ namespace SPTAG
                             CheckDuplicated \
                             break; \
                         } \
-                        tmpNode = m_pTrees[i].centerid; \
+                        tmpNode = trees[i].centerid; \
                     } while (i++ < tnode.childEnd); \
                } else { \
                    CheckDeleted \
@@ -203,7 +251,7 @@ namespace SPTAG
                 } \
             } \
             if (p_space.m_NGQueue.Top().distance > p_space.m_SPTQueue.Top().distance) { \
-                m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves); \
+                trees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves); \
             } \
         } \
         p_query.SortResult(); \
@@ -236,6 +284,19 @@ namespace SPTAG
             }
         }
 
+        template <typename T>
+        void Index<T>::SearchIndexWithFilter(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, const std::function<bool(SizeType)>& p_filter, bool p_searchDeleted) const
+        {
+            if (m_deletedID.Count() == 0 || p_searchDeleted)
+            {
+                Search(if (p_filter(tmpNode)), if (!p_query.AddPoint(tmpNode, gnode.distance)))
+            }
+            else
+            {
+                Search(if (!m_deletedID.Contains(tmpNode) && p_filter(tmpNode)), if (!p_query.AddPoint(tmpNode, gnode.distance)))
+            }
+        }
+
         template<typename T>
         ErrorCode Index<T>::SearchIndex(QueryResult &p_query, bool p_searchDeleted) const
         {
@@ -246,7 +307,37 @@ namespace SPTAG
 
             SearchIndex(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted, true);
 
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
+            ToExternalIDs(p_query);
+
+            if (p_query.WithMeta() && nullptr != m_pMetadata)
+            {
+                for (int i = 0; i < p_query.GetResultNum(); ++i)
+                {
+                    SizeType result = p_query.GetResult(i)->VID;
+                    p_query.SetMetadata(i, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
+                }
+            }
+            return ErrorCode::Success;
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexWithFilter(QueryResult &p_query, const std::function<bool(SizeType)>& p_filter, bool p_searchDeleted) const
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+
+            auto workSpace = m_workSpacePool->Rent();
+            workSpace->Reset(m_iMaxCheck, p_query.GetResultNum());
+
+            if (m_pIDMapping.R() > 0) {
+                SearchIndexWithFilter(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, [this, &p_filter](SizeType vid) { return p_filter(ToExternalID(vid)); }, p_searchDeleted);
+            }
+            else {
+                SearchIndexWithFilter(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_filter, p_searchDeleted);
+            }
+
+            m_workSpacePool->Return(std::move(workSpace));
+            ToExternalIDs(p_query);
 
             if (p_query.WithMeta() && nullptr != m_pMetadata)
             {
@@ -259,6 +350,147 @@ namespace SPTAG
             return ErrorCode::Success;
         }
 
+        template <typename T>
+        bool Index<T>::VisitInterleaved(const COMMON::BKTree::Snapshot& p_trees, InterleavedQuery& p_state, bool p_checkDeleted) const
+        {
+            COMMON::QueryResultSet<T>& p_query = *(p_state.m_query);
+            COMMON::WorkSpace& p_space = *(p_state.m_space);
+            const NodeDistPair& gnode = p_state.m_gnode;
+            const SizeType* node = p_state.m_node;
+            const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1;
+
+            SizeType tmpNode = gnode.node;
+            if (gnode.distance <= p_query.worstDist()) {
+                SizeType checkNode = node[checkPos];
+                if (checkNode < -1) {
+                    const COMMON::BKTNode& tnode = p_trees[-2 - checkNode];
+                    SizeType i = -tnode.childStart;
+                    do {
+                        if (!p_checkDeleted || !m_deletedID.Contains(tmpNode))
+                        {
+                            if (!p_query.AddPoint(tmpNode, gnode.distance)) break;
+                        }
+                        tmpNode = p_trees[i].centerid;
+                    } while (i++ < tnode.childEnd);
+                }
+                else if (!p_checkDeleted || !m_deletedID.Contains(tmpNode)) {
+                    p_query.AddPoint(tmpNode, gnode.distance);
+                }
+            }
+            else if (!p_checkDeleted || !m_deletedID.Contains(tmpNode)) {
+                if (gnode.distance > p_space.m_Results.worst() && p_space.m_iNumberOfCheckedLeaves > p_space.m_iMaxCheck) return false;
+            }
+
+            for (DimensionType i = 0; i <= checkPos; i++) {
+                SizeType nn_index = node[i];
+                if (nn_index < 0) break;
+                if (p_space.CheckAndSet(nn_index)) continue;
+                float distance2leaf = m_fComputeDistance(p_query.GetQuantizedTarget(), (m_pSamples)[nn_index], GetFeatureDim());
+                p_space.m_iNumberOfCheckedLeaves++;
+                if (p_space.m_Results.insert(distance2leaf)) {
+                    p_space.m_NGQueue.insert(NodeDistPair(nn_index, distance2leaf));
+                }
+            }
+            if (p_space.m_NGQueue.Top().distance > p_space.m_SPTQueue.Top().distance) {
+                p_trees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves);
+            }
+            return true;
+        }
+
+        template <typename T>
+        void Index<T>::SearchIndexInterleaved(std::vector<InterleavedQuery>& p_batch, bool p_checkDeleted) const
+        {
+            COMMON::BKTree::Snapshot trees(m_pTrees);
+            for (InterleavedQuery& state : p_batch) {
+                state.m_query->SetQuantizer(m_pQuantizer.get());
+                trees.InitSearchTrees(m_pSamples, m_fComputeDistance, *(state.m_query), *(state.m_space));
+                trees.SearchTrees(m_pSamples, m_fComputeDistance, *(state.m_query), *(state.m_space), m_iNumberOfInitialDynamicPivots);
+                state.m_stage = InterleavedQuery::Stage::Pop;
+            }
+
+            // Round robin over the batch: popping a node prefetches its neighbor list, the next stage prefetches
+            // the neighbor vectors, and only the stage after that touches them.
+            const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1;
+            size_t active = p_batch.size();
+            while (active > 0) {
+                for (InterleavedQuery& state : p_batch) {
+                    switch (state.m_stage) {
+                    case InterleavedQuery::Stage::Pop:
+                        if (state.m_space->m_NGQueue.empty()) {
+                            state.m_stage = InterleavedQuery::Stage::Done;
+                            state.m_query->SortResult();
+                            active--;
+                            break;
+                        }
+                        state.m_gnode = state.m_space->m_NGQueue.pop();
+                        PrefetchNeighbors(state.m_gnode.node);
+                        state.m_stage = InterleavedQuery::Stage::Prefetch;
+                        break;
+                    case InterleavedQuery::Stage::Prefetch:
+                        state.m_node = GetNeighbors(state.m_gnode.node, *(state.m_space));
+                        for (DimensionType i = 0; i <= checkPos; i++) {
+                            if (state.m_node[i] < 0) break;
+                            _mm_prefetch((const char *)(m_pSamples)[state.m_node[i]], _MM_HINT_T0);
+                        }
+                        state.m_stage = InterleavedQuery::Stage::Visit;
+                        break;
+                    case InterleavedQuery::Stage::Visit:
+                        if (VisitInterleaved(trees, state, p_checkDeleted)) {
+                            state.m_stage = InterleavedQuery::Stage::Pop;
+                        }
+                        else {
+                            state.m_stage = InterleavedQuery::Stage::Done;
+                            state.m_query->SortResult();
+                            active--;
+                        }
+                        break;
+                    default:
+                        break;
+                    }
+                }
+            }
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndex(QueryResult* p_queries, int p_queryCount, bool p_searchDeleted, int p_threadNum) const
+        {
+            if (m_iSearchInterleave <= 1) return VectorIndex::SearchIndex(p_queries, p_queryCount, p_searchDeleted, p_threadNum);
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+
+            bool checkDeleted = (m_deletedID.Count() > 0 && !p_searchDeleted);
+            int groups = (p_queryCount + m_iSearchInterleave - 1) / m_iSearchInterleave;
+            int threads = (p_threadNum > 0) ? p_threadNum : omp_get_max_threads();
+#pragma omp parallel for num_threads(threads) schedule(dynamic,1)
+            for (int g = 0; g < groups; g++) {
+                int begin = g * m_iSearchInterleave;
+                int end = min(begin + m_iSearchInterleave, p_queryCount);
+
+                std::vector<InterleavedQuery> batch(end - begin);
+                for (int i = begin; i < end; i++) {
+                    InterleavedQuery& state = batch[i - begin];
+                    state.m_query = (COMMON::QueryResultSet<T>*)(p_queries + i);
+                    state.m_space = m_workSpacePool->Rent();
+                    state.m_space->Reset(m_iMaxCheck, p_queries[i].GetResultNum());
+                }
+
+                SearchIndexInterleaved(batch, checkDeleted);
+
+                for (int i = begin; i < end; i++) {
+                    m_workSpacePool->Return(std::move(batch[i - begin].m_space));
+                    ToExternalIDs(p_queries[i]);
+                    if (p_queries[i].WithMeta() && nullptr != m_pMetadata)
+                    {
+                        for (int j = 0; j < p_queries[i].GetResultNum(); ++j)
+                        {
+                            SizeType result = p_queries[i].GetResult(j)->VID;
+                            p_queries[i].SetMetadata(j, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
+                        }
+                    }
+                }
+            }
+            return ErrorCode::Success;
+        }
+
         template<typename T>
         ErrorCode Index<T>::RefineSearchIndex(QueryResult &p_query, bool p_searchDeleted) const
         {
@@ -267,7 +499,7 @@ namespace SPTAG
 
             SearchIndex(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted, false);
 
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
             return ErrorCode::Success;
         }
 
@@ -278,8 +510,10 @@ namespace SPTAG
             workSpace->Reset(m_pGraph.m_iMaxCheckForRefineGraph, p_query.GetResultNum());
 
             COMMON::QueryResultSet<T>* p_results = (COMMON::QueryResultSet<T>*)&p_query;
-            m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, *p_results, *workSpace);
-            m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, *p_results, *workSpace, m_iNumberOfInitialDynamicPivots);
+            p_results->SetQuantizer(m_pQuantizer.get());
+            COMMON::BKTree::Snapshot trees(m_pTrees);
+            trees.InitSearchTrees(m_pSamples, m_fComputeDistance, *p_results, *workSpace);
+            trees.SearchTrees(m_pSamples, m_fComputeDistance, *p_results, *workSpace, m_iNumberOfInitialDynamicPivots);
             BasicResult * res = p_query.GetResults();
             for (int i = 0; i < p_query.GetResultNum(); i++)
             {
@@ -287,7 +521,8 @@ namespace SPTAG
                 res[i].VID = cell.node;
                 res[i].Dist = cell.distance;
             }
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
+            ToExternalIDs(p_query);
             return ErrorCode::Success;
         }
 #pragma endregion
@@ -299,10 +534,11 @@ namespace SPTAG
 
             omp_set_num_threads(m_iNumberOfThreads);
 
+            ApplyPagePolicy();
             m_pSamples.Initialize(p_vectorNum, p_dimension, m_iDataBlockSize, m_iDataCapacity, (T*)p_data, false);
             m_deletedID.Initialize(p_vectorNum, m_iDataBlockSize, m_iDataCapacity);
 
-            if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized)
+            if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized && m_pQuantizer == nullptr)
             {
                 int base = COMMON::Utils::GetBase<T>();
 #pragma omp parallel for
@@ -312,11 +548,11 @@ namespace SPTAG
             }
 
             m_workSpacePool.reset(new COMMON::WorkSpacePool<COMMON::WorkSpace>());
-            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             m_threadPool.init();
 
             auto t1 = std::chrono::high_resolution_clock::now();
-            m_pTrees.BuildTrees<T>(m_pSamples, m_iDistCalcMethod, m_iNumberOfThreads);
+            m_pTrees.BuildTrees<T>(m_pSamples, m_iDistCalcMethod, m_iNumberOfThreads, nullptr, nullptr, false, nullptr, m_pQuantizer);
             auto t2 = std::chrono::high_resolution_clock::now();
             LOG(Helper::LogLevel::LL_Info, "Build Tree time (s): %lld\n", std::chrono::duration_cast<std::chrono::seconds>(t2 - t1).count());
             
@@ -325,13 +561,107 @@ namespace SPTAG
             auto t3 = std::chrono::high_resolution_clock::now();
             LOG(Helper::LogLevel::LL_Info, "Build Graph time (s): %lld\n", std::chrono::duration_cast<std::chrono::seconds>(t3 - t2).count());
 
+            m_pIDMapping.SetR(0);
+            if (m_iReorderIDs) {
+                ReorderIDs();
+                auto t4 = std::chrono::high_resolution_clock::now();
+                LOG(Helper::LogLevel::LL_Info, "Reorder IDs time (s): %lld\n", std::chrono::duration_cast<std::chrono::seconds>(t4 - t3).count());
+            }
+
+            ErrorCode ret = ErrorCode::Success;
+            m_pCompressedGraph = COMMON::CompressedGraph();
+            if (m_iCompressGraph) {
+                if ((ret = CompressGraph()) != ErrorCode::Success) return ret;
+            }
+            else if (m_iCoLocateGraph && (ret = CoLocateGraph()) != ErrorCode::Success) return ret;
+
             m_bReady = true;
             return ErrorCode::Success;
         }
 
+        // Renumbers the vectors in breadth first order over the graph, starting from the tree centers, so the
+        // neighbors of a node (and their neighbor lists) sit close to it in m_pSamples and m_pGraph. The
+        // neighbor lists are sorted by distance, so the closest neighbors get the closest ids.
+        template <typename T>
+        void Index<T>::ReorderIDs()
+        {
+            SizeType n = GetNumSamples();
+            std::vector<SizeType> order, newIDs(n, -1);
+            order.reserve(n);
+            auto visit = [&](SizeType seed) {
+                if (newIDs[seed] >= 0) return;
+                size_t head = order.size();
+                newIDs[seed] = (SizeType)order.size();
+                order.push_back(seed);
+                while (head < order.size()) {
+                    const SizeType* node = m_pGraph[order[head++]];
+                    for (DimensionType j = 0; j < m_pGraph.m_iNeighborhoodSize; j++) {
+                        SizeType nn = node[j];
+                        if (nn < 0) break;
+                        if (newIDs[nn] >= 0) continue;
+                        newIDs[nn] = (SizeType)order.size();
+                        order.push_back(nn);
+                    }
+                }
+            };
+            for (SizeType i = 0; i < m_pTrees.size(); i++) {
+                SizeType cid = m_pTrees[i].centerid;
+                if (cid >= 0 && cid < n) visit(cid);
+            }
+            for (SizeType i = 0; i < n; i++) visit(i);
+
+            m_pSamples.Reorder(order);
+            m_pGraph.RenumberNodes(order, newIDs);
+            m_pTrees.RenumberSamples(newIDs);
+
+            m_pIDMapping.Initialize(n, 2, m_iDataBlockSize, m_iDataCapacity);
+            for (SizeType i = 0; i < n; i++) {
+                m_pIDMapping[i][0] = order[i];
+                m_pIDMapping[i][1] = newIDs[i];
+            }
+        }
+
+        // Moves every neighbor list into the record of its vector: the vector, padded to SizeType alignment, then
+        // the neighbor ids, padded to a multiple of the 64 byte cache line. Visiting a node then reads one
+        // contiguous record instead of a line from the samples and another from the graph.
+        template <typename T>
+        ErrorCode Index<T>::CoLocateGraph()
+        {
+            if (m_pGraph.R() != m_pSamples.R()) {
+                LOG(Helper::LogLevel::LL_Error, "Cannot co-locate graph (%d nodes) with samples (%d rows).\n", m_pGraph.R(), m_pSamples.R());
+                return ErrorCode::Fail;
+            }
+
+            std::size_t vectorBytes = (sizeof(T) * m_pSamples.C() + sizeof(SizeType) - 1) / sizeof(SizeType) * sizeof(SizeType);
+            std::size_t recordBytes = (vectorBytes + sizeof(SizeType) * m_pGraph.m_iNeighborhoodSize + 63) / 64 * 64;
+            ErrorCode ret = ErrorCode::Success;
+            if ((ret = m_pSamples.Restride(recordBytes)) != ErrorCode::Success || (ret = m_pGraph.CoLocate(m_pSamples, vectorBytes)) != ErrorCode::Success) {
+                LOG(Helper::LogLevel::LL_Error, "Cannot co-locate graph into %zu byte records.\n", recordBytes);
+                return ret;
+            }
+            LOG(Helper::LogLevel::LL_Info, "Co-locate graph with samples: %zu byte records.\n", recordBytes);
+            return ErrorCode::Success;
+        }
+
+        // Replaces m_pGraph by its bit-packed copy. Searches decode one neighbor list at a time, and the index
+        // can no longer take new vectors or be refined.
+        template <typename T>
+        ErrorCode Index<T>::CompressGraph()
+        {
+            ErrorCode ret = ErrorCode::Success;
+            if ((ret = m_pCompressedGraph.Compress(m_pGraph)) != ErrorCode::Success) return ret;
+            m_pGraph.Clear(m_iDataBlockSize, m_iDataCapacity);
+            return ErrorCode::Success;
+        }
+
         template <typename T>
         ErrorCode Index<T>::RefineIndex(std::shared_ptr<VectorIndex>& p_newIndex)
         {
+            if (IsGraphCompressed()) {
+                LOG(Helper::LogLevel::LL_Error, "Cannot refine an index with a compressed graph.\n");
+                return ErrorCode::Fail;
+            }
+
             p_newIndex.reset(new Index<T>());
             Index<T>* ptr = (Index<T>*)p_newIndex.get();
 
@@ -341,6 +671,9 @@ namespace SPTAG
 #include "inc/Core/BKT/ParameterDefinitionList.h"
 #undef DefineBKTParameter
 
+            ptr->SetQuantizer(m_pQuantizer);
+            ptr->ApplyPagePolicy();
+
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
 
@@ -366,18 +699,20 @@ namespace SPTAG
             if (newR == 0) return ErrorCode::EmptyIndex;
 
             ptr->m_workSpacePool.reset(new COMMON::WorkSpacePool<COMMON::WorkSpace>());
-            ptr->m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+            ptr->m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             ptr->m_threadPool.init();
 
             ErrorCode ret = ErrorCode::Success;
             if ((ret = m_pSamples.Refine(indices, ptr->m_pSamples)) != ErrorCode::Success) return ret;
-            if (nullptr != m_pMetadata && (ret = m_pMetadata->RefineMetadata(indices, ptr->m_pMetadata, m_iDataBlockSize, m_iDataCapacity, m_iMetaRecordSize)) != ErrorCode::Success) return ret;
+            std::vector<SizeType> metaIndices = ToExternalIDs(indices);
+            if (nullptr != m_pMetadata && (ret = m_pMetadata->RefineMetadata(metaIndices, ptr->m_pMetadata, m_iDataBlockSize, m_iDataCapacity, m_iMetaRecordSize)) != ErrorCode::Success) return ret;
 
             ptr->m_deletedID.Initialize(newR, m_iDataBlockSize, m_iDataCapacity);
             COMMON::BKTree* newtree = &(ptr->m_pTrees);
-            (*newtree).BuildTrees<T>(ptr->m_pSamples, ptr->m_iDistCalcMethod, omp_get_num_threads());
+            (*newtree).BuildTrees<T>(ptr->m_pSamples, ptr->m_iDistCalcMethod, omp_get_num_threads(), nullptr, nullptr, false, nullptr, m_pQuantizer);
             m_pGraph.RefineGraph<T>(this, indices, reverseIndices, nullptr, &(ptr->m_pGraph), &(ptr->m_pTrees.GetSampleMap()));
             if (HasMetaMapping()) ptr->BuildMetaMapping(false);
+            if (ptr->m_iCoLocateGraph && (ret = ptr->CoLocateGraph()) != ErrorCode::Success) return ret;
             ptr->m_bReady = true;
             return ret;
         }
@@ -385,6 +720,11 @@ namespace SPTAG
         template <typename T>
         ErrorCode Index<T>::RefineIndex(const std::vector<std::shared_ptr<Helper::DiskPriorityIO>>& p_indexStreams, IAbortOperation* p_abort)
         {
+            if (IsGraphCompressed()) {
+                LOG(Helper::LogLevel::LL_Error, "Cannot refine an index with a compressed graph.\n");
+                return ErrorCode::Fail;
+            }
+
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
 
@@ -415,7 +755,7 @@ namespace SPTAG
             if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
 
             COMMON::BKTree newTrees(m_pTrees);
-            newTrees.BuildTrees<T>(m_pSamples, m_iDistCalcMethod, omp_get_num_threads(), &indices, &reverseIndices);
+            newTrees.BuildTrees<T>(m_pSamples, m_iDistCalcMethod, omp_get_num_threads(), &indices, &reverseIndices, false, nullptr, m_pQuantizer);
             if ((ret = newTrees.SaveTrees(p_indexStreams[1])) != ErrorCode::Success) return ret;
 
             if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
@@ -425,9 +765,19 @@ namespace SPTAG
             COMMON::Labelset newDeletedID;
             newDeletedID.Initialize(newR, m_iDataBlockSize, m_iDataCapacity);
             if ((ret = newDeletedID.Save(p_indexStreams[3])) != ErrorCode::Success) return ret;
+
+            // The refined index keeps the current internal order as its ids, so it needs no mapping.
+            size_t metaStart = 4;
+            if (HasIDMapping()) {
+                if (p_indexStreams.size() < 5) return ErrorCode::LackOfInputs;
+                COMMON::Dataset<SizeType> newIDMapping(0, 2, m_iDataBlockSize, m_iDataCapacity);
+                if ((ret = newIDMapping.Save(p_indexStreams[4])) != ErrorCode::Success) return ret;
+                metaStart++;
+            }
             if (nullptr != m_pMetadata) {
-                if (p_indexStreams.size() < 6) return ErrorCode::LackOfInputs;
-                if ((ret = m_pMetadata->RefineMetadata(indices, p_indexStreams[4], p_indexStreams[5])) != ErrorCode::Success) return ret;
+                if (p_indexStreams.size() < metaStart + 2) return ErrorCode::LackOfInputs;
+                std::vector<SizeType> metaIndices = ToExternalIDs(indices);
+                if ((ret = m_pMetadata->RefineMetadata(metaIndices, p_indexStreams[metaStart], p_indexStreams[metaStart + 1])) != ErrorCode::Success) return ret;
             }
             return ret;
         }
@@ -454,12 +804,135 @@ namespace SPTAG
             if (!m_bReady) return ErrorCode::EmptyIndex;
 
             std::shared_lock<std::shared_timed_mutex> sharedlock(m_dataDeleteLock);
-            if (m_deletedID.Insert(p_id)) return ErrorCode::Success;
-            return ErrorCode::VectorNotFound;
+            if (!m_deletedID.Insert(ToInternalID(p_id))) return ErrorCode::VectorNotFound;
+
+            if (m_iDeleteRepairThreshold > 0 && ++m_deletesSinceRepair >= m_iDeleteRepairThreshold && !m_repairQueued.exchange(true)) {
+                m_threadPool.add(new RepairJob(this));
+            }
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::ConsolidateDeletes(IAbortOperation* p_abort)
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+            if (IsGraphCompressed()) {
+                LOG(Helper::LogLevel::LL_Error, "Cannot repair the compressed graph.\n");
+                return ErrorCode::Fail;
+            }
+
+            std::lock_guard<std::mutex> repairLock(m_repairLock);
+            // Keeps RefineIndex and SaveIndexData from copying the graph while lists change.
+            std::shared_lock<std::shared_timed_mutex> sharedlock(m_dataDeleteLock);
+            m_repairQueued = false;
+            m_deletesSinceRepair = 0;
+            m_deletesConsolidated = true;
+
+            // Vectors deleted from here on may still be linked from lists repaired before their delete, and
+            // vectors added from here on never link to deleted ones, so only the ids deleted now are freed.
+            SizeType rows = m_pGraph.R();
+            std::vector<SizeType> deleted;
+            for (SizeType i = 0; i < rows; i++) {
+                if (m_deletedID.Contains(i)) deleted.push_back(i);
+            }
+            if (deleted.empty()) return ErrorCode::Success;
+
+            auto t1 = std::chrono::high_resolution_clock::now();
+            std::atomic<SizeType> repaired(0);
+            std::atomic<bool> aborted(false);
+            auto isDeleted = [this](SizeType id) { return m_deletedID.Contains(id); };
+#pragma omp parallel for num_threads(m_iNumberOfThreads) schedule(dynamic,128)
+            for (SizeType node = 0; node < rows; node++)
+            {
+                if (aborted) continue;
+                if ((node & 1023) == 0 && p_abort != nullptr && p_abort->ShouldAbort()) aborted = true;
+                if (m_deletedID.Contains(node)) continue;
+                if (m_pGraph.RepairNode(this, node, isDeleted)) repaired++;
+            }
+            if (aborted) return ErrorCode::ExternalAbort;
+
+            // Deleted centers keep their vectors as long as the published trees route by them.
+            {
+                std::lock_guard<std::mutex> lock(m_recycleLock);
+                m_recycleIDs.clear();
+                for (SizeType id : deleted) {
+                    if (m_deletedID.Contains(id) && !m_pTrees.IsCenter(id)) m_recycleIDs.push_back(id);
+                }
+            }
+            auto t2 = std::chrono::high_resolution_clock::now();
+            LOG(Helper::LogLevel::LL_Info, "Consolidate %d deleted vectors: %d neighbor lists repaired in %lld ms.\n",
+                (int)deleted.size(), (int)repaired.load(), std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count());
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::AddIndexRecycled(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::vector<SizeType>& p_ids, bool p_normalized)
+        {
+            if (p_data == nullptr || p_vectorNum == 0 || p_dimension == 0) return ErrorCode::EmptyData;
+            if (m_pMetadata != nullptr) {
+                LOG(Helper::LogLevel::LL_Error, "Cannot reuse the ids of an index with metadata.\n");
+                return ErrorCode::Fail;
+            }
+
+            std::vector<SizeType> recycled;
+            if (GetNumSamples() > 0) {
+                if (p_dimension != GetFeatureDim()) return ErrorCode::DimensionSizeMismatch;
+                if (IsGraphCompressed()) {
+                    LOG(Helper::LogLevel::LL_Error, "Cannot add vectors to an index with a compressed graph.\n");
+                    return ErrorCode::Fail;
+                }
+
+                std::lock_guard<std::mutex> lock(m_dataAddLock);
+                // Holding the tree lock keeps a rebuild from publishing trees that route by a slot being overwritten;
+                // ids that became centers since ConsolidateDeletes are skipped.
+                std::lock_guard<std::mutex> treeLock(*m_pTrees.m_lock);
+                {
+                    std::lock_guard<std::mutex> recycleLock(m_recycleLock);
+                    while (recycled.size() < (size_t)p_vectorNum && !m_recycleIDs.empty()) {
+                        SizeType id = m_recycleIDs.back();
+                        m_recycleIDs.pop_back();
+                        if (!m_pTrees.IsCenter(id)) recycled.push_back(id);
+                    }
+                }
+                // The slots stay deleted, and thus out of all results, until they hold the new vectors.
+                for (size_t i = 0; i < recycled.size(); i++) {
+                    SizeType node = recycled[i];
+                    m_pGraph.ResetNode(node);
+                    std::memcpy((T*)m_pSamples[node], (const T*)p_data + i * p_dimension, sizeof(T) * p_dimension);
+                    if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized && m_pQuantizer == nullptr) {
+                        COMMON::Utils::Normalize((T*)m_pSamples[node], GetFeatureDim(), COMMON::Utils::GetBase<T>());
+                    }
+                    m_deletedID.Remove(node);
+                }
+            }
+
+#pragma omp parallel for num_threads(max(m_iAddNumberOfThreads, 1)) schedule(dynamic,16)
+            for (SizeType i = 0; i < (SizeType)recycled.size(); i++)
+            {
+                m_pGraph.LinkNewNode<T>(this, recycled[i], m_pGraph.m_iAddCEF, recycled[i], false);
+            }
+
+            p_ids.clear();
+            for (SizeType node : recycled) p_ids.push_back(ToExternalID(node));
+            SizeType rest = p_vectorNum - (SizeType)recycled.size();
+            if (rest == 0) return ErrorCode::Success;
+
+            SizeType begin;
+            ErrorCode ret = AppendIndex((const T*)p_data + recycled.size() * p_dimension, rest, p_dimension, nullptr, false, p_normalized, begin);
+            if (ret != ErrorCode::Success) return ret;
+            for (SizeType i = 0; i < rest; i++) p_ids.push_back(begin + i);
+            return ErrorCode::Success;
         }
 
         template <typename T>
         ErrorCode Index<T>::AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized)
+        {
+            SizeType begin;
+            return AppendIndex(p_data, p_vectorNum, p_dimension, p_metadataSet, p_withMetaIndex, p_normalized, begin);
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::AppendIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized, SizeType& p_begin)
         {
             if (p_data == nullptr || p_vectorNum == 0 || p_dimension == 0) return ErrorCode::EmptyData;
 
@@ -470,6 +943,7 @@ namespace SPTAG
 
                 begin = GetNumSamples();
                 end = begin + p_vectorNum;
+                p_begin = begin;
 
                 if (begin == 0) {
                     if (p_metadataSet != nullptr) {
@@ -482,6 +956,10 @@ namespace SPTAG
                 }
 
                 if (p_dimension != GetFeatureDim()) return ErrorCode::DimensionSizeMismatch;
+                if (IsGraphCompressed()) {
+                    LOG(Helper::LogLevel::LL_Error, "Cannot add vectors to an index with a compressed graph.\n");
+                    return ErrorCode::Fail;
+                }
 
                 if (m_pSamples.AddBatch((const T*)p_data, p_vectorNum) != ErrorCode::Success || 
                     m_pGraph.AddBatch(p_vectorNum) != ErrorCode::Success || 
@@ -492,7 +970,7 @@ namespace SPTAG
                     m_deletedID.SetR(begin);
                     return ErrorCode::MemoryOverFlow;
                 }
-                if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized)
+                if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized && m_pQuantizer == nullptr)
                 {
                     int base = COMMON::Utils::GetBase<T>();
                     for (SizeType i = begin; i < end; i++) {
@@ -518,12 +996,21 @@ namespace SPTAG
             }
 
             if (end - m_pTrees.sizePerTree() >= m_addCountForRebuild && m_threadPool.jobsize() == 0) {
-                m_threadPool.add(new RebuildJob(&m_pSamples, &m_pTrees, &m_pGraph, m_iDistCalcMethod));
+                m_threadPool.add(new RebuildJob(&m_pSamples, &m_pTrees, &m_pGraph, m_iDistCalcMethod, m_pQuantizer));
             }
 
+            if (m_iAddNumberOfThreads <= 1 && m_iAddBatchCandidates <= 0) {
+                for (SizeType node = begin; node < end; node++)
+                {
+                    m_pGraph.RefineNode<T>(this, node, true, LinkToDeleted(), m_pGraph.m_iAddCEF);
+                }
+                return ErrorCode::Success;
+            }
+
+#pragma omp parallel for num_threads(max(m_iAddNumberOfThreads, 1)) schedule(dynamic,16)
             for (SizeType node = begin; node < end; node++)
             {
-                m_pGraph.RefineNode<T>(this, node, true, true, m_pGraph.m_iAddCEF);
+                m_pGraph.LinkNewNode<T>(this, node, m_pGraph.m_iAddCEF, max(begin, node - (SizeType)max(m_iAddBatchCandidates, 0)), LinkToDeleted());
             }
             return ErrorCode::Success;
         }
@@ -534,7 +1021,7 @@ namespace SPTAG
         {
             omp_set_num_threads(m_iNumberOfThreads);
             m_workSpacePool.reset(new COMMON::WorkSpacePool<COMMON::WorkSpace>());
-            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             return ErrorCode::Success;
         }
 
@@ -559,8 +1046,13 @@ namespace SPTAG
 #undef DefineBKTParameter
 
             if (SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "DistCalcMethod")) {
-                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod);
-                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+                BindDistanceFunction();
+            }
+            else if (m_workSpacePool != nullptr && (SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "MaxCheck") ||
+                SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "MaxCheckForRefineGraph") ||
+                SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "HashTableExponent") ||
+                SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "VisitedTableLimit"))) {
+                m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             }
             return ErrorCode::Success;
         }
@@ -7,14 +7,7 @@ using namespace SPTAG::COMMON;
 template<typename T>
 int Utils::GetBase()
 {
-	if (DistanceUtils::Quantizer)
-	{
-		return DistanceUtils::Quantizer->GetBase();
-	}
-	else
-	{
-		return Utils::GetBaseCore<T>();
-	}
+	return Utils::GetBaseCore<T>();
 }
 
 #define DefineVectorValueType(Name, Type) template int Utils::GetBase<Type>();
@@ -24,8 +17,6 @@ int Utils::GetBase()
 template <typename T>
 void Utils::BatchNormalize(T* data, SizeType row, DimensionType col, int base, int threads) 
 {
-	if (DistanceUtils::Quantizer) return;
-
 #pragma omp parallel for num_threads(threads)
 	for (SizeType i = 0; i < row; i++)
 	{
@@ -15,8 +15,6 @@ using namespace SPTAG::COMMON;
 #define DIFF256 diff256.m256_f32
 #endif
 
-std::shared_ptr<IQuantizer> DistanceUtils::Quantizer(nullptr);
-
 inline __m128 _mm_mul_epi8(__m128i X, __m128i Y)
 {
     __m128i zero = _mm_setzero_si128();
@@ -646,3 +644,678 @@ float DistanceUtils::ComputeCosineDistance_AVX(const float* pX, const float* pY,
     while (pX < pEnd1) diff += (*pX++) * (*pY++);
     return 1 - diff;
 }
+
+// The AVX512 kernels are compiled per function so that the rest of the library keeps running on older CPUs;
+// DistanceCalcSelector only hands them out after InstructionSet has confirmed the CPU and OS support.
+#ifndef _MSC_VER
+#define F16C_TARGET __attribute__((target("avx,f16c")))
+#define AVX512_TARGET __attribute__((target("avx512f,avx512bw")))
+#define AVX512VNNI_TARGET __attribute__((target("avx512f,avx512bw,avx512vnni")))
+#else
+#define F16C_TARGET
+#define AVX512_TARGET
+#define AVX512VNNI_TARGET
+#endif
+
+// GCC passes an _mm*_undefined_* vector as the passthrough of the unmasked forms of many AVX512 intrinsics
+// and then warns that it is uninitialized, so the kernels below use the zero-masked forms and these sums.
+AVX512_TARGET inline float _mm512_hsum_ps(__m512 X)
+{
+    __m256 s = _mm256_add_ps(_mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, _mm512_castps_pd(X), 0)), _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, _mm512_castps_pd(X), 1)));
+    __m128 t = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+    t = _mm_add_ps(t, _mm_movehl_ps(t, t));
+    return _mm_cvtss_f32(_mm_add_ss(t, _mm_movehdup_ps(t)));
+}
+
+AVX512_TARGET inline int _mm512_hsum_epi32(__m512i X)
+{
+    __m256i s = _mm256_add_epi32(_mm512_maskz_extracti64x4_epi64(0xF, X, 0), _mm512_maskz_extracti64x4_epi64(0xF, X, 1));
+    __m128i t = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+    t = _mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtsi128_si32(_mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1))));
+}
+
+// Lane mask covering the next min(remain, lanes) elements, so the tails go through the same masked loads.
+inline __mmask64 _tail_mask64(DimensionType remain)
+{
+    return (remain >= 64) ? ~(__mmask64)0 : (((__mmask64)1 << remain) - 1);
+}
+
+AVX512_TARGET inline __m512i _mm512_sqdf_epi16x32(__m512i X, __m512i Y)
+{
+    __m512i d = _mm512_sub_epi16(X, Y);
+    return _mm512_madd_epi16(d, d);
+}
+
+AVX512_TARGET inline __m512 _mm512_sqdf_epi16(__m512i X, __m512i Y)
+{
+    __m512 dlo = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_sub_epi32(_mm512_maskz_cvtepi16_epi32(0xFFFF, _mm512_maskz_extracti64x4_epi64(0xF, X, 0)), _mm512_maskz_cvtepi16_epi32(0xFFFF, _mm512_maskz_extracti64x4_epi64(0xF, Y, 0))));
+    __m512 dhi = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_sub_epi32(_mm512_maskz_cvtepi16_epi32(0xFFFF, _mm512_maskz_extracti64x4_epi64(0xF, X, 1)), _mm512_maskz_cvtepi16_epi32(0xFFFF, _mm512_maskz_extracti64x4_epi64(0xF, Y, 1))));
+    return _mm512_fmadd_ps(dlo, dlo, _mm512_mul_ps(dhi, dhi));
+}
+
+AVX512_TARGET inline __m512i _mm512_sqdf_epi8(__m512i X, __m512i Y)
+{
+    __m512i lo = _mm512_sqdf_epi16x32(_mm512_maskz_cvtepi8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, X, 0)), _mm512_maskz_cvtepi8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, Y, 0)));
+    __m512i hi = _mm512_sqdf_epi16x32(_mm512_maskz_cvtepi8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, X, 1)), _mm512_maskz_cvtepi8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, Y, 1)));
+    return _mm512_add_epi32(lo, hi);
+}
+
+AVX512_TARGET inline __m512i _mm512_sqdf_epu8(__m512i X, __m512i Y)
+{
+    __m512i lo = _mm512_sqdf_epi16x32(_mm512_maskz_cvtepu8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, X, 0)), _mm512_maskz_cvtepu8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, Y, 0)));
+    __m512i hi = _mm512_sqdf_epi16x32(_mm512_maskz_cvtepu8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, X, 1)), _mm512_maskz_cvtepu8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, Y, 1)));
+    return _mm512_add_epi32(lo, hi);
+}
+
+AVX512_TARGET inline __m512i _mm512_mul_epi8(__m512i X, __m512i Y)
+{
+    __m512i lo = _mm512_madd_epi16(_mm512_maskz_cvtepi8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, X, 0)), _mm512_maskz_cvtepi8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, Y, 0)));
+    __m512i hi = _mm512_madd_epi16(_mm512_maskz_cvtepi8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, X, 1)), _mm512_maskz_cvtepi8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, Y, 1)));
+    return _mm512_add_epi32(lo, hi);
+}
+
+AVX512_TARGET inline __m512i _mm512_mul_epu8(__m512i X, __m512i Y)
+{
+    __m512i lo = _mm512_madd_epi16(_mm512_maskz_cvtepu8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, X, 0)), _mm512_maskz_cvtepu8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, Y, 0)));
+    __m512i hi = _mm512_madd_epi16(_mm512_maskz_cvtepu8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, X, 1)), _mm512_maskz_cvtepu8_epi16(0xFFFFFFFF, _mm512_maskz_extracti64x4_epi64(0xF, Y, 1)));
+    return _mm512_add_epi32(lo, hi);
+}
+
+AVX512_TARGET float DistanceUtils::ComputeL2Distance_AVX512(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+{
+    __m512i diff512 = _mm512_setzero_si512();
+    for (DimensionType i = 0; i < length; i += 64) {
+        __mmask64 mask = _tail_mask64(length - i);
+        __m512i x = _mm512_maskz_loadu_epi8(mask, pX + i);
+        __m512i y = _mm512_maskz_loadu_epi8(mask, pY + i);
+        diff512 = _mm512_add_epi32(diff512, _mm512_sqdf_epi8(x, y));
+    }
+    return (float)_mm512_hsum_epi32(diff512);
+}
+
+AVX512VNNI_TARGET float DistanceUtils::ComputeL2Distance_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+{
+    // d * d = d * (d - 128) + 128 * d, with d - 128 as the signed operand for the absolute difference d
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+    const __m512i ones = _mm512_set1_epi8(1);
+    __m512i diff512 = _mm512_setzero_si512();
+    __m512i sum512 = _mm512_setzero_si512();
+    for (DimensionType i = 0; i < length; i += 64) {
+        __mmask64 mask = _tail_mask64(length - i);
+        __m512i x = _mm512_maskz_loadu_epi8(mask, pX + i);
+        __m512i y = _mm512_maskz_loadu_epi8(mask, pY + i);
+        // max - min fits in an unsigned byte even when the signed difference does not
+        __m512i d = _mm512_sub_epi8(_mm512_max_epi8(x, y), _mm512_min_epi8(x, y));
+        diff512 = _mm512_dpbusd_epi32(diff512, d, _mm512_xor_si512(d, bias));
+        sum512 = _mm512_dpbusd_epi32(sum512, d, ones);
+    }
+    return (float)_mm512_hsum_epi32(_mm512_add_epi32(diff512, _mm512_maskz_slli_epi32(0xFFFF, sum512, 7)));
+}
+
+AVX512_TARGET float DistanceUtils::ComputeL2Distance_AVX512(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    __m512i diff512 = _mm512_setzero_si512();
+    for (DimensionType i = 0; i < length; i += 64) {
+        __mmask64 mask = _tail_mask64(length - i);
+        __m512i x = _mm512_maskz_loadu_epi8(mask, pX + i);
+        __m512i y = _mm512_maskz_loadu_epi8(mask, pY + i);
+        diff512 = _mm512_add_epi32(diff512, _mm512_sqdf_epu8(x, y));
+    }
+    return (float)_mm512_hsum_epi32(diff512);
+}
+
+AVX512VNNI_TARGET float DistanceUtils::ComputeL2Distance_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    // d * d = d * (d - 128) + 128 * d, with d - 128 as the signed operand for the absolute difference d
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+    const __m512i ones = _mm512_set1_epi8(1);
+    __m512i diff512 = _mm512_setzero_si512();
+    __m512i sum512 = _mm512_setzero_si512();
+    for (DimensionType i = 0; i < length; i += 64) {
+        __mmask64 mask = _tail_mask64(length - i);
+        __m512i x = _mm512_maskz_loadu_epi8(mask, pX + i);
+        __m512i y = _mm512_maskz_loadu_epi8(mask, pY + i);
+        __m512i d = _mm512_sub_epi8(_mm512_max_epu8(x, y), _mm512_min_epu8(x, y));
+        diff512 = _mm512_dpbusd_epi32(diff512, d, _mm512_xor_si512(d, bias));
+        sum512 = _mm512_dpbusd_epi32(sum512, d, ones);
+    }
+    return (float)_mm512_hsum_epi32(_mm512_add_epi32(diff512, _mm512_maskz_slli_epi32(0xFFFF, sum512, 7)));
+}
+
+AVX512_TARGET float DistanceUtils::ComputeL2Distance_AVX512(const std::int16_t* pX, const std::int16_t* pY, DimensionType length)
+{
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < length; i += 32) {
+        __mmask32 mask = (__mmask32)_tail_mask64(length - i);
+        __m512i x = _mm512_maskz_loadu_epi16(mask, pX + i);
+        __m512i y = _mm512_maskz_loadu_epi16(mask, pY + i);
+        diff512 = _mm512_add_ps(diff512, _mm512_sqdf_epi16(x, y));
+    }
+    return _mm512_hsum_ps(diff512);
+}
+
+AVX512_TARGET float DistanceUtils::ComputeL2Distance_AVX512(const float* pX, const float* pY, DimensionType length)
+{
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < length; i += 16) {
+        __mmask16 mask = (__mmask16)_tail_mask64(length - i);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, pX + i), _mm512_maskz_loadu_ps(mask, pY + i));
+        diff512 = _mm512_fmadd_ps(d, d, diff512);
+    }
+    return _mm512_hsum_ps(diff512);
+}
+
+AVX512_TARGET float DistanceUtils::ComputeCosineDistance_AVX512(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+{
+    __m512i diff512 = _mm512_setzero_si512();
+    for (DimensionType i = 0; i < length; i += 64) {
+        __mmask64 mask = _tail_mask64(length - i);
+        __m512i x = _mm512_maskz_loadu_epi8(mask, pX + i);
+        __m512i y = _mm512_maskz_loadu_epi8(mask, pY + i);
+        diff512 = _mm512_add_epi32(diff512, _mm512_mul_epi8(x, y));
+    }
+    return 16129 - (float)_mm512_hsum_epi32(diff512);
+}
+
+AVX512VNNI_TARGET float DistanceUtils::ComputeCosineDistance_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+{
+    // x * y = (x + 128) * y - 128 * y, with x + 128 as the unsigned operand
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+    const __m512i ones = _mm512_set1_epi8(1);
+    __m512i diff512 = _mm512_setzero_si512();
+    __m512i sum512 = _mm512_setzero_si512();
+    for (DimensionType i = 0; i < length; i += 64) {
+        __mmask64 mask = _tail_mask64(length - i);
+        __m512i x = _mm512_maskz_loadu_epi8(mask, pX + i);
+        __m512i y = _mm512_maskz_loadu_epi8(mask, pY + i);
+        diff512 = _mm512_dpbusd_epi32(diff512, _mm512_xor_si512(x, bias), y);
+        sum512 = _mm512_dpbusd_epi32(sum512, ones, y);
+    }
+    return 16129 - (float)_mm512_hsum_epi32(_mm512_sub_epi32(diff512, _mm512_maskz_slli_epi32(0xFFFF, sum512, 7)));
+}
+
+AVX512_TARGET float DistanceUtils::ComputeCosineDistance_AVX512(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    __m512i diff512 = _mm512_setzero_si512();
+    for (DimensionType i = 0; i < length; i += 64) {
+        __mmask64 mask = _tail_mask64(length - i);
+        __m512i x = _mm512_maskz_loadu_epi8(mask, pX + i);
+        __m512i y = _mm512_maskz_loadu_epi8(mask, pY + i);
+        diff512 = _mm512_add_epi32(diff512, _mm512_mul_epu8(x, y));
+    }
+    return 65025 - (float)_mm512_hsum_epi32(diff512);
+}
+
+AVX512VNNI_TARGET float DistanceUtils::ComputeCosineDistance_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    // x * y = x * (y - 128) + 128 * x, with y - 128 as the signed operand
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+    const __m512i ones = _mm512_set1_epi8(1);
+    __m512i diff512 = _mm512_setzero_si512();
+    __m512i sum512 = _mm512_setzero_si512();
+    for (DimensionType i = 0; i < length; i += 64) {
+        __mmask64 mask = _tail_mask64(length - i);
+        __m512i x = _mm512_maskz_loadu_epi8(mask, pX + i);
+        __m512i y = _mm512_maskz_loadu_epi8(mask, pY + i);
+        diff512 = _mm512_dpbusd_epi32(diff512, x, _mm512_xor_si512(y, bias));
+        sum512 = _mm512_dpbusd_epi32(sum512, x, ones);
+    }
+    return 65025 - (float)_mm512_hsum_epi32(_mm512_add_epi32(diff512, _mm512_maskz_slli_epi32(0xFFFF, sum512, 7)));
+}
+
+AVX512_TARGET float DistanceUtils::ComputeCosineDistance_AVX512(const std::int16_t* pX, const std::int16_t* pY, DimensionType length)
+{
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < length; i += 32) {
+        __mmask32 mask = (__mmask32)_tail_mask64(length - i);
+        __m512i x = _mm512_maskz_loadu_epi16(mask, pX + i);
+        __m512i y = _mm512_maskz_loadu_epi16(mask, pY + i);
+        diff512 = _mm512_add_ps(diff512, _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_madd_epi16(x, y)));
+    }
+    return 1073676289 - _mm512_hsum_ps(diff512);
+}
+
+AVX512_TARGET float DistanceUtils::ComputeCosineDistance_AVX512(const float* pX, const float* pY, DimensionType length)
+{
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < length; i += 16) {
+        __mmask16 mask = (__mmask16)_tail_mask64(length - i);
+        diff512 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, pX + i), _mm512_maskz_loadu_ps(mask, pY + i), diff512);
+    }
+    return 1 - _mm512_hsum_ps(diff512);
+}
+
+// The 16 bit floating point types are widened to float before any arithmetic: Float16 through F16C,
+// BFloat16 by shifting into the upper half of a binary32. Accumulating in half precision would lose
+// too much over a few hundred dimensions.
+F16C_TARGET inline __m256 _mm256_loadu_f16_ps(const Float16* p)
+{
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+}
+
+inline __m256 _mm256_loadu_bf16_ps(const BFloat16* p)
+{
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)), 16));
+}
+
+AVX512_TARGET inline __m512 _mm512_maskz_loadu_f16_ps(__mmask16 mask, const Float16* p)
+{
+    return _mm512_maskz_cvtph_ps(0xFFFF, _mm512_maskz_extracti64x4_epi64(0xF, _mm512_maskz_loadu_epi16((__mmask32)mask, p), 0));
+}
+
+AVX512_TARGET inline __m512 _mm512_maskz_loadu_bf16_ps(__mmask16 mask, const BFloat16* p)
+{
+    return _mm512_castsi512_ps(_mm512_maskz_slli_epi32(0xFFFF, _mm512_maskz_cvtepu16_epi32(0xFFFF, _mm512_maskz_extracti64x4_epi64(0xF, _mm512_maskz_loadu_epi16((__mmask32)mask, p), 0)), 16));
+}
+
+F16C_TARGET float DistanceUtils::ComputeL2Distance_AVX(const Float16* pX, const Float16* pY, DimensionType length)
+{
+    const Float16* pEnd8 = pX + ((length >> 3) << 3);
+    const Float16* pEnd1 = pX + length;
+
+    __m256 diff256 = _mm256_setzero_ps();
+    while (pX < pEnd8) {
+        REPEAT(__m256, const Float16, 8, _mm256_loadu_f16_ps, _mm256_sqdf_ps, _mm256_add_ps, diff256)
+    }
+    __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+    float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+    while (pX < pEnd1) {
+        float c1 = ((float)(*pX++) - (float)(*pY++)); diff += c1 * c1;
+    }
+    return diff;
+}
+
+float DistanceUtils::ComputeL2Distance_AVX(const BFloat16* pX, const BFloat16* pY, DimensionType length)
+{
+    const BFloat16* pEnd8 = pX + ((length >> 3) << 3);
+    const BFloat16* pEnd1 = pX + length;
+
+    __m256 diff256 = _mm256_setzero_ps();
+    while (pX < pEnd8) {
+        REPEAT(__m256, const BFloat16, 8, _mm256_loadu_bf16_ps, _mm256_sqdf_ps, _mm256_add_ps, diff256)
+    }
+    __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+    float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+    while (pX < pEnd1) {
+        float c1 = ((float)(*pX++) - (float)(*pY++)); diff += c1 * c1;
+    }
+    return diff;
+}
+
+AVX512_TARGET float DistanceUtils::ComputeL2Distance_AVX512(const Float16* pX, const Float16* pY, DimensionType length)
+{
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < length; i += 16) {
+        __mmask16 mask = (__mmask16)_tail_mask64(length - i);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_f16_ps(mask, pX + i), _mm512_maskz_loadu_f16_ps(mask, pY + i));
+        diff512 = _mm512_fmadd_ps(d, d, diff512);
+    }
+    return _mm512_hsum_ps(diff512);
+}
+
+AVX512_TARGET float DistanceUtils::ComputeL2Distance_AVX512(const BFloat16* pX, const BFloat16* pY, DimensionType length)
+{
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < length; i += 16) {
+        __mmask16 mask = (__mmask16)_tail_mask64(length - i);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_bf16_ps(mask, pX + i), _mm512_maskz_loadu_bf16_ps(mask, pY + i));
+        diff512 = _mm512_fmadd_ps(d, d, diff512);
+    }
+    return _mm512_hsum_ps(diff512);
+}
+
+F16C_TARGET float DistanceUtils::ComputeCosineDistance_AVX(const Float16* pX, const Float16* pY, DimensionType length)
+{
+    const Float16* pEnd8 = pX + ((length >> 3) << 3);
+    const Float16* pEnd1 = pX + length;
+
+    __m256 diff256 = _mm256_setzero_ps();
+    while (pX < pEnd8) {
+        REPEAT(__m256, const Float16, 8, _mm256_loadu_f16_ps, _mm256_mul_ps, _mm256_add_ps, diff256)
+    }
+    __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+    float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+    while (pX < pEnd1) diff += (float)(*pX++) * (float)(*pY++);
+    return 1 - diff;
+}
+
+float DistanceUtils::ComputeCosineDistance_AVX(const BFloat16* pX, const BFloat16* pY, DimensionType length)
+{
+    const BFloat16* pEnd8 = pX + ((length >> 3) << 3);
+    const BFloat16* pEnd1 = pX + length;
+
+    __m256 diff256 = _mm256_setzero_ps();
+    while (pX < pEnd8) {
+        REPEAT(__m256, const BFloat16, 8, _mm256_loadu_bf16_ps, _mm256_mul_ps, _mm256_add_ps, diff256)
+    }
+    __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+    float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+    while (pX < pEnd1) diff += (float)(*pX++) * (float)(*pY++);
+    return 1 - diff;
+}
+
+AVX512_TARGET float DistanceUtils::ComputeCosineDistance_AVX512(const Float16* pX, const Float16* pY, DimensionType length)
+{
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < length; i += 16) {
+        __mmask16 mask = (__mmask16)_tail_mask64(length - i);
+        diff512 = _mm512_fmadd_ps(_mm512_maskz_loadu_f16_ps(mask, pX + i), _mm512_maskz_loadu_f16_ps(mask, pY + i), diff512);
+    }
+    return 1 - _mm512_hsum_ps(diff512);
+}
+
+AVX512_TARGET float DistanceUtils::ComputeCosineDistance_AVX512(const BFloat16* pX, const BFloat16* pY, DimensionType length)
+{
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < length; i += 16) {
+        __mmask16 mask = (__mmask16)_tail_mask64(length - i);
+        diff512 = _mm512_fmadd_ps(_mm512_maskz_loadu_bf16_ps(mask, pX + i), _mm512_maskz_loadu_bf16_ps(mask, pY + i), diff512);
+    }
+    return 1 - _mm512_hsum_ps(diff512);
+}
+
+// Product quantization table lookups. The codes of 8 (AVX) or 16 (AVX512) subvectors are widened to 32-bit
+// table offsets and the entries fetched with one gather; the remaining subvectors go through the scalar loop.
+template <int Bits>
+inline __m256i _mm256_loadcodes_epi32(const std::uint8_t* pCodes, DimensionType i)
+{
+    if (Bits == 4) {
+        int packed;
+        std::memcpy(&packed, pCodes + (i >> 1), sizeof(int));
+        __m128i b = _mm_cvtsi32_si128(packed);
+        __m128i nibbleMask = _mm_set1_epi8(0x0F);
+        __m128i codes = _mm_unpacklo_epi8(_mm_and_si128(b, nibbleMask), _mm_and_si128(_mm_srli_epi16(b, 4), nibbleMask));
+        return _mm256_cvtepu8_epi32(codes);
+    }
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(pCodes + i)));
+}
+
+template <int Bits>
+float DistanceUtils::ComputeADCDistance_AVX(const float* pTable, const std::uint8_t* pCodes, DimensionType numSubvectors, SizeType ks)
+{
+    DimensionType end8 = ((numSubvectors >> 3) << 3);
+    __m256i offset = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(ks));
+    __m256i step = _mm256_set1_epi32(ks * 8);
+
+    __m256 diff256 = _mm256_setzero_ps();
+    for (DimensionType i = 0; i < end8; i += 8) {
+        __m256i idx = _mm256_add_epi32(offset, _mm256_loadcodes_epi32<Bits>(pCodes, i));
+        diff256 = _mm256_add_ps(diff256, _mm256_i32gather_ps(pTable, idx, 4));
+        offset = _mm256_add_epi32(offset, step);
+    }
+    __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+    float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+    for (DimensionType i = end8; i < numSubvectors; i++) diff += pTable[i * ks + GetCode<Bits>(pCodes, i)];
+    return diff;
+}
+
+template <int Bits>
+float DistanceUtils::ComputeSDCDistance_AVX(const float* pTables, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType numSubvectors, SizeType ks)
+{
+    DimensionType end8 = ((numSubvectors >> 3) << 3);
+    SizeType blockSize = ks * ks;
+    __m256i offset = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(blockSize));
+    __m256i step = _mm256_set1_epi32(blockSize * 8);
+    __m256i row = _mm256_set1_epi32(ks);
+
+    __m256 diff256 = _mm256_setzero_ps();
+    for (DimensionType i = 0; i < end8; i += 8) {
+        __m256i idx = _mm256_add_epi32(offset, _mm256_add_epi32(_mm256_mullo_epi32(_mm256_loadcodes_epi32<Bits>(pX, i), row), _mm256_loadcodes_epi32<Bits>(pY, i)));
+        diff256 = _mm256_add_ps(diff256, _mm256_i32gather_ps(pTables, idx, 4));
+        offset = _mm256_add_epi32(offset, step);
+    }
+    __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+    float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+    for (DimensionType i = end8; i < numSubvectors; i++) diff += pTables[i * blockSize + GetCode<Bits>(pX, i) * ks + GetCode<Bits>(pY, i)];
+    return diff;
+}
+
+template <int Bits>
+AVX512_TARGET inline __m512i _mm512_loadcodes_epi32(const std::uint8_t* pCodes, DimensionType i)
+{
+    if (Bits == 4) {
+        __m128i b = _mm_loadl_epi64((const __m128i*)(pCodes + (i >> 1)));
+        __m128i nibbleMask = _mm_set1_epi8(0x0F);
+        __m128i codes = _mm_unpacklo_epi8(_mm_and_si128(b, nibbleMask), _mm_and_si128(_mm_srli_epi16(b, 4), nibbleMask));
+        return _mm512_maskz_cvtepu8_epi32(0xFFFF, codes);
+    }
+    return _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm_loadu_si128((const __m128i*)(pCodes + i)));
+}
+
+template <int Bits>
+AVX512_TARGET float DistanceUtils::ComputeADCDistance_AVX512(const float* pTable, const std::uint8_t* pCodes, DimensionType numSubvectors, SizeType ks)
+{
+    DimensionType end16 = ((numSubvectors >> 4) << 4);
+    __m512i offset = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(ks));
+    __m512i step = _mm512_set1_epi32(ks * 16);
+
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < end16; i += 16) {
+        __m512i idx = _mm512_add_epi32(offset, _mm512_loadcodes_epi32<Bits>(pCodes, i));
+        diff512 = _mm512_add_ps(diff512, _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, idx, pTable, 4));
+        offset = _mm512_add_epi32(offset, step);
+    }
+    float diff = _mm512_hsum_ps(diff512);
+
+    for (DimensionType i = end16; i < numSubvectors; i++) diff += pTable[i * ks + GetCode<Bits>(pCodes, i)];
+    return diff;
+}
+
+template <int Bits>
+AVX512_TARGET float DistanceUtils::ComputeSDCDistance_AVX512(const float* pTables, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType numSubvectors, SizeType ks)
+{
+    DimensionType end16 = ((numSubvectors >> 4) << 4);
+    SizeType blockSize = ks * ks;
+    __m512i offset = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(blockSize));
+    __m512i step = _mm512_set1_epi32(blockSize * 16);
+    __m512i row = _mm512_set1_epi32(ks);
+
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < end16; i += 16) {
+        __m512i idx = _mm512_add_epi32(offset, _mm512_add_epi32(_mm512_mullo_epi32(_mm512_loadcodes_epi32<Bits>(pX, i), row), _mm512_loadcodes_epi32<Bits>(pY, i)));
+        diff512 = _mm512_add_ps(diff512, _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, idx, pTables, 4));
+        offset = _mm512_add_epi32(offset, step);
+    }
+    float diff = _mm512_hsum_ps(diff512);
+
+    for (DimensionType i = end16; i < numSubvectors; i++) diff += pTables[i * blockSize + GetCode<Bits>(pX, i) * ks + GetCode<Bits>(pY, i)];
+    return diff;
+}
+
+template float DistanceUtils::ComputeADCDistance_AVX<8>(const float*, const std::uint8_t*, DimensionType, SizeType);
+template float DistanceUtils::ComputeADCDistance_AVX<4>(const float*, const std::uint8_t*, DimensionType, SizeType);
+template float DistanceUtils::ComputeSDCDistance_AVX<8>(const float*, const std::uint8_t*, const std::uint8_t*, DimensionType, SizeType);
+template float DistanceUtils::ComputeSDCDistance_AVX<4>(const float*, const std::uint8_t*, const std::uint8_t*, DimensionType, SizeType);
+template float DistanceUtils::ComputeADCDistance_AVX512<8>(const float*, const std::uint8_t*, DimensionType, SizeType);
+template float DistanceUtils::ComputeADCDistance_AVX512<4>(const float*, const std::uint8_t*, DimensionType, SizeType);
+template float DistanceUtils::ComputeSDCDistance_AVX512<8>(const float*, const std::uint8_t*, const std::uint8_t*, DimensionType, SizeType);
+template float DistanceUtils::ComputeSDCDistance_AVX512<4>(const float*, const std::uint8_t*, const std::uint8_t*, DimensionType, SizeType);
+
+// Fast scan: the 16 quantized distances of a subvector fit one 128-bit lane, so a single pshufb looks up the
+// codes of all 32 block entries at once. Both lanes use the same table, the low lane covering entries 0-15
+// and the high lane entries 16-31; the 8-bit partial sums are widened to 16 bits before accumulating.
+void DistanceUtils::ComputeFastScanDistances_AVX(const std::uint8_t* pLUT, const std::uint8_t* pBlock, DimensionType numSubvectorPairs, std::uint16_t* pOut)
+{
+    __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    for (DimensionType p = 0; p < numSubvectorPairs; p++, pLUT += 32, pBlock += 32) {
+        __m256i codes = _mm256_loadu_si256((const __m256i*)pBlock);
+        __m256i lutLo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)pLUT));
+        __m256i lutHi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(pLUT + 16)));
+
+        __m256i distLo = _mm256_shuffle_epi8(lutLo, _mm256_and_si256(codes, nibbleMask));
+        __m256i distHi = _mm256_shuffle_epi8(lutHi, _mm256_and_si256(_mm256_srli_epi16(codes, 4), nibbleMask));
+
+        acc0 = _mm256_adds_epu16(acc0, _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(distLo)), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(distHi))));
+        acc1 = _mm256_adds_epu16(acc1, _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(distLo, 1)), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(distHi, 1))));
+    }
+    _mm256_storeu_si256((__m256i*)pOut, acc0);
+    _mm256_storeu_si256((__m256i*)(pOut + 16), acc1);
+}
+
+// Scalar quantization: 8 (AVX) or 16 (AVX512) codes are widened to floats and decoded with the per dimension
+// scale in registers; the remaining dimensions go through the scalar loop.
+inline float _mm256_hsum_ps(__m256 diff256)
+{
+    __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+    return DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+}
+
+template <int Bits>
+float DistanceUtils::ComputeSQL2Distance_AVX(const float* pQuery, const float* pScale, const std::uint8_t* pCodes, DimensionType length)
+{
+    DimensionType end8 = ((length >> 3) << 3);
+    __m256 diff256 = _mm256_setzero_ps();
+    for (DimensionType i = 0; i < end8; i += 8) {
+        __m256 codes = _mm256_cvtepi32_ps(_mm256_loadcodes_epi32<Bits>(pCodes, i));
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(pQuery + i), _mm256_mul_ps(codes, _mm256_loadu_ps(pScale + i)));
+        diff256 = _mm256_add_ps(diff256, _mm256_mul_ps(d, d));
+    }
+    float diff = _mm256_hsum_ps(diff256);
+    for (DimensionType i = end8; i < length; i++) {
+        float d = pQuery[i] - GetCode<Bits>(pCodes, i) * pScale[i];
+        diff += d * d;
+    }
+    return diff;
+}
+
+template <int Bits>
+float DistanceUtils::ComputeSQDotProduct_AVX(const float* pWeights, const std::uint8_t* pCodes, DimensionType length)
+{
+    DimensionType end8 = ((length >> 3) << 3);
+    __m256 sum256 = _mm256_setzero_ps();
+    for (DimensionType i = 0; i < end8; i += 8) {
+        __m256 codes = _mm256_cvtepi32_ps(_mm256_loadcodes_epi32<Bits>(pCodes, i));
+        sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(codes, _mm256_loadu_ps(pWeights + i)));
+    }
+    float sum = _mm256_hsum_ps(sum256);
+    for (DimensionType i = end8; i < length; i++) sum += pWeights[i] * GetCode<Bits>(pCodes, i);
+    return sum;
+}
+
+template <int Bits>
+float DistanceUtils::ComputeSQSDCL2Distance_AVX(const float* pScale, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    DimensionType end8 = ((length >> 3) << 3);
+    __m256 diff256 = _mm256_setzero_ps();
+    for (DimensionType i = 0; i < end8; i += 8) {
+        __m256 codes = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_loadcodes_epi32<Bits>(pX, i), _mm256_loadcodes_epi32<Bits>(pY, i)));
+        __m256 d = _mm256_mul_ps(codes, _mm256_loadu_ps(pScale + i));
+        diff256 = _mm256_add_ps(diff256, _mm256_mul_ps(d, d));
+    }
+    float diff = _mm256_hsum_ps(diff256);
+    for (DimensionType i = end8; i < length; i++) {
+        float d = ((int)GetCode<Bits>(pX, i) - (int)GetCode<Bits>(pY, i)) * pScale[i];
+        diff += d * d;
+    }
+    return diff;
+}
+
+template <int Bits>
+float DistanceUtils::ComputeSQSDCDotProduct_AVX(const float* pMin, const float* pScale, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    DimensionType end8 = ((length >> 3) << 3);
+    __m256 sum256 = _mm256_setzero_ps();
+    for (DimensionType i = 0; i < end8; i += 8) {
+        __m256 vmin = _mm256_loadu_ps(pMin + i);
+        __m256 scale = _mm256_loadu_ps(pScale + i);
+        __m256 x = _mm256_add_ps(vmin, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadcodes_epi32<Bits>(pX, i)), scale));
+        __m256 y = _mm256_add_ps(vmin, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadcodes_epi32<Bits>(pY, i)), scale));
+        sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(x, y));
+    }
+    float sum = _mm256_hsum_ps(sum256);
+    for (DimensionType i = end8; i < length; i++) sum += (pMin[i] + GetCode<Bits>(pX, i) * pScale[i]) * (pMin[i] + GetCode<Bits>(pY, i) * pScale[i]);
+    return sum;
+}
+
+template <int Bits>
+AVX512_TARGET float DistanceUtils::ComputeSQL2Distance_AVX512(const float* pQuery, const float* pScale, const std::uint8_t* pCodes, DimensionType length)
+{
+    DimensionType end16 = ((length >> 4) << 4);
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < end16; i += 16) {
+        __m512 codes = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_loadcodes_epi32<Bits>(pCodes, i));
+        __m512 d = _mm512_fnmadd_ps(codes, _mm512_loadu_ps(pScale + i), _mm512_loadu_ps(pQuery + i));
+        diff512 = _mm512_fmadd_ps(d, d, diff512);
+    }
+    float diff = _mm512_hsum_ps(diff512);
+    for (DimensionType i = end16; i < length; i++) {
+        float d = pQuery[i] - GetCode<Bits>(pCodes, i) * pScale[i];
+        diff += d * d;
+    }
+    return diff;
+}
+
+template <int Bits>
+AVX512_TARGET float DistanceUtils::ComputeSQDotProduct_AVX512(const float* pWeights, const std::uint8_t* pCodes, DimensionType length)
+{
+    DimensionType end16 = ((length >> 4) << 4);
+    __m512 sum512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < end16; i += 16) {
+        __m512 codes = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_loadcodes_epi32<Bits>(pCodes, i));
+        sum512 = _mm512_fmadd_ps(codes, _mm512_loadu_ps(pWeights + i), sum512);
+    }
+    float sum = _mm512_hsum_ps(sum512);
+    for (DimensionType i = end16; i < length; i++) sum += pWeights[i] * GetCode<Bits>(pCodes, i);
+    return sum;
+}
+
+template <int Bits>
+AVX512_TARGET float DistanceUtils::ComputeSQSDCL2Distance_AVX512(const float* pScale, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    DimensionType end16 = ((length >> 4) << 4);
+    __m512 diff512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < end16; i += 16) {
+        __m512 codes = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_sub_epi32(_mm512_loadcodes_epi32<Bits>(pX, i), _mm512_loadcodes_epi32<Bits>(pY, i)));
+        __m512 d = _mm512_mul_ps(codes, _mm512_loadu_ps(pScale + i));
+        diff512 = _mm512_fmadd_ps(d, d, diff512);
+    }
+    float diff = _mm512_hsum_ps(diff512);
+    for (DimensionType i = end16; i < length; i++) {
+        float d = ((int)GetCode<Bits>(pX, i) - (int)GetCode<Bits>(pY, i)) * pScale[i];
+        diff += d * d;
+    }
+    return diff;
+}
+
+template <int Bits>
+AVX512_TARGET float DistanceUtils::ComputeSQSDCDotProduct_AVX512(const float* pMin, const float* pScale, const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    DimensionType end16 = ((length >> 4) << 4);
+    __m512 sum512 = _mm512_setzero_ps();
+    for (DimensionType i = 0; i < end16; i += 16) {
+        __m512 vmin = _mm512_loadu_ps(pMin + i);
+        __m512 scale = _mm512_loadu_ps(pScale + i);
+        __m512 x = _mm512_fmadd_ps(_mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_loadcodes_epi32<Bits>(pX, i)), scale, vmin);
+        __m512 y = _mm512_fmadd_ps(_mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_loadcodes_epi32<Bits>(pY, i)), scale, vmin);
+        sum512 = _mm512_fmadd_ps(x, y, sum512);
+    }
+    float sum = _mm512_hsum_ps(sum512);
+    for (DimensionType i = end16; i < length; i++) sum += (pMin[i] + GetCode<Bits>(pX, i) * pScale[i]) * (pMin[i] + GetCode<Bits>(pY, i) * pScale[i]);
+    return sum;
+}
+
+template float DistanceUtils::ComputeSQL2Distance_AVX<8>(const float*, const float*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQL2Distance_AVX<4>(const float*, const float*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQDotProduct_AVX<8>(const float*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQDotProduct_AVX<4>(const float*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQSDCL2Distance_AVX<8>(const float*, const std::uint8_t*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQSDCL2Distance_AVX<4>(const float*, const std::uint8_t*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQSDCDotProduct_AVX<8>(const float*, const float*, const std::uint8_t*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQSDCDotProduct_AVX<4>(const float*, const float*, const std::uint8_t*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQL2Distance_AVX512<8>(const float*, const float*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQL2Distance_AVX512<4>(const float*, const float*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQDotProduct_AVX512<8>(const float*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQDotProduct_AVX512<4>(const float*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQSDCL2Distance_AVX512<8>(const float*, const std::uint8_t*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQSDCL2Distance_AVX512<4>(const float*, const std::uint8_t*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQSDCDotProduct_AVX512<8>(const float*, const float*, const std::uint8_t*, const std::uint8_t*, DimensionType);
+template float DistanceUtils::ComputeSQSDCDotProduct_AVX512<4>(const float*, const float*, const std::uint8_t*, const std::uint8_t*, DimensionType);
@@ -1,12 +1,14 @@
 #include <inc/Core/Common/IQuantizer.h>
 #include <inc/Core/Common/PQQuantizer.h>
+#include <inc/Core/Common/SQQuantizer.h>
 #include <inc/Helper/StringConvert.h>
 
 namespace SPTAG
 {
     namespace COMMON
     {
-        ErrorCode IQuantizer::LoadIQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_in) {
+        ErrorCode IQuantizer::LoadIQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_in, std::shared_ptr<IQuantizer>& p_quantizer) {
+            p_quantizer.reset();
             QuantizerType quantizerType = QuantizerType::Undefined;
             VectorValueType reconstructType = VectorValueType::Undefined;
             IOBINARY(p_in, ReadBinary, sizeof(QuantizerType), (char*)&quantizerType);
@@ -18,10 +20,12 @@ namespace SPTAG
             case QuantizerType::Undefined:
                 break;
             case QuantizerType::PQQuantizer:
+            case QuantizerType::PQ4Quantizer:
+            {
                 switch (reconstructType) {
                     #define DefineVectorValueType(Name, Type) \
                     case VectorValueType::Name: \
-                        DistanceUtils::Quantizer.reset(new PQQuantizer<Type>()); \
+                        p_quantizer.reset(new PQQuantizer<Type>(quantizerType == QuantizerType::PQ4Quantizer)); \
                         break;
 
 #include "inc/Core/DefinitionList.h"
@@ -29,8 +33,33 @@ namespace SPTAG
 
                 default: break;
                 }
-                
-                return DistanceUtils::Quantizer->LoadQuantizer(p_in);
+                if (p_quantizer == nullptr) return ErrorCode::FailedParseValue;
+
+                ErrorCode ret;
+                if ((ret = p_quantizer->LoadQuantizer(p_in)) != ErrorCode::Success) p_quantizer.reset();
+                return ret;
+            }
+
+            case QuantizerType::SQ8Quantizer:
+            case QuantizerType::SQ4Quantizer:
+            {
+                switch (reconstructType) {
+                    #define DefineVectorValueType(Name, Type) \
+                    case VectorValueType::Name: \
+                        p_quantizer.reset(new SQQuantizer<Type>(quantizerType == QuantizerType::SQ4Quantizer)); \
+                        break;
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineVectorValueType
+
+                default: break;
+                }
+                if (p_quantizer == nullptr) return ErrorCode::FailedParseValue;
+
+                ErrorCode ret;
+                if ((ret = p_quantizer->LoadQuantizer(p_in)) != ErrorCode::Success) p_quantizer.reset();
+                return ret;
+            }
 
             default: break;
             }
@@ -7,6 +7,17 @@ void cpuid(int info[4], int InfoType) {
 }
 #endif
 
+// Reads XCR0 to check which register states the OS saves on context switch.
+static unsigned long long xgetbv0() {
+#ifndef _MSC_VER
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#else
+    return _xgetbv(0);
+#endif
+}
+
 namespace SPTAG {
     namespace COMMON {
         const InstructionSet::InstructionSet_Internal InstructionSet::CPU_Rep;
@@ -15,10 +26,17 @@ namespace SPTAG {
         bool InstructionSet::SSE2(void) { return CPU_Rep.HW_SSE2; }
         bool InstructionSet::AVX(void) { return CPU_Rep.HW_AVX; }
         bool InstructionSet::AVX2(void) { return CPU_Rep.HW_AVX2; }
-        
+        bool InstructionSet::F16C(void) { return CPU_Rep.HW_F16C; }
+        bool InstructionSet::AVX512(void) { return CPU_Rep.HW_AVX512; }
+        bool InstructionSet::AVX512VNNI(void) { return CPU_Rep.HW_AVX512VNNI; }
+
         void InstructionSet::PrintInstructionSet(void) 
         {
-            if (CPU_Rep.HW_AVX2)
+            if (CPU_Rep.HW_AVX512VNNI)
+                LOG(Helper::LogLevel::LL_Info, "Using AVX512 VNNI InstructionSet!\n");
+            else if (CPU_Rep.HW_AVX512)
+                LOG(Helper::LogLevel::LL_Info, "Using AVX512 InstructionSet!\n");
+            else if (CPU_Rep.HW_AVX2)
                 LOG(Helper::LogLevel::LL_Info, "Using AVX2 InstructionSet!\n");
             else if (CPU_Rep.HW_AVX)
                 LOG(Helper::LogLevel::LL_Info, "Using AVX InstructionSet!\n");
@@ -35,24 +53,38 @@ namespace SPTAG {
             HW_SSE{ false },
             HW_SSE2{ false },
             HW_AVX{ false },
-            HW_AVX2{ false }
+            HW_AVX2{ false },
+            HW_F16C{ false },
+            HW_AVX512{ false },
+            HW_AVX512VNNI{ false }
         {
             int info[4];
             cpuid(info, 0);
             int nIds = info[0];
 
             //  Detect Features
+            bool zmmState = false;
             if (nIds >= 0x00000001) {
                 cpuid(info, 0x00000001);
                 HW_SSE = (info[3] & ((int)1 << 25)) != 0;
                 HW_SSE2 = (info[3] & ((int)1 << 26)) != 0;
                 HW_AVX = (info[2] & ((int)1 << 28)) != 0;
+                HW_F16C = (info[2] & ((int)1 << 29)) != 0;
+
+                // OSXSAVE, then XMM, YMM, opmask and both halves of the ZMM state enabled in XCR0
+                if ((info[2] & ((int)1 << 27)) != 0) zmmState = (xgetbv0() & 0xe6) == 0xe6;
             }
             if (nIds >= 0x00000007) {
                 cpuid(info, 0x00000007);
                 HW_AVX2 = (info[1] & ((int)1 << 5)) != 0;
+                HW_AVX512 = zmmState && (info[1] & ((int)1 << 16)) != 0 && (info[1] & ((int)1 << 30)) != 0;
+                HW_AVX512VNNI = HW_AVX512 && (info[2] & ((int)1 << 11)) != 0;
             }
-            if (HW_AVX2)
+            if (HW_AVX512VNNI)
+                LOG(Helper::LogLevel::LL_Info, "Using AVX512 VNNI InstructionSet!\n");
+            else if (HW_AVX512)
+                LOG(Helper::LogLevel::LL_Info, "Using AVX512 InstructionSet!\n");
+            else if (HW_AVX2)
                 LOG(Helper::LogLevel::LL_Info, "Using AVX2 InstructionSet!\n");
             else if (HW_AVX)
                 LOG(Helper::LogLevel::LL_Info, "Using AVX InstructionSet!\n");
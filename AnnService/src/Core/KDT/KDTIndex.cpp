@@ -38,7 +38,7 @@ namespace SPTAG
 
             omp_set_num_threads(m_iNumberOfThreads);
             m_workSpacePool.reset(new COMMON::WorkSpacePool<COMMON::WorkSpace>());
-            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             m_threadPool.init();
             return ErrorCode::Success;
         }
@@ -57,7 +57,7 @@ namespace SPTAG
 
             omp_set_num_threads(m_iNumberOfThreads);
             m_workSpacePool.reset(new COMMON::WorkSpacePool<COMMON::WorkSpace>());
-            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             m_threadPool.init();
             return ret;
         }
@@ -67,7 +67,7 @@ namespace SPTAG
         {
             auto workSpace = m_workSpacePool->Rent();
             m_iHashTableExp = workSpace->HashTableExponent();
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
 
 #define DefineKDTParameter(VarName, VarType, DefaultValue, RepresentStr) \
     IOSTRING(p_configOut, WriteString, (RepresentStr + std::string("=") + GetParameter(RepresentStr) + std::string("\n")).c_str());
@@ -99,6 +99,7 @@ namespace SPTAG
 
 #define Search(CheckDeleted) \
         std::shared_lock<std::shared_timed_mutex> lock(*(m_pTrees.m_lock)); \
+        p_query.SetQuantizer(m_pQuantizer.get()); \
         m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space); \
         m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots); \
         while (!p_space.m_NGQueue.empty()) { \
@@ -147,6 +148,19 @@ namespace SPTAG
             Search(;)
         }
 
+        template <typename T>
+        void Index<T>::SearchIndexWithFilter(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, const std::function<bool(SizeType)>& p_filter, bool p_searchDeleted) const
+        {
+            if (m_deletedID.Count() == 0 || p_searchDeleted)
+            {
+                Search(if (p_filter(gnode.node)))
+            }
+            else
+            {
+                Search(if (!m_deletedID.Contains(gnode.node) && p_filter(gnode.node)))
+            }
+        }
+
         template<typename T>
         ErrorCode
             Index<T>::SearchIndex(QueryResult &p_query, bool p_searchDeleted) const
@@ -161,7 +175,30 @@ namespace SPTAG
             else
                 SearchIndexWithoutDeleted(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace);
 
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
+
+            if (p_query.WithMeta() && nullptr != m_pMetadata)
+            {
+                for (int i = 0; i < p_query.GetResultNum(); ++i)
+                {
+                    SizeType result = p_query.GetResult(i)->VID;
+                    p_query.SetMetadata(i, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
+                }
+            }
+            return ErrorCode::Success;
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexWithFilter(QueryResult &p_query, const std::function<bool(SizeType)>& p_filter, bool p_searchDeleted) const
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+
+            auto workSpace = m_workSpacePool->Rent();
+            workSpace->Reset(m_iMaxCheck, p_query.GetResultNum());
+
+            SearchIndexWithFilter(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_filter, p_searchDeleted);
+
+            m_workSpacePool->Return(std::move(workSpace));
 
             if (p_query.WithMeta() && nullptr != m_pMetadata)
             {
@@ -185,7 +222,7 @@ namespace SPTAG
             else
                 SearchIndexWithoutDeleted(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace);
 
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
             return ErrorCode::Success;
         }
 
@@ -196,6 +233,7 @@ namespace SPTAG
             workSpace->Reset(m_pGraph.m_iMaxCheckForRefineGraph, p_query.GetResultNum());
 
             COMMON::QueryResultSet<T>* p_results = (COMMON::QueryResultSet<T>*)&p_query;
+            p_results->SetQuantizer(m_pQuantizer.get());
             m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, *p_results, *workSpace);
             m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, *p_results, *workSpace, m_iNumberOfInitialDynamicPivots);
             BasicResult * res = p_query.GetResults();
@@ -205,7 +243,7 @@ namespace SPTAG
                 res[i].VID = cell.node;
                 res[i].Dist = cell.distance;
             }
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
             return ErrorCode::Success;
         }
 #pragma endregion
@@ -220,7 +258,7 @@ namespace SPTAG
             m_pSamples.Initialize(p_vectorNum, p_dimension, m_iDataBlockSize, m_iDataCapacity, (T*)p_data, false);
             m_deletedID.Initialize(p_vectorNum, m_iDataBlockSize, m_iDataCapacity);
 
-            if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized)
+            if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized && m_pQuantizer == nullptr)
             {
                 int base = COMMON::Utils::GetBase<T>();
 #pragma omp parallel for
@@ -230,12 +268,12 @@ namespace SPTAG
             }
 
             m_workSpacePool.reset(new COMMON::WorkSpacePool<COMMON::WorkSpace>());
-            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             m_threadPool.init();
 
             auto t1 = std::chrono::high_resolution_clock::now();
 
-            m_pTrees.BuildTrees<T>(m_pSamples, m_iNumberOfThreads);
+            m_pTrees.BuildTrees<T>(m_pSamples, m_iNumberOfThreads, nullptr, nullptr, m_pQuantizer);
 
             auto t2 = std::chrono::high_resolution_clock::now();
             LOG(Helper::LogLevel::LL_Info, "Build Tree time (s): %lld\n", std::chrono::duration_cast<std::chrono::seconds>(t2 - t1).count());
@@ -259,6 +297,8 @@ namespace SPTAG
 #include "inc/Core/KDT/ParameterDefinitionList.h"
 #undef DefineKDTParameter
 
+            ptr->SetQuantizer(m_pQuantizer);
+
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
 
@@ -284,7 +324,7 @@ namespace SPTAG
             if (newR == 0) return ErrorCode::EmptyIndex;
 
             ptr->m_workSpacePool.reset(new COMMON::WorkSpacePool<COMMON::WorkSpace>());
-            ptr->m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+            ptr->m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             ptr->m_threadPool.init();
 
             ErrorCode ret = ErrorCode::Success;
@@ -294,7 +334,7 @@ namespace SPTAG
             ptr->m_deletedID.Initialize(newR, m_iDataBlockSize, m_iDataCapacity);
             COMMON::KDTree* newtree = &(ptr->m_pTrees);
 
-            (*newtree).BuildTrees<T>(ptr->m_pSamples, omp_get_num_threads());
+            (*newtree).BuildTrees<T>(ptr->m_pSamples, omp_get_num_threads(), nullptr, nullptr, m_pQuantizer);
             m_pGraph.RefineGraph<T>(this, indices, reverseIndices, nullptr, &(ptr->m_pGraph));
             if (HasMetaMapping()) ptr->BuildMetaMapping(false);
             ptr->m_bReady = true;
@@ -334,7 +374,7 @@ namespace SPTAG
             if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
 
             COMMON::KDTree newTrees(m_pTrees);
-            newTrees.BuildTrees<T>(m_pSamples, omp_get_num_threads(), &indices);
+            newTrees.BuildTrees<T>(m_pSamples, omp_get_num_threads(), &indices, nullptr, m_pQuantizer);
 #pragma omp parallel for
             for (SizeType i = 0; i < newTrees.size(); i++) {
                 if (newTrees[i].left < 0)
@@ -419,7 +459,7 @@ namespace SPTAG
                     m_deletedID.SetR(begin);
                     return ErrorCode::MemoryOverFlow;
                 }
-                if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized)
+                if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized && m_pQuantizer == nullptr)
                 {
                     int base = COMMON::Utils::GetBase<T>();
                     for (SizeType i = begin; i < end; i++) {
@@ -445,7 +485,7 @@ namespace SPTAG
             }
 
             if (end - m_pTrees.sizePerTree() >= m_addCountForRebuild && m_threadPool.jobsize() == 0) {
-                m_threadPool.add(new RebuildJob(&m_pSamples, &m_pTrees, &m_pGraph));
+                m_threadPool.add(new RebuildJob(&m_pSamples, &m_pTrees, &m_pGraph, m_pQuantizer));
             }
 
             for (SizeType node = begin; node < end; node++)
@@ -461,7 +501,7 @@ namespace SPTAG
         {
             omp_set_num_threads(m_iNumberOfThreads);
             m_workSpacePool.reset(new COMMON::WorkSpacePool<COMMON::WorkSpace>());
-            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+            m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             return ErrorCode::Success;
         }
 
@@ -486,8 +526,13 @@ namespace SPTAG
 #undef DefineKDTParameter
 
             if (SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "DistCalcMethod")) {
-                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod);
-                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+                BindDistanceFunction();
+            }
+            else if (m_workSpacePool != nullptr && (SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "MaxCheck") ||
+                SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "MaxCheckForRefineGraph") ||
+                SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "HashTableExponent") ||
+                SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "VisitedTableLimit"))) {
+                m_workSpacePool->Init(m_iNumberOfThreads, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_iVisitedTableLimit);
             }
             return ErrorCode::Success;
         }
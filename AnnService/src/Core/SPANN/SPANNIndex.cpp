@@ -16,7 +16,11 @@ namespace SPTAG
     {
         EdgeCompare Selection::g_edgeComparer;
 
+#ifdef IO_URING_READ
+        std::function<std::shared_ptr<Helper::DiskPriorityIO>(void)> f_createAsyncIO = []() -> std::shared_ptr<Helper::DiskPriorityIO> { return std::shared_ptr<Helper::DiskPriorityIO>(new Helper::IOUringFileIO()); };
+#else
         std::function<std::shared_ptr<Helper::DiskPriorityIO>(void)> f_createAsyncIO = []() -> std::shared_ptr<Helper::DiskPriorityIO> { return std::shared_ptr<Helper::DiskPriorityIO>(new Helper::AsyncFileIO()); };
+#endif
 
         template <typename T>
         bool Index<T>::CheckHeadIndexType() {
@@ -26,7 +30,7 @@ namespace SPTAG
                     SPTAG::Helper::Convert::ConvertToString(v1).c_str(),
                     SPTAG::Helper::Convert::ConvertToString(v2).c_str()
                 );
-                if (!SPTAG::COMMON::DistanceUtils::Quantizer) return false;
+                if (!m_pQuantizer) return false;
             }
             return true;
         }
@@ -61,9 +65,21 @@ namespace SPTAG
 
             m_extraSearcher.reset(new ExtraFullGraphSearcher<T>());
             if (!m_extraSearcher->LoadIndex(m_options)) return ErrorCode::Fail;
+            if (LoadFullVectors() != ErrorCode::Success) return ErrorCode::Fail;
+
+            size_t headFiles = m_index->BufferSize()->size();
+            m_vectorTranslateMap.reset((std::uint64_t*)(p_indexBlobs[headFiles].Data()), [=](std::uint64_t* ptr) {});
+            m_translateMapCapacity = m_index->GetNumSamples();
+
+            if (p_indexBlobs.size() > headFiles + 1 && p_indexBlobs[headFiles + 1].Length() > 0 &&
+                m_deletedID.Load((char*)(p_indexBlobs[headFiles + 1].Data()), m_options.m_datasetRowsInBlock, m_options.m_datasetCapacity) != ErrorCode::Success) return ErrorCode::Fail;
+            if (p_indexBlobs.size() > headFiles + 2 && p_indexBlobs[headFiles + 2].Length() > 0) {
+                std::shared_ptr<Helper::DiskPriorityIO> ptr(new Helper::SimpleBufferIO());
+                if (ptr == nullptr || !ptr->Initialize((char*)(p_indexBlobs[headFiles + 2].Data()), std::ios::binary | std::ios::in, p_indexBlobs[headFiles + 2].Length())) return ErrorCode::EmptyDiskIO;
+                if (m_extraSearcher->LoadPostingDelta(ptr) != ErrorCode::Success) return ErrorCode::Fail;
+            }
+            InitUpdate();
 
-            m_vectorTranslateMap.reset((std::uint64_t*)(p_indexBlobs.back().Data()), [=](std::uint64_t* ptr) {});
-           
             omp_set_num_threads(m_options.m_iSSDNumberOfThreads);
             m_workSpacePool.reset(new COMMON::WorkSpacePool<ExtraWorkSpace>());
             m_workSpacePool->Init(m_options.m_iSSDNumberOfThreads, m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, min(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx);
@@ -83,9 +99,18 @@ namespace SPTAG
 
             m_extraSearcher.reset(new ExtraFullGraphSearcher<T>());
             if (!m_extraSearcher->LoadIndex(m_options)) return ErrorCode::Fail;
+            if (LoadFullVectors() != ErrorCode::Success) return ErrorCode::Fail;
 
+            size_t headFiles = m_index->GetIndexFiles()->size();
             m_vectorTranslateMap.reset(new std::uint64_t[m_index->GetNumSamples()], std::default_delete<std::uint64_t[]>());
-            IOBINARY(p_indexStreams.back(), ReadBinary, sizeof(std::uint64_t) * m_index->GetNumSamples(), reinterpret_cast<char*>(m_vectorTranslateMap.get()));
+            m_translateMapCapacity = m_index->GetNumSamples();
+            IOBINARY(p_indexStreams[headFiles], ReadBinary, sizeof(std::uint64_t) * m_index->GetNumSamples(), reinterpret_cast<char*>(m_vectorTranslateMap.get()));
+
+            if (p_indexStreams.size() > headFiles + 1 && p_indexStreams[headFiles + 1] != nullptr &&
+                m_deletedID.Load(p_indexStreams[headFiles + 1], m_options.m_datasetRowsInBlock, m_options.m_datasetCapacity) != ErrorCode::Success) return ErrorCode::Fail;
+            if (p_indexStreams.size() > headFiles + 2 && p_indexStreams[headFiles + 2] != nullptr &&
+                m_extraSearcher->LoadPostingDelta(p_indexStreams[headFiles + 2]) != ErrorCode::Success) return ErrorCode::Fail;
+            InitUpdate();
 
             omp_set_num_threads(m_options.m_iSSDNumberOfThreads);
             m_workSpacePool.reset(new COMMON::WorkSpacePool<ExtraWorkSpace>());
@@ -134,12 +159,18 @@ namespace SPTAG
         template<typename T>
         ErrorCode Index<T>::SaveIndexData(const std::vector<std::shared_ptr<Helper::DiskPriorityIO>>& p_indexStreams)
         {
-            if (m_index == nullptr || m_vectorTranslateMap == nullptr) return ErrorCode::EmptyIndex;
+            if (m_index == nullptr || m_vectorTranslateMap == nullptr || m_extraSearcher == nullptr) return ErrorCode::EmptyIndex;
             
+            std::shared_lock<std::shared_timed_mutex> lock(m_headLock);
             ErrorCode ret;
             if ((ret = m_index->SaveIndexData(p_indexStreams)) != ErrorCode::Success) return ret;
 
-            IOBINARY(p_indexStreams.back(), WriteBinary, sizeof(std::uint64_t) * m_index->GetNumSamples(), (char*)(m_vectorTranslateMap.get()));
+            size_t headFiles = m_index->GetIndexFiles()->size();
+            IOBINARY(p_indexStreams[headFiles], WriteBinary, sizeof(std::uint64_t) * m_index->GetNumSamples(), (char*)(m_vectorTranslateMap.get()));
+            if ((ret = m_deletedID.Save(p_indexStreams[headFiles + 1])) != ErrorCode::Success) return ret;
+            if ((ret = m_extraSearcher->SavePostingDelta(p_indexStreams[headFiles + 2])) != ErrorCode::Success) return ret;
+            if (m_fullVectors != nullptr && p_indexStreams.size() > headFiles + 3 && p_indexStreams[headFiles + 3] != nullptr)
+                return SaveFullVectors(p_indexStreams[headFiles + 3]);
             return ErrorCode::Success;
         }
 
@@ -150,33 +181,63 @@ namespace SPTAG
         {
             if (!m_bReady) return ErrorCode::EmptyIndex;
 
-            m_index->SearchIndex(p_query);
-
+            std::shared_lock<std::shared_timed_mutex> headLock(m_headLock);
             COMMON::QueryResultSet<T>* p_queryResults = (COMMON::QueryResultSet<T>*) & p_query;
-            std::shared_ptr<ExtraWorkSpace> workSpace = nullptr;
-            if (m_extraSearcher != nullptr) {
-                workSpace = m_workSpacePool->Rent();
+            if (m_extraSearcher == nullptr) {
+                m_index->SearchIndex(p_query);
+            }
+            else {
+                // The head search needs enough candidates to select the postings from, and the rerank
+                // stage needs its whole depth, so search into a larger result set when the query is small.
+                int candidateNum = max(m_options.m_searchInternalResultNum, (m_fullVectors != nullptr) ? m_options.m_rerank : 0);
+                std::unique_ptr<COMMON::QueryResultSet<T>> candidateQuery;
+                if (p_query.GetResultNum() < candidateNum)
+                    candidateQuery.reset(new COMMON::QueryResultSet<T>((const T*)p_query.GetTarget(), candidateNum));
+                COMMON::QueryResultSet<T>* candidates = (candidateQuery != nullptr) ? candidateQuery.get() : p_queryResults;
+                m_index->SearchIndex(*candidates);
+
+                std::unique_ptr<ExtraWorkSpace> workSpace = m_workSpacePool->Rent();
                 workSpace->m_postingIDs.clear();
 
-                float limitDist = p_queryResults->GetResult(0)->Dist * m_options.m_maxDistRatio;
+                float limitDist = candidates->GetResult(0)->Dist * m_options.m_maxDistRatio;
                 for (int i = 0; i < m_options.m_searchInternalResultNum; ++i)
                 {
-                    auto res = p_queryResults->GetResult(i);
+                    auto res = candidates->GetResult(i);
                     if (res->VID == -1 || (limitDist > 0.1 && res->Dist > limitDist)) break;
                     workSpace->m_postingIDs.emplace_back(res->VID);
                 }
 
-                for (int i = 0; i < p_queryResults->GetResultNum(); ++i)
+                bool checkDeleted = (!p_searchDeleted && m_deletedID.Count() > 0);
+                int validResults = 0, i = 0;
+                for (; i < candidates->GetResultNum(); ++i)
                 {
-                    auto res = p_queryResults->GetResult(i);
+                    auto res = candidates->GetResult(i);
                     if (res->VID == -1) break;
                     res->VID = static_cast<SizeType>((m_vectorTranslateMap.get())[res->VID]);
+                    if (checkDeleted && m_deletedID.Contains(res->VID)) continue;
+                    if (validResults < i) *(candidates->GetResult(validResults)) = *res;
+                    validResults++;
                 }
+                headLock.unlock();
 
-                p_queryResults->Reverse();
-                m_extraSearcher->SearchIndex(workSpace.get(), *p_queryResults, m_index, nullptr);
-                p_queryResults->SortResult();
-                m_workSpacePool->Return(workSpace);
+                // Deleted heads still route to their postings but are dropped from the results.
+                for (; validResults < i; ++validResults)
+                {
+                    auto res = candidates->GetResult(validResults);
+                    res->VID = -1;
+                    res->Dist = MaxDist;
+                }
+
+                candidates->Reverse();
+                m_extraSearcher->SearchIndex(workSpace.get(), *candidates, m_index, nullptr);
+                candidates->SortResult();
+                RerankResults(*candidates, p_query.GetResultNum(), workSpace.get());
+                m_workSpacePool->Return(std::move(workSpace));
+
+                if (candidateQuery != nullptr)
+                {
+                    for (int j = 0; j < p_query.GetResultNum(); ++j) *(p_queryResults->GetResult(j)) = *(candidates->GetResult(j));
+                }
             }
 
             if (p_query.WithMeta() && nullptr != m_pMetadata)
@@ -197,14 +258,17 @@ namespace SPTAG
             if (nullptr == m_extraSearcher) return ErrorCode::EmptyIndex;
 
             COMMON::QueryResultSet<T> newResults(*((COMMON::QueryResultSet<T>*)&p_query));
-            for (int i = 0; i < newResults.GetResultNum(); ++i)
             {
-                auto res = newResults.GetResult(i);
-                if (res->VID == -1) break;
+                std::shared_lock<std::shared_timed_mutex> headLock(m_headLock);
+                for (int i = 0; i < newResults.GetResultNum(); ++i)
+                {
+                    auto res = newResults.GetResult(i);
+                    if (res->VID == -1) break;
 
-                auto global_VID = static_cast<SizeType>((m_vectorTranslateMap.get())[res->VID]);
-                if (truth && truth->count(global_VID)) (*found)[res->VID].insert(global_VID);
-                res->VID = global_VID;
+                    auto global_VID = static_cast<SizeType>((m_vectorTranslateMap.get())[res->VID]);
+                    if (truth && truth->count(global_VID)) (*found)[res->VID].insert(global_VID);
+                    res->VID = global_VID;
+                }
             }
             newResults.Reverse();
 
@@ -224,15 +288,547 @@ namespace SPTAG
                 }
 
                 m_extraSearcher->SearchIndex(auto_ws.get(), newResults, m_index, p_stats, truth, found);
-                m_workSpacePool->Return(auto_ws);
+                m_workSpacePool->Return(std::move(auto_ws));
             }
 
             newResults.SortResult();
+            if (m_fullVectors != nullptr) {
+                auto auto_ws = m_workSpacePool->Rent();
+                RerankResults(newResults, newResults.GetResultNum(), auto_ws.get());
+                m_workSpacePool->Return(std::move(auto_ws));
+            }
             std::copy(newResults.GetResults(), newResults.GetResults() + newResults.GetResultNum(), p_query.GetResults());
             return ErrorCode::Success;
         }
 #pragma endregion
 
+#pragma region Rerank
+        template <typename T>
+        ErrorCode Index<T>::BuildFullVectors()
+        {
+            // With a quantizer the index stores codes, the full precision vectors have the reconstruct type and dimension.
+            VectorValueType valueType = m_pQuantizer ? m_pQuantizer->GetReconstructType() : m_options.m_valueType;
+            DimensionType dim = m_pQuantizer ? m_pQuantizer->ReconstructDim() : m_options.m_dim;
+            std::string sourceFile = m_options.m_fullVectorPath.empty() ? m_options.m_vectorPath : m_options.m_fullVectorPath;
+
+            std::shared_ptr<Helper::ReaderOptions> vectorOptions(new Helper::ReaderOptions(valueType, dim, m_options.m_vectorType, m_options.m_vectorDelimiter));
+            auto vectorReader = Helper::VectorSetReader::CreateInstance(vectorOptions);
+            if (ErrorCode::Success != vectorReader->LoadFile(sourceFile))
+            {
+                LOG(Helper::LogLevel::LL_Error, "Failed to read full precision vector file %s.\n", sourceFile.c_str());
+                return ErrorCode::Fail;
+            }
+            auto fullVectors = vectorReader->GetVectorSet();
+            if (m_options.m_distCalcMethod == DistCalcMethod::Cosine && !vectorReader->IsNormalized()) fullVectors->Normalize(m_options.m_iSSDNumberOfThreads);
+
+            std::string outputFile = FullVectorFilePath();
+            auto ptr = SPTAG::f_createIO();
+            if (ptr == nullptr || !ptr->Initialize(outputFile.c_str(), std::ios::binary | std::ios::out)) {
+                LOG(Helper::LogLevel::LL_Error, "Failed to create full vector file %s.\n", outputFile.c_str());
+                return ErrorCode::FailedCreateFile;
+            }
+
+            // The header takes the whole first page so that every vector read can be page aligned.
+            std::unique_ptr<char[]> page(new char[PageSize]);
+            memset(page.get(), 0, PageSize);
+            SizeType count = fullVectors->Count();
+            std::uint8_t type = static_cast<std::uint8_t>(valueType);
+            memcpy(page.get(), &count, sizeof(count));
+            memcpy(page.get() + sizeof(count), &dim, sizeof(dim));
+            memcpy(page.get() + sizeof(count) + sizeof(dim), &type, sizeof(type));
+            IOBINARY(ptr, WriteBinary, PageSize, page.get());
+
+            std::uint64_t dataSize = static_cast<std::uint64_t>(count) * fullVectors->PerVectorDataSize();
+            IOBINARY(ptr, WriteBinary, dataSize, (char*)(fullVectors->GetData()));
+
+            memset(page.get(), 0, PageSize);
+            std::uint64_t padding = (PageSize - dataSize % PageSize) % PageSize;
+            if (padding > 0) IOBINARY(ptr, WriteBinary, padding, page.get());
+            LOG(Helper::LogLevel::LL_Info, "Save full vectors (%d,%d) to %s.\n", count, dim, outputFile.c_str());
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::SaveFullVectors(std::shared_ptr<Helper::DiskPriorityIO> p_output) const
+        {
+            const std::uint64_t chunk = ((std::uint64_t)1) << 20;
+            PageBuffer<std::uint8_t> buffer;
+            buffer.ReservePageBuffer(chunk);
+            for (std::uint64_t offset = 0; offset < m_fullVectorBytes; offset += chunk) {
+                std::uint64_t bytes = min(chunk, m_fullVectorBytes - offset);
+                IOBINARY(m_fullVectors, ReadBinary, bytes, (char*)(buffer.GetBuffer()), offset);
+                IOBINARY(p_output, WriteBinary, bytes, (char*)(buffer.GetBuffer()));
+            }
+            LOG(Helper::LogLevel::LL_Info, "Save full vectors (%llu bytes).\n", (unsigned long long)m_fullVectorBytes);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::LoadFullVectors()
+        {
+            m_fullVectors.reset();
+            m_fullVectorBytes = 0;
+            std::string file = FullVectorFilePath();
+            if (!fileexists(file.c_str())) return ErrorCode::Success;
+
+            auto ptr = f_createAsyncIO();
+            if (ptr == nullptr || !ptr->Initialize(file.c_str(), std::ios::binary | std::ios::in, (1 << 20), 2, 2, m_options.m_ioThreads)) {
+                LOG(Helper::LogLevel::LL_Error, "Cannot open file:%s!\n", file.c_str());
+                return ErrorCode::FailedOpenFile;
+            }
+
+            PageBuffer<std::uint8_t> header;
+            header.ReservePageBuffer(PageSize);
+            IOBINARY(ptr, ReadBinary, PageSize, (char*)(header.GetBuffer()), 0);
+            SizeType count = *((SizeType*)(header.GetBuffer()));
+            m_fullVectorDim = *((DimensionType*)(header.GetBuffer() + sizeof(SizeType)));
+            m_fullVectorType = static_cast<VectorValueType>(*(header.GetBuffer() + sizeof(SizeType) + sizeof(DimensionType)));
+            if (m_fullVectorType >= VectorValueType::Undefined || m_fullVectorDim <= 0 || count < m_extraSearcher->GetDocumentCount()) {
+                LOG(Helper::LogLevel::LL_Error, "Full vector file %s (%d,%d) does not match the index with %d vectors.\n", file.c_str(), count, m_fullVectorDim, m_extraSearcher->GetDocumentCount());
+                return ErrorCode::DimensionSizeMismatch;
+            }
+            std::uint64_t dataSize = static_cast<std::uint64_t>(count) * m_fullVectorDim * GetValueTypeSize(m_fullVectorType);
+            m_fullVectorBytes = PageSize + ((dataSize + PageSize - 1) >> PageSizeEx << PageSizeEx);
+            m_fullVectors = ptr;
+            LOG(Helper::LogLevel::LL_Info, "Load full vectors (%d,%d) for rerank.\n", count, m_fullVectorDim);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        void Index<T>::RerankResults(COMMON::QueryResultSet<T>& p_results, int p_resultNum, ExtraWorkSpace* p_exWorkSpace) const
+        {
+            if (m_fullVectors == nullptr || m_options.m_rerank <= 0) return;
+
+            // Every returned result is reranked even past the rerank depth, otherwise the tail would keep its
+            // quantized distance and be ordered against exact ones.
+            int depth = min(max(m_options.m_rerank, p_resultNum), p_results.GetResultNum());
+            std::uint64_t vectorBytes = GetValueTypeSize(m_fullVectorType) * static_cast<std::uint64_t>(m_fullVectorDim);
+            std::uint64_t pageMask = ~(static_cast<std::uint64_t>(PageSize) - 1);
+            // A vector can straddle a page boundary, so each read gets one extra page.
+            std::uint64_t readPages = ((vectorBytes + PageSize - 1) >> PageSizeEx) + 1;
+            p_exWorkSpace->m_rerankBuffer.ReservePageBuffer(static_cast<std::size_t>(depth * readPages) << PageSizeEx);
+            if (p_exWorkSpace->m_rerankRequests.size() < static_cast<std::size_t>(depth)) p_exWorkSpace->m_rerankRequests.resize(depth);
+
+            auto& batch = p_exWorkSpace->m_rerankBatch;
+            batch.clear();
+            for (int i = 0; i < depth; ++i)
+            {
+                BasicResult* res = p_results.GetResult(i);
+                if (res->VID < 0) continue;
+
+                std::uint64_t offset = PageSize + vectorBytes * res->VID;
+                auto& request = p_exWorkSpace->m_rerankRequests[batch.size()];
+                request.m_offset = offset & pageMask;
+                request.m_readSize = ((offset + vectorBytes + PageSize - 1) & pageMask) - request.m_offset;
+                request.m_buffer = (char*)(p_exWorkSpace->m_rerankBuffer.GetBuffer()) + ((batch.size() * readPages) << PageSizeEx);
+                request.m_callback = nullptr;
+                request.m_payload = (void*)res;
+                request.m_success = false;
+                batch.push_back(&request);
+            }
+            m_fullVectors->BatchReadFile(batch.data(), static_cast<std::uint32_t>(batch.size()));
+
+            for (auto request : batch)
+            {
+                BasicResult* res = (BasicResult*)(request->m_payload);
+                if (!request->m_success)
+                {
+                    // A quantized distance is not comparable with the reranked ones.
+                    LOG(Helper::LogLevel::LL_Error, "Failed to read full vector %d for rerank.\n", res->VID);
+                    res->Dist = MaxDist;
+                    continue;
+                }
+
+                const void* fullVector = request->m_buffer + (PageSize + vectorBytes * res->VID - request->m_offset);
+                switch (m_fullVectorType)
+                {
+#define DefineVectorValueType(Name, Type) \
+                case VectorValueType::Name: \
+                    res->Dist = COMMON::DistanceUtils::ComputeDistance((const Type*)p_results.GetTarget(), (const Type*)fullVector, m_fullVectorDim, m_options.m_distCalcMethod); \
+                    break; \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineVectorValueType
+
+                default: break;
+                }
+            }
+            std::sort(p_results.GetResults(), p_results.GetResults() + depth, COMMON::Compare);
+        }
+#pragma endregion
+
+#pragma region Update
+        template <typename T>
+        void Index<T>::InitUpdate()
+        {
+            if (m_deletedID.R() == 0) m_deletedID.Initialize(m_extraSearcher->GetDocumentCount(), m_options.m_datasetRowsInBlock, m_options.m_datasetCapacity);
+            m_options.m_vectorSize = m_deletedID.R();
+            m_extraSearcher->SetDeletedID(&m_deletedID);
+            m_extraSearcher->ExtendPostings(m_index->GetNumSamples());
+            m_postingSizeLimit = static_cast<int>((static_cast<size_t>(m_options.m_postingPageLimit) << PageSizeEx) / (sizeof(int) + sizeof(T) * m_options.m_dim));
+            if (m_options.m_updateThreadNum > 0) m_splitThreadPool.init(m_options.m_updateThreadNum);
+        }
+
+        template <typename T>
+        void Index<T>::SelectReplicas(const T* p_vector, std::vector<SizeType>& p_heads) const
+        {
+            COMMON::QueryResultSet<T> query(p_vector, m_options.m_internalResultNum);
+            m_index->SearchIndex(query);
+
+            p_heads.clear();
+            for (int i = 0; i < m_options.m_internalResultNum && (int)p_heads.size() < m_options.m_replicaCount; ++i)
+            {
+                auto res = query.GetResult(i);
+                if (res->VID == -1) break;
+
+                // Same RNG rule as the posting build: skip heads closer to an already selected head than to the vector.
+                bool rngAccepted = true;
+                for (SizeType head : p_heads)
+                {
+                    float nnDist = m_index->ComputeDistance(m_index->GetSample(res->VID), m_index->GetSample(head));
+                    if (m_options.m_rngFactor * nnDist < res->Dist)
+                    {
+                        rngAccepted = false;
+                        break;
+                    }
+                }
+                if (rngAccepted) p_heads.push_back(res->VID);
+            }
+        }
+
+        template <typename T>
+        SizeType Index<T>::SearchNearestHead(const T* p_vector, float& p_dist) const
+        {
+            COMMON::QueryResultSet<T> query(p_vector, 1);
+            m_index->SearchIndex(query);
+            p_dist = query.GetResult(0)->Dist;
+            return query.GetResult(0)->VID;
+        }
+
+        template <typename T>
+        void Index<T>::QueueSplit(SizeType p_headID)
+        {
+            if (m_options.m_updateThreadNum <= 0) {
+                Split(p_headID);
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_splitLock);
+                if (!m_splitList.insert(p_headID).second) return;
+            }
+            m_splitThreadPool.add(new SplitJob(this, p_headID));
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::Append(SizeType p_headID, const std::string& p_records)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_postingLocks[p_headID]);
+                if (!m_extraSearcher->AppendPosting(p_headID, p_records)) {
+                    LOG(Helper::LogLevel::LL_Error, "Failed to append to posting %d!\n", p_headID);
+                    return ErrorCode::Fail;
+                }
+            }
+            if (m_extraSearcher->GetPostingSize(p_headID) > m_postingSizeLimit) QueueSplit(p_headID);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::Split(SizeType p_headID)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_splitLock);
+                m_splitList.erase(p_headID);
+            }
+
+            DimensionType dim = m_options.m_dim;
+            size_t vectorInfoSize = sizeof(int) + sizeof(T) * dim;
+            const int maxAttempts = 3;
+            for (int attempt = 0; attempt < maxAttempts; attempt++) {
+                std::string posting;
+                SizeType count;
+                COMMON::Dataset<T> data;
+                SizeType newCenter;
+                const T* headVector = (const T*)m_index->GetSample(p_headID);
+                {
+                    std::lock_guard<std::mutex> lock(m_postingLocks[p_headID]);
+                    if (!m_index->ContainSample(p_headID)) return ErrorCode::Success;
+                    if (!m_extraSearcher->ReadPosting(p_headID, posting)) return ErrorCode::Fail;
+
+                    count = static_cast<SizeType>(posting.size() / vectorInfoSize);
+                    if (count <= m_postingSizeLimit) {
+                        // Deleted vectors made enough room, just drop them.
+                        if (count < m_extraSearcher->GetPostingSize(p_headID)) m_extraSearcher->OverridePosting(p_headID, posting);
+                        return ErrorCode::Success;
+                    }
+                }
+
+                data.Initialize(count, dim, count, count + 1);
+                std::vector<SizeType> localIndices(count);
+                for (SizeType i = 0; i < count; i++) {
+                    std::memcpy((void*)data[i], posting.data() + i * vectorInfoSize + sizeof(int), sizeof(T) * dim);
+                    localIndices[i] = i;
+                }
+
+                COMMON::KmeansArgs<T> args(2, dim, count, 1, m_options.m_distCalcMethod, m_pQuantizer);
+                if (COMMON::KmeansClustering(data, localIndices, 0, count, args, count) <= 1) {
+                    LOG(Helper::LogLevel::LL_Warning, "Cannot split posting %d with %d vectors!\n", p_headID, count);
+                    return ErrorCode::Fail;
+                }
+
+                // The cluster closer to the old head keeps it, the other one is promoted to a new head.
+                int keep = (m_fComputeDistance(headVector, data[args.clusterIdx[0]], dim) <= m_fComputeDistance(headVector, data[args.clusterIdx[1]], dim)) ? 0 : 1;
+                newCenter = args.clusterIdx[1 - keep];
+                const T* newHeadVector = data[newCenter];
+                if (m_fComputeDistance(headVector, newHeadVector, dim) <= 1e-6) {
+                    LOG(Helper::LogLevel::LL_Warning, "Cannot split posting %d: new head is a duplicate of the old one!\n", p_headID);
+                    return ErrorCode::Fail;
+                }
+                int newHeadVID = *(reinterpret_cast<const int*>(posting.data() + newCenter * vectorInfoSize));
+
+                // Reassign every vector to the nearest of the two heads, or to another head which is even closer.
+                // The head searches run without the posting lock, so inserts into this posting go on meanwhile.
+                std::vector<std::pair<SizeType, std::string>> reassigns;
+                std::string keepPosting, newPosting;
+                for (SizeType i = 0; i < count; i++) {
+                    if (i == newCenter) continue;
+
+                    const char* record = posting.data() + i * vectorInfoSize;
+                    float headDist = m_fComputeDistance(data[i], headVector, dim);
+                    float newHeadDist = m_fComputeDistance(data[i], newHeadVector, dim);
+                    float nearestDist;
+                    SizeType nearest = SearchNearestHead(data[i], nearestDist);
+                    if (nearest != -1 && nearest != p_headID && nearestDist < min(headDist, newHeadDist))
+                        reassigns.emplace_back(nearest, std::string(record, vectorInfoSize));
+                    else if (headDist <= newHeadDist)
+                        keepPosting.append(record, vectorInfoSize);
+                    else
+                        newPosting.append(record, vectorInfoSize);
+                }
+
+                SizeType newHeadID = -1;
+                {
+                    std::lock_guard<std::mutex> lock(m_postingLocks[p_headID]);
+                    // Appends only add to the end. If anything else rewrote the posting, or merged the head away,
+                    // the split starts over from the current posting.
+                    std::string current;
+                    if (!m_index->ContainSample(p_headID)) return ErrorCode::Success;
+                    if (!m_extraSearcher->ReadPosting(p_headID, current)) return ErrorCode::Fail;
+                    if (current.size() < posting.size() || current.compare(0, posting.size(), posting) != 0) continue;
+
+                    // Records appended since go to the closer of the two heads.
+                    for (size_t offset = posting.size(); offset + vectorInfoSize <= current.size(); offset += vectorInfoSize) {
+                        const char* record = current.data() + offset;
+                        const T* vector = reinterpret_cast<const T*>(record + sizeof(int));
+                        if (m_fComputeDistance(vector, headVector, dim) <= m_fComputeDistance(vector, newHeadVector, dim))
+                            keepPosting.append(record, vectorInfoSize);
+                        else
+                            newPosting.append(record, vectorInfoSize);
+                    }
+
+                    {
+                        std::unique_lock<std::shared_timed_mutex> headLock(m_headLock);
+                        newHeadID = m_index->GetNumSamples();
+                        if (newHeadID >= m_translateMapCapacity) {
+                            SizeType capacity = max(newHeadID + 1, m_translateMapCapacity * 2);
+                            std::shared_ptr<std::uint64_t> translateMap(new std::uint64_t[capacity], std::default_delete<std::uint64_t[]>());
+                            std::memcpy(translateMap.get(), m_vectorTranslateMap.get(), sizeof(std::uint64_t) * newHeadID);
+                            m_vectorTranslateMap = translateMap;
+                            m_translateMapCapacity = capacity;
+                        }
+                        (m_vectorTranslateMap.get())[newHeadID] = static_cast<std::uint64_t>(newHeadVID);
+
+                        // The new posting has to exist before the head becomes searchable.
+                        m_extraSearcher->ExtendPostings(newHeadID + 1);
+                        m_extraSearcher->OverridePosting(newHeadID, newPosting);
+                        if (m_index->AddIndex(newHeadVector, 1, dim, nullptr, false, true) != ErrorCode::Success) {
+                            LOG(Helper::LogLevel::LL_Error, "Failed to add new head for posting %d!\n", p_headID);
+                            return ErrorCode::Fail;
+                        }
+                    }
+                    m_extraSearcher->OverridePosting(p_headID, keepPosting);
+                }
+
+                for (auto& reassign : reassigns) Append(reassign.first, reassign.second);
+
+                LOG(Helper::LogLevel::LL_Debug, "Split posting %d into %d(%d) and %d(%d), reassigned %d\n", p_headID,
+                    p_headID, static_cast<int>(keepPosting.size() / vectorInfoSize), newHeadID, static_cast<int>(newPosting.size() / vectorInfoSize), static_cast<int>(reassigns.size()));
+
+                if (keepPosting.size() / vectorInfoSize > m_postingSizeLimit) QueueSplit(p_headID);
+                if (newPosting.size() / vectorInfoSize > m_postingSizeLimit) QueueSplit(newHeadID);
+                return ErrorCode::Success;
+            }
+            LOG(Helper::LogLevel::LL_Warning, "Posting %d kept changing during %d split attempts, split it later.\n", p_headID, maxAttempts);
+            QueueSplit(p_headID);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::Merge(SizeType p_headID)
+        {
+            DimensionType dim = m_options.m_dim;
+            size_t vectorInfoSize = sizeof(int) + sizeof(T) * dim;
+            std::string posting;
+            {
+                std::lock_guard<std::mutex> lock(m_postingLocks[p_headID]);
+                if (!m_index->ContainSample(p_headID) || m_index->GetNumSamples() - m_index->GetNumDeleted() <= 1) return ErrorCode::Success;
+                if (!m_extraSearcher->ReadPosting(p_headID, posting)) return ErrorCode::Fail;
+                if (posting.size() / vectorInfoSize >= m_options.m_mergeThreshold) return ErrorCode::Success;
+
+                // The head vector itself only lives in the head index, move it into the postings as well.
+                int headVID;
+                {
+                    std::shared_lock<std::shared_timed_mutex> headLock(m_headLock);
+                    headVID = static_cast<int>((m_vectorTranslateMap.get())[p_headID]);
+                }
+                if (!m_deletedID.Contains(headVID)) {
+                    posting.append((const char*)&headVID, sizeof(int));
+                    posting.append((const char*)m_index->GetSample(p_headID), sizeof(T) * dim);
+                }
+
+                if (m_index->DeleteIndex(p_headID) != ErrorCode::Success) return ErrorCode::Fail;
+                m_extraSearcher->OverridePosting(p_headID, std::string());
+            }
+
+            std::vector<SizeType> heads;
+            SizeType count = static_cast<SizeType>(posting.size() / vectorInfoSize);
+            for (SizeType i = 0; i < count; i++) {
+                std::string record = posting.substr(i * vectorInfoSize, vectorInfoSize);
+                SelectReplicas(reinterpret_cast<const T*>(record.data() + sizeof(int)), heads);
+                for (SizeType head : heads) Append(head, record);
+            }
+            LOG(Helper::LogLevel::LL_Debug, "Merge posting %d, reassigned %d\n", p_headID, count);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized)
+        {
+            if (!m_bReady || m_extraSearcher == nullptr) return ErrorCode::EmptyIndex;
+            if (p_data == nullptr || p_vectorNum == 0 || p_dimension == 0) return ErrorCode::EmptyData;
+            if (p_dimension != GetFeatureDim()) return ErrorCode::DimensionSizeMismatch;
+            if (m_pQuantizer) {
+                LOG(Helper::LogLevel::LL_Error, "Updating SPANN index with quantized postings is not supported!\n");
+                return ErrorCode::Fail;
+            }
+
+            const T* vectors = (const T*)p_data;
+            std::unique_ptr<T[]> normalizedVectors;
+            if (m_options.m_distCalcMethod == DistCalcMethod::Cosine && !p_normalized) {
+                normalizedVectors.reset(new T[static_cast<size_t>(p_vectorNum) * p_dimension]);
+                std::memcpy(normalizedVectors.get(), p_data, sizeof(T) * p_vectorNum * p_dimension);
+                COMMON::Utils::BatchNormalize(normalizedVectors.get(), p_vectorNum, p_dimension, COMMON::Utils::GetBase<T>(), m_options.m_iSSDNumberOfThreads);
+                vectors = normalizedVectors.get();
+            }
+
+            SizeType begin, end;
+            {
+                std::lock_guard<std::mutex> lock(m_dataAddLock);
+
+                begin = m_options.m_vectorSize;
+                end = begin + p_vectorNum;
+                if (m_deletedID.AddBatch(p_vectorNum) != ErrorCode::Success) {
+                    LOG(Helper::LogLevel::LL_Error, "Memory Error: Cannot alloc space for vectors!\n");
+                    m_deletedID.SetR(begin);
+                    return ErrorCode::MemoryOverFlow;
+                }
+
+                if (m_pMetadata != nullptr) {
+                    if (p_metadataSet != nullptr) {
+                        m_pMetadata->AddBatch(*p_metadataSet);
+                        if (HasMetaMapping()) {
+                            for (SizeType i = begin; i < end; i++) {
+                                ByteArray meta = m_pMetadata->GetMetadata(i);
+                                std::string metastr((char*)meta.Data(), meta.Length());
+                                UpdateMetaMapping(metastr, i);
+                            }
+                        }
+                    }
+                    else {
+                        for (SizeType i = begin; i < end; i++) m_pMetadata->Add(ByteArray::c_empty);
+                    }
+                }
+                m_options.m_vectorSize = end;
+            }
+
+            size_t vectorInfoSize = sizeof(int) + sizeof(T) * p_dimension;
+#pragma omp parallel for schedule(dynamic)
+            for (SizeType i = 0; i < p_vectorNum; i++) {
+                const T* vector = vectors + static_cast<size_t>(i) * p_dimension;
+                int vectorID = static_cast<int>(begin + i);
+                std::string record(vectorInfoSize, '\0');
+                std::memcpy(&record[0], &vectorID, sizeof(int));
+                std::memcpy(&record[sizeof(int)], vector, sizeof(T) * p_dimension);
+
+                std::vector<SizeType> heads;
+                SelectReplicas(vector, heads);
+                for (SizeType head : heads) Append(head, record);
+            }
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::DeleteIndex(const void* p_vectors, SizeType p_vectorNum) {
+            const T* ptr_v = (const T*)p_vectors;
+#pragma omp parallel for schedule(dynamic)
+            for (SizeType i = 0; i < p_vectorNum; i++) {
+                COMMON::QueryResultSet<T> query(ptr_v + i * GetFeatureDim(), m_options.m_resultNum);
+                SearchIndex(query);
+
+                for (int j = 0; j < m_options.m_resultNum; j++) {
+                    if (query.GetResult(j)->Dist < 1e-6) {
+                        DeleteIndex(query.GetResult(j)->VID);
+                    }
+                }
+            }
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::DeleteIndex(const SizeType& p_id) {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+            if (p_id < 0 || p_id >= m_options.m_vectorSize) return ErrorCode::VectorNotFound;
+
+            if (m_deletedID.Insert(p_id)) return ErrorCode::Success;
+            return ErrorCode::VectorNotFound;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::RefineIndex(const std::vector<std::shared_ptr<Helper::DiskPriorityIO>>& p_indexStreams, IAbortOperation* p_abort)
+        {
+            if (!m_bReady || m_extraSearcher == nullptr) return ErrorCode::EmptyIndex;
+
+            // Drop deleted vectors from postings, then split oversized and merge undersized ones.
+            size_t vectorInfoSize = sizeof(int) + sizeof(T) * m_options.m_dim;
+            SizeType headCount = m_index->GetNumSamples();
+            for (SizeType i = 0; i < headCount; i++) {
+                if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
+                if (!m_index->ContainSample(i)) continue;
+
+                std::string posting;
+                int count;
+                {
+                    std::lock_guard<std::mutex> lock(m_postingLocks[i]);
+                    if (!m_extraSearcher->ReadPosting(i, posting)) return ErrorCode::Fail;
+                    count = static_cast<int>(posting.size() / vectorInfoSize);
+                    if (count < m_extraSearcher->GetPostingSize(i)) m_extraSearcher->OverridePosting(i, posting);
+                }
+                if (count > m_postingSizeLimit) Split(i);
+                else if (count < m_options.m_mergeThreshold) Merge(i);
+            }
+
+            ErrorCode ret = m_extraSearcher->CompactPostings();
+            if (ret != ErrorCode::Success) return ret;
+            if (m_pMetadata != nullptr) {
+                size_t metaStart = GetIndexFiles()->size();
+                if (p_indexStreams.size() < metaStart + 2) return ErrorCode::LackOfInputs;
+                if ((ret = m_pMetadata->SaveMetadata(p_indexStreams[metaStart], p_indexStreams[metaStart + 1])) != ErrorCode::Success) return ret;
+            }
+            return SaveIndexData(p_indexStreams);
+        }
+#pragma endregion
+
         template <typename T>
         void Index<T>::SelectHeadAdjustOptions(int p_vectorCount) {
             if (m_options.m_headVectorCount != 0) m_options.m_ratio = m_options.m_headVectorCount * 1.0 / p_vectorCount;
@@ -404,7 +1000,7 @@ namespace SPTAG
         template <typename T>
         bool Index<T>::SelectHead(std::shared_ptr<Helper::VectorSetReader>& p_reader) {
             std::shared_ptr<VectorSet> vectorset = p_reader->GetVectorSet();
-            if (m_options.m_distCalcMethod == DistCalcMethod::Cosine && !p_reader->IsNormalized())
+            if (m_options.m_distCalcMethod == DistCalcMethod::Cosine && !p_reader->IsNormalized() && !m_pQuantizer)
                 vectorset->Normalize(m_options.m_iSelectHeadNumberOfThreads);
             COMMON::Dataset<T> data(vectorset->Count(), vectorset->Dimension(), vectorset->Count(), vectorset->Count() + 1, (T*)vectorset->GetData());
             
@@ -530,9 +1126,10 @@ namespace SPTAG
             LOG(Helper::LogLevel::LL_Info, "select head time: %.2lfs\n", selectHeadTime);
 
             if (m_options.m_buildHead) {
-                auto valueType = SPTAG::COMMON::DistanceUtils::Quantizer ? SPTAG::VectorValueType::UInt8 : m_options.m_valueType;
+                auto valueType = m_pQuantizer ? SPTAG::VectorValueType::UInt8 : m_options.m_valueType;
                 m_index = SPTAG::VectorIndex::CreateInstance(m_options.m_indexAlgoType, valueType);
                 m_index->SetParameter("DistCalcMethod", SPTAG::Helper::Convert::ConvertToString(m_options.m_distCalcMethod));
+                m_index->SetQuantizer(m_pQuantizer);
                 for (const auto& iter : m_headParameters)
                 {
                     m_index->SetParameter(iter.first.c_str(), iter.second.c_str());
@@ -562,6 +1159,7 @@ namespace SPTAG
                     LOG(Helper::LogLevel::LL_Error, "Cannot load head index from %s!\n", (m_options.m_indexDirectory + FolderSep + m_options.m_headIndexFolder).c_str());
                     return ErrorCode::Fail;
                 }
+                if (m_pQuantizer) m_index->SetQuantizer(m_pQuantizer);
                 if (!CheckHeadIndexType()) return ErrorCode::Fail;
 
                 m_extraSearcher.reset(new ExtraFullGraphSearcher<T>());
@@ -570,11 +1168,17 @@ namespace SPTAG
                         LOG(Helper::LogLevel::LL_Error, "BuildSSDIndex Failed!\n");
                         return ErrorCode::Fail;
                     }
+                    // Quantized postings are reranked against the full precision vectors kept on SSD.
+                    if (m_pQuantizer && m_options.m_rerank > 0 && BuildFullVectors() != ErrorCode::Success) {
+                        LOG(Helper::LogLevel::LL_Error, "Build full vector file Failed!\n");
+                        return ErrorCode::Fail;
+                    }
                 }
                 if (!m_extraSearcher->LoadIndex(m_options)) {
                     LOG(Helper::LogLevel::LL_Error, "Cannot Load SSDIndex!\n");
                     return ErrorCode::Fail;
                 }
+                if (LoadFullVectors() != ErrorCode::Success) return ErrorCode::Fail;
 
                 m_vectorTranslateMap.reset(new std::uint64_t[m_index->GetNumSamples()], std::default_delete<std::uint64_t[]>());
                 std::shared_ptr<Helper::DiskPriorityIO> ptr = SPTAG::f_createIO();
@@ -583,6 +1187,8 @@ namespace SPTAG
                     return ErrorCode::Fail;
                 }
                 IOBINARY(ptr, ReadBinary, sizeof(std::uint64_t) * m_index->GetNumSamples(), (char*)(m_vectorTranslateMap.get()));
+                m_translateMapCapacity = m_index->GetNumSamples();
+                InitUpdate();
             }
             auto t4 = std::chrono::high_resolution_clock::now();
             double buildSSDTime = std::chrono::duration_cast<std::chrono::seconds>(t4 - t3).count();
@@ -603,7 +1209,7 @@ namespace SPTAG
         template <typename T>
         ErrorCode Index<T>::BuildIndex(bool p_normalized) 
         {
-            SPTAG::VectorValueType valueType = SPTAG::COMMON::DistanceUtils::Quantizer ? SPTAG::VectorValueType::UInt8 : m_options.m_valueType;
+            SPTAG::VectorValueType valueType = m_pQuantizer ? SPTAG::VectorValueType::UInt8 : m_options.m_valueType;
             std::shared_ptr<Helper::ReaderOptions> vectorOptions(new Helper::ReaderOptions(valueType, m_options.m_dim, m_options.m_vectorType, m_options.m_vectorDelimiter, p_normalized));
             auto vectorReader = Helper::VectorSetReader::CreateInstance(vectorOptions);
             if (ErrorCode::Success != vectorReader->LoadFile(m_options.m_vectorPath))
@@ -619,12 +1225,12 @@ namespace SPTAG
         {
             if (p_data == nullptr || p_vectorNum == 0 || p_dimension == 0) return ErrorCode::EmptyData;
 
-            if (m_options.m_distCalcMethod == DistCalcMethod::Cosine && !p_normalized) {
+            if (m_options.m_distCalcMethod == DistCalcMethod::Cosine && !p_normalized && !m_pQuantizer) {
                 COMMON::Utils::BatchNormalize((T*)p_data, p_vectorNum, p_dimension, COMMON::Utils::GetBase<T>(), m_options.m_iSSDNumberOfThreads);
             }
             std::shared_ptr<VectorSet> vectorSet(new BasicVectorSet(ByteArray((std::uint8_t*)p_data, p_vectorNum * p_dimension * sizeof(T), false),
                 GetEnumValueType<T>(), p_dimension, p_vectorNum));
-            SPTAG::VectorValueType valueType = SPTAG::COMMON::DistanceUtils::Quantizer ? SPTAG::VectorValueType::UInt8 : m_options.m_valueType;
+            SPTAG::VectorValueType valueType = m_pQuantizer ? SPTAG::VectorValueType::UInt8 : m_options.m_valueType;
             std::shared_ptr<Helper::VectorSetReader> vectorReader(new Helper::MemoryVectorReader(std::make_shared<Helper::ReaderOptions>(valueType, p_dimension, VectorFileType::DEFAULT, m_options.m_vectorDelimiter, m_options.m_iSSDNumberOfThreads, true),
                 vectorSet));
             
@@ -654,8 +1260,7 @@ namespace SPTAG
                 m_options.SetParameter(p_section, p_param, p_value);
             }
             if (SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "DistCalcMethod")) {
-                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_options.m_distCalcMethod);
-                m_iBaseSquare = (m_options.m_distCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+                BindDistanceFunction();
             }
             return ErrorCode::Success;
         }
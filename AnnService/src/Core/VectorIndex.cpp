@@ -6,6 +6,7 @@
 #include "inc/Helper/StringConvert.h"
 #include "inc/Helper/SimpleIniReader.h"
 #include "inc/Helper/ConcurrentSet.h"
+#include "inc/Helper/MemoryMap.h"
 
 #include "inc/Core/BKT/Index.h"
 #include "inc/Core/KDT/Index.h"
@@ -145,9 +146,9 @@ std::shared_ptr<std::vector<std::uint64_t>> VectorIndex::CalculateBufferSize() c
         ret->push_back(metasize.second);
     }
 
-    if (SPTAG::COMMON::DistanceUtils::Quantizer)
+    if (m_pQuantizer)
     {
-        ret->push_back(SPTAG::COMMON::DistanceUtils::Quantizer->BufferSize());
+        ret->push_back(m_pQuantizer->BufferSize());
     }
     return std::move(ret);
 }
@@ -184,7 +185,7 @@ VectorIndex::SaveIndexConfig(std::shared_ptr<Helper::DiskPriorityIO> p_configOut
         IOSTRING(p_configOut, WriteString, "\n");
     }
 
-    if (SPTAG::COMMON::DistanceUtils::Quantizer)
+    if (m_pQuantizer)
     {
         IOSTRING(p_configOut, WriteString, "[Quantizer]\n");
         IOSTRING(p_configOut, WriteString, ("QuantizerFilePath=" + m_sQuantizerFile + "\n").c_str());
@@ -272,8 +273,8 @@ VectorIndex::SaveIndex(std::string& p_config, const std::vector<ByteArray>& p_in
     }
     if (m_pMetadata != nullptr) metaStart += 2;
     
-    if (ErrorCode::Success == ret && SPTAG::COMMON::DistanceUtils::Quantizer && p_indexStreams.size() > metaStart) {
-        ret = SPTAG::COMMON::DistanceUtils::Quantizer->SaveQuantizer(p_indexStreams[metaStart]);
+    if (ErrorCode::Success == ret && m_pQuantizer && p_indexStreams.size() > metaStart) {
+        ret = m_pQuantizer->SaveQuantizer(p_indexStreams[metaStart]);
     }
     return ret;
 }
@@ -322,7 +323,7 @@ VectorIndex::SaveIndex(const std::string& p_folderPath)
         indexfiles->push_back(m_sMetadataFile);
         indexfiles->push_back(m_sMetadataIndexFile);
     }
-    if (SPTAG::COMMON::DistanceUtils::Quantizer) {
+    if (m_pQuantizer) {
         indexfiles->push_back(m_sQuantizerFile);
     }
     std::vector<std::shared_ptr<Helper::DiskPriorityIO>> handles;
@@ -330,6 +331,11 @@ VectorIndex::SaveIndex(const std::string& p_folderPath)
         std::string newfile = folderPath + f;
         if (!direxists(newfile.substr(0, newfile.find_last_of(FolderSep)).c_str())) mkdir(newfile.substr(0, newfile.find_last_of(FolderSep)).c_str());
         
+        // A mapped index may be saving over the files it is mapped from, and SPANN copies its full vectors
+        // from the open file. Unlink them first so the readers keep the old contents instead of seeing the
+        // file truncated under them.
+        if (!m_mappedFiles.empty() || GetIndexAlgoType() == IndexAlgoType::SPANN) std::remove(newfile.c_str());
+
         auto ptr = SPTAG::f_createIO();
         if (ptr == nullptr || !ptr->Initialize(newfile.c_str(), std::ios::binary | std::ios::out)) return ErrorCode::FailedCreateFile;
         handles.push_back(std::move(ptr));
@@ -347,8 +353,8 @@ VectorIndex::SaveIndex(const std::string& p_folderPath)
     }
     if (m_pMetadata != nullptr) metaStart += 2;
 
-    if (ErrorCode::Success == ret && SPTAG::COMMON::DistanceUtils::Quantizer) {
-        ret = SPTAG::COMMON::DistanceUtils::Quantizer->SaveQuantizer(handles[metaStart]);
+    if (ErrorCode::Success == ret && m_pQuantizer) {
+        ret = m_pQuantizer->SaveQuantizer(handles[metaStart]);
     }
     return ret;
 }
@@ -388,8 +394,8 @@ VectorIndex::SaveIndexToFile(const std::string& p_file, IAbortOperation* p_abort
             if (ErrorCode::Success == ret && m_pMetadata != nullptr) ret = m_pMetadata->SaveMetadata(fp, fp);
         }
 
-        if (ErrorCode::Success == ret && SPTAG::COMMON::DistanceUtils::Quantizer) {
-            ret = SPTAG::COMMON::DistanceUtils::Quantizer->SaveQuantizer(fp);
+        if (ErrorCode::Success == ret && m_pQuantizer) {
+            ret = m_pQuantizer->SaveQuantizer(fp);
         }
     }
     if (ErrorCode::Success == ret) IOBINARY(fp, WriteBinary, sizeof(configSize), (char*)&configSize, 0);
@@ -430,6 +436,20 @@ VectorIndex::SearchIndex(const void* p_vector, int p_vectorCount, int p_neighbor
 }
 
 
+ErrorCode
+VectorIndex::SearchIndex(QueryResult* p_queries, int p_queryCount, bool p_searchDeleted, int p_threadNum) const {
+    std::atomic<ErrorCode> ret(ErrorCode::Success);
+    int threads = (p_threadNum > 0) ? p_threadNum : omp_get_max_threads();
+#pragma omp parallel for num_threads(threads) schedule(dynamic,10)
+    for (int i = 0; i < p_queryCount; i++) {
+        ErrorCode queryRet = SearchIndex(p_queries[i], p_searchDeleted);
+        ErrorCode expected = ErrorCode::Success;
+        if (queryRet != ErrorCode::Success) ret.compare_exchange_strong(expected, queryRet);
+    }
+    return ret.load();
+}
+
+
 ErrorCode 
 VectorIndex::AddIndex(std::shared_ptr<VectorSet> p_vectorSet, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized) {
     if (nullptr == p_vectorSet || p_vectorSet->GetValueType() != GetVectorValueType())
@@ -512,20 +532,22 @@ const void* VectorIndex::GetSample(ByteArray p_meta, bool& deleteFlag)
 
 
 ErrorCode
-VectorIndex::LoadQuantizer(std::string p_quantizerFile)
+VectorIndex::LoadQuantizer(const std::string& p_quantizerFile)
 {
     auto ptr = SPTAG::f_createIO();
-    if (!ptr->Initialize(p_quantizerFile.c_str(), std::ios::binary | std::ios::in))
+    if (ptr == nullptr || !ptr->Initialize(p_quantizerFile.c_str(), std::ios::binary | std::ios::in))
     {
         LOG(Helper::LogLevel::LL_Error, "Failed to read quantizer file.\n");
         return ErrorCode::FailedOpenFile;
     }
-    auto code = SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr);
+    std::shared_ptr<COMMON::IQuantizer> quantizer;
+    auto code = SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr, quantizer);
     if (code != ErrorCode::Success)
     {
         LOG(Helper::LogLevel::LL_Error, "Failed to load quantizer.\n");
         return code;
     }
+    SetQuantizer(quantizer);
     return ErrorCode::Success;
 }
 
@@ -582,7 +604,7 @@ VectorIndex::CreateInstance(IndexAlgoType p_algo, VectorValueType p_valuetype)
 
 
 ErrorCode
-VectorIndex::LoadIndex(const std::string& p_loaderFilePath, std::shared_ptr<VectorIndex>& p_vectorIndex)
+VectorIndex::LoadIndex(const std::string& p_loaderFilePath, std::shared_ptr<VectorIndex>& p_vectorIndex, bool p_memoryMap)
 {
     std::string folderPath(p_loaderFilePath);
     if (!folderPath.empty() && *(folderPath.rbegin()) != FolderSep) folderPath += FolderSep;
@@ -609,6 +631,25 @@ VectorIndex::LoadIndex(const std::string& p_loaderFilePath, std::shared_ptr<Vect
     if (iniReader.DoesSectionExist("Quantizer")) {
         indexfiles->push_back(p_vectorIndex->m_sQuantizerFile);
     }
+
+    if (p_memoryMap && (algoType == IndexAlgoType::BKT || algoType == IndexAlgoType::KDT)) {
+        std::vector<ByteArray> blobs;
+        for (std::string& f : *indexfiles) {
+            ByteArray blob = Helper::MapFile(folderPath + f);
+            if (blob.Data() == nullptr) {
+                LOG(Helper::LogLevel::LL_Warning, "Cannot map file %s, load a private copy of the index instead.\n", (folderPath + f).c_str());
+                break;
+            }
+            blobs.push_back(std::move(blob));
+        }
+
+        if (blobs.size() == indexfiles->size()) {
+            // Set before loading so the index knows its data is mapped and keeps it in place.
+            p_vectorIndex->m_mappedFiles = std::move(blobs);
+            return p_vectorIndex->LoadIndexFromMemory(iniReader, p_vectorIndex->m_mappedFiles);
+        }
+    }
+
     std::vector<std::shared_ptr<Helper::DiskPriorityIO>> handles;
     for (std::string& f : *indexfiles) {
         auto ptr = SPTAG::f_createIO();
@@ -640,8 +681,9 @@ VectorIndex::LoadIndex(const std::string& p_loaderFilePath, std::shared_ptr<Vect
         metaStart += 2;
     }
     if (iniReader.DoesSectionExist("Quantizer")) {
-        ret = SPTAG::COMMON::IQuantizer::LoadIQuantizer(handles[metaStart]);
-        if (ret != ErrorCode::Success) return ret;
+        std::shared_ptr<COMMON::IQuantizer> quantizer;
+        if ((ret = SPTAG::COMMON::IQuantizer::LoadIQuantizer(handles[metaStart], quantizer)) != ErrorCode::Success) return ret;
+        p_vectorIndex->SetQuantizer(quantizer);
     }
     p_vectorIndex->m_bReady = true;
     return ErrorCode::Success;
@@ -697,8 +739,9 @@ VectorIndex::LoadIndexFromFile(const std::string& p_file, std::shared_ptr<Vector
 
     if (iniReader.DoesSectionExist("Quantizer"))
     {
-        ret = SPTAG::COMMON::IQuantizer::LoadIQuantizer(fp);
-        if (ret != ErrorCode::Success) return ret;
+        std::shared_ptr<COMMON::IQuantizer> quantizer;
+        if ((ret = SPTAG::COMMON::IQuantizer::LoadIQuantizer(fp, quantizer)) != ErrorCode::Success) return ret;
+        p_vectorIndex->SetQuantizer(quantizer);
     }
     p_vectorIndex->m_bReady = true;
     return ErrorCode::Success;
@@ -720,37 +763,46 @@ VectorIndex::LoadIndex(const std::string& p_config, const std::vector<ByteArray>
     ErrorCode ret = ErrorCode::Success;
     if ((p_vectorIndex->LoadIndexConfig(iniReader)) != ErrorCode::Success) return ret;
 
-    if ((ret = p_vectorIndex->LoadIndexDataFromMemory(p_indexBlobs)) != ErrorCode::Success) return ret;
+    return p_vectorIndex->LoadIndexFromMemory(iniReader, p_indexBlobs);
+}
+
+
+ErrorCode
+VectorIndex::LoadIndexFromMemory(Helper::IniReader& p_reader, const std::vector<ByteArray>& p_indexBlobs)
+{
+    ErrorCode ret = ErrorCode::Success;
+    if ((ret = LoadIndexDataFromMemory(p_indexBlobs)) != ErrorCode::Success) return ret;
 
-    size_t metaStart = p_vectorIndex->BufferSize()->size();
-    if (iniReader.DoesSectionExist("MetaData") && p_indexBlobs.size() >= metaStart + 2)
+    size_t metaStart = BufferSize()->size();
+    if (p_reader.DoesSectionExist("MetaData") && p_indexBlobs.size() >= metaStart + 2)
     {
         ByteArray pMetaIndex = p_indexBlobs[metaStart + 1];
-        p_vectorIndex->SetMetadata(new MemMetadataSet(p_indexBlobs[metaStart],
+        SetMetadata(new MemMetadataSet(p_indexBlobs[metaStart],
             ByteArray(pMetaIndex.Data() + sizeof(SizeType), pMetaIndex.Length() - sizeof(SizeType), false),
             *((SizeType*)pMetaIndex.Data()), 
-            p_vectorIndex->m_iDataBlockSize, p_vectorIndex->m_iDataCapacity, p_vectorIndex->m_iMetaRecordSize));
+            m_iDataBlockSize, m_iDataCapacity, m_iMetaRecordSize));
 
-        if (!(p_vectorIndex->GetMetadata()->Available()))
+        if (!(GetMetadata()->Available()))
         {
             LOG(Helper::LogLevel::LL_Error, "Error: Failed to load metadata.\n");
             return ErrorCode::Fail;
         }
 
-        if (iniReader.GetParameter("MetaData", "MetaDataToVectorIndex", std::string()) == "true")
+        if (p_reader.GetParameter("MetaData", "MetaDataToVectorIndex", std::string()) == "true")
         {
-            p_vectorIndex->BuildMetaMapping();
+            BuildMetaMapping();
         }
         metaStart += 2;
     }
-    if (iniReader.DoesSectionExist("Quantizer") && p_indexBlobs.size() > metaStart)
+    if (p_reader.DoesSectionExist("Quantizer") && p_indexBlobs.size() > metaStart)
     {
         std::shared_ptr<Helper::DiskPriorityIO> ptr(new Helper::SimpleBufferIO());
         if (ptr == nullptr || !ptr->Initialize((char*)p_indexBlobs[metaStart].Data(), std::ios::binary | std::ios::in, p_indexBlobs[metaStart].Length())) return ErrorCode::EmptyDiskIO;
-        ret = SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr);
-        if (ret != ErrorCode::Success) return ret;
+        std::shared_ptr<COMMON::IQuantizer> quantizer;
+        if ((ret = SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr, quantizer)) != ErrorCode::Success) return ret;
+        SetQuantizer(quantizer);
     }
-    p_vectorIndex->m_bReady = true;
+    m_bReady = true;
     return ErrorCode::Success;
 }
 
@@ -889,10 +941,10 @@ void VectorIndex::ApproximateRNG(std::shared_ptr<VectorSet>& fullVectors, std::u
                     }
                     
                     void* reconstructed_vector = nullptr;
-                    if (SPTAG::COMMON::DistanceUtils::Quantizer)
+                    if (m_pQuantizer)
                     {
-                        reconstructed_vector = _mm_malloc(SPTAG::COMMON::DistanceUtils::Quantizer->ReconstructSize(), ALIGN_SPTAG);
-                        SPTAG::COMMON::DistanceUtils::Quantizer->ReconstructVector((const uint8_t*)fullVectors->GetVector(fullID), reconstructed_vector);
+                        reconstructed_vector = _mm_malloc(m_pQuantizer->ReconstructSize(), ALIGN_SPTAG);
+                        m_pQuantizer->ReconstructVector((const uint8_t*)fullVectors->GetVector(fullID), reconstructed_vector);
                         resultSet.SetTarget(reconstructed_vector);
                     }
                     else
@@ -0,0 +1,108 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Helper/Epoch.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SPTAG
+{
+namespace Helper
+{
+
+// Epoch pinned by one thread, 0 while it holds no guard. Aligned to its own cache line so that readers on
+// different cores do not share one.
+struct alignas(64) EpochSlot
+{
+    std::atomic<std::uint64_t> m_epoch{ 0 };
+    std::atomic<bool> m_inUse{ false };
+    int m_depth = 0;
+};
+
+} // namespace Helper
+} // namespace SPTAG
+
+using namespace SPTAG;
+
+namespace
+{
+    std::atomic<std::uint64_t> g_epoch(1);
+
+    // Slots are never freed, so pointers to them stay valid; a thread gives its slot back when it exits.
+    std::mutex g_slotLock;
+    std::deque<Helper::EpochSlot> g_slots;
+
+    struct ThreadSlot
+    {
+        Helper::EpochSlot* m_slot = nullptr;
+
+        ~ThreadSlot()
+        {
+            if (m_slot == nullptr) return;
+            m_slot->m_epoch.store(0);
+            m_slot->m_depth = 0;
+            m_slot->m_inUse.store(false);
+        }
+    };
+
+    thread_local ThreadSlot t_slot;
+
+    Helper::EpochSlot* AcquireSlot()
+    {
+        if (t_slot.m_slot != nullptr) return t_slot.m_slot;
+
+        std::lock_guard<std::mutex> lock(g_slotLock);
+        for (Helper::EpochSlot& slot : g_slots)
+        {
+            bool free = false;
+            if (slot.m_inUse.compare_exchange_strong(free, true))
+            {
+                t_slot.m_slot = &slot;
+                return &slot;
+            }
+        }
+        g_slots.emplace_back();
+        g_slots.back().m_inUse.store(true);
+        t_slot.m_slot = &g_slots.back();
+        return t_slot.m_slot;
+    }
+}
+
+
+Helper::EpochGuard::EpochGuard()
+    : m_slot(AcquireSlot())
+{
+    if (m_slot->m_depth++ == 0) m_slot->m_epoch.store(g_epoch.load());
+}
+
+
+Helper::EpochGuard::~EpochGuard()
+{
+    if (--m_slot->m_depth == 0) m_slot->m_epoch.store(0);
+}
+
+
+void
+Helper::WaitForReaders()
+{
+    // A reader that pinned an epoch below target may have loaded the old pointer. One that pins target or
+    // later read g_epoch after the increment, so it also sees the pointer published before this call.
+    std::uint64_t target = g_epoch.fetch_add(1) + 1;
+
+    std::vector<EpochSlot*> slots;
+    {
+        std::lock_guard<std::mutex> lock(g_slotLock);
+        for (EpochSlot& slot : g_slots) slots.push_back(&slot);
+    }
+
+    for (EpochSlot* slot : slots)
+    {
+        std::uint64_t epoch;
+        while ((epoch = slot->m_epoch.load()) != 0 && epoch < target) std::this_thread::yield();
+    }
+}
@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Helper/MemoryMap.h"
+#include "inc/Core/Common.h"
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+using namespace SPTAG;
+
+ByteArray
+Helper::MapFile(const std::string& p_filePath)
+{
+#ifndef _MSC_VER
+    int fd = open(p_filePath.c_str(), O_RDONLY);
+    if (fd < 0) return ByteArray::c_empty;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return ByteArray::c_empty;
+    }
+
+    std::size_t length = static_cast<std::size_t>(st.st_size);
+    void* view = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return ByteArray::c_empty;
+
+    std::shared_ptr<std::uint8_t> holder(static_cast<std::uint8_t*>(view), [length](std::uint8_t* p) { munmap(p, length); });
+#else
+    HANDLE file = CreateFileA(p_filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return ByteArray::c_empty;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+    {
+        CloseHandle(file);
+        return ByteArray::c_empty;
+    }
+
+    std::size_t length = static_cast<std::size_t>(size.QuadPart);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return ByteArray::c_empty;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == NULL) return ByteArray::c_empty;
+
+    std::shared_ptr<std::uint8_t> holder(static_cast<std::uint8_t*>(view), [](std::uint8_t* p) { UnmapViewOfFile(p); });
+#endif
+    return ByteArray(holder.get(), length, holder);
+}
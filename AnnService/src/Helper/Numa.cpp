@@ -0,0 +1,112 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Helper/Numa.h"
+#include "inc/Core/Common.h"
+
+#include <fstream>
+
+#ifndef _MSC_VER
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace SPTAG;
+
+namespace
+{
+    thread_local int t_numaNode = -1;
+
+    // Parses a sysfs list such as "0-3,8-11".
+    std::vector<int> ReadIdList(const std::string& p_path)
+    {
+        std::vector<int> ids;
+        std::ifstream input(p_path);
+        std::string list;
+        if (!input.is_open() || !std::getline(input, list)) return ids;
+
+        std::size_t pos = 0;
+        while (pos < list.size()) {
+            std::size_t end = list.find(',', pos);
+            if (end == std::string::npos) end = list.size();
+            std::string range = list.substr(pos, end - pos);
+            std::size_t dash = range.find('-');
+            try {
+                int first = std::stoi(range.substr(0, dash));
+                int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+                for (int id = first; id <= last; id++) ids.push_back(id);
+            }
+            catch (const std::exception&) {
+                return std::vector<int>();
+            }
+            pos = end + 1;
+        }
+        return ids;
+    }
+}
+
+int
+Helper::NumaNodeCount()
+{
+#ifndef _MSC_VER
+    static const int count = []() {
+        std::vector<int> nodes = ReadIdList("/sys/devices/system/node/online");
+        return nodes.empty() ? 1 : nodes.back() + 1;
+    }();
+    return count;
+#else
+    return 1;
+#endif
+}
+
+bool
+Helper::BindThreadToNumaNode(int p_node)
+{
+    if (p_node < 0 || p_node >= NumaNodeCount()) return false;
+    if (t_numaNode == p_node) return true;
+#ifndef _MSC_VER
+    std::vector<int> cpus = ReadIdList("/sys/devices/system/node/node" + std::to_string(p_node) + "/cpulist");
+    if (cpus.empty()) return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) {
+        LOG(Helper::LogLevel::LL_Warning, "Cannot bind thread to NUMA node %d.\n", p_node);
+        return false;
+    }
+#endif
+    t_numaNode = p_node;
+    return true;
+}
+
+int
+Helper::CurrentNumaNode()
+{
+    return (t_numaNode < 0) ? 0 : t_numaNode;
+}
+
+bool
+Helper::SetInterleaveMemory(bool p_interleave)
+{
+#if !defined(_MSC_VER) && defined(SYS_set_mempolicy)
+    const int mpolDefault = 0, mpolInterleave = 3;
+    int nodes = NumaNodeCount();
+    if (!p_interleave) return syscall(SYS_set_mempolicy, mpolDefault, nullptr, 0) == 0;
+    if (nodes <= 1) return true;
+
+    unsigned long mask[4] = { 0 };
+    const int bitsPerWord = sizeof(unsigned long) * 8;
+    for (int node = 0; node < nodes && node < 4 * bitsPerWord; node++) mask[node / bitsPerWord] |= 1UL << (node % bitsPerWord);
+    if (syscall(SYS_set_mempolicy, mpolInterleave, mask, (unsigned long)(4 * bitsPerWord + 1)) != 0) {
+        LOG(Helper::LogLevel::LL_Warning, "Cannot interleave memory over %d NUMA nodes.\n", nodes);
+        return false;
+    }
+    return true;
+#else
+    return !p_interleave;
+#endif
+}
@@ -0,0 +1,110 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Helper/PageAllocator.h"
+#include "inc/Core/Common.h"
+
+#ifndef _MSC_VER
+#include <sys/mman.h>
+#endif
+
+using namespace SPTAG;
+
+namespace
+{
+    // Every allocation starts with this header, so FreePages knows how to release it. The caller's memory
+    // follows at c_headerSize, which keeps the ALIGN_SPTAG alignment.
+    struct PageHeader
+    {
+        std::size_t m_mappedBytes; // 0 for heap memory
+        void* m_mappedBase;
+    };
+
+    const std::size_t c_headerSize = 64;
+    const std::size_t c_hugePageSize = 2 * 1024 * 1024;
+
+#ifndef _MSC_VER
+    // Maps p_size bytes starting on a hugepage boundary, so that every full 2 MB of the range can be a hugepage.
+    void* MapAligned(std::size_t p_size, int p_flags, std::size_t& p_mappedBytes)
+    {
+        std::size_t length = (p_size + c_hugePageSize - 1) / c_hugePageSize * c_hugePageSize;
+        if (p_flags & MAP_HUGETLB) {
+            void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | p_flags, -1, 0);
+            if (base == MAP_FAILED) return nullptr;
+            p_mappedBytes = length;
+            return base;
+        }
+
+        void* raw = mmap(nullptr, length + c_hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | p_flags, -1, 0);
+        if (raw == MAP_FAILED) return nullptr;
+        char* begin = (char*)raw;
+        char* base = (char*)(((std::uintptr_t)begin + c_hugePageSize - 1) / c_hugePageSize * c_hugePageSize);
+        if (base > begin) munmap(begin, base - begin);
+        std::size_t tail = (begin + length + c_hugePageSize) - (base + length);
+        if (tail > 0) munmap(base + length, tail);
+        p_mappedBytes = length;
+        return base;
+    }
+#endif
+}
+
+void*
+Helper::AllocatePages(std::size_t p_size, PagePolicy p_policy)
+{
+    std::size_t total = p_size + c_headerSize;
+    void* base = nullptr;
+    std::size_t mappedBytes = 0;
+#ifndef _MSC_VER
+    // Below one hugepage nothing can be hugepage backed, and mapping would round the request up to 2 MB.
+    if (total < c_hugePageSize) p_policy = PagePolicy::Default;
+    if (p_policy == PagePolicy::ExplicitHuge) {
+        base = MapAligned(total, MAP_HUGETLB, mappedBytes);
+        if (base == nullptr) {
+            LOG(Helper::LogLevel::LL_Debug, "No explicit hugepages for %zu bytes, use transparent hugepages instead.\n", total);
+            p_policy = PagePolicy::TransparentHuge;
+        }
+    }
+    if (p_policy == PagePolicy::TransparentHuge) {
+        base = MapAligned(total, 0, mappedBytes);
+        if (base != nullptr) AdviseHugePages(base, mappedBytes);
+    }
+#endif
+    if (base == nullptr) {
+        base = _mm_malloc(total, ALIGN_SPTAG);
+        if (base == nullptr) return nullptr;
+        mappedBytes = 0;
+    }
+
+    PageHeader* header = (PageHeader*)base;
+    header->m_mappedBytes = mappedBytes;
+    header->m_mappedBase = base;
+    return (char*)base + c_headerSize;
+}
+
+void
+Helper::FreePages(void* p_ptr)
+{
+    if (p_ptr == nullptr) return;
+
+    PageHeader* header = (PageHeader*)((char*)p_ptr - c_headerSize);
+#ifndef _MSC_VER
+    if (header->m_mappedBytes > 0) {
+        munmap(header->m_mappedBase, header->m_mappedBytes);
+        return;
+    }
+#endif
+    _mm_free(header->m_mappedBase);
+}
+
+void
+Helper::AdviseHugePages(void* p_ptr, std::size_t p_size)
+{
+#if !defined(_MSC_VER) && defined(MADV_HUGEPAGE)
+    // madvise needs a page aligned start; the partial page in front is left as it is.
+    std::uintptr_t begin = ((std::uintptr_t)p_ptr + 4095) / 4096 * 4096;
+    std::uintptr_t end = (std::uintptr_t)p_ptr + p_size;
+    if (end > begin && madvise((void*)begin, end - begin, MADV_HUGEPAGE) != 0) {
+        LOG(Helper::LogLevel::LL_Debug, "madvise(MADV_HUGEPAGE) failed for %zu bytes.\n", (std::size_t)(end - begin));
+    }
+#endif
+}
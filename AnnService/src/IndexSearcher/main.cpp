@@ -113,7 +113,7 @@ int Process(std::shared_ptr<SearcherOptions> options, VectorIndex& index)
                 exit(1);
             }
             COMMON::TruthSet::GenerateTruth<T>(queryVectors, dataVectors, options->m_truthFile, index.GetDistCalcMethod(), options->m_truthK,
-                (options->m_truthFile.find("bin") != std::string::npos) ? TruthFileType::DEFAULT : TruthFileType::TXT);
+                (options->m_truthFile.find("bin") != std::string::npos) ? TruthFileType::DEFAULT : TruthFileType::TXT, index.GetQuantizer());
         }
 
         ftruth = SPTAG::f_createIO();
@@ -296,9 +296,9 @@ int main(int argc, char** argv)
         LOG(Helper::LogLevel::LL_Error, "Cannot open index configure file!");
         return -1;
     }
-    if (SPTAG::COMMON::DistanceUtils::Quantizer)
+    if (vecIndex->GetQuantizer())
     {
-        COMMON::DistanceUtils::Quantizer->SetEnableADC(options->m_enableADC);
+        vecIndex->GetQuantizer()->SetEnableADC(options->m_enableADC);
     }
 
     Helper::IniReader iniReader;
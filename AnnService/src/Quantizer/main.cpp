@@ -0,0 +1,120 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Helper/VectorSetReader.h"
+#include "inc/Core/Common.h"
+#include "inc/Core/Common/QuantizerTrainer.h"
+
+#include <memory>
+
+using namespace SPTAG;
+
+class QuantizerOptions : public Helper::ReaderOptions
+{
+public:
+    QuantizerOptions() : Helper::ReaderOptions(VectorValueType::Float, 0, VectorFileType::TXT, "|", 32)
+    {
+        AddRequiredOption(m_inputFiles, "-i", "--input", "Input raw data.");
+        AddRequiredOption(m_outputQuantizer, "-o", "--output", "Output quantizer file.");
+        AddOptionalOption(m_numSubvectors, "-qs", "--subvectors", "Number of PQ subvectors, required unless -sq is set.");
+        AddOptionalOption(m_ksPerSubvector, "-qk", "--ks", "Centroids per subvector, at most 256 (16 for 4-bit codes). Default is 256.");
+        AddOptionalOption(m_fourBitCodes, "-q4", "--fourbit", "Pack two 4-bit codes per byte for fast scan. Default is false.");
+        AddOptionalOption(m_scalar, "-sq", "--scalar", "Train a per dimension scalar quantizer (SQ8, or SQ4 with -q4) instead of PQ. Default is false.");
+        AddOptionalOption(m_sampleNum, "-s", "--samples", "Number of vectors sampled for training. Default is 100000.");
+        AddOptionalOption(m_maxIter, "-it", "--iterations", "Max k-means iterations per subvector. Default is 100.");
+        AddOptionalOption(m_seed, "-seed", "--seed", "Random seed for sampling and center initialization.");
+        AddOptionalOption(m_outputEncoded, "-e", "--encoded", "Output file for the codes of the whole input, in DEFAULT UInt8 format.");
+    }
+
+    ~QuantizerOptions() {}
+
+    std::string m_inputFiles;
+
+    std::string m_outputQuantizer;
+
+    std::string m_outputEncoded;
+
+    DimensionType m_numSubvectors = 0;
+
+    SizeType m_ksPerSubvector = 256;
+
+    bool m_fourBitCodes = false;
+
+    bool m_scalar = false;
+
+    SizeType m_sampleNum = 100000;
+
+    int m_maxIter = 100;
+
+    std::uint32_t m_seed = 0;
+};
+
+template <typename T>
+ErrorCode TrainAndEncode(const std::shared_ptr<QuantizerOptions>& p_opts, const std::shared_ptr<VectorSet>& p_vectors)
+{
+    std::shared_ptr<COMMON::IQuantizer> quantizer;
+    if (p_opts->m_scalar) {
+        quantizer = COMMON::TrainSQQuantizer<T>(p_vectors, p_opts->m_sampleNum, p_opts->m_threadNum, p_opts->m_seed, p_opts->m_fourBitCodes);
+    }
+    else {
+        quantizer = COMMON::TrainPQQuantizer<T>(p_vectors, p_opts->m_numSubvectors, p_opts->m_ksPerSubvector,
+            p_opts->m_sampleNum, p_opts->m_threadNum, p_opts->m_maxIter, p_opts->m_seed, p_opts->m_fourBitCodes);
+    }
+    if (quantizer == nullptr) return ErrorCode::Fail;
+
+    {
+        auto ptr = SPTAG::f_createIO();
+        if (ptr == nullptr || !ptr->Initialize(p_opts->m_outputQuantizer.c_str(), std::ios::binary | std::ios::out)) return ErrorCode::FailedCreateFile;
+        ErrorCode ret = quantizer->SaveQuantizer(ptr);
+        if (ret != ErrorCode::Success) return ret;
+    }
+
+    if (p_opts->m_outputEncoded.empty()) return ErrorCode::Success;
+
+    SizeType count = p_vectors->Count();
+    SizeType codeSize = quantizer->QuantizeSize();
+    ByteArray codes = ByteArray::Alloc(((size_t)count) * codeSize);
+#pragma omp parallel for num_threads(p_opts->m_threadNum) schedule(static)
+    for (SizeType i = 0; i < count; i++) {
+        quantizer->QuantizeVector(p_vectors->GetVector(i), codes.Data() + ((size_t)i) * codeSize);
+    }
+    LOG(Helper::LogLevel::LL_Info, "Encoded %d vectors into %d bytes each.\n", count, codeSize);
+    return BasicVectorSet(codes, VectorValueType::UInt8, codeSize, count).Save(p_opts->m_outputEncoded);
+}
+
+int main(int argc, char* argv[])
+{
+    std::shared_ptr<QuantizerOptions> options(new QuantizerOptions);
+    if (!options->Parse(argc - 1, argv + 1))
+    {
+        exit(1);
+    }
+
+    auto vectorReader = Helper::VectorSetReader::CreateInstance(options);
+    if (ErrorCode::Success != vectorReader->LoadFile(options->m_inputFiles))
+    {
+        LOG(Helper::LogLevel::LL_Error, "Failed to read input file.\n");
+        exit(1);
+    }
+
+    ErrorCode code = ErrorCode::Undefined;
+    switch (options->m_inputValueType)
+    {
+#define DefineVectorValueType(Name, Type) \
+    case VectorValueType::Name: \
+        code = TrainAndEncode<Type>(options, vectorReader->GetVectorSet()); \
+        break; \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineVectorValueType
+
+    default: break;
+    }
+
+    if (code != ErrorCode::Success)
+    {
+        LOG(Helper::LogLevel::LL_Error, "Failed to train quantizer.\n");
+        exit(1);
+    }
+    return 0;
+}
@@ -87,7 +87,7 @@ namespace SPTAG {
 			}
 
 			std::string quantizerPath = index->GetParameter("QuantizerFilePath", SEC_BASE);
-			if (!quantizerPath.empty() && VectorIndex::LoadQuantizer(quantizerPath) != ErrorCode::Success)
+			if (!quantizerPath.empty() && index->LoadQuantizer(quantizerPath) != ErrorCode::Success)
 			{
 				exit(1);
 			}
@@ -116,7 +116,7 @@ namespace SPTAG {
 			if (opts->m_generateTruth)
 			{
 				LOG(Helper::LogLevel::LL_Info, "Start generating truth. It's maybe a long time.\n");
-				if (COMMON::DistanceUtils::Quantizer) valueType = VectorValueType::UInt8;
+				if (index->GetQuantizer()) valueType = VectorValueType::UInt8;
 				std::shared_ptr<Helper::ReaderOptions> vectorOptions(new Helper::ReaderOptions(valueType, opts->m_dim, opts->m_vectorType, opts->m_vectorDelimiter));
 				auto vectorReader = Helper::VectorSetReader::CreateInstance(vectorOptions);
 				if (ErrorCode::Success != vectorReader->LoadFile(opts->m_vectorPath))
@@ -140,7 +140,7 @@ namespace SPTAG {
 #define DefineVectorValueType(Name, Type) \
 	if (opts->m_valueType == VectorValueType::Name) { \
 		COMMON::TruthSet::GenerateTruth<Type>(querySet, vectorSet, opts->m_truthPath, \
-			distCalcMethod, opts->m_resultNum, opts->m_truthType); \
+			distCalcMethod, opts->m_resultNum, opts->m_truthType, index->GetQuantizer()); \
 	} \
 
 #include "inc/Core/DefinitionList.h"
@@ -2,6 +2,7 @@
 // Licensed under the MIT License.
 
 #include "inc/Server/SearchExecutor.h"
+#include "inc/Helper/Numa.h"
 
 using namespace SPTAG;
 using namespace SPTAG::Service;
@@ -95,7 +96,7 @@ void
 SearchExecutor::SelectIndex()
 {
     const auto& indexNames = m_executionContext->GetSelectedIndexNames();
-    const auto& indexMap = c_serviceContext->GetIndexMap();
+    const auto& indexMap = c_serviceContext->GetIndexMap(Helper::CurrentNumaNode());
     if (indexMap.empty())
     {
         return;
@@ -6,6 +6,7 @@
 #include "inc/Socket/RemoteSearchQuery.h"
 #include "inc/Helper/CommonHelper.h"
 #include "inc/Helper/ArgumentsParser.h"
+#include "inc/Helper/Numa.h"
 
 #include <iostream>
 
@@ -123,13 +124,32 @@ void
 SearchService::RunSocketMode()
 {
     auto threadNum = max((SizeType)1, m_serviceContext->GetServiceSettings()->m_threadNum);
-    m_threadPool.reset(new boost::asio::thread_pool(threadNum));
+    // Only the nodes that got replicas get a pool; with none of them, one unbound pool serves the shared indexes.
+    m_poolNodes.clear();
+    if (m_serviceContext->GetServiceSettings()->m_numaMode == NumaMode::Replicate)
+    {
+        const auto& replicaNodes = m_serviceContext->GetReplicaNodes();
+        m_poolNodes.assign(replicaNodes.begin(), replicaNodes.begin() + min((SizeType)replicaNodes.size(), threadNum));
+    }
+    SizeType poolNum = max((SizeType)1, (SizeType)m_poolNodes.size());
+
+    m_nextThreadPool = 0;
+    m_threadPools.clear();
+    for (SizeType i = 0; i < poolNum; ++i)
+    {
+        m_threadPools.emplace_back(new boost::asio::thread_pool(threadNum / poolNum + (i < threadNum % poolNum ? 1 : 0)));
+    }
 
     Socket::PacketHandlerMapPtr handlerMap(new Socket::PacketHandlerMap);
     handlerMap->emplace(Socket::PacketType::SearchRequest,
                         [this](Socket::ConnectionID p_srcID, Socket::Packet p_packet)
                         {
-                            boost::asio::post(*m_threadPool, std::bind(&SearchService::SearchHanlder, this, p_srcID, std::move(p_packet)));
+                            PostSearch(std::bind(&SearchService::SearchHanlder, this, p_srcID, std::move(p_packet)));
+                        });
+    handlerMap->emplace(Socket::PacketType::BatchSearchRequest,
+                        [this](Socket::ConnectionID p_srcID, Socket::Packet p_packet)
+                        {
+                            PostSearch(std::bind(&SearchService::BatchSearchHanlder, this, p_srcID, std::move(p_packet)));
                         });
 
     m_socketServer.reset(new Socket::Server(m_serviceContext->GetServiceSettings()->m_listenAddr,
@@ -157,8 +177,34 @@ SearchService::RunSocketMode()
     LOG(Helper::LogLevel::LL_Info, "Start shutdown procedure.\n");
 
     m_socketServer.reset();
-    m_threadPool->stop();
-    m_threadPool->join();
+    for (auto& threadPool : m_threadPools)
+    {
+        threadPool->stop();
+    }
+    for (auto& threadPool : m_threadPools)
+    {
+        threadPool->join();
+    }
+}
+
+
+void
+SearchService::PostSearch(std::function<void()> p_handler)
+{
+    if (m_poolNodes.size() <= 1)
+    {
+        boost::asio::post(*m_threadPools[0], std::move(p_handler));
+        return;
+    }
+
+    // Pool i only runs on NUMA node m_poolNodes[i], where GetIndexMap gives its handlers the node local replicas.
+    std::size_t pool = m_nextThreadPool++ % m_threadPools.size();
+    int node = m_poolNodes[pool];
+    boost::asio::post(*m_threadPools[pool], [node, handler = std::move(p_handler)]()
+                      {
+                          Helper::BindThreadToNumaNode(node);
+                          handler();
+                      });
 }
 
 
@@ -272,3 +318,117 @@ SearchService::SearchHanlderCallback(std::shared_ptr<SearchExecutionContext> p_e
 
     m_socketServer->SendPacket(p_srcPacket.Header().m_connectionID, std::move(ret), nullptr);
 }
+
+
+void
+SearchService::BatchSearchHanlder(Socket::ConnectionID p_localConnectionID, Socket::Packet p_packet)
+{
+    if (p_packet.Header().m_bodyLength == 0)
+    {
+        LOG(Helper::LogLevel::LL_Error, "Empty package with body length equals 0!\n");
+        return;
+    }
+
+    if (Socket::c_invalidConnectionID == p_packet.Header().m_connectionID)
+    {
+        p_packet.Header().m_connectionID = p_localConnectionID;
+    }
+
+    Socket::RemoteBatchQuery batchQuery;
+    if (batchQuery.Read(p_packet.Body(), p_packet.Header().m_bodyLength) == nullptr) {
+        LOG(Helper::LogLevel::LL_Error, "Failed to read batch search packet!\n");
+        return;
+    }
+
+    Socket::RemoteBatchSearchResult batchResult = SearchBatch(batchQuery, m_serviceContext->GetIndexMap(Helper::CurrentNumaNode()));
+
+    Socket::Packet ret;
+    ret.Header().m_packetType = Socket::PacketType::BatchSearchResponse;
+    ret.Header().m_processStatus = Socket::PacketProcessStatus::Ok;
+    ret.Header().m_connectionID = p_packet.Header().m_connectionID;
+    ret.Header().m_resourceID = p_packet.Header().m_resourceID;
+
+    ret.AllocateBuffer(static_cast<std::uint32_t>(batchResult.EstimateBufferSize()));
+    auto bodyEnd = batchResult.Write(ret.Body());
+
+    ret.Header().m_bodyLength = static_cast<std::uint32_t>(bodyEnd - ret.Body());
+    ret.Header().WriteBuffer(ret.HeaderBuffer());
+
+    m_socketServer->SendPacket(p_packet.Header().m_connectionID, std::move(ret), nullptr);
+}
+
+
+Socket::RemoteBatchSearchResult
+SearchService::SearchBatch(const Socket::RemoteBatchQuery& p_query,
+                           const std::map<std::string, std::shared_ptr<VectorIndex>>& p_indexMap)
+{
+    Socket::RemoteBatchSearchResult batchResult;
+    batchResult.m_status = Socket::RemoteSearchResult::ResultStatus::FailedExecute;
+    batchResult.m_queryResults.resize(p_query.QueryCount());
+    for (auto& queryResult : batchResult.m_queryResults)
+    {
+        queryResult.m_status = Socket::RemoteSearchResult::ResultStatus::FailedExecute;
+    }
+
+    std::size_t vectorSize = GetValueTypeSize(p_query.m_valueType) * p_query.m_dimension;
+    if (p_query.m_dimension <= 0 || p_query.m_vectors.Length() != vectorSize * p_query.QueryCount())
+    {
+        LOG(Helper::LogLevel::LL_Error, "Failed to match batch vector size!\n");
+        return batchResult;
+    }
+
+    std::vector<std::shared_ptr<VectorIndex>> selectedIndex;
+    if (p_query.m_indexNames.empty())
+    {
+        if (p_indexMap.size() == 1) selectedIndex.push_back(p_indexMap.begin()->second);
+    }
+    else
+    {
+        std::size_t begin = 0;
+        while (begin <= p_query.m_indexNames.size())
+        {
+            std::size_t end = p_query.m_indexNames.find(',', begin);
+            if (end == std::string::npos) end = p_query.m_indexNames.size();
+
+            auto iter = p_indexMap.find(p_query.m_indexNames.substr(begin, end - begin));
+            if (iter != p_indexMap.cend()) selectedIndex.push_back(iter->second);
+            begin = end + 1;
+        }
+    }
+
+    for (const auto& vectorIndex : selectedIndex)
+    {
+        if (vectorIndex->GetVectorValueType() != p_query.m_valueType
+            || vectorIndex->GetFeatureDim() != p_query.m_dimension)
+        {
+            continue;
+        }
+
+        // A query cannot find more vectors than the index holds, so larger result numbers are not allocated.
+        std::int32_t maxResultNum = static_cast<std::int32_t>(max(vectorIndex->GetNumSamples(), (SizeType)1));
+        std::vector<QueryResult> queries;
+        queries.reserve(p_query.QueryCount());
+        for (std::uint32_t i = 0; i < p_query.QueryCount(); ++i)
+        {
+            queries.emplace_back(p_query.m_vectors.Data() + i * vectorSize, min(p_query.m_resultNums[i], maxResultNum), p_query.m_extractMetadata);
+        }
+
+        if (ErrorCode::Success != vectorIndex->SearchIndex(queries.data(), static_cast<int>(queries.size()), false, 1))
+        {
+            LOG(Helper::LogLevel::LL_Error, "Failed to execute batch SearchIndex!\n");
+            continue;
+        }
+
+        for (std::uint32_t i = 0; i < p_query.QueryCount(); ++i)
+        {
+            auto& queryResult = batchResult.m_queryResults[i];
+            queryResult.m_status = Socket::RemoteSearchResult::ResultStatus::Success;
+            queryResult.m_allIndexResults.emplace_back();
+            queryResult.m_allIndexResults.back().m_indexName = vectorIndex->GetIndexName();
+            queryResult.m_allIndexResults.back().m_results = queries[i];
+        }
+        batchResult.m_status = Socket::RemoteSearchResult::ResultStatus::Success;
+    }
+
+    return batchResult;
+}
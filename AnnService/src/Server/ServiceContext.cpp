@@ -5,6 +5,9 @@
 #include "inc/Helper/SimpleIniReader.h"
 #include "inc/Helper/CommonHelper.h"
 #include "inc/Helper/StringConvert.h"
+#include "inc/Helper/Numa.h"
+
+#include <thread>
 
 using namespace SPTAG;
 using namespace SPTAG::Service;
@@ -26,6 +29,27 @@ ServiceContext::ServiceContext(const std::string& p_configFilePath)
     m_settings->m_threadNum = iniReader.GetParameter("Service", "ThreadNumber", static_cast<std::uint32_t>(8));
     m_settings->m_socketThreadNum = iniReader.GetParameter("Service", "SocketThreadNumber", static_cast<std::uint32_t>(8));
 
+    std::string numaMode = iniReader.GetParameter("Service", "NumaMode", std::string("None"));
+    if (Helper::StrUtils::StrEqualIgnoreCase(numaMode.c_str(), "Interleave"))
+    {
+        m_settings->m_numaMode = NumaMode::Interleave;
+    }
+    else if (Helper::StrUtils::StrEqualIgnoreCase(numaMode.c_str(), "Replicate"))
+    {
+        m_settings->m_numaMode = NumaMode::Replicate;
+    }
+    else if (!Helper::StrUtils::StrEqualIgnoreCase(numaMode.c_str(), "None"))
+    {
+        LOG(Helper::LogLevel::LL_Warning, "Unknown NumaMode %s, use None.\n", numaMode.c_str());
+    }
+
+    int numaNodes = Helper::NumaNodeCount();
+    if (m_settings->m_numaMode != NumaMode::None && numaNodes <= 1)
+    {
+        LOG(Helper::LogLevel::LL_Info, "Single NUMA node, ignore NumaMode %s.\n", numaMode.c_str());
+        m_settings->m_numaMode = NumaMode::None;
+    }
+
     m_settings->m_defaultMaxResultNumber = iniReader.GetParameter("QueryConfig", "DefaultMaxResultNumber", static_cast<SizeType>(10));
     m_settings->m_vectorSeparator = iniReader.GetParameter("QueryConfig", "DefaultSeparator", std::string("|"));
 
@@ -44,9 +68,28 @@ ServiceContext::ServiceContext(const std::string& p_configFilePath)
         }
 
         std::string indexFolder = iniReader.GetParameter(sectionName, "IndexFolder", emptyStr);
+        bool memoryMap = iniReader.GetParameter(sectionName, "MemoryMap", false);
 
         std::shared_ptr<VectorIndex> vectorIndex;
-        if (ErrorCode::Success == VectorIndex::LoadIndex(indexFolder, vectorIndex))
+        if (m_settings->m_numaMode == NumaMode::Replicate)
+        {
+            if (memoryMap)
+            {
+                LOG(Helper::LogLevel::LL_Warning, "Index %s is memory mapped, its replicas share the page cache of one node.\n", indexName.c_str());
+            }
+            vectorIndex = LoadReplicas(indexName, indexFolder, memoryMap);
+        }
+
+        // Without NUMA replicas, or when no node could take one, one shared copy serves every thread.
+        ErrorCode ret = ErrorCode::Success;
+        if (vectorIndex == nullptr)
+        {
+            if (m_settings->m_numaMode == NumaMode::Interleave) Helper::SetInterleaveMemory(true);
+            ret = VectorIndex::LoadIndex(indexFolder, vectorIndex, memoryMap);
+            if (m_settings->m_numaMode == NumaMode::Interleave) Helper::SetInterleaveMemory(false);
+        }
+
+        if (ErrorCode::Success == ret && vectorIndex != nullptr)
         {
             vectorIndex->SetIndexName(indexName);
             m_fullIndexList.emplace(indexName, vectorIndex);
@@ -57,6 +100,11 @@ ServiceContext::ServiceContext(const std::string& p_configFilePath)
         }
     }
 
+    for (int node = 0; node < static_cast<int>(m_replicaIndexList.size()); node++)
+    {
+        if (!m_replicaIndexList[node].empty()) m_replicaNodes.push_back(node);
+    }
+
     m_initialized = true;
 }
 
@@ -74,6 +122,71 @@ ServiceContext::GetIndexMap() const
 }
 
 
+const std::map<std::string, std::shared_ptr<VectorIndex>>&
+ServiceContext::GetIndexMap(int p_numaNode) const
+{
+    if (p_numaNode < 0 || p_numaNode >= static_cast<int>(m_replicaIndexList.size()) || m_replicaIndexList[p_numaNode].empty())
+    {
+        return m_fullIndexList;
+    }
+
+    return m_replicaIndexList[p_numaNode];
+}
+
+
+const std::vector<int>&
+ServiceContext::GetReplicaNodes() const
+{
+    return m_replicaNodes;
+}
+
+
+std::shared_ptr<VectorIndex>
+ServiceContext::LoadReplicas(const std::string& p_indexName, const std::string& p_indexFolder, bool p_memoryMap)
+{
+    // Every copy, node 0 included, is loaded on a thread pinned to its node, so that first touch puts the
+    // data there. Nodes without CPUs cannot be bound and get no copy.
+    int numaNodes = Helper::NumaNodeCount();
+    std::vector<std::shared_ptr<VectorIndex>> replicas(numaNodes);
+    std::vector<char> bound(numaNodes, 0);
+    std::vector<std::thread> loaders;
+    for (int node = 0; node < numaNodes; node++)
+    {
+        loaders.emplace_back([&, node]()
+            {
+                if (!Helper::BindThreadToNumaNode(node))
+                {
+                    LOG(Helper::LogLevel::LL_Info, "NUMA node %d has no CPUs to bind, no replica of index %s there.\n", node, p_indexName.c_str());
+                    return;
+                }
+                bound[node] = 1;
+                if (ErrorCode::Success != VectorIndex::LoadIndex(p_indexFolder, replicas[node], p_memoryMap))
+                {
+                    LOG(Helper::LogLevel::LL_Error, "Failed loading index %s on NUMA node %d.\n", p_indexName.c_str(), node);
+                    replicas[node].reset();
+                }
+            });
+    }
+    for (auto& loader : loaders) loader.join();
+
+    // The copy of the lowest node also serves unbound threads and the nodes whose own load failed.
+    std::shared_ptr<VectorIndex> first;
+    for (int node = 0; node < numaNodes && first == nullptr; node++) first = replicas[node];
+    if (first == nullptr) return nullptr;
+
+    m_replicaIndexList.resize(numaNodes);
+    for (int node = 0; node < numaNodes; node++)
+    {
+        if (!bound[node]) continue;
+
+        std::shared_ptr<VectorIndex> replica = (replicas[node] != nullptr) ? replicas[node] : first;
+        replica->SetIndexName(p_indexName);
+        m_replicaIndexList[node].emplace(p_indexName, replica);
+    }
+    return first;
+}
+
+
 const std::shared_ptr<ServiceSettings>&
 ServiceContext::GetServiceSettings() const
 {
@@ -8,6 +8,41 @@ using namespace SPTAG;
 using namespace SPTAG::Socket;
 
 
+namespace
+{
+
+// Reads p_val only if it fits between p_buffer and p_end, returns nullptr otherwise or if p_buffer already is.
+template<typename T>
+const std::uint8_t*
+CheckedReadBuffer(const std::uint8_t* p_buffer, const std::uint8_t* p_end, T& p_val)
+{
+    if (nullptr == p_buffer || static_cast<std::size_t>(p_end - p_buffer) < sizeof(T))
+    {
+        return nullptr;
+    }
+
+    return SimpleSerialization::SimpleReadBuffer(p_buffer, p_val);
+}
+
+
+// Same for strings and byte arrays, whose bytes follow a 32 bit length.
+template<typename T>
+const std::uint8_t*
+CheckedReadSizedBuffer(const std::uint8_t* p_buffer, const std::uint8_t* p_end, T& p_val)
+{
+    std::uint32_t len = 0;
+    if (nullptr == CheckedReadBuffer(p_buffer, p_end, len)
+        || static_cast<std::size_t>(p_end - p_buffer) - sizeof(len) < len)
+    {
+        return nullptr;
+    }
+
+    return SimpleSerialization::SimpleReadBuffer(p_buffer, p_val);
+}
+
+} // namespace
+
+
 RemoteQuery::RemoteQuery()
     : m_type(QueryType::String)
 {
@@ -208,3 +243,279 @@ RemoteSearchResult::Read(const std::uint8_t* p_buffer)
 
     return p_buffer;
 }
+
+
+const std::uint8_t*
+RemoteSearchResult::Read(const std::uint8_t* p_buffer, std::size_t p_length)
+{
+    const std::uint8_t* end = p_buffer + p_length;
+
+    decltype(MajorVersion()) majorVer = 0;
+    decltype(MirrorVersion()) mirrorVer = 0;
+
+    p_buffer = CheckedReadBuffer(p_buffer, end, majorVer);
+    p_buffer = CheckedReadBuffer(p_buffer, end, mirrorVer);
+    if (nullptr == p_buffer || majorVer != MajorVersion())
+    {
+        return nullptr;
+    }
+
+    p_buffer = CheckedReadBuffer(p_buffer, end, m_status);
+
+    // Even an index result without results takes its name length, result count and metadata flag.
+    const std::size_t minIndexResultSize = 2 * sizeof(std::uint32_t) + sizeof(bool);
+    std::uint32_t len = 0;
+    p_buffer = CheckedReadBuffer(p_buffer, end, len);
+    if (nullptr == p_buffer || len > static_cast<std::size_t>(end - p_buffer) / minIndexResultSize)
+    {
+        return nullptr;
+    }
+
+    m_allIndexResults.resize(len);
+    for (auto& indexRes : m_allIndexResults)
+    {
+        p_buffer = CheckedReadSizedBuffer(p_buffer, end, indexRes.m_indexName);
+
+        std::uint32_t resNum = 0;
+        p_buffer = CheckedReadBuffer(p_buffer, end, resNum);
+
+        bool withMeta = false;
+        p_buffer = CheckedReadBuffer(p_buffer, end, withMeta);
+
+        const std::size_t resultSize = sizeof(SizeType) + sizeof(float) + (withMeta ? sizeof(std::uint32_t) : 0);
+        if (nullptr == p_buffer || resNum > static_cast<std::size_t>(end - p_buffer) / resultSize)
+        {
+            return nullptr;
+        }
+
+        indexRes.m_results.Init(nullptr, resNum, withMeta);
+        for (auto& res : indexRes.m_results)
+        {
+            p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, res.VID);
+            p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, res.Dist);
+        }
+
+        if (withMeta)
+        {
+            for (int i = 0; i < indexRes.m_results.GetResultNum(); ++i)
+            {
+                ByteArray meta;
+                p_buffer = CheckedReadSizedBuffer(p_buffer, end, meta);
+                if (nullptr == p_buffer)
+                {
+                    return nullptr;
+                }
+
+                indexRes.m_results.SetMetadata(i, std::move(meta));
+            }
+        }
+    }
+
+    return p_buffer;
+}
+
+
+RemoteBatchQuery::RemoteBatchQuery()
+    : m_valueType(VectorValueType::Undefined),
+      m_dimension(0),
+      m_extractMetadata(false)
+{
+}
+
+
+std::size_t
+RemoteBatchQuery::EstimateBufferSize() const
+{
+    std::size_t sum = 0;
+    sum += SimpleSerialization::EstimateBufferSize(MajorVersion());
+    sum += SimpleSerialization::EstimateBufferSize(MirrorVersion());
+    sum += SimpleSerialization::EstimateBufferSize(m_indexNames);
+    sum += SimpleSerialization::EstimateBufferSize(m_valueType);
+    sum += SimpleSerialization::EstimateBufferSize(m_dimension);
+    sum += SimpleSerialization::EstimateBufferSize(m_extractMetadata);
+
+    sum += sizeof(std::uint32_t);
+    sum += sizeof(std::int32_t) * m_resultNums.size();
+    sum += SimpleSerialization::EstimateBufferSize(m_vectors);
+
+    return sum;
+}
+
+
+std::uint8_t*
+RemoteBatchQuery::Write(std::uint8_t* p_buffer) const
+{
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(MajorVersion(), p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(MirrorVersion(), p_buffer);
+
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_indexNames, p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_valueType, p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_dimension, p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_extractMetadata, p_buffer);
+
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(static_cast<std::uint32_t>(m_resultNums.size()), p_buffer);
+    for (std::int32_t resultNum : m_resultNums)
+    {
+        p_buffer = SimpleSerialization::SimpleWriteBuffer(resultNum, p_buffer);
+    }
+
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_vectors, p_buffer);
+
+    return p_buffer;
+}
+
+
+const std::uint8_t*
+RemoteBatchQuery::Read(const std::uint8_t* p_buffer, std::size_t p_length)
+{
+    const std::uint8_t* end = p_buffer + p_length;
+
+    decltype(MajorVersion()) majorVer = 0;
+    decltype(MirrorVersion()) mirrorVer = 0;
+
+    p_buffer = CheckedReadBuffer(p_buffer, end, majorVer);
+    p_buffer = CheckedReadBuffer(p_buffer, end, mirrorVer);
+    if (nullptr == p_buffer || majorVer != MajorVersion())
+    {
+        return nullptr;
+    }
+
+    p_buffer = CheckedReadSizedBuffer(p_buffer, end, m_indexNames);
+    p_buffer = CheckedReadBuffer(p_buffer, end, m_valueType);
+    p_buffer = CheckedReadBuffer(p_buffer, end, m_dimension);
+    p_buffer = CheckedReadBuffer(p_buffer, end, m_extractMetadata);
+
+    // The count comes off the wire, so it has to fit into the rest of the packet before anything is allocated.
+    std::uint32_t len = 0;
+    p_buffer = CheckedReadBuffer(p_buffer, end, len);
+    if (nullptr == p_buffer || m_dimension <= 0 || 0 == len
+        || len > static_cast<std::size_t>(end - p_buffer) / sizeof(std::int32_t))
+    {
+        return nullptr;
+    }
+
+    m_resultNums.resize(len);
+    for (auto& resultNum : m_resultNums)
+    {
+        p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, resultNum);
+        if (resultNum <= 0)
+        {
+            return nullptr;
+        }
+    }
+
+    return CheckedReadSizedBuffer(p_buffer, end, m_vectors);
+}
+
+
+std::uint32_t
+RemoteBatchQuery::QueryCount() const
+{
+    return static_cast<std::uint32_t>(m_resultNums.size());
+}
+
+
+RemoteBatchSearchResult::RemoteBatchSearchResult()
+    : m_status(RemoteSearchResult::ResultStatus::Timeout)
+{
+}
+
+
+RemoteBatchSearchResult::RemoteBatchSearchResult(const RemoteBatchSearchResult& p_right)
+    : m_status(p_right.m_status),
+      m_queryResults(p_right.m_queryResults)
+{
+}
+
+
+RemoteBatchSearchResult::RemoteBatchSearchResult(RemoteBatchSearchResult&& p_right)
+    : m_status(std::move(p_right.m_status)),
+      m_queryResults(std::move(p_right.m_queryResults))
+{
+}
+
+
+RemoteBatchSearchResult&
+RemoteBatchSearchResult::operator=(RemoteBatchSearchResult&& p_right)
+{
+    m_status = p_right.m_status;
+    m_queryResults = std::move(p_right.m_queryResults);
+
+    return *this;
+}
+
+
+std::size_t
+RemoteBatchSearchResult::EstimateBufferSize() const
+{
+    std::size_t sum = 0;
+    sum += SimpleSerialization::EstimateBufferSize(MajorVersion());
+    sum += SimpleSerialization::EstimateBufferSize(MirrorVersion());
+
+    sum += SimpleSerialization::EstimateBufferSize(m_status);
+
+    sum += sizeof(std::uint32_t);
+    for (const auto& queryRes : m_queryResults)
+    {
+        sum += queryRes.EstimateBufferSize();
+    }
+
+    return sum;
+}
+
+
+std::uint8_t*
+RemoteBatchSearchResult::Write(std::uint8_t* p_buffer) const
+{
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(MajorVersion(), p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(MirrorVersion(), p_buffer);
+
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_status, p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(static_cast<std::uint32_t>(m_queryResults.size()), p_buffer);
+    for (const auto& queryRes : m_queryResults)
+    {
+        p_buffer = queryRes.Write(p_buffer);
+    }
+
+    return p_buffer;
+}
+
+
+const std::uint8_t*
+RemoteBatchSearchResult::Read(const std::uint8_t* p_buffer, std::size_t p_length)
+{
+    const std::uint8_t* end = p_buffer + p_length;
+
+    decltype(MajorVersion()) majorVer = 0;
+    decltype(MirrorVersion()) mirrorVer = 0;
+
+    p_buffer = CheckedReadBuffer(p_buffer, end, majorVer);
+    p_buffer = CheckedReadBuffer(p_buffer, end, mirrorVer);
+    if (nullptr == p_buffer || majorVer != MajorVersion())
+    {
+        return nullptr;
+    }
+
+    p_buffer = CheckedReadBuffer(p_buffer, end, m_status);
+
+    // Even an empty RemoteSearchResult takes its versions, status and index count.
+    const std::size_t minResultSize = 2 * sizeof(std::uint16_t) + sizeof(RemoteSearchResult::ResultStatus) + sizeof(std::uint32_t);
+    std::uint32_t len = 0;
+    p_buffer = CheckedReadBuffer(p_buffer, end, len);
+    if (nullptr == p_buffer || len > static_cast<std::size_t>(end - p_buffer) / minResultSize)
+    {
+        return nullptr;
+    }
+
+    m_queryResults.resize(len);
+    for (auto& queryRes : m_queryResults)
+    {
+        p_buffer = queryRes.Read(p_buffer, static_cast<std::size_t>(end - p_buffer));
+        if (nullptr == p_buffer)
+        {
+            return nullptr;
+        }
+    }
+
+    return p_buffer;
+}
@@ -0,0 +1,136 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Aggregator/AggregatorService.h"
+
+#include <cstring>
+
+namespace
+{
+    struct Entry
+    {
+        SPTAG::SizeType vid;
+        float dist;
+        const char* meta;
+    };
+
+    // A partition answer for one index; fewer entries than p_resultNum leave the tail at VID -1, as a
+    // partition with too few vectors returns it.
+    SPTAG::Aggregator::AggregatorResult Partition(const std::string& p_indexName, int p_resultNum, bool p_withMeta, const std::vector<Entry>& p_entries)
+    {
+        SPTAG::Aggregator::AggregatorResult result(new SPTAG::Socket::RemoteSearchResult);
+        result->m_status = SPTAG::Socket::RemoteSearchResult::ResultStatus::Success;
+        result->m_allIndexResults.emplace_back();
+        auto& indexResult = result->m_allIndexResults.back();
+        indexResult.m_indexName = p_indexName;
+        indexResult.m_results.Init(nullptr, p_resultNum, p_withMeta);
+        for (int i = 0; i < (int)p_entries.size(); i++)
+        {
+            indexResult.m_results.SetResult(i, p_entries[i].vid, p_entries[i].dist);
+            if (p_withMeta)
+            {
+                SPTAG::ByteArray meta = SPTAG::ByteArray::Alloc(std::strlen(p_entries[i].meta));
+                std::memcpy(meta.Data(), p_entries[i].meta, meta.Length());
+                indexResult.m_results.SetMetadata(i, meta);
+            }
+        }
+        return result;
+    }
+
+    std::string Meta(const SPTAG::QueryResult& p_results, int p_index)
+    {
+        const SPTAG::ByteArray& meta = p_results.GetMetadata(p_index);
+        return std::string((const char*)meta.Data(), meta.Length());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(AggregatorTest)
+
+BOOST_AUTO_TEST_CASE(MergeDuplicatesTest)
+{
+    // "b" is replicated to both partitions; only its closer copy survives. VID 1 exists in both
+    // partitions too, but as two different vectors, so both are kept.
+    std::vector<SPTAG::Aggregator::AggregatorResult> servers = {
+        Partition("idx", 4, true, { { 1, 1.0f, "a" }, { 2, 2.0f, "b" }, { 3, 5.0f, "c" }, { 4, 7.0f, "d" } }),
+        Partition("idx", 4, true, { { 7, 1.5f, "b" }, { 1, 3.0f, "e" }, { 9, 4.0f, "f" }, { 5, 8.0f, "g" } })
+    };
+
+    SPTAG::Socket::RemoteSearchResult merged;
+    SPTAG::Aggregator::AggregatorService::MergeServerResults(servers, 4, merged);
+    BOOST_CHECK(merged.m_status == SPTAG::Socket::RemoteSearchResult::ResultStatus::Success);
+    BOOST_REQUIRE(merged.m_allIndexResults.size() == 1);
+    const SPTAG::QueryResult& results = merged.m_allIndexResults[0].m_results;
+    BOOST_REQUIRE(results.GetResultNum() == 4);
+
+    const char* expectedMeta[] = { "a", "b", "e", "f" };
+    SPTAG::SizeType expectedVID[] = { 1, 7, 1, 9 };
+    float expectedDist[] = { 1.0f, 1.5f, 3.0f, 4.0f };
+    for (int i = 0; i < 4; i++)
+    {
+        BOOST_CHECK(Meta(results, i) == expectedMeta[i]);
+        BOOST_CHECK(results.GetResult(i)->VID == expectedVID[i]);
+        BOOST_CHECK(results.GetResult(i)->Dist == expectedDist[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MergeShortAndFailedTest)
+{
+    // One partition found only two vectors, one failed, one timed out without an answer, and one
+    // answered for another index.
+    auto failed = Partition("idx", 3, false, { { 100, 0.0f, "" } });
+    failed->m_status = SPTAG::Socket::RemoteSearchResult::ResultStatus::FailedExecute;
+    std::vector<SPTAG::Aggregator::AggregatorResult> servers = {
+        Partition("idx", 3, false, { { 1, 2.0f, "" }, { 2, 4.0f, "" } }),
+        failed,
+        nullptr,
+        Partition("other", 3, false, { { 8, 0.5f, "" } }),
+        Partition("idx", 3, false, { { 5, 3.0f, "" } })
+    };
+
+    SPTAG::Socket::RemoteSearchResult merged;
+    SPTAG::Aggregator::AggregatorService::MergeServerResults(servers, 5, merged);
+    BOOST_REQUIRE(merged.m_allIndexResults.size() == 2);
+    BOOST_CHECK(merged.m_allIndexResults[0].m_indexName == "idx");
+    BOOST_CHECK(merged.m_allIndexResults[1].m_indexName == "other");
+
+    const SPTAG::QueryResult& results = merged.m_allIndexResults[0].m_results;
+    BOOST_REQUIRE(results.GetResultNum() == 5);
+    SPTAG::SizeType expectedVID[] = { 1, 5, 2, -1, -1 };
+    for (int i = 0; i < 5; i++) BOOST_CHECK(results.GetResult(i)->VID == expectedVID[i]);
+
+    const SPTAG::QueryResult& other = merged.m_allIndexResults[1].m_results;
+    BOOST_CHECK(other.GetResult(0)->VID == 8);
+    BOOST_CHECK(other.GetResult(1)->VID == -1);
+
+    // Nothing usable at all still gives a successful, empty answer.
+    SPTAG::Socket::RemoteSearchResult empty;
+    SPTAG::Aggregator::AggregatorService::MergeServerResults({ failed, nullptr }, 5, empty);
+    BOOST_CHECK(empty.m_status == SPTAG::Socket::RemoteSearchResult::ResultStatus::Success);
+    BOOST_CHECK(empty.m_allIndexResults.empty());
+}
+
+BOOST_AUTO_TEST_CASE(MergeTiesTest)
+{
+    // Equal distances come out in partition order, so the merge does not depend on which server
+    // answered first. The tie on "x" keeps the copy of the first partition.
+    std::vector<SPTAG::Aggregator::AggregatorResult> servers = {
+        Partition("idx", 3, true, { { 10, 1.0f, "x" }, { 11, 2.0f, "y" }, { 12, 2.0f, "z" } }),
+        Partition("idx", 3, true, { { 20, 1.0f, "x" }, { 21, 1.0f, "w" }, { 22, 2.0f, "v" } })
+    };
+
+    SPTAG::Socket::RemoteSearchResult merged;
+    SPTAG::Aggregator::AggregatorService::MergeServerResults(servers, 5, merged);
+    BOOST_REQUIRE(merged.m_allIndexResults.size() == 1);
+    const SPTAG::QueryResult& results = merged.m_allIndexResults[0].m_results;
+
+    SPTAG::SizeType expectedVID[] = { 10, 21, 11, 12, 22 };
+    const char* expectedMeta[] = { "x", "w", "y", "z", "v" };
+    for (int i = 0; i < 5; i++)
+    {
+        BOOST_CHECK(results.GetResult(i)->VID == expectedVID[i]);
+        BOOST_CHECK(Meta(results, i) == expectedMeta[i]);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
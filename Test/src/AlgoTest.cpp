@@ -5,9 +5,14 @@
 #include "inc/Helper/SimpleIniReader.h"
 #include "inc/Core/VectorIndex.h"
 #include "inc/Core/Common/CommonUtils.h"
+#include "inc/Core/Common/BKTree.h"
 
 #include <unordered_set>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <fstream>
 
 template <typename T>
 void Build(SPTAG::IndexAlgoType algo, std::string distCalcMethod, std::shared_ptr<SPTAG::VectorSet>& vec, std::shared_ptr<SPTAG::MetadataSet>& meta, const std::string out)
@@ -38,10 +43,10 @@ void BuildWithMetaMapping(SPTAG::IndexAlgoType algo, std::string distCalcMethod,
 }
 
 template <typename T>
-void Search(const std::string folder, T* vec, SPTAG::SizeType n, int k, std::string* truthmeta)
+void Search(const std::string folder, T* vec, SPTAG::SizeType n, int k, std::string* truthmeta, bool memoryMap = false)
 {
     std::shared_ptr<SPTAG::VectorIndex> vecIndex;
-    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex(folder, vecIndex));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex(folder, vecIndex, memoryMap));
     BOOST_CHECK(nullptr != vecIndex);
 
     for (SPTAG::SizeType i = 0; i < n; i++) 
@@ -65,12 +70,69 @@ void Search(const std::string folder, T* vec, SPTAG::SizeType n, int k, std::str
 }
 
 template <typename T>
-void Add(const std::string folder, std::shared_ptr<SPTAG::VectorSet>& vec, std::shared_ptr<SPTAG::MetadataSet>& meta, const std::string out)
+void BatchSearch(const std::string folder, T* vec, SPTAG::SizeType n, int k, std::string* truthmeta)
+{
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex(folder, vecIndex));
+    BOOST_CHECK(nullptr != vecIndex);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SetParameter("SearchInterleave", "2"));
+
+    std::vector<SPTAG::QueryResult> res;
+    res.reserve(n);
+    for (SPTAG::SizeType i = 0; i < n; i++)
+    {
+        res.emplace_back(vec + i * vecIndex->GetFeatureDim(), k, true);
+    }
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(res.data(), n));
+
+    for (SPTAG::SizeType i = 0; i < n; i++)
+    {
+        std::unordered_set<std::string> resmeta;
+        for (int j = 0; j < k; j++)
+        {
+            resmeta.insert(std::string((char*)res[i].GetMetadata(j).Data(), res[i].GetMetadata(j).Length()));
+        }
+        for (int j = 0; j < k; j++)
+        {
+            BOOST_CHECK(resmeta.find(truthmeta[i * k + j]) != resmeta.end());
+        }
+    }
+    vecIndex.reset();
+}
+
+template <typename T>
+void SearchWithFilter(const std::string folder, T* vec, SPTAG::SizeType n, int k, std::function<bool(SPTAG::SizeType)> filter, std::string* truthmeta)
 {
     std::shared_ptr<SPTAG::VectorIndex> vecIndex;
     BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex(folder, vecIndex));
     BOOST_CHECK(nullptr != vecIndex);
 
+    for (SPTAG::SizeType i = 0; i < n; i++)
+    {
+        SPTAG::QueryResult res(vec, k, true);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexWithFilter(res, filter));
+        std::unordered_set<std::string> resmeta;
+        for (int j = 0; j < k; j++)
+        {
+            BOOST_CHECK(filter(res.GetResult(j)->VID));
+            resmeta.insert(std::string((char*)res.GetMetadata(j).Data(), res.GetMetadata(j).Length()));
+        }
+        for (int j = 0; j < k; j++)
+        {
+            BOOST_CHECK(resmeta.find(truthmeta[i * k + j]) != resmeta.end());
+        }
+        vec += vecIndex->GetFeatureDim();
+    }
+    vecIndex.reset();
+}
+
+template <typename T>
+void Add(const std::string folder, std::shared_ptr<SPTAG::VectorSet>& vec, std::shared_ptr<SPTAG::MetadataSet>& meta, const std::string out, bool memoryMap = false)
+{
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex(folder, vecIndex, memoryMap));
+    BOOST_CHECK(nullptr != vecIndex);
+
     BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddIndex(vec, meta));
     BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SaveIndex(out));
     vecIndex.reset();
@@ -155,6 +217,11 @@ void Test(SPTAG::IndexAlgoType algo, std::string distCalcMethod)
     Build<T>(algo, distCalcMethod, vecset, metaset, "testindices");
     std::string truthmeta1[] = { "0", "1", "2", "2", "1", "3", "4", "3", "5" };
     Search<T>("testindices", query.data(), q, k, truthmeta1);
+    Search<T>("testindices", query.data(), q, k, truthmeta1, true);
+    if (algo == SPTAG::IndexAlgoType::BKT) BatchSearch<T>("testindices", query.data(), q, k, truthmeta1);
+
+    std::string truthmetaOdd[] = { "1", "3", "1", "3", "3", "5" };
+    SearchWithFilter<T>("testindices", query.data(), q, 2, [](SPTAG::SizeType vid) { return (vid & 1) == 1; }, truthmetaOdd);
 
     Add<T>("testindices", vecset, metaset, "testindices");
     std::string truthmeta2[] = { "0", "0", "1", "2", "2", "1", "4", "4", "3" };
@@ -168,13 +235,500 @@ void Test(SPTAG::IndexAlgoType algo, std::string distCalcMethod)
     std::string truthmeta4[] = { "0", "1", "2", "2", "1", "3", "4", "3", "5" };
     Search<T>("testindices", query.data(), q, k, truthmeta4);
 
-    Add<T>("testindices", vecset, metaset, "testindices");
+    // Adding to a copy-on-write mapping leaves the mapped files as they were.
     std::string truthmeta5[] = { "0", "1", "2", "2", "1", "3", "4", "3", "5" };
+    Add<T>("testindices", vecset, metaset, "testindices_mmap", true);
+    Search<T>("testindices_mmap", query.data(), q, k, truthmeta5);
+    Search<T>("testindices", query.data(), q, k, truthmeta4);
+
+    Add<T>("testindices", vecset, metaset, "testindices");
     Search<T>("testindices", query.data(), q, k, truthmeta5);
     
     AddOneByOne<T>(algo, distCalcMethod, vecset, metaset, "testindices");
     std::string truthmeta6[] = { "0", "1", "2", "2", "1", "3", "4", "3", "5" };
-    Search<float>("testindices", query.data(), q, k, truthmeta6);
+    Search<T>("testindices", query.data(), q, k, truthmeta6);
+}
+
+// Vectors whose every dimension is their id, so vector i is the only exact match of itself, and a BKT index for
+// them with the distance and build threads set but nothing built yet.
+template <typename T>
+struct LineIndex
+{
+    LineIndex(SPTAG::SizeType p_count, SPTAG::DimensionType p_dim, const std::string& p_distCalcMethod, const char* p_threads)
+        : m(p_dim), index(SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::GetEnumValueType<T>()))
+    {
+        for (SPTAG::SizeType i = 0; i < p_count; i++) vec.insert(vec.end(), m, (T)i);
+        index->SetParameter("DistCalcMethod", p_distCalcMethod);
+        index->SetParameter("NumberOfThreads", p_threads);
+    }
+
+    const T* Vector(SPTAG::SizeType p_id) const { return vec.data() + p_id * m; }
+
+    // Vectors [p_begin, p_begin + p_count) as a set that shares their memory.
+    std::shared_ptr<SPTAG::VectorSet> Vectors(SPTAG::SizeType p_begin, SPTAG::SizeType p_count)
+    {
+        return std::make_shared<SPTAG::BasicVectorSet>(
+            SPTAG::ByteArray((std::uint8_t*)(vec.data() + p_begin * m), sizeof(T) * p_count * m, false),
+            SPTAG::GetEnumValueType<T>(), m, p_count);
+    }
+
+    SPTAG::DimensionType m;
+    std::vector<T> vec;
+    std::shared_ptr<SPTAG::VectorIndex> index;
+};
+
+template <typename T>
+void ReorderIDsTest(std::string distCalcMethod)
+{
+    SPTAG::SizeType n = 2000;
+    LineIndex<T> line(n, 10, distCalcMethod, "16");
+    auto& vecIndex = line.index;
+
+    std::vector<char> meta;
+    std::vector<std::uint64_t> metaoffset;
+    for (SPTAG::SizeType i = 0; i < n; i++) {
+        metaoffset.push_back((std::uint64_t)meta.size());
+        std::string a = std::to_string(i);
+        meta.insert(meta.end(), a.begin(), a.end());
+    }
+    metaoffset.push_back((std::uint64_t)meta.size());
+
+    std::shared_ptr<SPTAG::MetadataSet> metaset(new SPTAG::MemMetadataSet(
+        SPTAG::ByteArray((std::uint8_t*)meta.data(), meta.size() * sizeof(char), false),
+        SPTAG::ByteArray((std::uint8_t*)metaoffset.data(), metaoffset.size() * sizeof(std::uint64_t), false),
+        n));
+
+    vecIndex->SetParameter("ReorderIDs", "1");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(line.Vectors(0, n), metaset));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SaveIndex("testindices_reorder"));
+
+    for (bool memoryMap : { false, true }) {
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testindices_reorder", vecIndex, memoryMap));
+        BOOST_CHECK(vecIndex->GetParameter("ReorderIDs") == "1");
+
+        // Ids seen from outside are still the input positions.
+        for (SPTAG::SizeType i = 0; i < n; i += 97) {
+            SPTAG::QueryResult res(line.Vector(i), 1, true);
+            vecIndex->SearchIndex(res);
+            BOOST_CHECK(res.GetResult(0)->VID == i);
+            BOOST_CHECK(std::string((char*)res.GetMetadata(0).Data(), res.GetMetadata(0).Length()) == std::to_string(i));
+            BOOST_CHECK(memcmp(vecIndex->GetSample(i), line.Vector(i), sizeof(T) * line.m) == 0);
+        }
+
+        SPTAG::QueryResult odd(line.Vector(10), 2, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexWithFilter(odd, [](SPTAG::SizeType vid) { return (vid & 1) == 1; }));
+        BOOST_CHECK((odd.GetResult(0)->VID == 9 && odd.GetResult(1)->VID == 11) || (odd.GetResult(0)->VID == 11 && odd.GetResult(1)->VID == 9));
+    }
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(500));
+    BOOST_CHECK(!vecIndex->ContainSample(500));
+    BOOST_CHECK(vecIndex->ContainSample(501));
+    SPTAG::QueryResult res(line.Vector(500), 1, false);
+    vecIndex->SearchIndex(res);
+    BOOST_CHECK(res.GetResult(0)->VID == 499 || res.GetResult(0)->VID == 501);
+    vecIndex.reset();
+}
+
+template <typename T>
+void CoLocateGraphTest(std::string distCalcMethod)
+{
+    SPTAG::SizeType n = 2000;
+    LineIndex<T> line(2 * n, 10, distCalcMethod, "16");
+    auto& vecIndex = line.index;
+    vecIndex->SetParameter("DataBlockSize", "1024");
+    vecIndex->SetParameter("CoLocateGraph", "1");
+    // Restride, incremental blocks and refine all allocate through the hugepage policy as well.
+    vecIndex->SetParameter("HugePages", "2");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(line.Vectors(0, n), nullptr));
+
+    // Added vectors land in incremental blocks, whose records hold the new neighbor lists as well.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddIndex(line.Vectors(n, n), nullptr));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SaveIndex("testindices_colocate"));
+
+    for (bool memoryMap : { false, true }) {
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testindices_colocate", vecIndex, memoryMap));
+        BOOST_CHECK(vecIndex->GetNumSamples() == 2 * n);
+        // A mapped index keeps the packed rows of the file instead of copying them into records.
+        std::ptrdiff_t stride = (const char*)vecIndex->GetSample(1) - (const char*)vecIndex->GetSample(0);
+        if (memoryMap) BOOST_CHECK(stride == (std::ptrdiff_t)(sizeof(T) * line.m));
+        else BOOST_CHECK(stride > (std::ptrdiff_t)(sizeof(T) * line.m));
+        for (SPTAG::SizeType i = 0; i < 2 * n; i += 97) {
+            SPTAG::QueryResult res(line.Vector(i), 1, false);
+            vecIndex->SearchIndex(res);
+            BOOST_CHECK(res.GetResult(0)->VID == i);
+            BOOST_CHECK(memcmp(vecIndex->GetSample(i), line.Vector(i), sizeof(T) * line.m) == 0);
+        }
+    }
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(500));
+    std::shared_ptr<SPTAG::VectorIndex> refined;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->RefineIndex(refined));
+    SPTAG::QueryResult res(line.Vector(3000), 1, false);
+    refined->SearchIndex(res);
+    BOOST_CHECK(res.GetResult(0)->Dist == 0);
+    vecIndex.reset();
+}
+
+template <typename T>
+void CompressGraphTest(std::string distCalcMethod)
+{
+    SPTAG::SizeType n = 2000;
+    LineIndex<T> line(n, 10, distCalcMethod, "16");
+    auto& vecIndex = line.index;
+    auto vecset = line.Vectors(0, n);
+    vecIndex->SetParameter("CompressGraph", "1");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SaveIndex("testindices_compress"));
+
+    SPTAG::DimensionType neighborhoodSize = std::stoi(vecIndex->GetParameter("NeighborhoodSize"));
+    BOOST_CHECK(vecIndex->BufferSize()->at(2) < sizeof(SPTAG::SizeType) * neighborhoodSize * n);
+
+    for (bool memoryMap : { false, true }) {
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testindices_compress", vecIndex, memoryMap));
+        BOOST_CHECK(vecIndex->GetParameter("CompressGraph") == "1");
+        for (SPTAG::SizeType i = 0; i < n; i += 97) {
+            SPTAG::QueryResult res(line.Vector(i), 1, false);
+            vecIndex->SearchIndex(res);
+            BOOST_CHECK(res.GetResult(0)->VID == i);
+        }
+
+        // Interleaved batches fetch the packed lists ahead and decode them one stage later.
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SetParameter("SearchInterleave", "4"));
+        std::vector<SPTAG::QueryResult> batch;
+        batch.reserve(n / 97 + 1);
+        for (SPTAG::SizeType i = 0; i < n; i += 97) batch.emplace_back(line.Vector(i), 1, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(batch.data(), (int)batch.size()));
+        for (std::size_t i = 0; i < batch.size(); i++) BOOST_CHECK(batch[i].GetResult(0)->VID == (SPTAG::SizeType)(i * 97));
+    }
+
+    // The graph can no longer be updated, but deletes only mark the vectors.
+    BOOST_CHECK(SPTAG::ErrorCode::Success != vecIndex->AddIndex(vecset, nullptr));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(500));
+    SPTAG::QueryResult res(line.Vector(500), 1, false);
+    vecIndex->SearchIndex(res);
+    BOOST_CHECK(res.GetResult(0)->VID == 499 || res.GetResult(0)->VID == 501);
+    vecIndex.reset();
+
+    // A graph file that is not a compressed graph, is cut short, or does not match the samples is rejected by
+    // both loaders instead of being decoded.
+    std::string graphFile = "testindices_compress" + std::string(1, FolderSep) + "graph.bin", graph;
+    {
+        std::ifstream in(graphFile, std::ios::binary);
+        graph.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    BOOST_REQUIRE(graph.size() > 32);
+    std::vector<std::string> corrupted(4, graph);
+    corrupted[0][0] ^= 0x01;
+    corrupted[1].resize(graph.size() / 2);
+    *((std::uint64_t*)&corrupted[2][16]) += 1024 * 1024;
+    *((SPTAG::SizeType*)&corrupted[3][8]) = n - 1;
+    for (const std::string& bad : corrupted) {
+        {
+            std::ofstream out(graphFile, std::ios::binary | std::ios::trunc);
+            out.write(bad.data(), bad.size());
+        }
+        for (bool memoryMap : { false, true }) {
+            std::shared_ptr<SPTAG::VectorIndex> badIndex;
+            BOOST_CHECK(SPTAG::ErrorCode::Success != SPTAG::VectorIndex::LoadIndex("testindices_compress", badIndex, memoryMap));
+        }
+    }
+}
+
+template <typename T>
+void RebuildDuringSearchTest(std::string distCalcMethod)
+{
+    SPTAG::SizeType n = 2000, added = 2000;
+    LineIndex<T> line(n + added, 10, distCalcMethod, "4");
+    auto& vecIndex = line.index;
+    vecIndex->SetParameter("AddCountForRebuild", "100");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(line.Vectors(0, n), nullptr));
+
+    // Adds keep publishing rebuilt trees in the background while the searcher walks them. The trees grow with
+    // every rebuild that covers the added vectors, so the searcher sees a publish as a change of their size.
+    std::uint64_t builtTreeSize = vecIndex->BufferSize()->at(1);
+    std::atomic<bool> done(false), sawRebuild(false);
+    std::atomic<int> misses(0);
+    std::thread searcher([&]() {
+        for (SPTAG::SizeType i = 0; !done; i = (i + 37) % n) {
+            SPTAG::QueryResult res(line.Vector(i), 1, false);
+            vecIndex->SearchIndex(res);
+            if (res.GetResult(0)->VID != i) misses++;
+            if (vecIndex->BufferSize()->at(1) != builtTreeSize) sawRebuild = true;
+        }
+    });
+
+    for (SPTAG::SizeType begin = n; begin < n + added; begin += 100) {
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddIndex(line.Vectors(begin, 100), nullptr));
+    }
+    // Rebuilds run on the index thread pool, so the last one may still be going.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (!sawRebuild && std::chrono::steady_clock::now() < deadline) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    done = true;
+    searcher.join();
+    BOOST_CHECK(sawRebuild);
+    BOOST_CHECK(misses == 0);
+
+    for (SPTAG::SizeType i = 0; i < n + added; i += 97) {
+        SPTAG::QueryResult res(line.Vector(i), 1, false);
+        vecIndex->SearchIndex(res);
+        BOOST_CHECK(res.GetResult(0)->VID == i);
+    }
+    vecIndex.reset();
+}
+
+template <typename T>
+void ParallelAddTest(std::string distCalcMethod)
+{
+    SPTAG::SizeType n = 1000, added = 3000;
+    LineIndex<T> line(n + added, 10, distCalcMethod, "4");
+    auto& vecIndex = line.index;
+    vecIndex->SetParameter("AddCountForRebuild", "100000");
+    vecIndex->SetParameter("AddNumberOfThreads", "4");
+    vecIndex->SetParameter("AddBatchCandidates", "16");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(line.Vectors(0, n), nullptr));
+
+    // The new vectors lie outside the trees, so searches can only reach them through the links added here.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddIndex(line.Vectors(n, added), nullptr));
+    BOOST_CHECK(vecIndex->GetNumSamples() == n + added);
+
+    for (SPTAG::SizeType i = 0; i < n + added; i += 31) {
+        SPTAG::QueryResult res(line.Vector(i), 1, false);
+        vecIndex->SearchIndex(res);
+        BOOST_CHECK(res.GetResult(0)->VID == i);
+    }
+    vecIndex.reset();
+}
+
+template <typename T>
+void ConsolidateDeletesTest(std::string distCalcMethod)
+{
+    SPTAG::SizeType n = 2000, added = 1000;
+    LineIndex<T> line(n + added, 10, distCalcMethod, "4");
+    auto& vecIndex = line.index;
+    vecIndex->SetParameter("AddCountForRebuild", "100000");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(line.Vectors(0, n), nullptr));
+
+    SPTAG::SizeType deleted = 0;
+    for (SPTAG::SizeType i = 0; i < n; i += 3, deleted++) BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(i));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->ConsolidateDeletes());
+
+    // The repaired lists still lead to every live vector.
+    for (SPTAG::SizeType i = 1; i < n; i += 3) {
+        SPTAG::QueryResult res(line.Vector(i), 1, false);
+        vecIndex->SearchIndex(res);
+        BOOST_CHECK(res.GetResult(0)->VID == i);
+    }
+
+    // New vectors take the deleted ids the trees do not route by first and only the rest grows the index.
+    std::vector<SPTAG::SizeType> ids;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddIndexRecycled(line.Vector(n), added, line.m, ids));
+    BOOST_CHECK(ids.size() == added);
+    SPTAG::SizeType recycled = n + added - vecIndex->GetNumSamples();
+    BOOST_CHECK(recycled > 0 && recycled < deleted);
+    BOOST_CHECK(vecIndex->GetNumDeleted() == deleted - recycled);
+    for (SPTAG::SizeType j = 0; j < added; j++) {
+        if (j < recycled) BOOST_CHECK(ids[j] % 3 == 0 && ids[j] < n);
+        SPTAG::QueryResult res(line.Vector(n + j), 1, false);
+        vecIndex->SearchIndex(res);
+        BOOST_CHECK(res.GetResult(0)->VID == ids[j]);
+        BOOST_CHECK(res.GetResult(0)->Dist == 0);
+    }
+    vecIndex.reset();
+}
+
+template <typename T>
+void RecycleCenterTest(std::string distCalcMethod)
+{
+    SPTAG::SizeType n = 4000, q = 100;
+    SPTAG::DimensionType m = 16;
+    int k = 10;
+    std::mt19937 rg(7);
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+    std::vector<T> vec(n * m), added(n / 2 * m), query(q * m);
+    for (auto& v : vec) v = (T)value(rg);
+    // Far away from every old vector, so a center overwritten by one of them would send searches astray.
+    for (auto& v : added) v = (T)(value(rg) + 1000.0f);
+    for (auto& v : query) v = (T)value(rg);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::GetEnumValueType<T>());
+    vecIndex->SetParameter("DistCalcMethod", distCalcMethod);
+    vecIndex->SetParameter("NumberOfThreads", "4");
+    vecIndex->SetParameter("AddCountForRebuild", "100000");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    // Deleting the first half deletes centers of every tree level, and the new vectors try to take all of their ids.
+    for (SPTAG::SizeType i = 0; i < n / 2; i++) BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(i));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->ConsolidateDeletes());
+    std::vector<SPTAG::SizeType> ids;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddIndexRecycled(added.data(), n / 2, m, ids));
+    BOOST_CHECK(vecIndex->GetNumDeleted() > 0);
+
+    int hits = 0;
+    for (SPTAG::SizeType i = 0; i < q; i++) {
+        const T* target = query.data() + i * m;
+        std::vector<std::pair<float, SPTAG::SizeType>> dists;
+        for (SPTAG::SizeType j = n / 2; j < n; j++) dists.emplace_back(vecIndex->ComputeDistance(target, vec.data() + j * m), j);
+        std::partial_sort(dists.begin(), dists.begin() + k, dists.end());
+
+        SPTAG::QueryResult res(target, k, false);
+        vecIndex->SearchIndex(res);
+        std::unordered_set<SPTAG::SizeType> found;
+        for (int j = 0; j < k; j++) found.insert(res.GetResult(j)->VID);
+        for (int j = 0; j < k; j++) if (found.count(dists[j].second)) hits++;
+    }
+    BOOST_CHECK_GE((float)hits / (q * k), 0.9f);
+    vecIndex.reset();
+}
+
+template <typename T>
+float ParallelBuildRecall(std::shared_ptr<SPTAG::VectorSet>& vecset, const std::vector<T>& query, SPTAG::SizeType q, int k, const std::vector<SPTAG::SizeType>& truth, const char* threads)
+{
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::GetEnumValueType<T>());
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", threads);
+    vecIndex->SetParameter("TPTNumber", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    int hits = 0;
+    for (SPTAG::SizeType i = 0; i < q; i++) {
+        SPTAG::QueryResult res(query.data() + i * vecset->Dimension(), k, false);
+        vecIndex->SearchIndex(res);
+        std::unordered_set<SPTAG::SizeType> found;
+        for (int j = 0; j < k; j++) found.insert(res.GetResult(j)->VID);
+        for (int j = 0; j < k; j++) if (found.count(truth[i * k + j])) hits++;
+    }
+    return (float)hits / (q * k);
+}
+
+template <typename T>
+void ParallelTreeBuildTest(std::string distCalcMethod)
+{
+    SPTAG::SizeType n = 4000, q = 100;
+    SPTAG::DimensionType m = 16;
+    int k = 10, threads = 4;
+    std::mt19937 rg(5);
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+    std::vector<T> vec(n * m), query(q * m);
+    for (auto& v : vec) v = (T)value(rg);
+    for (auto& v : query) v = (T)value(rg);
+
+    // Big enough that the clusters below N / (16 * threads) are built as parallel tasks and spliced in.
+    SPTAG::COMMON::Dataset<T> data(n, m, 1024 * 1024, n, vec.data(), false);
+    SPTAG::DistCalcMethod distMethod = SPTAG::DistCalcMethod::L2;
+    BOOST_CHECK(SPTAG::Helper::Convert::ConvertStringTo<SPTAG::DistCalcMethod>(distCalcMethod.c_str(), distMethod));
+    SPTAG::COMMON::BKTree tree, rebuilt;
+    std::srand(7);
+    tree.BuildTrees<T>(data, distMethod, threads);
+
+    // Every task seeds its kmeans from the cluster it splits, so the same global seed gives the same tree
+    // whichever thread builds which cluster.
+    std::srand(7);
+    rebuilt.BuildTrees<T>(data, distMethod, threads);
+    BOOST_REQUIRE(rebuilt.size() == tree.size());
+    for (SPTAG::SizeType i = 0; i < tree.size(); i++) {
+        BOOST_CHECK(rebuilt[i].centerid == tree[i].centerid);
+        BOOST_CHECK(rebuilt[i].childStart == tree[i].childStart);
+        BOOST_CHECK(rebuilt[i].childEnd == tree[i].childEnd);
+    }
+
+    // Node 0 is the root and the last node closes the tree. Every other node is the child of exactly one
+    // node, and holds a sample of its own, as a leaf or as a cluster center.
+    SPTAG::SizeType nodes = tree.size();
+    BOOST_REQUIRE(nodes > 2);
+    BOOST_CHECK(tree[0].centerid == n);
+    BOOST_CHECK(tree[nodes - 1].centerid == -1);
+    std::vector<int> parents(nodes, 0), samples(n, 0);
+    for (SPTAG::SizeType i = 0; i < nodes - 1; i++) {
+        const SPTAG::COMMON::BKTNode& node = tree[i];
+        if (i > 0) {
+            BOOST_REQUIRE(node.centerid >= 0 && node.centerid < n);
+            samples[node.centerid]++;
+        }
+        if (node.childStart == -1) continue;
+
+        SPTAG::SizeType start = (node.childStart < 0) ? -node.childStart : node.childStart;
+        BOOST_REQUIRE(start > i && start <= node.childEnd && node.childEnd < nodes);
+        for (SPTAG::SizeType j = start; j < node.childEnd; j++) parents[j]++;
+    }
+    BOOST_CHECK(parents[0] == 0 && parents[nodes - 1] == 0);
+    for (SPTAG::SizeType i = 1; i < nodes - 1; i++) BOOST_CHECK(parents[i] == 1);
+    for (SPTAG::SizeType i = 0; i < n; i++) BOOST_CHECK(samples[i] == 1);
+
+    std::vector<SPTAG::SizeType> truth(q * k);
+    for (SPTAG::SizeType i = 0; i < q; i++) {
+        std::vector<std::pair<float, SPTAG::SizeType>> dists(n);
+        for (SPTAG::SizeType j = 0; j < n; j++) {
+            float d = 0;
+            for (SPTAG::DimensionType l = 0; l < m; l++) {
+                float diff = (float)query[i * m + l] - (float)vec[j * m + l];
+                d += diff * diff;
+            }
+            dists[j] = std::make_pair(d, j);
+        }
+        std::partial_sort(dists.begin(), dists.begin() + k, dists.end());
+        for (int j = 0; j < k; j++) truth[i * k + j] = dists[j].second;
+    }
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    float serialRecall = ParallelBuildRecall<T>(vecset, query, q, k, truth, "1");
+    float parallelRecall = ParallelBuildRecall<T>(vecset, query, q, k, truth, std::to_string(threads).c_str());
+    BOOST_TEST_MESSAGE("Recall@" << k << " single threaded build " << serialRecall << ", " << threads << " threads " << parallelRecall);
+    BOOST_CHECK_GE(parallelRecall, serialRecall - 0.02f);
+}
+
+template <typename T>
+void InterleaveBatchTest(std::string distCalcMethod)
+{
+    SPTAG::SizeType n = 4000;
+    SPTAG::DimensionType m = 16;
+    int q = 301, k = 10;
+    std::mt19937 rg(11);
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+    std::vector<T> vec(n * m), query(q * m);
+    for (auto& v : vec) v = (T)value(rg);
+    for (auto& v : query) v = (T)value(rg);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::GetEnumValueType<T>());
+    vecIndex->SetParameter("DistCalcMethod", distCalcMethod);
+    vecIndex->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    std::vector<SPTAG::QueryResult> single;
+    single.reserve(q);
+    for (int i = 0; i < q; i++)
+    {
+        single.emplace_back(query.data() + i * m, k, false);
+        vecIndex->SearchIndex(single.back());
+    }
+
+    // The odd query count leaves a short last group for every interleave above 1.
+    for (const char* interleave : { "1", "2", "4" })
+    {
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SetParameter("SearchInterleave", interleave));
+        std::vector<SPTAG::QueryResult> batch;
+        batch.reserve(q);
+        for (int i = 0; i < q; i++) batch.emplace_back(query.data() + i * m, k, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(batch.data(), q));
+
+        int mismatches = 0;
+        for (int i = 0; i < q; i++)
+        {
+            for (int j = 0; j < k; j++)
+            {
+                if (batch[i].GetResult(j)->VID != single[i].GetResult(j)->VID || batch[i].GetResult(j)->Dist != single[i].GetResult(j)->Dist) mismatches++;
+            }
+        }
+        BOOST_CHECK_MESSAGE(mismatches == 0, "SearchInterleave " << interleave << ": " << mismatches << " results differ from single query search");
+    }
+    vecIndex.reset();
 }
 
 BOOST_AUTO_TEST_SUITE (AlgoTest)
@@ -189,4 +743,54 @@ BOOST_AUTO_TEST_CASE(BKTTest)
     Test<float>(SPTAG::IndexAlgoType::BKT, "L2");
 }
 
+BOOST_AUTO_TEST_CASE(BKTParallelTreeBuildTest)
+{
+    ParallelTreeBuildTest<float>("L2");
+}
+
+BOOST_AUTO_TEST_CASE(BKTInterleaveBatchTest)
+{
+    InterleaveBatchTest<float>("L2");
+}
+
+BOOST_AUTO_TEST_CASE(BKTReorderIDsTest)
+{
+    ReorderIDsTest<float>("L2");
+}
+
+BOOST_AUTO_TEST_CASE(BKTCoLocateGraphTest)
+{
+    CoLocateGraphTest<float>("L2");
+}
+
+BOOST_AUTO_TEST_CASE(BKTCompressGraphTest)
+{
+    CompressGraphTest<float>("L2");
+}
+
+BOOST_AUTO_TEST_CASE(BKTRebuildDuringSearchTest)
+{
+    RebuildDuringSearchTest<float>("L2");
+}
+
+BOOST_AUTO_TEST_CASE(BKTParallelAddTest)
+{
+    ParallelAddTest<float>("L2");
+}
+
+BOOST_AUTO_TEST_CASE(BKTConsolidateDeletesTest)
+{
+    ConsolidateDeletesTest<float>("L2");
+}
+
+BOOST_AUTO_TEST_CASE(BKTRecycleCenterTest)
+{
+    RecycleCenterTest<float>("L2");
+}
+
+BOOST_AUTO_TEST_CASE(BKTFloat16Test)
+{
+    Test<SPTAG::Float16>(SPTAG::IndexAlgoType::BKT, "L2");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,98 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Helper/AsyncFileReader.h"
+
+#include <fstream>
+#include <random>
+
+namespace
+{
+    const int PageCount = 256;
+    const int BatchSize = 64;
+    const char* TestFile = "async_read_test.bin";
+
+    void WriteTestFile()
+    {
+        std::ofstream out(TestFile, std::ios::binary);
+        std::vector<std::uint32_t> page(SPTAG::PageSize / sizeof(std::uint32_t));
+        for (int i = 0; i < PageCount; i++)
+        {
+            for (size_t j = 0; j < page.size(); j++) page[j] = static_cast<std::uint32_t>(i * page.size() + j);
+            out.write(reinterpret_cast<const char*>(page.data()), SPTAG::PageSize);
+        }
+        out.close();
+    }
+
+    void CheckBatchRead(SPTAG::Helper::DiskPriorityIO& p_io)
+    {
+        std::mt19937 rg(0);
+        std::vector<int> pages(BatchSize);
+        std::vector<SPTAG::Helper::AsyncReadRequest> requests(BatchSize);
+        std::vector<SPTAG::Helper::AsyncReadRequest*> requestPtrs(BatchSize);
+        std::unique_ptr<char[]> buffer(new char[(size_t)BatchSize * 2 * SPTAG::PageSize]);
+        int callbacks = 0;
+        for (int i = 0; i < BatchSize; i++)
+        {
+            pages[i] = rg() % (PageCount - 1);
+            requests[i].m_offset = (std::uint64_t)pages[i] * SPTAG::PageSize;
+            requests[i].m_readSize = (i % 2 + 1) * SPTAG::PageSize;
+            requests[i].m_buffer = buffer.get() + (size_t)i * 2 * SPTAG::PageSize;
+            requests[i].m_callback = [&callbacks](bool success) { if (success) callbacks++; };
+            requestPtrs[i] = &(requests[i]);
+        }
+
+        BOOST_CHECK_EQUAL(BatchSize, p_io.BatchReadFile(requestPtrs.data(), BatchSize));
+        BOOST_CHECK_EQUAL(BatchSize, callbacks);
+
+        for (int i = 0; i < BatchSize; i++)
+        {
+            BOOST_CHECK(requests[i].m_success);
+            std::uint32_t* values = reinterpret_cast<std::uint32_t*>(requests[i].m_buffer);
+            size_t count = requests[i].m_readSize / sizeof(std::uint32_t);
+            std::uint32_t start = static_cast<std::uint32_t>(pages[i] * (SPTAG::PageSize / sizeof(std::uint32_t)));
+            BOOST_CHECK_EQUAL(start, values[0]);
+            BOOST_CHECK_EQUAL(start + count - 1, values[count - 1]);
+        }
+
+        // A read past the end of file must be reported as failed.
+        SPTAG::Helper::AsyncReadRequest tail;
+        tail.m_offset = (std::uint64_t)(PageCount - 1) * SPTAG::PageSize;
+        tail.m_readSize = 2 * SPTAG::PageSize;
+        tail.m_buffer = buffer.get();
+        SPTAG::Helper::AsyncReadRequest* tailPtr = &tail;
+        BOOST_CHECK_EQUAL(0, p_io.BatchReadFile(&tailPtr, 1));
+        BOOST_CHECK(!tail.m_success);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(AsyncFileReaderTest)
+
+BOOST_AUTO_TEST_CASE(SimpleFileBatchReadTest)
+{
+    WriteTestFile();
+    SPTAG::Helper::SimpleFileIO io;
+    BOOST_REQUIRE(io.Initialize(TestFile, std::ios::binary | std::ios::in));
+    CheckBatchRead(io);
+    io.ShutDown();
+    remove(TestFile);
+}
+
+#ifdef IO_URING_READ
+BOOST_AUTO_TEST_CASE(IOUringBatchReadTest)
+{
+    WriteTestFile();
+    SPTAG::Helper::IOUringFileIO io;
+    BOOST_REQUIRE(io.Initialize(TestFile, std::ios::binary | std::ios::in));
+    BOOST_REQUIRE_MESSAGE(io.RingAvailable(), "io_uring cannot be set up on this system");
+    CheckBatchRead(io);
+    // Every request, the failing one past the end included, went through the ring and not the serial fallback.
+    BOOST_CHECK(io.RingAvailable());
+    BOOST_CHECK_EQUAL(BatchSize + 1, io.RingReadCount());
+    io.ShutDown();
+    remove(TestFile);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
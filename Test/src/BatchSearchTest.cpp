@@ -0,0 +1,219 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Socket/RemoteSearchQuery.h"
+#include "inc/Socket/SimpleSerialization.h"
+#include "inc/Server/SearchService.h"
+#include "inc/Core/VectorIndex.h"
+
+#include <cstring>
+
+namespace
+{
+    const SPTAG::DimensionType Dim = 8;
+
+    std::vector<float> GenerateVectors(SPTAG::SizeType n)
+    {
+        std::vector<float> vec(n * Dim);
+        for (SPTAG::SizeType i = 0; i < n; i++)
+        {
+            for (SPTAG::DimensionType j = 0; j < Dim; j++) vec[i * Dim + j] = (float)((i * 7 + j * 13) % 101);
+        }
+        return vec;
+    }
+
+    SPTAG::Socket::RemoteBatchQuery MakeQuery(const std::vector<float>& vec, const std::vector<std::int32_t>& resultNums)
+    {
+        SPTAG::Socket::RemoteBatchQuery query;
+        query.m_indexNames = "batch";
+        query.m_valueType = SPTAG::VectorValueType::Float;
+        query.m_dimension = Dim;
+        query.m_extractMetadata = false;
+        query.m_resultNums = resultNums;
+        query.m_vectors = SPTAG::ByteArray::Alloc(sizeof(float) * Dim * resultNums.size());
+        std::memcpy(query.m_vectors.Data(), vec.data(), query.m_vectors.Length());
+        return query;
+    }
+
+    std::vector<std::uint8_t> Serialize(const SPTAG::Socket::RemoteBatchQuery& query)
+    {
+        std::vector<std::uint8_t> buffer(query.EstimateBufferSize());
+        BOOST_REQUIRE(query.Write(buffer.data()) == buffer.data() + buffer.size());
+        return buffer;
+    }
+
+    // The query count is written right after the versions, the index names, value type, dimension and metadata flag.
+    std::size_t CountOffset(const SPTAG::Socket::RemoteBatchQuery& query)
+    {
+        return 2 * sizeof(std::uint16_t) + sizeof(std::uint32_t) + query.m_indexNames.size()
+            + sizeof(SPTAG::VectorValueType) + sizeof(SPTAG::DimensionType) + sizeof(bool);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(BatchSearchTest)
+
+BOOST_AUTO_TEST_CASE(QueryRoundTripTest)
+{
+    auto vec = GenerateVectors(3);
+    auto query = MakeQuery(vec, { 1, 5, 10 });
+    auto buffer = Serialize(query);
+
+    SPTAG::Socket::RemoteBatchQuery read;
+    BOOST_CHECK(read.Read(buffer.data(), buffer.size()) == buffer.data() + buffer.size());
+    BOOST_CHECK(read.m_indexNames == query.m_indexNames);
+    BOOST_CHECK(read.m_valueType == query.m_valueType);
+    BOOST_CHECK(read.m_dimension == query.m_dimension);
+    BOOST_CHECK(read.m_extractMetadata == query.m_extractMetadata);
+    BOOST_CHECK(read.m_resultNums == query.m_resultNums);
+    BOOST_REQUIRE(read.m_vectors.Length() == query.m_vectors.Length());
+    BOOST_CHECK(std::memcmp(read.m_vectors.Data(), query.m_vectors.Data(), query.m_vectors.Length()) == 0);
+    BOOST_CHECK(read.QueryCount() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(QueryRejectTest)
+{
+    auto vec = GenerateVectors(3);
+    auto query = MakeQuery(vec, { 1, 5, 10 });
+    auto buffer = Serialize(query);
+    std::size_t countOffset = CountOffset(query);
+
+    // Every truncation, including one inside the vectors, is caught instead of read past the end.
+    for (std::size_t length = 0; length < buffer.size(); length++)
+    {
+        SPTAG::Socket::RemoteBatchQuery read;
+        BOOST_CHECK(read.Read(buffer.data(), length) == nullptr);
+    }
+
+    // Counts the packet cannot hold are rejected before anything is allocated for them.
+    for (std::uint32_t count : { 0u, 0xFFFFFFFFu, static_cast<std::uint32_t>(buffer.size()) })
+    {
+        auto bad = buffer;
+        SPTAG::Socket::SimpleSerialization::SimpleWriteBuffer(count, bad.data() + countOffset);
+        SPTAG::Socket::RemoteBatchQuery read;
+        BOOST_CHECK(read.Read(bad.data(), bad.size()) == nullptr);
+        BOOST_CHECK(read.m_resultNums.size() <= 3);
+    }
+
+    for (std::int32_t resultNum : { 0, -1 })
+    {
+        auto bad = buffer;
+        SPTAG::Socket::SimpleSerialization::SimpleWriteBuffer(resultNum, bad.data() + countOffset + sizeof(std::uint32_t) + sizeof(std::int32_t));
+        SPTAG::Socket::RemoteBatchQuery read;
+        BOOST_CHECK(read.Read(bad.data(), bad.size()) == nullptr);
+    }
+
+    auto bad = buffer;
+    SPTAG::Socket::SimpleSerialization::SimpleWriteBuffer((SPTAG::DimensionType)0, bad.data() + countOffset - sizeof(bool) - sizeof(SPTAG::DimensionType));
+    SPTAG::Socket::RemoteBatchQuery read;
+    BOOST_CHECK(read.Read(bad.data(), bad.size()) == nullptr);
+
+    // A vector length prefix larger than the rest of the packet.
+    bad = buffer;
+    SPTAG::Socket::SimpleSerialization::SimpleWriteBuffer(static_cast<std::uint32_t>(query.m_vectors.Length() + 1), bad.data() + countOffset + sizeof(std::uint32_t) + 3 * sizeof(std::int32_t));
+    BOOST_CHECK(read.Read(bad.data(), bad.size()) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(ResultRoundTripTest)
+{
+    SPTAG::Socket::RemoteBatchSearchResult result;
+    result.m_status = SPTAG::Socket::RemoteSearchResult::ResultStatus::Success;
+    result.m_queryResults.resize(2);
+    for (int i = 0; i < 2; i++)
+    {
+        auto& queryResult = result.m_queryResults[i];
+        queryResult.m_status = SPTAG::Socket::RemoteSearchResult::ResultStatus::Success;
+        queryResult.m_allIndexResults.emplace_back();
+        queryResult.m_allIndexResults.back().m_indexName = "batch";
+        queryResult.m_allIndexResults.back().m_results.Init(nullptr, 2, false);
+        queryResult.m_allIndexResults.back().m_results.SetResult(0, i, 0.5f);
+        queryResult.m_allIndexResults.back().m_results.SetResult(1, i + 10, 1.5f);
+    }
+
+    std::vector<std::uint8_t> buffer(result.EstimateBufferSize());
+    BOOST_REQUIRE(result.Write(buffer.data()) == buffer.data() + buffer.size());
+
+    SPTAG::Socket::RemoteBatchSearchResult read;
+    BOOST_CHECK(read.Read(buffer.data(), buffer.size()) == buffer.data() + buffer.size());
+    BOOST_CHECK(read.m_status == result.m_status);
+    BOOST_REQUIRE(read.m_queryResults.size() == 2);
+    for (int i = 0; i < 2; i++)
+    {
+        BOOST_REQUIRE(read.m_queryResults[i].m_allIndexResults.size() == 1);
+        const auto& indexResult = read.m_queryResults[i].m_allIndexResults[0];
+        BOOST_CHECK(indexResult.m_indexName == "batch");
+        BOOST_REQUIRE(indexResult.m_results.GetResultNum() == 2);
+        BOOST_CHECK(indexResult.m_results.GetResult(0)->VID == i && indexResult.m_results.GetResult(0)->Dist == 0.5f);
+        BOOST_CHECK(indexResult.m_results.GetResult(1)->VID == i + 10 && indexResult.m_results.GetResult(1)->Dist == 1.5f);
+    }
+
+    auto bad = buffer;
+    SPTAG::Socket::SimpleSerialization::SimpleWriteBuffer(0xFFFFFFFFu, bad.data() + 2 * sizeof(std::uint16_t) + sizeof(SPTAG::Socket::RemoteSearchResult::ResultStatus));
+    BOOST_CHECK(read.Read(bad.data(), bad.size()) == nullptr);
+
+    // Every truncation, including one inside a nested query result, is caught instead of read past the end.
+    for (std::size_t length = 0; length < buffer.size(); length++)
+    {
+        SPTAG::Socket::RemoteBatchSearchResult truncated;
+        BOOST_CHECK(truncated.Read(buffer.data(), length) == nullptr);
+    }
+
+    // A result count in the first query result that the packet cannot hold.
+    bad = buffer;
+    std::size_t resultCountOffset = 2 * sizeof(std::uint16_t) + sizeof(SPTAG::Socket::RemoteSearchResult::ResultStatus) + sizeof(std::uint32_t)
+        + 2 * sizeof(std::uint16_t) + sizeof(SPTAG::Socket::RemoteSearchResult::ResultStatus) + sizeof(std::uint32_t)
+        + sizeof(std::uint32_t) + std::strlen("batch");
+    SPTAG::Socket::SimpleSerialization::SimpleWriteBuffer(0xFFFFFFFFu, bad.data() + resultCountOffset);
+    BOOST_CHECK(read.Read(bad.data(), bad.size()) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(SearchBatchTest)
+{
+    SPTAG::SizeType n = 500;
+    auto vec = GenerateVectors(n);
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::Float);
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", "2");
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vec.data(), n, Dim));
+    vecIndex->SetIndexName("batch");
+    std::map<std::string, std::shared_ptr<SPTAG::VectorIndex>> indexMap;
+    indexMap["batch"] = vecIndex;
+
+    // The request goes through the wire format first, as it does in the handler.
+    std::vector<std::int32_t> resultNums = { 1, 3, 5, 10, 2000 };
+    auto buffer = Serialize(MakeQuery(vec, resultNums));
+    SPTAG::Socket::RemoteBatchQuery query;
+    BOOST_REQUIRE(query.Read(buffer.data(), buffer.size()) != nullptr);
+
+    auto result = SPTAG::Service::SearchService::SearchBatch(query, indexMap);
+    BOOST_CHECK(result.m_status == SPTAG::Socket::RemoteSearchResult::ResultStatus::Success);
+    BOOST_REQUIRE(result.m_queryResults.size() == resultNums.size());
+    for (std::size_t i = 0; i < resultNums.size(); i++)
+    {
+        BOOST_REQUIRE(result.m_queryResults[i].m_allIndexResults.size() == 1);
+        const auto& batchResults = result.m_queryResults[i].m_allIndexResults[0].m_results;
+        BOOST_CHECK(batchResults.GetResultNum() == std::min(resultNums[i], (std::int32_t)n));
+
+        SPTAG::QueryResult single(vec.data() + i * Dim, batchResults.GetResultNum(), false);
+        vecIndex->SearchIndex(single);
+        for (int j = 0; j < batchResults.GetResultNum(); j++)
+        {
+            BOOST_CHECK(batchResults.GetResult(j)->VID == single.GetResult(j)->VID);
+            BOOST_CHECK(batchResults.GetResult(j)->Dist == single.GetResult(j)->Dist);
+        }
+    }
+
+    // Unknown indexes and vectors of the wrong size fail every query instead of searching.
+    query.m_indexNames = "missing";
+    result = SPTAG::Service::SearchService::SearchBatch(query, indexMap);
+    BOOST_CHECK(result.m_status == SPTAG::Socket::RemoteSearchResult::ResultStatus::FailedExecute);
+    for (const auto& queryResult : result.m_queryResults) BOOST_CHECK(queryResult.m_allIndexResults.empty());
+
+    query.m_indexNames = "batch";
+    query.m_vectors = SPTAG::ByteArray::Alloc(sizeof(float) * Dim);
+    result = SPTAG::Service::SearchService::SearchBatch(query, indexMap);
+    BOOST_CHECK(result.m_status == SPTAG::Socket::RemoteSearchResult::ResultStatus::FailedExecute);
+    BOOST_CHECK(result.m_queryResults.size() == resultNums.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
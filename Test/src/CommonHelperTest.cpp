@@ -3,8 +3,11 @@
 
 #include "inc/Test.h"
 #include "inc/Helper/CommonHelper.h"
+#include "inc/Helper/PageAllocator.h"
+#include "inc/Helper/Numa.h"
 
 #include <memory>
+#include <thread>
 
 BOOST_AUTO_TEST_SUITE(CommonHelperTest)
 
@@ -90,4 +93,43 @@ BOOST_AUTO_TEST_CASE(StrEqualIgnoreCaseTest)
 
 
 
+BOOST_AUTO_TEST_CASE(AllocatePagesTest)
+{
+    using SPTAG::Helper::PagePolicy;
+    for (PagePolicy policy : { PagePolicy::Default, PagePolicy::TransparentHuge, PagePolicy::ExplicitHuge })
+    {
+        // Explicit hugepages fall back when the pool is empty, so every policy has to hand out usable memory.
+        for (std::size_t size : { (std::size_t)100, (std::size_t)(5 * 1024 * 1024 + 3) })
+        {
+            std::uint8_t* p = (std::uint8_t*)SPTAG::Helper::AllocatePages(size, policy);
+            BOOST_CHECK(p != nullptr);
+            BOOST_CHECK(((std::uintptr_t)p) % 32 == 0);
+            for (std::size_t i = 0; i < size; i++) p[i] = (std::uint8_t)i;
+            BOOST_CHECK(p[size - 1] == (std::uint8_t)(size - 1));
+            SPTAG::Helper::FreePages(p);
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(NumaNodeTest)
+{
+    int nodes = SPTAG::Helper::NumaNodeCount();
+    BOOST_CHECK(nodes >= 1);
+    BOOST_CHECK(SPTAG::Helper::CurrentNumaNode() == 0);
+    BOOST_CHECK(!SPTAG::Helper::BindThreadToNumaNode(nodes));
+
+    // Binding on a helper thread leaves the test thread alone.
+    int boundNode = -1;
+    std::thread worker([&]()
+        {
+            if (SPTAG::Helper::BindThreadToNumaNode(nodes - 1)) boundNode = SPTAG::Helper::CurrentNumaNode();
+        });
+    worker.join();
+    BOOST_CHECK(boundNode == -1 || boundNode == nodes - 1);
+    BOOST_CHECK(SPTAG::Helper::CurrentNumaNode() == 0);
+    BOOST_CHECK(SPTAG::Helper::SetInterleaveMemory(false));
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -46,6 +46,85 @@ void test(int high) {
     delete[] Y;
 }
 
+template<typename T>
+void testKernels(int high, int low, int base,
+    float(*l2)(const T*, const T*, SPTAG::DimensionType), float(*cosine)(const T*, const T*, SPTAG::DimensionType))
+{
+    // Cover every tail length of the widest vector loop, plus the extreme values.
+    for (SPTAG::DimensionType dimension = 1; dimension <= 130; dimension++) {
+        std::vector<T> X(dimension), Y(dimension);
+        for (SPTAG::DimensionType i = 0; i < dimension; i++) {
+            X[i] = (i % 7 == 0) ? (T)high : random<T>(high, low);
+            Y[i] = (i % 5 == 0) ? (T)low : random<T>(high, low);
+        }
+        BOOST_CHECK_CLOSE_FRACTION(ComputeL2Distance(X.data(), Y.data(), dimension), l2(X.data(), Y.data(), dimension), 1e-5);
+        // The dot product may cancel out, so bound the error by the magnitude of the terms instead.
+        BOOST_CHECK_SMALL((float)base * base - ComputeCosineDistance(X.data(), Y.data(), dimension) - cosine(X.data(), Y.data(), dimension), 1e-6f * base * base * dimension);
+    }
+}
+
+template<typename T>
+void testHalfKernels(float(*l2)(const T*, const T*, SPTAG::DimensionType), float(*cosine)(const T*, const T*, SPTAG::DimensionType))
+{
+    for (SPTAG::DimensionType dimension = 1; dimension <= 40; dimension++) {
+        std::vector<T> X(dimension), Y(dimension);
+        for (SPTAG::DimensionType i = 0; i < dimension; i++) {
+            X[i] = random<float>(1, -1);
+            Y[i] = random<float>(1, -1);
+        }
+        // The reference runs on the same rounded values, so only the summation order differs.
+        BOOST_CHECK_CLOSE_FRACTION(ComputeL2Distance(X.data(), Y.data(), dimension), l2(X.data(), Y.data(), dimension), 1e-4);
+        BOOST_CHECK_SMALL(1 - ComputeCosineDistance(X.data(), Y.data(), dimension) - cosine(X.data(), Y.data(), dimension), 1e-4f);
+    }
+}
+
+template<int Bits>
+void testPQKernels(float(*adc)(const float*, const std::uint8_t*, SPTAG::DimensionType, SPTAG::SizeType),
+    float(*sdc)(const float*, const std::uint8_t*, const std::uint8_t*, SPTAG::DimensionType, SPTAG::SizeType))
+{
+    using SPTAG::COMMON::DistanceUtils;
+    SPTAG::SizeType ks = (Bits == 4) ? 16 : 256;
+    for (SPTAG::DimensionType subvectors = 1; subvectors <= 40; subvectors++) {
+        std::vector<float> table(subvectors * ks), tables(subvectors * ks * ks);
+        for (float& v : table) v = random<float>(100);
+        for (float& v : tables) v = random<float>(100);
+        std::vector<std::uint8_t> X((subvectors * Bits + 7) / 8), Y(X.size());
+        for (size_t i = 0; i < X.size(); i++) {
+            X[i] = random<std::uint8_t>(256);
+            Y[i] = random<std::uint8_t>(256);
+        }
+        BOOST_CHECK_CLOSE_FRACTION(DistanceUtils::ComputeADCDistance<Bits>(table.data(), Y.data(), subvectors, ks), adc(table.data(), Y.data(), subvectors, ks), 1e-5);
+        BOOST_CHECK_CLOSE_FRACTION(DistanceUtils::ComputeSDCDistance<Bits>(tables.data(), X.data(), Y.data(), subvectors, ks), sdc(tables.data(), X.data(), Y.data(), subvectors, ks), 1e-5);
+    }
+}
+
+template<int Bits>
+void testSQKernels(float(*l2)(const float*, const float*, const std::uint8_t*, SPTAG::DimensionType),
+    float(*dot)(const float*, const std::uint8_t*, SPTAG::DimensionType),
+    float(*sdcl2)(const float*, const std::uint8_t*, const std::uint8_t*, SPTAG::DimensionType),
+    float(*sdcdot)(const float*, const float*, const std::uint8_t*, const std::uint8_t*, SPTAG::DimensionType))
+{
+    using SPTAG::COMMON::DistanceUtils;
+    for (SPTAG::DimensionType dimension = 1; dimension <= 40; dimension++) {
+        std::vector<float> query(dimension), vmin(dimension), scale(dimension);
+        for (SPTAG::DimensionType i = 0; i < dimension; i++) {
+            query[i] = random<float>(10, -10);
+            vmin[i] = random<float>(1, -1);
+            scale[i] = random<float>(1, 0);
+        }
+        std::vector<std::uint8_t> X((dimension * Bits + 7) / 8), Y(X.size());
+        for (size_t i = 0; i < X.size(); i++) {
+            X[i] = random<std::uint8_t>(256);
+            Y[i] = random<std::uint8_t>(256);
+        }
+        // The dot products may cancel out, so bound their error by the magnitude of the terms instead.
+        BOOST_CHECK_CLOSE_FRACTION(DistanceUtils::ComputeSQL2Distance<Bits>(query.data(), scale.data(), Y.data(), dimension), l2(query.data(), scale.data(), Y.data(), dimension), 1e-4);
+        BOOST_CHECK_SMALL(DistanceUtils::ComputeSQDotProduct<Bits>(query.data(), Y.data(), dimension) - dot(query.data(), Y.data(), dimension), 1e-5f * 2560 * dimension);
+        BOOST_CHECK_CLOSE_FRACTION(DistanceUtils::ComputeSQSDCL2Distance<Bits>(scale.data(), X.data(), Y.data(), dimension), sdcl2(scale.data(), X.data(), Y.data(), dimension), 1e-4);
+        BOOST_CHECK_SMALL(DistanceUtils::ComputeSQSDCDotProduct<Bits>(vmin.data(), scale.data(), X.data(), Y.data(), dimension) - sdcdot(vmin.data(), scale.data(), X.data(), Y.data(), dimension), 1e-5f * 65536 * dimension);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE(DistanceTest)
 
 BOOST_AUTO_TEST_CASE(TestDistanceComputation)
@@ -55,4 +134,87 @@ BOOST_AUTO_TEST_CASE(TestDistanceComputation)
     test<std::int16_t>(32767);
 }
 
+BOOST_AUTO_TEST_CASE(TestHalfPrecision)
+{
+    using SPTAG::COMMON::DistanceUtils;
+    using SPTAG::COMMON::InstructionSet;
+
+    BOOST_CHECK_EQUAL(0x3c00, SPTAG::Float16(1.0f).Bits());
+    BOOST_CHECK_EQUAL(0xc000, SPTAG::Float16(-2.0f).Bits());
+    BOOST_CHECK_EQUAL(0x7bff, SPTAG::Float16(65504.0f).Bits());
+    BOOST_CHECK_EQUAL(0x7c00, SPTAG::Float16(1e6f).Bits());
+    BOOST_CHECK_EQUAL(0x0001, SPTAG::Float16(5.96046448e-8f).Bits());
+    BOOST_CHECK_EQUAL(0x3f80, SPTAG::BFloat16(1.0f).Bits());
+    BOOST_CHECK_EQUAL(0x4049, SPTAG::BFloat16(3.14159265f).Bits());
+    for (int i = -2048; i <= 2048; i++) BOOST_CHECK_EQUAL((float)i, (float)SPTAG::Float16((float)i));
+    for (int i = -256; i <= 256; i++) BOOST_CHECK_EQUAL((float)i, (float)SPTAG::BFloat16((float)i));
+
+    testHalfKernels<SPTAG::Float16>(&DistanceUtils::ComputeL2Distance<SPTAG::Float16>, &DistanceUtils::ComputeCosineDistance<SPTAG::Float16>);
+    testHalfKernels<SPTAG::BFloat16>(&DistanceUtils::ComputeL2Distance<SPTAG::BFloat16>, &DistanceUtils::ComputeCosineDistance<SPTAG::BFloat16>);
+    if (InstructionSet::F16C() && InstructionSet::AVX()) {
+        testHalfKernels<SPTAG::Float16>(&DistanceUtils::ComputeL2Distance_AVX, &DistanceUtils::ComputeCosineDistance_AVX);
+    }
+    if (InstructionSet::AVX2()) {
+        testHalfKernels<SPTAG::BFloat16>(&DistanceUtils::ComputeL2Distance_AVX, &DistanceUtils::ComputeCosineDistance_AVX);
+    }
+    if (InstructionSet::AVX512()) {
+        testHalfKernels<SPTAG::Float16>(&DistanceUtils::ComputeL2Distance_AVX512, &DistanceUtils::ComputeCosineDistance_AVX512);
+        testHalfKernels<SPTAG::BFloat16>(&DistanceUtils::ComputeL2Distance_AVX512, &DistanceUtils::ComputeCosineDistance_AVX512);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestAVX512Kernels)
+{
+    using SPTAG::COMMON::DistanceUtils;
+    using SPTAG::COMMON::InstructionSet;
+    if (InstructionSet::AVX512()) {
+        testKernels<float>(1, -1, 1, &DistanceUtils::ComputeL2Distance_AVX512, &DistanceUtils::ComputeCosineDistance_AVX512);
+        testKernels<std::int16_t>(32767, -32768, 32767, &DistanceUtils::ComputeL2Distance_AVX512, &DistanceUtils::ComputeCosineDistance_AVX512);
+        testKernels<std::int8_t>(127, -128, 127, &DistanceUtils::ComputeL2Distance_AVX512, &DistanceUtils::ComputeCosineDistance_AVX512);
+        testKernels<std::uint8_t>(255, 0, 255, &DistanceUtils::ComputeL2Distance_AVX512, &DistanceUtils::ComputeCosineDistance_AVX512);
+    }
+    if (InstructionSet::AVX512VNNI()) {
+        testKernels<std::int8_t>(127, -128, 127, &DistanceUtils::ComputeL2Distance_AVX512VNNI, &DistanceUtils::ComputeCosineDistance_AVX512VNNI);
+        testKernels<std::uint8_t>(255, 0, 255, &DistanceUtils::ComputeL2Distance_AVX512VNNI, &DistanceUtils::ComputeCosineDistance_AVX512VNNI);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestPQKernels)
+{
+    using SPTAG::COMMON::DistanceUtils;
+    using SPTAG::COMMON::InstructionSet;
+    if (InstructionSet::AVX2()) {
+        testPQKernels<8>(&DistanceUtils::ComputeADCDistance_AVX<8>, &DistanceUtils::ComputeSDCDistance_AVX<8>);
+        testPQKernels<4>(&DistanceUtils::ComputeADCDistance_AVX<4>, &DistanceUtils::ComputeSDCDistance_AVX<4>);
+
+        for (SPTAG::DimensionType pairs = 1; pairs <= 64; pairs *= 2) {
+            std::vector<std::uint8_t> lut(pairs * 32), block(pairs * 32);
+            for (std::uint8_t& v : lut) v = random<std::uint8_t>(256);
+            for (std::uint8_t& v : block) v = random<std::uint8_t>(256);
+            std::uint16_t expected[32], actual[32];
+            DistanceUtils::ComputeFastScanDistances(lut.data(), block.data(), pairs, expected);
+            DistanceUtils::ComputeFastScanDistances_AVX(lut.data(), block.data(), pairs, actual);
+            for (int k = 0; k < 32; k++) BOOST_CHECK_EQUAL(expected[k], actual[k]);
+        }
+    }
+    if (InstructionSet::AVX512()) {
+        testPQKernels<8>(&DistanceUtils::ComputeADCDistance_AVX512<8>, &DistanceUtils::ComputeSDCDistance_AVX512<8>);
+        testPQKernels<4>(&DistanceUtils::ComputeADCDistance_AVX512<4>, &DistanceUtils::ComputeSDCDistance_AVX512<4>);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestSQKernels)
+{
+    using SPTAG::COMMON::DistanceUtils;
+    using SPTAG::COMMON::InstructionSet;
+    if (InstructionSet::AVX2()) {
+        testSQKernels<8>(&DistanceUtils::ComputeSQL2Distance_AVX<8>, &DistanceUtils::ComputeSQDotProduct_AVX<8>, &DistanceUtils::ComputeSQSDCL2Distance_AVX<8>, &DistanceUtils::ComputeSQSDCDotProduct_AVX<8>);
+        testSQKernels<4>(&DistanceUtils::ComputeSQL2Distance_AVX<4>, &DistanceUtils::ComputeSQDotProduct_AVX<4>, &DistanceUtils::ComputeSQSDCL2Distance_AVX<4>, &DistanceUtils::ComputeSQSDCDotProduct_AVX<4>);
+    }
+    if (InstructionSet::AVX512()) {
+        testSQKernels<8>(&DistanceUtils::ComputeSQL2Distance_AVX512<8>, &DistanceUtils::ComputeSQDotProduct_AVX512<8>, &DistanceUtils::ComputeSQSDCL2Distance_AVX512<8>, &DistanceUtils::ComputeSQSDCDotProduct_AVX512<8>);
+        testSQKernels<4>(&DistanceUtils::ComputeSQL2Distance_AVX512<4>, &DistanceUtils::ComputeSQDotProduct_AVX512<4>, &DistanceUtils::ComputeSQSDCL2Distance_AVX512<4>, &DistanceUtils::ComputeSQSDCDotProduct_AVX512<4>);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,183 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/Common/QuantizerTrainer.h"
+
+#include <set>
+
+BOOST_AUTO_TEST_SUITE(QuantizerTrainerTest)
+
+BOOST_AUTO_TEST_CASE(SampleVectorIDsTest)
+{
+    std::mt19937 rg(7);
+    std::vector<SPTAG::SizeType> ids = SPTAG::COMMON::SampleVectorIDs(1000, 100, rg);
+    BOOST_CHECK(ids.size() == 100);
+    BOOST_CHECK(std::set<SPTAG::SizeType>(ids.begin(), ids.end()).size() == 100);
+    BOOST_CHECK(std::is_sorted(ids.begin(), ids.end()));
+    BOOST_CHECK(ids.front() >= 0 && ids.back() < 1000);
+
+    BOOST_CHECK(SPTAG::COMMON::SampleVectorIDs(50, 100, rg).size() == 50);
+}
+
+BOOST_AUTO_TEST_CASE(TrainPQTest)
+{
+    // Every subvector is drawn around one of 16 fixed points, so a trained codebook should
+    // reconstruct each vector up to the noise.
+    const SPTAG::SizeType n = 4000;
+    const SPTAG::DimensionType dim = 16, subvectors = 4, dsub = dim / subvectors;
+    const int points = 16;
+
+    std::mt19937 rg(1);
+    std::uniform_real_distribution<float> pointDist(-100.0f, 100.0f), noiseDist(-1.0f, 1.0f);
+    std::vector<float> centers(subvectors * points * dsub);
+    for (float& c : centers) c = pointDist(rg);
+
+    std::vector<float> vec(((size_t)n) * dim);
+    for (SPTAG::SizeType i = 0; i < n; i++) {
+        for (SPTAG::DimensionType m = 0; m < subvectors; m++) {
+            int p = std::uniform_int_distribution<int>(0, points - 1)(rg);
+            for (SPTAG::DimensionType j = 0; j < dsub; j++) {
+                vec[((size_t)i) * dim + m * dsub + j] = centers[(m * points + p) * dsub + j] + noiseDist(rg);
+            }
+        }
+    }
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(float) * vec.size(), false),
+        SPTAG::VectorValueType::Float, dim, n));
+
+    BOOST_CHECK(SPTAG::COMMON::TrainPQQuantizer<float>(vecset, 5, 32, 1000, 2) == nullptr);
+
+    auto quantizer = SPTAG::COMMON::TrainPQQuantizer<float>(vecset, subvectors, 32, 2000, 2);
+    BOOST_REQUIRE(quantizer != nullptr);
+    BOOST_CHECK(quantizer->GetNumSubvectors() == subvectors);
+    BOOST_CHECK(quantizer->QuantizeSize() == subvectors);
+
+    std::vector<std::uint8_t> code(subvectors);
+    std::vector<float> rec(dim);
+    float err = 0;
+    for (SPTAG::SizeType i = 0; i < n; i++) {
+        quantizer->QuantizeVector(vecset->GetVector(i), code.data());
+        quantizer->ReconstructVector(code.data(), rec.data());
+        for (SPTAG::DimensionType j = 0; j < dim; j++) {
+            float diff = rec[j] - vec[((size_t)i) * dim + j];
+            err += diff * diff;
+        }
+    }
+    err /= n;
+    std::cout << "PQ reconstruction error per vector: " << err << std::endl;
+    BOOST_CHECK(err < 4 * dim / 3.0f);
+}
+
+BOOST_AUTO_TEST_CASE(FastScanPQTest)
+{
+    const SPTAG::SizeType n = 1000;
+    const SPTAG::DimensionType dim = 24, subvectors = 12;
+
+    std::mt19937 rg(3);
+    std::uniform_real_distribution<float> valueDist(-10.0f, 10.0f);
+    std::vector<float> vec(((size_t)n) * dim);
+    for (float& v : vec) v = valueDist(rg);
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(float) * vec.size(), false),
+        SPTAG::VectorValueType::Float, dim, n));
+
+    BOOST_CHECK(SPTAG::COMMON::TrainPQQuantizer<float>(vecset, subvectors, 32, n, 2, 100, 0, true) == nullptr);
+    auto quantizer = SPTAG::COMMON::TrainPQQuantizer<float>(vecset, subvectors, 16, n, 2, 20, 0, true);
+    BOOST_REQUIRE(quantizer != nullptr);
+    BOOST_CHECK(quantizer->GetQuantizerType() == SPTAG::QuantizerType::PQ4Quantizer);
+    BOOST_CHECK(quantizer->QuantizeSize() == subvectors / 2);
+
+    SPTAG::SizeType codeSize = quantizer->QuantizeSize();
+    std::vector<std::uint8_t> codes(((size_t)n) * codeSize);
+    for (SPTAG::SizeType i = 0; i < n; i++) quantizer->QuantizeVector(vecset->GetVector(i), codes.data() + ((size_t)i) * codeSize);
+
+    // Fast scan distances approximate the exact ADC distances, which the quantized tables bound by half a step per subvector.
+    std::vector<std::uint8_t> table(quantizer->FastScanTableSize()), block(quantizer->FastScanBlockSize());
+    quantizer->QuantizeFastScanTable(vecset->GetVector(0), table.data());
+    float scale = ((const float*)(table.data() + quantizer->FastScanBlockSize()))[1];
+
+    quantizer->SetEnableADC(true);
+    std::vector<std::uint8_t> adcTable(quantizer->QuantizeSize());
+    quantizer->QuantizeVector(vecset->GetVector(0), adcTable.data());
+
+    float dists[32];
+    for (SPTAG::SizeType begin = 0; begin < n; begin += 32) {
+        SPTAG::SizeType num = std::min<SPTAG::SizeType>(32, n - begin);
+        quantizer->PackFastScanBlock(codes.data() + ((size_t)begin) * codeSize, codeSize, num, block.data());
+        quantizer->ComputeFastScanDistances(table.data(), block.data(), dists);
+        for (SPTAG::SizeType k = 0; k < num; k++) {
+            float exact = quantizer->L2Distance(adcTable.data(), codes.data() + ((size_t)begin + k) * codeSize);
+            BOOST_CHECK_SMALL(dists[k] - exact, scale * subvectors * 0.5f + 1e-3f);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TrainSQTest)
+{
+    const SPTAG::SizeType n = 1000;
+    const SPTAG::DimensionType dim = 37;
+
+    std::mt19937 rg(5);
+    std::vector<float> vec(((size_t)n) * dim);
+    for (SPTAG::SizeType i = 0; i < n; i++) {
+        for (SPTAG::DimensionType j = 0; j < dim; j++) {
+            vec[((size_t)i) * dim + j] = std::uniform_real_distribution<float>(-j - 1.0f, 2.0f * j + 1.0f)(rg);
+        }
+    }
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(float) * vec.size(), false),
+        SPTAG::VectorValueType::Float, dim, n));
+
+    for (bool fourBit : { false, true }) {
+        auto quantizer = SPTAG::COMMON::TrainSQQuantizer<float>(vecset, n, 2, 0, fourBit);
+        BOOST_REQUIRE(quantizer != nullptr);
+        BOOST_CHECK(quantizer->GetQuantizerType() == (fourBit ? SPTAG::QuantizerType::SQ4Quantizer : SPTAG::QuantizerType::SQ8Quantizer));
+        BOOST_CHECK(quantizer->QuantizeSize() == (fourBit ? (dim + 1) / 2 : dim));
+
+        // Every value is within half a step of its reconstruction.
+        SPTAG::SizeType codeSize = quantizer->QuantizeSize();
+        std::vector<std::uint8_t> codes(((size_t)n) * codeSize);
+        std::vector<float> rec(dim);
+        for (SPTAG::SizeType i = 0; i < n; i++) {
+            quantizer->QuantizeVector(vecset->GetVector(i), codes.data() + ((size_t)i) * codeSize);
+            quantizer->ReconstructVector(codes.data() + ((size_t)i) * codeSize, rec.data());
+            for (SPTAG::DimensionType j = 0; j < dim; j++) {
+                float step = (3.0f * j + 2.0f) / quantizer->GetLevels();
+                BOOST_CHECK_SMALL(rec[j] - vec[((size_t)i) * dim + j], step * 0.5f + 1e-3f);
+            }
+        }
+
+        // Save and load keep the codes, and ADC matches the distances to the reconstructed vectors.
+        auto ptr = SPTAG::f_createIO();
+        BOOST_REQUIRE(ptr != nullptr && ptr->Initialize("sqtest_quantizer.bin", std::ios::binary | std::ios::out));
+        BOOST_REQUIRE(quantizer->SaveQuantizer(ptr) == SPTAG::ErrorCode::Success);
+        ptr->ShutDown();
+        std::shared_ptr<SPTAG::COMMON::IQuantizer> loaded;
+        BOOST_REQUIRE(ptr->Initialize("sqtest_quantizer.bin", std::ios::binary | std::ios::in));
+        BOOST_REQUIRE(SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr, loaded) == SPTAG::ErrorCode::Success);
+        ptr->ShutDown();
+        BOOST_REQUIRE(loaded != nullptr);
+        BOOST_CHECK(loaded->GetQuantizerType() == quantizer->GetQuantizerType());
+
+        std::vector<std::uint8_t> code(codeSize);
+        loaded->QuantizeVector(vecset->GetVector(0), code.data());
+        BOOST_CHECK(std::equal(code.begin(), code.end(), codes.begin()));
+
+        loaded->SetEnableADC(true);
+        std::vector<std::uint8_t> query(loaded->QuantizeSize());
+        loaded->QuantizeVector(vecset->GetVector(0), query.data());
+        for (SPTAG::SizeType i = 0; i < n; i += 7) {
+            const std::uint8_t* y = codes.data() + ((size_t)i) * codeSize;
+            loaded->ReconstructVector(y, rec.data());
+            float l2 = SPTAG::COMMON::DistanceUtils::ComputeL2Distance((const float*)vecset->GetVector(0), rec.data(), dim);
+            float ip = 0;
+            for (SPTAG::DimensionType j = 0; j < dim; j++) ip += ((const float*)vecset->GetVector(0))[j] * rec[j];
+            BOOST_CHECK_CLOSE_FRACTION(loaded->L2Distance(query.data(), y), l2, 1e-3);
+            BOOST_CHECK_SMALL(loaded->CosineDistance(query.data(), y) - (1 - ip), 1e-2f);
+        }
+    }
+    remove("sqtest_quantizer.bin");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
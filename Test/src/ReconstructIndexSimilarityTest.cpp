@@ -5,6 +5,7 @@
 #include <random>
 #include "inc/Helper/VectorSetReader.h"
 #include "inc/Core/Common/PQQuantizer.h"
+#include "inc/Core/Common/QuantizerTrainer.h"
 #include "inc/Core/VectorIndex.h"
 #include "inc/Core/Common/CommonUtils.h"
 #include "inc/Core/Common/QueryResultSet.h"
@@ -62,11 +63,13 @@ void Search(std::shared_ptr<VectorIndex>& vecIndex, std::shared_ptr<VectorSet>&
 
 
 template<typename T>
-std::shared_ptr<VectorIndex> PerfBuild(IndexAlgoType algo, std::string distCalcMethod, std::shared_ptr<VectorSet>& vec, std::shared_ptr<MetadataSet>& meta, std::shared_ptr<VectorSet>& queryset, int k, std::shared_ptr<VectorSet>& truth, std::string out)
+std::shared_ptr<VectorIndex> PerfBuild(IndexAlgoType algo, std::string distCalcMethod, std::shared_ptr<VectorSet>& vec, std::shared_ptr<MetadataSet>& meta, std::shared_ptr<VectorSet>& queryset, int k, std::shared_ptr<VectorSet>& truth, std::string out, std::shared_ptr<COMMON::IQuantizer> quantizer = nullptr)
 {
     std::shared_ptr<VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
     BOOST_CHECK(nullptr != vecIndex);
 
+    vecIndex->SetQuantizer(quantizer);
+
     if (algo == IndexAlgoType::KDT) vecIndex->SetParameter("KDTNumber", "2");
     vecIndex->SetParameter("DistCalcMethod", distCalcMethod);
     vecIndex->SetParameter("NumberOfThreads", "12");
@@ -82,7 +85,7 @@ std::shared_ptr<VectorIndex> PerfBuild(IndexAlgoType algo, std::string distCalcM
 
 
 template <typename R>
-void LoadReconstructData(std::shared_ptr<VectorSet>& real_vecset, std::shared_ptr<VectorSet>& rec_vecset, std::shared_ptr<VectorSet>& quan_vecset, std::shared_ptr<MetadataSet>& metaset, std::shared_ptr<VectorSet>& queryset, std::shared_ptr<VectorSet>& truth, DistCalcMethod distCalcMethod, int k)
+void LoadReconstructData(std::shared_ptr<VectorSet>& real_vecset, std::shared_ptr<VectorSet>& rec_vecset, std::shared_ptr<VectorSet>& quan_vecset, std::shared_ptr<MetadataSet>& metaset, std::shared_ptr<VectorSet>& queryset, std::shared_ptr<VectorSet>& truth, std::shared_ptr<COMMON::IQuantizer>& quantizer, DistCalcMethod distCalcMethod, int k)
 {
     int m = 960;
     int M = 480;
@@ -110,8 +113,8 @@ void LoadReconstructData(std::shared_ptr<VectorSet>& real_vecset, std::shared_pt
 
     auto ptr = SPTAG::f_createIO();
     BOOST_ASSERT(ptr->Initialize("gist_codebooks.bin", std::ios::binary | std::ios::in));
-    SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr);
-    BOOST_ASSERT(SPTAG::COMMON::DistanceUtils::Quantizer != nullptr);
+    SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr, quantizer);
+    BOOST_ASSERT(quantizer != nullptr);
 
     ByteArray PQvec = ByteArray::Alloc(sizeof(std::uint8_t) * n * M);
     ByteArray rec_vec = ByteArray::Alloc(sizeof(R) * n * m);
@@ -120,8 +123,8 @@ void LoadReconstructData(std::shared_ptr<VectorSet>& real_vecset, std::shared_pt
     quan_vecset.reset(new BasicVectorSet(PQvec, GetEnumValueType<std::uint8_t>(), M, n));
 
     for (int i = 0; i < real_vecset->Count(); i++) {
-        COMMON::DistanceUtils::Quantizer->QuantizeVector(real_vecset->GetVector(i), (uint8_t*)quan_vecset->GetVector(i));
-        COMMON::DistanceUtils::Quantizer->ReconstructVector((uint8_t*)quan_vecset->GetVector(i), rec_vecset->GetVector(i));
+        quantizer->QuantizeVector(real_vecset->GetVector(i), (uint8_t*)quan_vecset->GetVector(i));
+        quantizer->ReconstructVector((uint8_t*)quan_vecset->GetVector(i), rec_vecset->GetVector(i));
     }
     quan_vecset->Save("quan_vector.bin");
     rec_vecset->Save("rec_vector.bin");
@@ -134,15 +137,12 @@ void LoadReconstructData(std::shared_ptr<VectorSet>& real_vecset, std::shared_pt
     queryset.reset(new BasicVectorSet(rec_query, GetEnumValueType<R>(), m, q));
 
     for (int i = 0; i < queryset->Count(); i++) {
-        COMMON::DistanceUtils::Quantizer->QuantizeVector(queryset->GetVector(i), (uint8_t*)pq_queryset->GetVector(i));
-        COMMON::DistanceUtils::Quantizer->ReconstructVector((uint8_t*)pq_queryset->GetVector(i), rec_queryset->GetVector(i));
+        quantizer->QuantizeVector(queryset->GetVector(i), (uint8_t*)pq_queryset->GetVector(i));
+        quantizer->ReconstructVector((uint8_t*)pq_queryset->GetVector(i), rec_queryset->GetVector(i));
     }
 
     ByteArray tru = ByteArray::Alloc(sizeof(SizeType) * queryset->Count() * 2 * k);
     //ByteArray quan_tru = ByteArray::Alloc(sizeof(SizeType) * queryset->Count() * 2 * k);
-    auto quan_holder = COMMON::DistanceUtils::Quantizer;
-    COMMON::DistanceUtils::Quantizer.reset();
-
     for (SizeType i = 0; i < queryset->Count(); ++i)
     {
         SizeType* neighbors = ((SizeType*)tru.Data()) + i * 2 * k;
@@ -159,12 +159,11 @@ void LoadReconstructData(std::shared_ptr<VectorSet>& real_vecset, std::shared_pt
         res.SortResult();
         for (int j = 0; j < 2 * k; j++) neighbors[j] = res.GetResult(j)->VID;
     }
-    COMMON::DistanceUtils::Quantizer = quan_holder;
     truth.reset(new BasicVectorSet(tru, GetEnumValueType<float>(), 2 * k, queryset->Count()));
 }
 
 template <typename R>
-void GenerateReconstructData(std::shared_ptr<VectorSet>& real_vecset, std::shared_ptr<VectorSet>& rec_vecset, std::shared_ptr<VectorSet>& quan_vecset, std::shared_ptr<MetadataSet>& metaset, std::shared_ptr<VectorSet>& queryset, std::shared_ptr<VectorSet>& truth, DistCalcMethod distCalcMethod, int k)
+void GenerateReconstructData(std::shared_ptr<VectorSet>& real_vecset, std::shared_ptr<VectorSet>& rec_vecset, std::shared_ptr<VectorSet>& quan_vecset, std::shared_ptr<MetadataSet>& metaset, std::shared_ptr<VectorSet>& queryset, std::shared_ptr<VectorSet>& truth, std::shared_ptr<COMMON::IQuantizer>& quantizer, DistCalcMethod distCalcMethod, int k)
 {
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -247,8 +246,8 @@ void GenerateReconstructData(std::shared_ptr<VectorSet>& real_vecset, std::share
         if (ptr == nullptr || !ptr->Initialize(CODEBOOK_FILE.c_str(), std::ios::binary | std::ios::in)) {
             BOOST_ASSERT("Canot Open CODEBOOK_FILE to read!" == "Error");
         }
-        SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr);
-        BOOST_ASSERT(SPTAG::COMMON::DistanceUtils::Quantizer);
+        SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr, quantizer);
+        BOOST_ASSERT(quantizer);
 
         std::shared_ptr<Helper::ReaderOptions> options(new Helper::ReaderOptions(GetEnumValueType<R>(), m, VectorFileType::DEFAULT));
         auto vectorReader = Helper::VectorSetReader::CreateInstance(options);
@@ -329,15 +328,15 @@ void GenerateReconstructData(std::shared_ptr<VectorSet>& real_vecset, std::share
         if (!ptr->Initialize(CODEBOOK_FILE.c_str(), std::ios::binary | std::ios::in)) {
             BOOST_ASSERT("Canot Open CODEBOOK_FILE to read!" == "Error");
         }
-        SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr);
-        BOOST_ASSERT(SPTAG::COMMON::DistanceUtils::Quantizer);
+        SPTAG::COMMON::IQuantizer::LoadIQuantizer(ptr, quantizer);
+        BOOST_ASSERT(quantizer);
 
         rec_vecset.reset(new BasicVectorSet(ByteArray::Alloc(sizeof(R) * n * m), GetEnumValueType<R>(), m, n));
         quan_vecset.reset(new BasicVectorSet(ByteArray::Alloc(sizeof(std::uint8_t) * n * M), GetEnumValueType<std::uint8_t>(), M, n));
         for (int i = 0; i < n; i++) {
             auto nvec = &vecs[i * m];
-            COMMON::DistanceUtils::Quantizer->QuantizeVector(nvec, (uint8_t*)quan_vecset->GetVector(i));
-            COMMON::DistanceUtils::Quantizer->ReconstructVector((uint8_t*)quan_vecset->GetVector(i), rec_vecset->GetVector(i));
+            quantizer->QuantizeVector(nvec, (uint8_t*)quan_vecset->GetVector(i));
+            quantizer->ReconstructVector((uint8_t*)quan_vecset->GetVector(i), rec_vecset->GetVector(i));
         }
         quan_vecset->Save("quantest_quan_vector.bin");
         rec_vecset->Save("quantest_rec_vector.bin");
@@ -349,46 +348,120 @@ void ReconstructTest(IndexAlgoType algo, DistCalcMethod distMethod)
 {
     std::shared_ptr<VectorSet> real_vecset, rec_vecset, quan_vecset, queryset, truth;
     std::shared_ptr<MetadataSet> metaset;
-    GenerateReconstructData<R>(real_vecset, rec_vecset, quan_vecset, metaset, queryset, truth, distMethod, 10);
-    //LoadReconstructData<R>(real_vecset, rec_vecset, quan_vecset, metaset, queryset, truth, distMethod, 10);
+    std::shared_ptr<COMMON::IQuantizer> quantizer;
+    GenerateReconstructData<R>(real_vecset, rec_vecset, quan_vecset, metaset, queryset, truth, quantizer, distMethod, 10);
+    //LoadReconstructData<R>(real_vecset, rec_vecset, quan_vecset, metaset, queryset, truth, quantizer, distMethod, 10);
     
-    auto quantizer = COMMON::DistanceUtils::Quantizer;
-    COMMON::DistanceUtils::Quantizer.reset();
-    BOOST_ASSERT(!COMMON::DistanceUtils::Quantizer);
     auto real_idx = PerfBuild<R>(algo, Helper::Convert::ConvertToString<DistCalcMethod>(distMethod), real_vecset, metaset, queryset, 10, truth, "real_idx");
     Search<R>(real_idx, queryset, 10, truth);
     auto rec_idx = PerfBuild<R>(algo, Helper::Convert::ConvertToString<DistCalcMethod>(distMethod), rec_vecset, metaset, queryset, 10, truth, "rec_idx");
     Search<R>(rec_idx, queryset, 10, truth);
-    COMMON::DistanceUtils::Quantizer = quantizer;
-    auto quan_idx = PerfBuild<std::uint8_t>(algo, Helper::Convert::ConvertToString<DistCalcMethod>(distMethod), quan_vecset, metaset, queryset, 10, truth, "quan_idx");
+    auto quan_idx = PerfBuild<std::uint8_t>(algo, Helper::Convert::ConvertToString<DistCalcMethod>(distMethod), quan_vecset, metaset, queryset, 10, truth, "quan_idx", quantizer);
 
     LOG(Helper::LogLevel::LL_Info, "Test search with SDC");
     Search<R>(quan_idx, queryset, 10, truth);
     
     LOG(Helper::LogLevel::LL_Info, "Test search with ADC");
-    SPTAG::COMMON::DistanceUtils::Quantizer->SetEnableADC(true);
+    quantizer->SetEnableADC(true);
     Search<R>(quan_idx, queryset, 10, truth);
 }
 
+std::shared_ptr<VectorIndex> QuantizedBuild(std::shared_ptr<VectorSet>& vecset, std::shared_ptr<COMMON::IQuantizer> quantizer, std::shared_ptr<VectorSet>& codeset)
+{
+    SizeType n = vecset->Count();
+    SizeType codeSize = quantizer->QuantizeSize();
+    codeset.reset(new BasicVectorSet(ByteArray::Alloc(sizeof(std::uint8_t) * n * codeSize), VectorValueType::UInt8, codeSize, n));
+    for (SizeType i = 0; i < n; i++) quantizer->QuantizeVector(vecset->GetVector(i), (std::uint8_t*)codeset->GetVector(i));
+
+    std::shared_ptr<VectorIndex> vecIndex = VectorIndex::CreateInstance(IndexAlgoType::BKT, VectorValueType::UInt8);
+    vecIndex->SetQuantizer(quantizer);
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", "4");
+    vecIndex->SetParameter("MaxCheck", "2048");
+    BOOST_CHECK(ErrorCode::Success == vecIndex->BuildIndex(codeset, nullptr, true));
+    return vecIndex;
+}
+
+// A PQ and an SQ index share the process and every query goes to both, one after the other on the same
+// query object. Each index must rank with its own codebook: every returned distance is the distance of
+// that quantizer to the stored codes, and the results match a brute force scan over the same codes.
+void MixedQuantizerTest()
+{
+    SizeType n = 2000, q = 100;
+    DimensionType dim = 32;
+    int k = 10;
+
+    std::mt19937 rg(7);
+    std::uniform_real_distribution<float> valueDist(-10.0f, 10.0f);
+    std::shared_ptr<VectorSet> vecset(new BasicVectorSet(ByteArray::Alloc(sizeof(float) * n * dim), VectorValueType::Float, dim, n));
+    std::shared_ptr<VectorSet> queryset(new BasicVectorSet(ByteArray::Alloc(sizeof(float) * q * dim), VectorValueType::Float, dim, q));
+    for (SizeType i = 0; i < n * dim; i++) ((float*)vecset->GetData())[i] = valueDist(rg);
+    for (SizeType i = 0; i < q * dim; i++) ((float*)queryset->GetData())[i] = valueDist(rg);
+
+    std::vector<std::shared_ptr<COMMON::IQuantizer>> quantizers = {
+        COMMON::TrainPQQuantizer<float>(vecset, 16, 256, n, 4, 20),
+        COMMON::TrainSQQuantizer<float>(vecset, n, 4)
+    };
+    std::vector<std::shared_ptr<VectorSet>> codesets(quantizers.size());
+    std::vector<std::shared_ptr<VectorIndex>> indexes;
+    for (std::size_t i = 0; i < quantizers.size(); i++)
+    {
+        BOOST_REQUIRE(quantizers[i] != nullptr);
+        indexes.push_back(QuantizedBuild(vecset, quantizers[i], codesets[i]));
+    }
+    BOOST_CHECK(indexes[0]->GetQuantizer() != indexes[1]->GetQuantizer());
+
+    std::vector<float> recall(quantizers.size(), 0);
+    for (SizeType i = 0; i < q; i++)
+    {
+        COMMON::QueryResultSet<float> res((const float*)queryset->GetVector(i), k);
+        for (std::size_t idx = 0; idx < indexes.size(); idx++)
+        {
+            res.Reset();
+            BOOST_CHECK(ErrorCode::Success == indexes[idx]->SearchIndex(res));
+            const std::uint8_t* target = (const std::uint8_t*)res.GetQuantizedTarget();
+            const COMMON::IQuantizer* quantizer = quantizers[idx].get();
+
+            COMMON::QueryResultSet<std::uint8_t> truth(target, k);
+            for (SizeType j = 0; j < n; j++) truth.AddPoint(j, quantizer->L2Distance(target, (const std::uint8_t*)codesets[idx]->GetVector(j)));
+            truth.SortResult();
+
+            for (int j = 0; j < k; j++)
+            {
+                SizeType vid = res.GetResult(j)->VID;
+                BOOST_REQUIRE(vid >= 0 && vid < n);
+                float dist = quantizer->L2Distance(target, (const std::uint8_t*)codesets[idx]->GetVector(vid));
+                BOOST_CHECK_SMALL(res.GetResult(j)->Dist - dist, 1e-3f * (dist + 1.0f));
+                for (int l = 0; l < k; l++)
+                {
+                    if (truth.GetResult(l)->VID == vid) { recall[idx] += 1; break; }
+                }
+            }
+        }
+    }
+    for (std::size_t idx = 0; idx < indexes.size(); idx++)
+    {
+        recall[idx] /= (float)(q * k);
+        LOG(Helper::LogLevel::LL_Info, "Recall of index %d: %f\n", (int)idx, recall[idx]);
+        BOOST_CHECK(recall[idx] > 0.9f);
+    }
+}
 
 BOOST_AUTO_TEST_SUITE(ReconstructIndexSimilarityTest)
 
 BOOST_AUTO_TEST_CASE(BKTReconstructTest)
 {
-    SPTAG::COMMON::DistanceUtils::Quantizer.reset();
-
     ReconstructTest<float>(IndexAlgoType::BKT, DistCalcMethod::L2);
-
-    SPTAG::COMMON::DistanceUtils::Quantizer.reset();
 }
 
 BOOST_AUTO_TEST_CASE(KDTReconstructTest)
 {
-    SPTAG::COMMON::DistanceUtils::Quantizer.reset();
-
     ReconstructTest<float>(IndexAlgoType::KDT, DistCalcMethod::L2);
+}
 
-    SPTAG::COMMON::DistanceUtils::Quantizer.reset();
+BOOST_AUTO_TEST_CASE(MixedQuantizerIndexTest)
+{
+    MixedQuantizerTest();
 }
 
 BOOST_AUTO_TEST_SUITE_END()
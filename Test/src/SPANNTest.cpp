@@ -0,0 +1,381 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Core/SPANN/Index.h"
+#include "inc/Core/Common/PQQuantizer.h"
+#include "inc/Core/Common/QuantizerTrainer.h"
+
+#include <algorithm>
+#include <random>
+
+#ifndef _MSC_VER
+#include <dirent.h>
+#endif
+
+namespace
+{
+    const SPTAG::DimensionType Dim = 16;
+    const char* IndexFolder = "spann_update_test";
+    const char* RerankIndexFolder = "spann_rerank_test";
+    const char* RefineIndexFolder = "spann_refine_test";
+    const char* FastScanIndexFolder = "spann_fastscan_test";
+    const char* FullVectorFile = "spann_rerank_vectors.bin";
+
+    // Deletes an index folder with everything SaveIndex wrote into it, the head index subfolder included.
+    void RemoveFolder(const std::string& p_folder)
+    {
+#ifndef _MSC_VER
+        if (auto dirptr = opendir(p_folder.c_str())) {
+            while (auto f = readdir(dirptr)) {
+                if (f->d_name[0] == '.') continue;
+                std::string path = p_folder + FolderSep + f->d_name;
+                if (f->d_type == DT_DIR) RemoveFolder(path);
+                else remove(path.c_str());
+            }
+            closedir(dirptr);
+        }
+        remove(p_folder.c_str());
+#else
+        WIN32_FIND_DATA fd;
+        HANDLE hFile = FindFirstFile((p_folder + FolderSep + "*").c_str(), &fd);
+        if (hFile != INVALID_HANDLE_VALUE) {
+            do {
+                if (fd.cFileName[0] == '.') continue;
+                std::string path = p_folder + FolderSep + fd.cFileName;
+                if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) RemoveFolder(path);
+                else remove(path.c_str());
+            } while (FindNextFile(hFile, &fd));
+            FindClose(hFile);
+        }
+        RemoveDirectory(p_folder.c_str());
+#endif
+    }
+
+    std::shared_ptr<SPTAG::VectorSet> GenerateVectors(SPTAG::SizeType p_count, unsigned int p_seed)
+    {
+        std::mt19937 rg(p_seed);
+        std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+        SPTAG::ByteArray data = SPTAG::ByteArray::Alloc(sizeof(float) * p_count * Dim);
+        float* ptr = reinterpret_cast<float*>(data.Data());
+        for (size_t i = 0; i < (size_t)p_count * Dim; i++) ptr[i] = dist(rg);
+        return std::make_shared<SPTAG::BasicVectorSet>(data, SPTAG::VectorValueType::Float, Dim, p_count);
+    }
+
+    // Returns how many of the vectors find themselves as the nearest neighbor with the expected id.
+    int CountSelfHits(std::shared_ptr<SPTAG::VectorIndex>& p_index, std::shared_ptr<SPTAG::VectorSet>& p_vectors, SPTAG::SizeType p_begin, SPTAG::SizeType p_count, SPTAG::SizeType p_idOffset)
+    {
+        int hits = 0;
+        for (SPTAG::SizeType i = p_begin; i < p_begin + p_count; i++)
+        {
+            SPTAG::QueryResult res(p_vectors->GetVector(i), 5, false);
+            p_index->SearchIndex(res);
+            if (res.GetResult(0)->VID == i + p_idOffset) hits++;
+        }
+        return hits;
+    }
+
+    bool Found(std::shared_ptr<SPTAG::VectorIndex>& p_index, std::shared_ptr<SPTAG::VectorSet>& p_vectors, SPTAG::SizeType p_vector, SPTAG::SizeType p_id)
+    {
+        SPTAG::QueryResult res(p_vectors->GetVector(p_vector), 5, false);
+        p_index->SearchIndex(res);
+        for (int j = 0; j < 5; j++) if (res.GetResult(j)->VID == p_id) return true;
+        return false;
+    }
+
+    // Returns how many reranked results do not carry the exact full precision distance.
+    int CountInexactDistances(std::shared_ptr<SPTAG::VectorIndex>& p_index, std::shared_ptr<SPTAG::VectorSet>& p_vectors, SPTAG::SizeType p_count, int& p_hits)
+    {
+        int inexact = 0;
+        p_hits = 0;
+        for (SPTAG::SizeType i = 0; i < p_count; i++)
+        {
+            SPTAG::QueryResult res(p_vectors->GetVector(i), 5, false);
+            p_index->SearchIndex(res);
+            if (res.GetResult(0)->VID == i) p_hits++;
+            for (int j = 0; j < 5; j++)
+            {
+                auto result = res.GetResult(j);
+                if (result->VID < 0) continue;
+                float exact = SPTAG::COMMON::DistanceUtils::ComputeL2Distance((const float*)p_vectors->GetVector(i), (const float*)p_vectors->GetVector(result->VID), Dim);
+                if (std::fabs(exact - result->Dist) > 1e-3f * (exact + 1.0f)) inexact++;
+            }
+        }
+        return inexact;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(SPANNTest)
+
+BOOST_AUTO_TEST_CASE(SPANNUpdateTest)
+{
+    SPTAG::SizeType n = 2000, added = 2000, deleted = 50;
+    auto vectors = GenerateVectors(n, 0);
+    auto newVectors = GenerateVectors(added, 1);
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::SPANN, SPTAG::VectorValueType::Float);
+    BOOST_REQUIRE(nullptr != vecIndex);
+
+    vecIndex->SetParameter("ValueType", "Float", "Base");
+    vecIndex->SetParameter("DistCalcMethod", "L2", "Base");
+    vecIndex->SetParameter("IndexAlgoType", "BKT", "Base");
+    vecIndex->SetParameter("Dim", std::to_string(Dim).c_str(), "Base");
+    vecIndex->SetParameter("IndexDirectory", IndexFolder, "Base");
+    vecIndex->SetParameter("isExecute", "true", "SelectHead");
+    vecIndex->SetParameter("NumberOfThreads", "2", "SelectHead");
+    vecIndex->SetParameter("Ratio", "0.1", "SelectHead");
+    vecIndex->SetParameter("isExecute", "true", "BuildHead");
+    vecIndex->SetParameter("NumberOfThreads", "2", "BuildHead");
+    vecIndex->SetParameter("isExecute", "true", "BuildSSDIndex");
+    vecIndex->SetParameter("BuildSsdIndex", "true", "BuildSSDIndex");
+    vecIndex->SetParameter("NumberOfThreads", "2", "BuildSSDIndex");
+    vecIndex->SetParameter("PostingPageLimit", "2", "BuildSSDIndex");
+    // Split inline so that every added vector is searchable once AddIndex returns.
+    vecIndex->SetParameter("UpdateThreadNum", "0", "BuildSSDIndex");
+
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vectors, nullptr));
+    BOOST_CHECK_EQUAL(n, vecIndex->GetNumSamples());
+    BOOST_CHECK_GE(CountSelfHits(vecIndex, vectors, 0, 100, 0), 95);
+
+    auto spann = static_cast<SPTAG::SPANN::Index<float>*>(vecIndex.get());
+    SPTAG::SizeType heads = spann->GetMemoryIndex()->GetNumSamples();
+
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vecIndex->AddIndex(newVectors, nullptr));
+    BOOST_CHECK_EQUAL(n + added, vecIndex->GetNumSamples());
+    BOOST_CHECK_GT(spann->GetMemoryIndex()->GetNumSamples(), heads);
+    BOOST_CHECK_GE(CountSelfHits(vecIndex, newVectors, 0, 200, n), 190);
+    BOOST_CHECK_GE(CountSelfHits(vecIndex, vectors, 0, 100, 0), 95);
+
+    for (SPTAG::SizeType i = 0; i < deleted; i++)
+    {
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(i));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(n + i));
+    }
+    BOOST_CHECK(SPTAG::ErrorCode::VectorNotFound == vecIndex->DeleteIndex(0));
+    BOOST_CHECK_EQUAL(deleted * 2, vecIndex->GetNumDeleted());
+    for (SPTAG::SizeType i = 0; i < deleted; i++)
+    {
+        BOOST_CHECK(!Found(vecIndex, vectors, i, i));
+        BOOST_CHECK(!Found(vecIndex, newVectors, i, n + i));
+    }
+
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vecIndex->SaveIndex(IndexFolder));
+    vecIndex.reset();
+
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex(IndexFolder, vecIndex));
+    BOOST_REQUIRE(nullptr != vecIndex);
+    BOOST_CHECK_EQUAL(n + added, vecIndex->GetNumSamples());
+    BOOST_CHECK_EQUAL(deleted * 2, vecIndex->GetNumDeleted());
+    BOOST_CHECK_GE(CountSelfHits(vecIndex, newVectors, deleted, 200, n), 190);
+    for (SPTAG::SizeType i = 0; i < deleted; i++)
+    {
+        BOOST_CHECK(!Found(vecIndex, newVectors, i, n + i));
+    }
+
+    vecIndex.reset();
+    RemoveFolder(IndexFolder);
+}
+
+BOOST_AUTO_TEST_CASE(SPANNRefineTest)
+{
+    SPTAG::SizeType n = 2000, added = 500, deleted = 1500;
+    auto vectors = GenerateVectors(n, 3);
+    auto newVectors = GenerateVectors(added, 4);
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::SPANN, SPTAG::VectorValueType::Float);
+    BOOST_REQUIRE(nullptr != vecIndex);
+
+    vecIndex->SetParameter("ValueType", "Float", "Base");
+    vecIndex->SetParameter("DistCalcMethod", "L2", "Base");
+    vecIndex->SetParameter("IndexAlgoType", "BKT", "Base");
+    vecIndex->SetParameter("Dim", std::to_string(Dim).c_str(), "Base");
+    vecIndex->SetParameter("IndexDirectory", RefineIndexFolder, "Base");
+    vecIndex->SetParameter("isExecute", "true", "SelectHead");
+    vecIndex->SetParameter("NumberOfThreads", "2", "SelectHead");
+    vecIndex->SetParameter("Ratio", "0.1", "SelectHead");
+    vecIndex->SetParameter("isExecute", "true", "BuildHead");
+    vecIndex->SetParameter("NumberOfThreads", "2", "BuildHead");
+    vecIndex->SetParameter("isExecute", "true", "BuildSSDIndex");
+    vecIndex->SetParameter("BuildSsdIndex", "true", "BuildSSDIndex");
+    vecIndex->SetParameter("NumberOfThreads", "2", "BuildSSDIndex");
+    vecIndex->SetParameter("UpdateThreadNum", "0", "BuildSSDIndex");
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vectors, nullptr));
+
+    auto spann = static_cast<SPTAG::SPANN::Index<float>*>(vecIndex.get());
+    auto headIndex = spann->GetMemoryIndex();
+    SPTAG::SizeType heads = headIndex->GetNumSamples() - headIndex->GetNumDeleted();
+    for (SPTAG::SizeType i = 0; i < deleted; i++) BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(i));
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vecIndex->AddIndex(newVectors->GetData(), added, Dim, nullptr));
+    BOOST_CHECK_GT(spann->BufferSize()->back(), sizeof(int) * 2);
+
+    // Most postings lost three quarters of their vectors, so the refine merges the small ones away.
+    vecIndex->SetParameter("MergeThreshold", "20", "BuildSSDIndex");
+    std::vector<std::shared_ptr<SPTAG::Helper::DiskPriorityIO>> streams;
+    auto files = vecIndex->GetIndexFiles();
+    for (auto& file : *files)
+    {
+        auto ptr = SPTAG::f_createIO();
+        BOOST_REQUIRE(ptr != nullptr && ptr->Initialize((std::string(RefineIndexFolder) + FolderSep + file).c_str(), std::ios::binary | std::ios::out));
+        streams.push_back(ptr);
+    }
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == spann->RefineIndex(streams, nullptr));
+    streams.clear();
+    // The refine compacts every posting back into the posting file and leaves no delta in memory.
+    BOOST_CHECK_EQUAL(spann->BufferSize()->back(), sizeof(int) * 2);
+    BOOST_CHECK_LT(headIndex->GetNumSamples() - headIndex->GetNumDeleted(), heads);
+    BOOST_CHECK_GE(CountSelfHits(vecIndex, vectors, deleted, 200, 0), 190);
+    BOOST_CHECK_GE(CountSelfHits(vecIndex, newVectors, 0, 200, n), 190);
+    for (SPTAG::SizeType i = 0; i < 50; i++) BOOST_CHECK(!Found(vecIndex, vectors, i, i));
+
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vecIndex->SaveIndex(RefineIndexFolder));
+    vecIndex.reset();
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex(RefineIndexFolder, vecIndex));
+    BOOST_REQUIRE(nullptr != vecIndex);
+    BOOST_CHECK_GE(CountSelfHits(vecIndex, vectors, deleted, 200, 0), 190);
+    BOOST_CHECK_GE(CountSelfHits(vecIndex, newVectors, 0, 200, n), 190);
+
+    vecIndex.reset();
+    RemoveFolder(RefineIndexFolder);
+}
+
+BOOST_AUTO_TEST_CASE(SPANNRerankTest)
+{
+    SPTAG::SizeType n = 2000;
+    const int levels = 16;
+    auto vectors = GenerateVectors(n, 2);
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vectors->Save(FullVectorFile));
+
+    // A coarse scalar codebook per dimension, so the postings only hold approximate vectors.
+    std::shared_ptr<float> codebooks(new float[Dim * levels], std::default_delete<float[]>());
+    for (int i = 0; i < Dim; i++)
+    {
+        for (int j = 0; j < levels; j++) codebooks.get()[i * levels + j] = -100.0f + (j + 0.5f) * 200.0f / levels;
+    }
+    std::shared_ptr<SPTAG::COMMON::IQuantizer> quantizer(new SPTAG::COMMON::PQQuantizer<float>(Dim, levels, 1, false, codebooks));
+
+    SPTAG::ByteArray codes = SPTAG::ByteArray::Alloc(sizeof(std::uint8_t) * n * Dim);
+    for (SPTAG::SizeType i = 0; i < n; i++)
+    {
+        quantizer->QuantizeVector(vectors->GetVector(i), codes.Data() + (size_t)i * Dim);
+    }
+    std::shared_ptr<SPTAG::VectorSet> codeSet(new SPTAG::BasicVectorSet(codes, SPTAG::VectorValueType::UInt8, Dim, n));
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::SPANN, SPTAG::VectorValueType::UInt8);
+    BOOST_REQUIRE(nullptr != vecIndex);
+
+    vecIndex->SetQuantizer(quantizer);
+    vecIndex->SetParameter("ValueType", "UInt8", "Base");
+    vecIndex->SetParameter("DistCalcMethod", "L2", "Base");
+    vecIndex->SetParameter("IndexAlgoType", "BKT", "Base");
+    vecIndex->SetParameter("Dim", std::to_string(Dim).c_str(), "Base");
+    vecIndex->SetParameter("IndexDirectory", RerankIndexFolder, "Base");
+    vecIndex->SetParameter("FullVectorPath", FullVectorFile, "Base");
+    vecIndex->SetParameter("isExecute", "true", "SelectHead");
+    vecIndex->SetParameter("NumberOfThreads", "2", "SelectHead");
+    vecIndex->SetParameter("Ratio", "0.1", "SelectHead");
+    vecIndex->SetParameter("isExecute", "true", "BuildHead");
+    vecIndex->SetParameter("NumberOfThreads", "2", "BuildHead");
+    vecIndex->SetParameter("isExecute", "true", "BuildSSDIndex");
+    vecIndex->SetParameter("BuildSsdIndex", "true", "BuildSSDIndex");
+    vecIndex->SetParameter("NumberOfThreads", "2", "BuildSSDIndex");
+    vecIndex->SetParameter("Rerank", "64", "BuildSSDIndex");
+
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(codeSet, nullptr));
+
+    int hits = 0;
+    BOOST_CHECK_EQUAL(0, CountInexactDistances(vecIndex, vectors, 100, hits));
+    BOOST_CHECK_GE(hits, 98);
+
+    // Without rerank the distances come from the quantized postings.
+    vecIndex->SetParameter("Rerank", "0", "BuildSSDIndex");
+    BOOST_CHECK_GT(CountInexactDistances(vecIndex, vectors, 100, hits), 0);
+
+    // A rerank depth below the result count still reranks every returned result.
+    vecIndex->SetParameter("Rerank", "2", "BuildSSDIndex");
+    BOOST_CHECK_EQUAL(0, CountInexactDistances(vecIndex, vectors, 100, hits));
+    vecIndex->SetParameter("Rerank", "64", "BuildSSDIndex");
+
+    // The full vectors are part of the index files, and saving over them copies them from the open file.
+    auto files = vecIndex->GetIndexFiles();
+    BOOST_CHECK(std::find(files->begin(), files->end(), vecIndex->GetParameter("FullVectors", "Base")) != files->end());
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vecIndex->SaveIndex(RerankIndexFolder));
+    vecIndex.reset();
+
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex(RerankIndexFolder, vecIndex));
+    BOOST_REQUIRE(nullptr != vecIndex);
+    BOOST_CHECK_EQUAL(0, CountInexactDistances(vecIndex, vectors, 100, hits));
+    BOOST_CHECK_GE(hits, 98);
+
+    BOOST_CHECK(nullptr != vecIndex->GetQuantizer());
+
+    vecIndex.reset();
+    remove(FullVectorFile);
+}
+
+BOOST_AUTO_TEST_CASE(SPANNFastScanTest)
+{
+    SPTAG::SizeType n = 2000;
+    const int k = 10;
+    auto vectors = GenerateVectors(n, 3);
+    auto quantizer = SPTAG::COMMON::TrainPQQuantizer<float>(vectors, Dim / 2, 16, n, 2, 20, 0, true);
+    BOOST_REQUIRE(quantizer != nullptr);
+
+    SPTAG::DimensionType codeSize = quantizer->QuantizeSize();
+    SPTAG::ByteArray codes = SPTAG::ByteArray::Alloc(sizeof(std::uint8_t) * n * codeSize);
+    for (SPTAG::SizeType i = 0; i < n; i++)
+    {
+        quantizer->QuantizeVector(vectors->GetVector(i), codes.Data() + (size_t)i * codeSize);
+    }
+    std::shared_ptr<SPTAG::VectorSet> codeSet(new SPTAG::BasicVectorSet(codes, SPTAG::VectorValueType::UInt8, codeSize, n));
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::SPANN, SPTAG::VectorValueType::UInt8);
+    BOOST_REQUIRE(nullptr != vecIndex);
+
+    vecIndex->SetQuantizer(quantizer);
+    vecIndex->SetParameter("ValueType", "UInt8", "Base");
+    vecIndex->SetParameter("DistCalcMethod", "L2", "Base");
+    vecIndex->SetParameter("IndexAlgoType", "BKT", "Base");
+    vecIndex->SetParameter("Dim", std::to_string(codeSize).c_str(), "Base");
+    vecIndex->SetParameter("IndexDirectory", FastScanIndexFolder, "Base");
+    vecIndex->SetParameter("isExecute", "true", "SelectHead");
+    vecIndex->SetParameter("NumberOfThreads", "2", "SelectHead");
+    vecIndex->SetParameter("Ratio", "0.05", "SelectHead");
+    vecIndex->SetParameter("isExecute", "true", "BuildHead");
+    vecIndex->SetParameter("NumberOfThreads", "2", "BuildHead");
+    vecIndex->SetParameter("isExecute", "true", "BuildSSDIndex");
+    vecIndex->SetParameter("BuildSsdIndex", "true", "BuildSSDIndex");
+    vecIndex->SetParameter("NumberOfThreads", "2", "BuildSSDIndex");
+    BOOST_REQUIRE(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(codeSet, nullptr));
+
+    // ADC makes the posting scan go through the fast scan blocks. Every result must still carry its exact ADC
+    // distance, and the results must be the nearest ones by that distance.
+    quantizer->SetEnableADC(true);
+    std::vector<std::uint8_t> adcTable(quantizer->QuantizeSize());
+    std::vector<float> adcDists(n);
+    int found = 0;
+    for (SPTAG::SizeType q = 0; q < 50; q++)
+    {
+        quantizer->QuantizeVector(vectors->GetVector(q), adcTable.data());
+        for (SPTAG::SizeType i = 0; i < n; i++) adcDists[i] = quantizer->L2Distance(adcTable.data(), codes.Data() + (size_t)i * codeSize);
+        std::vector<float> sorted(adcDists);
+        std::nth_element(sorted.begin(), sorted.begin() + k - 1, sorted.end());
+        float kthDist = sorted[k - 1];
+
+        SPTAG::QueryResult res(vectors->GetVector(q), k, false);
+        vecIndex->SearchIndex(res);
+        for (int j = 0; j < k; j++)
+        {
+            auto result = res.GetResult(j);
+            BOOST_REQUIRE(result->VID >= 0 && result->VID < n);
+            BOOST_CHECK_SMALL(result->Dist - adcDists[result->VID], 1e-3f * (adcDists[result->VID] + 1.0f));
+            if (adcDists[result->VID] <= kthDist + 1e-3f * (kthDist + 1.0f)) found++;
+        }
+    }
+    BOOST_CHECK_GE(found, 50 * k * 9 / 10);
+
+    vecIndex.reset();
+    RemoveFolder(FastScanIndexFolder);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
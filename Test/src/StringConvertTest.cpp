@@ -117,6 +117,8 @@ BOOST_AUTO_TEST_CASE(ConvertVectorValueType)
     Local::TestConvertSuccCase<SPTAG::VectorValueType>(SPTAG::VectorValueType::Float, "Float");
     Local::TestConvertSuccCase<SPTAG::VectorValueType>(SPTAG::VectorValueType::Int8, "Int8");
     Local::TestConvertSuccCase<SPTAG::VectorValueType>(SPTAG::VectorValueType::Int16, "Int16");
+    Local::TestConvertSuccCase<SPTAG::VectorValueType>(SPTAG::VectorValueType::Float16, "Float16");
+    Local::TestConvertSuccCase<SPTAG::VectorValueType>(SPTAG::VectorValueType::BFloat16, "BFloat16");
 }
 
 BOOST_AUTO_TEST_CASE(ConvertDistCalcMethod)
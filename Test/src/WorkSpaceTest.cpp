@@ -0,0 +1,138 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/Common/WorkSpacePool.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+    // Counts the live copies, to see which workspaces a pool's thread caches still hold.
+    struct CountedSpace
+    {
+        static std::atomic<int> s_live;
+
+        CountedSpace() { ++s_live; }
+        CountedSpace(const CountedSpace&) { ++s_live; }
+        ~CountedSpace() { --s_live; }
+
+        void Initialize() {}
+    };
+
+    std::atomic<int> CountedSpace::s_live(0);
+}
+
+BOOST_AUTO_TEST_SUITE(WorkSpaceTest)
+
+BOOST_AUTO_TEST_CASE(CheckAndSetTest)
+{
+    SPTAG::COMMON::WorkSpace space;
+    space.Initialize(1024, 2, 100);
+    space.Reset(1024, 10);
+
+    // Ids below the limit go to the epoch table, the rest to the hash table.
+    for (SPTAG::SizeType id : { 0, 5, 99, 100, 1000, 50 }) BOOST_CHECK(!space.CheckAndSet(id));
+    for (SPTAG::SizeType id : { 0, 5, 99, 100, 1000, 50 }) BOOST_CHECK(space.CheckAndSet(id));
+    BOOST_CHECK(!space.CheckAndSet(1));
+
+    space.Reset(1024, 10);
+    for (SPTAG::SizeType id : { 0, 5, 99, 100, 1000, 50, 1 }) BOOST_CHECK(!space.CheckAndSet(id));
+
+    // A full cycle of the epoch counter comes back to the epoch that marked 7, so the mark must have been
+    // wiped on the wrap around.
+    space.Reset(1024, 10);
+    space.CheckAndSet(7);
+    for (int i = 0; i < 65535; i++) space.Reset(1024, 10);
+    BOOST_CHECK(!space.CheckAndSet(7));
+    BOOST_CHECK(space.CheckAndSet(7));
+
+    SPTAG::COMMON::WorkSpace copy(space);
+    copy.Reset(1024, 10);
+    BOOST_CHECK(!copy.CheckAndSet(7));
+    BOOST_CHECK(copy.CheckAndSet(7));
+}
+
+BOOST_AUTO_TEST_CASE(WorkSpacePoolTest)
+{
+    SPTAG::COMMON::WorkSpacePool<SPTAG::COMMON::WorkSpace> pool;
+    pool.Init(2, 1024, 2, (SPTAG::SizeType)100);
+
+    // A returned workspace stays with the thread that returned it.
+    auto first = pool.Rent();
+    SPTAG::COMMON::WorkSpace* cached = first.get();
+    pool.Return(std::move(first));
+    auto again = pool.Rent();
+    BOOST_CHECK(again.get() == cached);
+
+    auto nested = pool.Rent();
+    BOOST_CHECK(nested.get() != cached);
+    pool.Return(std::move(nested));
+    pool.Return(std::move(again));
+
+    SPTAG::COMMON::WorkSpace* other = nullptr;
+    std::thread worker([&]() { auto space = pool.Rent(); other = space.get(); pool.Return(std::move(space)); });
+    worker.join();
+    BOOST_CHECK(other != cached);
+
+    // A new Init must not hand out workspaces sized for the old one.
+    pool.Init(2, 4096, 3, (SPTAG::SizeType)100);
+    auto resized = pool.Rent();
+    BOOST_CHECK(resized->m_iMaxCheck == 4096);
+    BOOST_CHECK(resized->HashTableExponent() == 3);
+    pool.Return(std::move(resized));
+
+    // A thread never holds more than c_threadCacheSize workspaces; the rest go back to the shared queue.
+    std::vector<std::unique_ptr<SPTAG::COMMON::WorkSpace>> spaces;
+    for (int i = 0; i < 2 * SPTAG::COMMON::WorkSpacePool<SPTAG::COMMON::WorkSpace>::c_threadCacheSize; i++) spaces.push_back(pool.Rent());
+    for (auto& space : spaces) pool.Return(std::move(space));
+    for (auto& space : spaces) space = pool.Rent();
+    for (auto& space : spaces) BOOST_CHECK(space != nullptr && space->m_iMaxCheck == 4096);
+    for (auto& space : spaces) pool.Return(std::move(space));
+}
+
+BOOST_AUTO_TEST_CASE(WorkSpacePoolRetireTest)
+{
+    typedef SPTAG::COMMON::WorkSpacePool<CountedSpace> Pool;
+    int baseline = CountedSpace::s_live;
+    {
+        Pool dropped;
+        dropped.Init(0);
+        auto space = dropped.Rent();
+        dropped.Return(std::move(space));
+        BOOST_CHECK(CountedSpace::s_live == baseline + 2);
+    }
+    // The destroyed pool's workspace is still cached until the next Rent of this thread frees it.
+    BOOST_CHECK(CountedSpace::s_live == baseline + 1);
+
+    Pool pool;
+    pool.Init(0);
+    auto space = pool.Rent();
+    BOOST_CHECK(CountedSpace::s_live == baseline + 2);
+
+    // Another Init retires the cached workspace as well, and the rent after it gets a new one.
+    pool.Return(std::move(space));
+    pool.Init(0);
+    BOOST_CHECK(CountedSpace::s_live == baseline + 2);
+    space = pool.Rent();
+    BOOST_CHECK(CountedSpace::s_live == baseline + 2);
+    pool.Return(std::move(space));
+
+    // Whatever the mix of pools, a thread caches at most c_threadCacheSize workspaces: once the other pools
+    // are gone, only the slots they filled, besides the one of pool, still hold workspaces.
+    {
+        Pool others[2 * Pool::c_threadCacheSize];
+        for (auto& other : others)
+        {
+            other.Init(0);
+            other.Return(other.Rent());
+        }
+    }
+    BOOST_CHECK(CountedSpace::s_live == baseline + 1 + Pool::c_threadCacheSize);
+    space = pool.Rent();
+    pool.Return(std::move(space));
+    BOOST_CHECK(CountedSpace::s_live == baseline + 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()